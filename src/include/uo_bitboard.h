@@ -53,8 +53,8 @@ extern "C"
 #define uo_bitboard_diagonal_a1_h8 ((uo_bitboard)0x8040201008040201ull)
 #define uo_bitboard_antidiagonal_h1_a8 ((uo_bitboard)0x0102040810204080ull)
 
-#define uo_bitboard__light_squares = ((uo_bitboard)0x55AA55AA55AA55AAull);
-#define uo_bitboard__dark_squares = ((uo_bitboard)0xAA55AA55AA55AA55ull);
+#define uo_bitboard__light_squares ((uo_bitboard)0x55AA55AA55AA55AAull)
+#define uo_bitboard__dark_squares ((uo_bitboard)0xAA55AA55AA55AA55ull)
 
   extern uo_bitboard uo_bitboard_diagonal[15];     //  /
   extern uo_bitboard uo_bitboard_antidiagonal[15]; //  \
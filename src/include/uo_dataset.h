@@ -0,0 +1,126 @@
+#ifndef UO_DATASET_H
+#define UO_DATASET_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "uo_position.h"
+#include "uo_misc.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+  // Training data record of a position. Board, score and result are from the point of view of the side to move,
+  // i.e. the board is stored as in uo_position and flags tell which color is to move.
+  typedef struct uo_dataset_record
+  {
+    uo_bitboard occupied;
+    uint8_t pieces[16]; // pieces of occupied squares in square order, four bits each starting from the low bits
+    uo_position_flags flags;
+    int16_t score;      // centipawns or +-uo_score_checkmate for a forced mate
+    uint16_t ply;       // game ply
+    int8_t result;      // 1 win, 0 draw, -1 loss or uo_dataset_result_unknown
+    uint8_t reserved;
+  } uo_dataset_record;
+
+  static_assert(sizeof(uo_dataset_record) == 32, "Unexpected size: uo_dataset_record");
+
+#define uo_dataset_result_unknown INT8_MIN
+
+  // Binary dataset file: magic "UODS", version, record size and a reserved zero as little endian uint32 values followed
+  // by records until the end of the file. Records are appended without updating the header.
+#define UO_DATASET_FILE_MAGIC 0x53444F55
+#define UO_DATASET_FILE_VERSION 1
+
+  // Dataset files with this extension are written in binary format. Other dataset files are csv files of fen and score.
+#define UO_DATASET_FILE_EXTENSION ".bin"
+
+  static inline bool uo_dataset_filepath_is_binary(const char *filepath)
+  {
+    size_t len = strlen(filepath);
+    size_t ext_len = uo_strlen(UO_DATASET_FILE_EXTENSION);
+    return len >= ext_len && strcmp(filepath + len - ext_len, UO_DATASET_FILE_EXTENSION) == 0;
+  }
+
+  // Returns false if the position has more than 32 pieces, which do not fit in the record
+  bool uo_dataset_record_pack(const uo_position *position, int16_t score, int8_t result, uo_dataset_record *record);
+
+  // Squares of a piece. Piece codes equal to the piece are found with nibble-wise comparison, and their indexes are
+  // deposited to the occupied squares, so squares are decoded without looping over the pieces.
+  static inline uo_bitboard uo_dataset_record_piece_squares(const uint64_t codes[2], uo_bitboard occupied, uo_piece piece)
+  {
+    const uint64_t nibbles = 0x1111111111111111;
+
+    // Low bit of each nibble is cleared if the nibble is equal to the piece
+    uint64_t lo = codes[0] ^ (nibbles * piece);
+    uint64_t hi = codes[1] ^ (nibbles * piece);
+    lo |= lo >> 2;
+    lo |= lo >> 1;
+    hi |= hi >> 2;
+    hi |= hi >> 1;
+
+    uint64_t matches = ~(uo_pext(lo, nibbles) | (uo_pext(hi, nibbles) << 16));
+    return uo_pdep(matches, occupied);
+  }
+
+  // Decodes the board and flags of a record. Use uo_position_unpack to load the packed position.
+  static inline void uo_dataset_record_unpack(const uo_dataset_record *record, uo_position_packed *packed)
+  {
+    uint64_t codes[2];
+    memcpy(codes, record->pieces, sizeof codes);
+
+    packed->flags = record->flags;
+    packed->bitboards[uo_color_own] = 0;
+    packed->bitboards[uo_color_enemy] = 0;
+
+    for (uo_piece piece = uo_piece__P; piece <= uo_piece__K; piece += 2)
+    {
+      uo_bitboard own = uo_dataset_record_piece_squares(codes, record->occupied, piece);
+      uo_bitboard enemy = uo_dataset_record_piece_squares(codes, record->occupied, piece + 1);
+      packed->bitboards[1 + (piece >> 1)] = own | enemy;
+      packed->bitboards[uo_color_own] |= own;
+      packed->bitboards[uo_color_enemy] |= enemy;
+    }
+  }
+
+  // Parses a csv line of fen and score from white's point of view, e.g. "<fen>,+25" or "<fen>,#-3" for a forced mate,
+  // optionally followed by game result from white's point of view, e.g. "<fen>,+25,1". Position is used for parsing the fen.
+  // Returns false if the line cannot be parsed or if the position does not fit in a record.
+  bool uo_dataset_record_parse_csv(uo_position *position, char *line, uo_dataset_record *record);
+
+  // Prints a record as a csv line of fen, score and game result if known, all from white's point of view.
+  // Returns the number of characters written.
+  size_t uo_dataset_record_print_csv(uo_position *position, const uo_dataset_record *record, char line[0x100]);
+
+  // Opens a binary dataset file for appending records. Header is written if the file is empty.
+  FILE *uo_dataset_open_append(const char *filepath);
+
+  // Creates or overwrites a binary dataset file and writes the header
+  FILE *uo_dataset_open_write(const char *filepath);
+
+  // Binary dataset mapped into memory. Records are read directly from the mapped file.
+  typedef struct uo_dataset
+  {
+    uo_file_mmap *file_mmap;
+    const uo_dataset_record *records;
+    size_t count;
+  } uo_dataset;
+
+  // Returns null if the file does not exist or is not a binary dataset file
+  uo_dataset *uo_dataset_open_read(const char *filepath);
+
+  void uo_dataset_close(uo_dataset *dataset);
+
+  // Converts a csv dataset into a binary dataset or a binary dataset into a csv dataset. Output file is overwritten.
+  // Returns the number of converted positions.
+  size_t uo_dataset_convert(const char *input_filepath, const char *output_filepath);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
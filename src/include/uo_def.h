@@ -11,6 +11,7 @@ extern "C"
 #define UO_MAX_PLY 128
 #define UO_BRANCING_FACTOR 60
 #define UO_PV_MAX_LENGTH 32
+#define UO_MAX_MOVE_COUNT 256
 
 #define UO_PARALLEL_MIN_DEPTH 9
 #define UO_PARALLEL_MAX_COUNT 4
@@ -26,6 +26,7 @@ extern "C"
     size_t threads;
     uint16_t multipv;
     size_t hash_size;
+    size_t eval_hash_size;
     size_t move_overhead;
     bool debug;
     bool use_own_book;
@@ -34,6 +35,7 @@ extern "C"
     char nn_dir[0x100];
     char test_data_dir[0x100];
     char dataset_dir[0x100];
+    uo_search_parameters search_parameters;
     struct
     {
       struct
@@ -70,15 +72,25 @@ extern "C"
     uo_atomic_flag busy;
     uo_atomic_int cutoff;
     int nmp_min_ply;
+    const uo_search_parameters *search_parameters; // engine options unless overridden, e.g. when tuning
+    uo_ttable *ttable; // engine transposition table unless overridden, e.g. when tuning
     uo_move_cache move_cache[0x1000];
-    uo_move pv[UO_MAX_PLY];
+    uo_pawn_hash pawn_hash;
+    uo_material_hash material_hash;
+    uo_eval_hash eval_hash;
+    // Triangular principal variation table. Row of each ply holds the null terminated line from that ply onwards.
+    uo_move pv_table[UO_MAX_PLY + 1][UO_MAX_PLY + 1];
+    uint8_t pv_length[UO_MAX_PLY + 1];
     uo_move **secondary_pvs;
+    uo_root_move root_moves[UO_MAX_MOVE_COUNT];
   } uo_engine_thread;
 
   typedef struct uo_engine
   {
     uo_tb tb;
     uo_ttable ttable;
+    uo_eval_hash eval_hash;
+    char eval_filename[0x100]; // loaded evaluation file, either a network or evaluation parameters
     uo_book *book;
     uo_engine_thread *threads;
     size_t thread_count;
@@ -88,6 +100,7 @@ extern "C"
     uo_mutex *position_mutex;
     uo_position position;
     uo_search_params search_params;
+    uo_move searchmoves[UO_MAX_MOVE_COUNT];
     struct
     {
       uint64_t key;
@@ -96,7 +109,7 @@ extern "C"
       bool is_continuation;
       bool is_ponderhit;
     } ponder;
-    uo_move pv[UO_MAX_PLY];
+    uo_move pv[UO_MAX_PLY + 1];
     uo_move **secondary_pvs;
     volatile uo_atomic_int stopped;
     bool exit;
@@ -161,11 +174,11 @@ extern "C"
     int16_t beta_initial;
   } uo_abtentry;
 
-  static inline void uo_engine_prefetch_entry(uint64_t key)
+  static inline void uo_engine_prefetch_entry(uo_ttable *ttable, uint64_t key)
   {
-    uint64_t mask = engine.ttable.hash_mask;
+    uint64_t mask = ttable->hash_mask;
     uint64_t hash = key & mask;
-    uo_tentry *entry = engine.ttable.entries + hash;
+    uo_tentry *entry = ttable->entries + hash;
     uo_prefetch(entry);
   }
 
@@ -175,7 +188,7 @@ extern "C"
   // Returns false if no entry was found or the score is not valid.
   // If an entry was found, the abtentry.data contains the values which were stored in the transposition table
   // even in the case that the score is not valid given search depth and alpha/beta values.
-  static inline bool uo_engine_lookup_entry(uo_position *position, uo_abtentry *abtentry)
+  static inline bool uo_engine_lookup_entry(uo_ttable *ttable, uo_position *position, uo_abtentry *abtentry)
   {
     // Step 1. Save initial alpha-beta boundaries
     abtentry->alpha_initial = *abtentry->alpha;
@@ -200,7 +213,7 @@ extern "C"
     }
 
     // Step 3. Probe transposition table
-    bool found = uo_ttable_get(&engine.ttable, position->key, position->root_ply, &abtentry->data);
+    bool found = uo_ttable_get(ttable, position->key, position->root_ply, &abtentry->data);
 
     // Step 4. Return if no match was found
     if (!found) return false;
@@ -262,7 +275,7 @@ extern "C"
   }
 
   // Stores an entry to the transposition table and return final score.
-  static inline int16_t uo_engine_store_entry(const uo_position *position, uo_abtentry *abtentry)
+  static inline int16_t uo_engine_store_entry(uo_ttable *ttable, const uo_position *position, uo_abtentry *abtentry)
   {
     int16_t value = abtentry->value;
 
@@ -293,7 +306,7 @@ extern "C"
         value <= abtentry->alpha_initial ? uo_score_type__upper_bound :
         uo_score_type__exact;
 
-      uo_ttable_set(&engine.ttable, position->key, position->root_ply, &abtentry->data);
+      uo_ttable_set(ttable, position->key, position->root_ply, &abtentry->data);
     }
 
     return value;
@@ -311,7 +324,9 @@ extern "C"
 
   static inline bool uo_engine_thread_is_stopped(uo_engine_thread *thread)
   {
-    return uo_engine_is_stopped() || (thread->owner && uo_atomic_load(&thread->cutoff));
+    return uo_engine_is_stopped()
+      || (thread->owner && uo_atomic_load(&thread->cutoff))
+      || (thread->info.nodes_limit && thread->info.nodes >= thread->info.nodes_limit);
   }
 
   void uo_engine_start_search(void);
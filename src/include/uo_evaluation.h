@@ -13,6 +13,15 @@ extern "C"
 
 #include <math.h>
 #include <stdbool.h>
+#include <string.h>
+
+#ifdef UO_EVALUATION_TRACE_CYCLES
+# ifdef WIN32
+#  include <intrin.h>
+# else
+#  include <x86intrin.h>
+# endif
+#endif
 
 #define uo_score_centipawn_to_win_prob(cp) (atanf(cp / 290.680623072f) / 3.096181612f + 0.5f)
 #define uo_score_centipawn_to_q_score(cp) (atanf(cp / 111.714640912f) / 1.5620688421f)
@@ -116,303 +125,162 @@ extern "C"
     return (float)score * ln;
   }
 
-  // side to move
-#define uo_score_tempo 23
+  // Evaluation parameters as compile time constants
+  enum uo_evaluation_parameter_value
+  {
+#define uo_evaluation_parameter(name, value) name = value,
+#include "uo_evaluation_parameters.h"
+#undef uo_evaluation_parameter
+  };
 
-  // mobility
+  // Evaluation parameters for parameterised evaluation. All fields are int16_t, so parameters can also be accessed as an array.
+  typedef struct uo_evaluation_parameters
+  {
+#define uo_evaluation_parameter(name, value) int16_t name;
+#include "uo_evaluation_parameters.h"
+#undef uo_evaluation_parameter
+  } uo_evaluation_parameters;
 
-#define uo_score_mobility_P 18
-#define uo_score_zero_mobility_P -5
+#define uo_evaluation_parameter_count (sizeof(uo_evaluation_parameters) / sizeof(int16_t))
 
-#define uo_score_zero_mobility_K -54
+  extern const uo_evaluation_parameters uo_evaluation_parameters_default;
+  extern const char *const uo_evaluation_parameter_names[];
 
-  extern const int16_t score_mobility_N[9];
-#define score_mobility_N_0 -44
-#define score_mobility_N_1 -25
-#define score_mobility_N_2 -12
-#define score_mobility_N_3  -2
-#define score_mobility_N_4   7
-#define score_mobility_N_5  14
-#define score_mobility_N_6  21
-#define score_mobility_N_7  27
-#define score_mobility_N_8  29
+  // Parameters used by evaluation instead of the compile time constants. Set when a parameter file is loaded as EvalFile.
+  extern uo_evaluation_parameters *uo_evaluation_parameters_active;
 
-  extern const int16_t score_mobility_B[14];
-#define score_mobility_B_0 -31
-#define score_mobility_B_1 -24
-#define score_mobility_B_2 -14
-#define score_mobility_B_3  -8
-#define score_mobility_B_4  -3
-#define score_mobility_B_5   1
-#define score_mobility_B_6   5
-#define score_mobility_B_7   5
-#define score_mobility_B_8   7
-#define score_mobility_B_9   7
-#define score_mobility_B_10 10
-#define score_mobility_B_11 12
-#define score_mobility_B_12 15
-#define score_mobility_B_13 15
+  // Parameters for evaluation or null if the compile time constants are used. Building with UO_EVALUATION_PARAMETERS_RUNTIME
+  // defined selects parameterised evaluation also when a parameter file is not loaded.
+  static inline const uo_evaluation_parameters *uo_evaluation_parameters_current(void)
+  {
+#ifdef UO_EVALUATION_PARAMETERS_RUNTIME
+    return uo_evaluation_parameters_active ? uo_evaluation_parameters_active : &uo_evaluation_parameters_default;
+#else
+    return uo_evaluation_parameters_active;
+#endif
+  }
 
-  extern const int16_t score_mobility_R[15];
-#define score_mobility_R_0 -19
-#define score_mobility_R_1  -2
-#define score_mobility_R_2  -1
-#define score_mobility_R_3   5
-#define score_mobility_R_4   7
-#define score_mobility_R_5  15
-#define score_mobility_R_6  19
-#define score_mobility_R_7  25
-#define score_mobility_R_8  30
-#define score_mobility_R_9  35
-#define score_mobility_R_10 38
-#define score_mobility_R_11 40
-#define score_mobility_R_12 42
-#define score_mobility_R_13 42
-#define score_mobility_R_14 42
+  // Value of a parameter. Without parameters, the value is the compile time constant. Evaluation functions are inlined
+  // with a constant null pointer in the production path, so the conditional is resolved at compile time.
+#define uo_evaluation_parameter_value(parameters, name) ((parameters) ? (parameters)->name : (name))
 
-  extern const int16_t score_mobility_Q[28];
-#define score_mobility_Q_0   9
-#define score_mobility_Q_1  14
-#define score_mobility_Q_2  14
-#define score_mobility_Q_3  14
-#define score_mobility_Q_4  16
-#define score_mobility_Q_5  18
-#define score_mobility_Q_6  21
-#define score_mobility_Q_7  23
-#define score_mobility_Q_8  25
-#define score_mobility_Q_9  26
-#define score_mobility_Q_10 28
-#define score_mobility_Q_11 29
-#define score_mobility_Q_12 30
-#define score_mobility_Q_13 31
-#define score_mobility_Q_14 32
-#define score_mobility_Q_15 33
-#define score_mobility_Q_16 36
-#define score_mobility_Q_17 36
-#define score_mobility_Q_18 37
-#define score_mobility_Q_19 39
-#define score_mobility_Q_20 43
-#define score_mobility_Q_21 43
-#define score_mobility_Q_22 43
-#define score_mobility_Q_23 43
-#define score_mobility_Q_24 43
-#define score_mobility_Q_25 43
-#define score_mobility_Q_26 43
-#define score_mobility_Q_27 43
-
-  // pawns
-#define uo_score_supported_P 5
-#define uo_score_isolated_P -12
-
-#define uo_score_passed_pawn_on_fifth 20
-#define uo_score_passed_pawn_on_sixth 67
-
-  // piece development
-#define uo_score_rook_stuck_in_corner -34
+  // Value of a table entry. Table entries are consecutive fields named with a running index suffix starting from zero.
+#define uo_evaluation_parameter_table(parameters, table, index) ((parameters) ? (&(parameters)->table##_0)[index] : table[index])
 
-  // attacked and defended pieces
+  // Binary parameter file: magic "UOEP", version and parameter count as little endian uint32 values followed by the
+  // parameters in the order of the description as little endian int16 values
+#define UO_EVALUATION_PARAMETERS_FILE_MAGIC 0x50454F55
+#define UO_EVALUATION_PARAMETERS_FILE_VERSION 1
 
-  extern const int16_t score_piece_attacked_by_enemy[];
-#define uo_score_P_attacked_by_enemy_P -5
-#define uo_score_P_attacked_by_enemy_N -5
-#define uo_score_P_attacked_by_enemy_B -5
-#define uo_score_P_attacked_by_enemy_R -5
-#define uo_score_P_attacked_by_enemy_Q -5
-#define uo_score_P_attacked_by_enemy_K -5
-
-#define uo_score_N_attacked_by_enemy_P -5
-#define uo_score_N_attacked_by_enemy_N -5
-#define uo_score_N_attacked_by_enemy_B -5
-#define uo_score_N_attacked_by_enemy_R -5
-#define uo_score_N_attacked_by_enemy_Q -5
-#define uo_score_N_attacked_by_enemy_K -5
-
-#define uo_score_B_attacked_by_enemy_P -5
-#define uo_score_B_attacked_by_enemy_N -5
-#define uo_score_B_attacked_by_enemy_B -5
-#define uo_score_B_attacked_by_enemy_R -5
-#define uo_score_B_attacked_by_enemy_Q -5
-#define uo_score_B_attacked_by_enemy_K -5
-
-#define uo_score_R_attacked_by_enemy_P -5
-#define uo_score_R_attacked_by_enemy_N -5
-#define uo_score_R_attacked_by_enemy_B -5
-#define uo_score_R_attacked_by_enemy_R -5
-#define uo_score_R_attacked_by_enemy_Q -5
-#define uo_score_R_attacked_by_enemy_K -5
-
-#define uo_score_Q_attacked_by_enemy_P -5
-#define uo_score_Q_attacked_by_enemy_N -5
-#define uo_score_Q_attacked_by_enemy_B -5
-#define uo_score_Q_attacked_by_enemy_R -5
-#define uo_score_Q_attacked_by_enemy_Q -5
-#define uo_score_Q_attacked_by_enemy_K -5
+  uo_evaluation_parameters *uo_evaluation_parameters_create(const char *filepath);
 
+  void uo_evaluation_parameters_free(uo_evaluation_parameters *parameters);
 
+  bool uo_evaluation_parameters_save(const uo_evaluation_parameters *parameters, const char *filepath);
 
-  extern const int16_t score_piece_defended_by[];
-#define uo_score_P_defended_by_P 5
-#define uo_score_P_defended_by_N 5
-#define uo_score_P_defended_by_B 5
-#define uo_score_P_defended_by_R 5
-#define uo_score_P_defended_by_Q 5
-#define uo_score_P_defended_by_K 5
-
-#define uo_score_N_defended_by_P 5
-#define uo_score_N_defended_by_N 5
-#define uo_score_N_defended_by_B 5
-#define uo_score_N_defended_by_R 5
-#define uo_score_N_defended_by_Q 5
-#define uo_score_N_defended_by_K 5
-
-#define uo_score_B_defended_by_P 5
-#define uo_score_B_defended_by_N 5
-#define uo_score_B_defended_by_B 5
-#define uo_score_B_defended_by_R 5
-#define uo_score_B_defended_by_Q 5
-#define uo_score_B_defended_by_K 5
-
-#define uo_score_R_defended_by_P 5
-#define uo_score_R_defended_by_N 5
-#define uo_score_R_defended_by_B 5
-#define uo_score_R_defended_by_R 5
-#define uo_score_R_defended_by_Q 5
-#define uo_score_R_defended_by_K 5
-
-#define uo_score_Q_defended_by_P 5
-#define uo_score_Q_defended_by_N 5
-#define uo_score_Q_defended_by_B 5
-#define uo_score_Q_defended_by_R 5
-#define uo_score_Q_defended_by_Q 5
-#define uo_score_Q_defended_by_K 5
+  // Terms of hand crafted evaluation in the order they are evaluated
+  typedef enum uo_evaluation_term
+  {
+    uo_evaluation_term_tempo,
+    uo_evaluation_term_attacks, // piece bitboards and attack maps used by the other terms, no score
+    uo_evaluation_term_material,
+    uo_evaluation_term_pawn_structure,
+    uo_evaluation_term_mobility_P,
+    uo_evaluation_term_mobility_N, // piece mobility terms include counting of attack units
+    uo_evaluation_term_mobility_B,
+    uo_evaluation_term_mobility_R,
+    uo_evaluation_term_mobility_Q,
+    uo_evaluation_term_king_attacks,
+    uo_evaluation_term_king_safety,
+    uo_evaluation_term_pawn_squares,
+    uo_evaluation_term_castling,
+    uo_evaluation_term_king_placement,
+    uo_evaluation_term_count
+  } uo_evaluation_term;
+
+  extern const char *const uo_evaluation_term_names[uo_evaluation_term_count];
+
+  // Contributions of evaluation terms from the point of view of the side to move. Cycle counts are collected only
+  // when built with UO_EVALUATION_TRACE_CYCLES defined.
+  typedef struct uo_evaluation_trace
+  {
+    int32_t mg[uo_evaluation_term_count];
+    int32_t eg[uo_evaluation_term_count];
+    uint64_t cycles[uo_evaluation_term_count];
+    int32_t phase;
+    int16_t score_unscaled;
+    int16_t score;
+
+    // totals and time stamp counter at previous term
+    int32_t score_prev;
+    int32_t score_mg_prev;
+    int32_t score_eg_prev;
+    uint64_t tsc_prev;
+  } uo_evaluation_trace;
+
+#ifdef UO_EVALUATION_TRACE_CYCLES
+# define uo_evaluation_trace_tsc() __rdtsc()
+#else
+# define uo_evaluation_trace_tsc() 0
+#endif
 
+  static inline void uo_evaluation_trace_begin(uo_evaluation_trace *trace)
+  {
+    if (!trace) return;
 
-  // attacks near king
-  // see: https://www.chessprogramming.org/King_Safety#Attack_Units
-#define uo_attack_unit_N 2
-#define uo_attack_unit_B 2
-#define uo_attack_unit_R 3
-#define uo_attack_unit_Q 5
-#define uo_attack_unit_supported_contact_R 2
-#define uo_attack_unit_supported_contact_Q 6
-
-  // king safety and castling
-#define uo_score_casting_right 10
-#define uo_score_king_in_the_center -5
-#define uo_score_castled_king 13
-#define uo_score_king_cover_pawn 8
+    memset(trace, 0, sizeof * trace);
+    trace->tsc_prev = uo_evaluation_trace_tsc();
+  }
 
+  // Records the change of the score totals and the elapsed cycles since the previous term. Terms added to the common
+  // score contribute equally to middle game and endgame.
+  static inline void uo_evaluation_trace_term(uo_evaluation_trace *trace, uo_evaluation_term term, int32_t score, int32_t score_mg, int32_t score_eg)
+  {
+    if (!trace) return;
+
+    uint64_t tsc = uo_evaluation_trace_tsc();
+    trace->cycles[term] += tsc - trace->tsc_prev;
+
+    int32_t delta = score - trace->score_prev;
+    trace->mg[term] += delta + score_mg - trace->score_mg_prev;
+    trace->eg[term] += delta + score_eg - trace->score_eg_prev;
+
+    trace->score_prev = score;
+    trace->score_mg_prev = score_mg;
+    trace->score_eg_prev = score_eg;
+    trace->tsc_prev = uo_evaluation_trace_tsc();
+  }
+
+  // mobility
+  extern const int16_t score_mobility_N[9];
+  extern const int16_t score_mobility_B[14];
+  extern const int16_t score_mobility_R[15];
+  extern const int16_t score_mobility_Q[28];
+
+  // lazy evaluation is used if its score is by margin outside of the search window
+#define uo_score_lazy_eval_margin 200
+
+  // specialised endgames
+#define uo_score_endgame_known_win 5000
+#define uo_score_endgame_push_to_edge 20
+#define uo_score_endgame_push_close 20
+#define uo_score_endgame_push_to_corner 40
+
+  // scale factors applied to the score of the side which is ahead
+#define uo_scale_factor_normal 64
+#define uo_scale_factor_opposite_B 32
+#define uo_scale_factor_draw 0
+
+  // attacked and defended pieces
+  extern const int16_t score_piece_attacked_by_enemy[];
+  extern const int16_t score_piece_defended_by[];
+
+  // attacks near king
   extern const int16_t score_attacks_to_K[100];
 
+  // pawn square scores
   extern const int16_t score_mg_P[56];
-#define score_mg_P_a2 -16
-#define score_mg_P_b2 -24
-#define score_mg_P_c2 -17
-#define score_mg_P_d2 -22
-#define score_mg_P_e2 -16
-#define score_mg_P_f2   6
-#define score_mg_P_g2   2
-#define score_mg_P_h2 -16
-
-#define score_mg_P_a3 -26
-#define score_mg_P_b3 -12
-#define score_mg_P_c3 -15
-#define score_mg_P_d3 -19
-#define score_mg_P_e3 -10
-#define score_mg_P_f3  -5
-#define score_mg_P_g3  10
-#define score_mg_P_h3  -9
-
-#define score_mg_P_a4 -17
-#define score_mg_P_b4 -14
-#define score_mg_P_c4  -3
-#define score_mg_P_d4   0
-#define score_mg_P_e4   3
-#define score_mg_P_f4  12
-#define score_mg_P_g4  -3
-#define score_mg_P_h4 -13
-
-#define score_mg_P_a5 -28
-#define score_mg_P_b5 -13
-#define score_mg_P_c5  -4
-#define score_mg_P_d5   2
-#define score_mg_P_e5  17
-#define score_mg_P_f5  16
-#define score_mg_P_g5   6
-#define score_mg_P_h5 -12
-
-#define score_mg_P_a6 -41
-#define score_mg_P_b6 -27
-#define score_mg_P_c6 -12
-#define score_mg_P_d6  -2
-#define score_mg_P_e6  -7
-#define score_mg_P_f6  58
-#define score_mg_P_g6  35
-#define score_mg_P_h6  -2
-
-#define score_mg_P_a7  30
-#define score_mg_P_b7  37
-#define score_mg_P_c7  37
-#define score_mg_P_d7  85
-#define score_mg_P_e7 114
-#define score_mg_P_f7  98
-#define score_mg_P_g7 -13
-#define score_mg_P_h7  41
-
   extern const int16_t score_eg_P[56];
-#define score_eg_P_a2   2
-#define score_eg_P_b2   7
-#define score_eg_P_c2  -4
-#define score_eg_P_d2   0
-#define score_eg_P_e2  34
-#define score_eg_P_f2  18
-#define score_eg_P_g2   7
-#define score_eg_P_h2   0
-
-#define score_eg_P_a3   7
-#define score_eg_P_b3   3
-#define score_eg_P_c3   4
-#define score_eg_P_d3  20
-#define score_eg_P_e3  20
-#define score_eg_P_f3  22
-#define score_eg_P_g3  17
-#define score_eg_P_h3   8
-
-#define score_eg_P_a4  23
-#define score_eg_P_b4  20
-#define score_eg_P_c4  10
-#define score_eg_P_d4   9
-#define score_eg_P_e4  10
-#define score_eg_P_f4  22
-#define score_eg_P_g4  29
-#define score_eg_P_h4  19
-
-#define score_eg_P_a5  48
-#define score_eg_P_b5  32
-#define score_eg_P_c5  22
-#define score_eg_P_d5   5
-#define score_eg_P_e5  16
-#define score_eg_P_f5  19
-#define score_eg_P_g5  35
-#define score_eg_P_h5  36
-
-#define score_eg_P_a6  80
-#define score_eg_P_b6  70
-#define score_eg_P_c6  36
-#define score_eg_P_d6  17
-#define score_eg_P_e6   3
-#define score_eg_P_f6   9
-#define score_eg_P_g6  21
-#define score_eg_P_h6  28
-
-#define score_eg_P_a7 227
-#define score_eg_P_b7 233
-#define score_eg_P_c7 228
-#define score_eg_P_d7 164
-#define score_eg_P_e7 117
-#define score_eg_P_f7 123
-#define score_eg_P_g7 139
-#define score_eg_P_h7 147
 
 
 #ifdef __cplusplus
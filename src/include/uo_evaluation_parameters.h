@@ -0,0 +1,394 @@
+// Hand crafted evaluation parameters. This file is the single description of the parameters and it is included
+// multiple times with different definitions of uo_evaluation_parameter(name, value), so it has no include guard.
+// Production evaluation uses the values as compile time constants and parameterised evaluation reads them from
+// uo_evaluation_parameters, which can be loaded from a binary parameter file.
+// Parameters with the same name and a running index suffix are tables and have to be listed in order.
+
+// side to move
+uo_evaluation_parameter(uo_score_tempo, 23)
+
+// mobility
+uo_evaluation_parameter(uo_score_mobility_P, 18)
+uo_evaluation_parameter(uo_score_zero_mobility_P, -5)
+uo_evaluation_parameter(uo_score_zero_mobility_K, -54)
+
+uo_evaluation_parameter(score_mobility_N_0, -44)
+uo_evaluation_parameter(score_mobility_N_1, -25)
+uo_evaluation_parameter(score_mobility_N_2, -12)
+uo_evaluation_parameter(score_mobility_N_3, -2)
+uo_evaluation_parameter(score_mobility_N_4, 7)
+uo_evaluation_parameter(score_mobility_N_5, 14)
+uo_evaluation_parameter(score_mobility_N_6, 21)
+uo_evaluation_parameter(score_mobility_N_7, 27)
+uo_evaluation_parameter(score_mobility_N_8, 29)
+
+uo_evaluation_parameter(score_mobility_B_0, -31)
+uo_evaluation_parameter(score_mobility_B_1, -24)
+uo_evaluation_parameter(score_mobility_B_2, -14)
+uo_evaluation_parameter(score_mobility_B_3, -8)
+uo_evaluation_parameter(score_mobility_B_4, -3)
+uo_evaluation_parameter(score_mobility_B_5, 1)
+uo_evaluation_parameter(score_mobility_B_6, 5)
+uo_evaluation_parameter(score_mobility_B_7, 5)
+uo_evaluation_parameter(score_mobility_B_8, 7)
+uo_evaluation_parameter(score_mobility_B_9, 7)
+uo_evaluation_parameter(score_mobility_B_10, 10)
+uo_evaluation_parameter(score_mobility_B_11, 12)
+uo_evaluation_parameter(score_mobility_B_12, 15)
+uo_evaluation_parameter(score_mobility_B_13, 15)
+
+uo_evaluation_parameter(score_mobility_R_0, -19)
+uo_evaluation_parameter(score_mobility_R_1, -2)
+uo_evaluation_parameter(score_mobility_R_2, -1)
+uo_evaluation_parameter(score_mobility_R_3, 5)
+uo_evaluation_parameter(score_mobility_R_4, 7)
+uo_evaluation_parameter(score_mobility_R_5, 15)
+uo_evaluation_parameter(score_mobility_R_6, 19)
+uo_evaluation_parameter(score_mobility_R_7, 25)
+uo_evaluation_parameter(score_mobility_R_8, 30)
+uo_evaluation_parameter(score_mobility_R_9, 35)
+uo_evaluation_parameter(score_mobility_R_10, 38)
+uo_evaluation_parameter(score_mobility_R_11, 40)
+uo_evaluation_parameter(score_mobility_R_12, 42)
+uo_evaluation_parameter(score_mobility_R_13, 42)
+uo_evaluation_parameter(score_mobility_R_14, 42)
+
+uo_evaluation_parameter(score_mobility_Q_0, 9)
+uo_evaluation_parameter(score_mobility_Q_1, 14)
+uo_evaluation_parameter(score_mobility_Q_2, 14)
+uo_evaluation_parameter(score_mobility_Q_3, 14)
+uo_evaluation_parameter(score_mobility_Q_4, 16)
+uo_evaluation_parameter(score_mobility_Q_5, 18)
+uo_evaluation_parameter(score_mobility_Q_6, 21)
+uo_evaluation_parameter(score_mobility_Q_7, 23)
+uo_evaluation_parameter(score_mobility_Q_8, 25)
+uo_evaluation_parameter(score_mobility_Q_9, 26)
+uo_evaluation_parameter(score_mobility_Q_10, 28)
+uo_evaluation_parameter(score_mobility_Q_11, 29)
+uo_evaluation_parameter(score_mobility_Q_12, 30)
+uo_evaluation_parameter(score_mobility_Q_13, 31)
+uo_evaluation_parameter(score_mobility_Q_14, 32)
+uo_evaluation_parameter(score_mobility_Q_15, 33)
+uo_evaluation_parameter(score_mobility_Q_16, 36)
+uo_evaluation_parameter(score_mobility_Q_17, 36)
+uo_evaluation_parameter(score_mobility_Q_18, 37)
+uo_evaluation_parameter(score_mobility_Q_19, 39)
+uo_evaluation_parameter(score_mobility_Q_20, 43)
+uo_evaluation_parameter(score_mobility_Q_21, 43)
+uo_evaluation_parameter(score_mobility_Q_22, 43)
+uo_evaluation_parameter(score_mobility_Q_23, 43)
+uo_evaluation_parameter(score_mobility_Q_24, 43)
+uo_evaluation_parameter(score_mobility_Q_25, 43)
+uo_evaluation_parameter(score_mobility_Q_26, 43)
+uo_evaluation_parameter(score_mobility_Q_27, 43)
+
+// pawns
+uo_evaluation_parameter(uo_score_supported_P, 5)
+uo_evaluation_parameter(uo_score_isolated_P, -12)
+
+uo_evaluation_parameter(uo_score_passed_pawn_on_fifth, 20)
+uo_evaluation_parameter(uo_score_passed_pawn_on_sixth, 67)
+
+// piece development
+uo_evaluation_parameter(uo_score_rook_stuck_in_corner, -34)
+
+// material imbalance
+uo_evaluation_parameter(uo_score_B_pair, 30)
+
+// attacked and defended pieces
+uo_evaluation_parameter(uo_score_P_attacked_by_enemy_P, -5)
+uo_evaluation_parameter(uo_score_P_attacked_by_enemy_N, -5)
+uo_evaluation_parameter(uo_score_P_attacked_by_enemy_B, -5)
+uo_evaluation_parameter(uo_score_P_attacked_by_enemy_R, -5)
+uo_evaluation_parameter(uo_score_P_attacked_by_enemy_Q, -5)
+uo_evaluation_parameter(uo_score_P_attacked_by_enemy_K, -5)
+
+uo_evaluation_parameter(uo_score_N_attacked_by_enemy_P, -5)
+uo_evaluation_parameter(uo_score_N_attacked_by_enemy_N, -5)
+uo_evaluation_parameter(uo_score_N_attacked_by_enemy_B, -5)
+uo_evaluation_parameter(uo_score_N_attacked_by_enemy_R, -5)
+uo_evaluation_parameter(uo_score_N_attacked_by_enemy_Q, -5)
+uo_evaluation_parameter(uo_score_N_attacked_by_enemy_K, -5)
+
+uo_evaluation_parameter(uo_score_B_attacked_by_enemy_P, -5)
+uo_evaluation_parameter(uo_score_B_attacked_by_enemy_N, -5)
+uo_evaluation_parameter(uo_score_B_attacked_by_enemy_B, -5)
+uo_evaluation_parameter(uo_score_B_attacked_by_enemy_R, -5)
+uo_evaluation_parameter(uo_score_B_attacked_by_enemy_Q, -5)
+uo_evaluation_parameter(uo_score_B_attacked_by_enemy_K, -5)
+
+uo_evaluation_parameter(uo_score_R_attacked_by_enemy_P, -5)
+uo_evaluation_parameter(uo_score_R_attacked_by_enemy_N, -5)
+uo_evaluation_parameter(uo_score_R_attacked_by_enemy_B, -5)
+uo_evaluation_parameter(uo_score_R_attacked_by_enemy_R, -5)
+uo_evaluation_parameter(uo_score_R_attacked_by_enemy_Q, -5)
+uo_evaluation_parameter(uo_score_R_attacked_by_enemy_K, -5)
+
+uo_evaluation_parameter(uo_score_Q_attacked_by_enemy_P, -5)
+uo_evaluation_parameter(uo_score_Q_attacked_by_enemy_N, -5)
+uo_evaluation_parameter(uo_score_Q_attacked_by_enemy_B, -5)
+uo_evaluation_parameter(uo_score_Q_attacked_by_enemy_R, -5)
+uo_evaluation_parameter(uo_score_Q_attacked_by_enemy_Q, -5)
+uo_evaluation_parameter(uo_score_Q_attacked_by_enemy_K, -5)
+
+uo_evaluation_parameter(uo_score_P_defended_by_P, 5)
+uo_evaluation_parameter(uo_score_P_defended_by_N, 5)
+uo_evaluation_parameter(uo_score_P_defended_by_B, 5)
+uo_evaluation_parameter(uo_score_P_defended_by_R, 5)
+uo_evaluation_parameter(uo_score_P_defended_by_Q, 5)
+uo_evaluation_parameter(uo_score_P_defended_by_K, 5)
+
+uo_evaluation_parameter(uo_score_N_defended_by_P, 5)
+uo_evaluation_parameter(uo_score_N_defended_by_N, 5)
+uo_evaluation_parameter(uo_score_N_defended_by_B, 5)
+uo_evaluation_parameter(uo_score_N_defended_by_R, 5)
+uo_evaluation_parameter(uo_score_N_defended_by_Q, 5)
+uo_evaluation_parameter(uo_score_N_defended_by_K, 5)
+
+uo_evaluation_parameter(uo_score_B_defended_by_P, 5)
+uo_evaluation_parameter(uo_score_B_defended_by_N, 5)
+uo_evaluation_parameter(uo_score_B_defended_by_B, 5)
+uo_evaluation_parameter(uo_score_B_defended_by_R, 5)
+uo_evaluation_parameter(uo_score_B_defended_by_Q, 5)
+uo_evaluation_parameter(uo_score_B_defended_by_K, 5)
+
+uo_evaluation_parameter(uo_score_R_defended_by_P, 5)
+uo_evaluation_parameter(uo_score_R_defended_by_N, 5)
+uo_evaluation_parameter(uo_score_R_defended_by_B, 5)
+uo_evaluation_parameter(uo_score_R_defended_by_R, 5)
+uo_evaluation_parameter(uo_score_R_defended_by_Q, 5)
+uo_evaluation_parameter(uo_score_R_defended_by_K, 5)
+
+uo_evaluation_parameter(uo_score_Q_defended_by_P, 5)
+uo_evaluation_parameter(uo_score_Q_defended_by_N, 5)
+uo_evaluation_parameter(uo_score_Q_defended_by_B, 5)
+uo_evaluation_parameter(uo_score_Q_defended_by_R, 5)
+uo_evaluation_parameter(uo_score_Q_defended_by_Q, 5)
+uo_evaluation_parameter(uo_score_Q_defended_by_K, 5)
+
+// attacks near king
+// see: https://www.chessprogramming.org/King_Safety#Attack_Units
+uo_evaluation_parameter(uo_attack_unit_N, 2)
+uo_evaluation_parameter(uo_attack_unit_B, 2)
+uo_evaluation_parameter(uo_attack_unit_R, 3)
+uo_evaluation_parameter(uo_attack_unit_Q, 5)
+uo_evaluation_parameter(uo_attack_unit_supported_contact_R, 2)
+uo_evaluation_parameter(uo_attack_unit_supported_contact_Q, 6)
+
+// king safety and castling
+uo_evaluation_parameter(uo_score_casting_right, 10)
+uo_evaluation_parameter(uo_score_king_in_the_center, -5)
+uo_evaluation_parameter(uo_score_castled_king, 13)
+uo_evaluation_parameter(uo_score_king_cover_pawn, 8)
+
+// score by attack units near king
+uo_evaluation_parameter(score_attacks_to_K_0, 0)
+uo_evaluation_parameter(score_attacks_to_K_1, 0)
+uo_evaluation_parameter(score_attacks_to_K_2, 0)
+uo_evaluation_parameter(score_attacks_to_K_3, 0)
+uo_evaluation_parameter(score_attacks_to_K_4, 0)
+uo_evaluation_parameter(score_attacks_to_K_5, 0)
+uo_evaluation_parameter(score_attacks_to_K_6, 0)
+uo_evaluation_parameter(score_attacks_to_K_7, 0)
+uo_evaluation_parameter(score_attacks_to_K_8, 0)
+uo_evaluation_parameter(score_attacks_to_K_9, 0)
+uo_evaluation_parameter(score_attacks_to_K_10, 0)
+uo_evaluation_parameter(score_attacks_to_K_11, 0)
+uo_evaluation_parameter(score_attacks_to_K_12, 3)
+uo_evaluation_parameter(score_attacks_to_K_13, 6)
+uo_evaluation_parameter(score_attacks_to_K_14, 10)
+uo_evaluation_parameter(score_attacks_to_K_15, 13)
+uo_evaluation_parameter(score_attacks_to_K_16, 16)
+uo_evaluation_parameter(score_attacks_to_K_17, 19)
+uo_evaluation_parameter(score_attacks_to_K_18, 22)
+uo_evaluation_parameter(score_attacks_to_K_19, 26)
+uo_evaluation_parameter(score_attacks_to_K_20, 29)
+uo_evaluation_parameter(score_attacks_to_K_21, 32)
+uo_evaluation_parameter(score_attacks_to_K_22, 35)
+uo_evaluation_parameter(score_attacks_to_K_23, 38)
+uo_evaluation_parameter(score_attacks_to_K_24, 42)
+uo_evaluation_parameter(score_attacks_to_K_25, 45)
+uo_evaluation_parameter(score_attacks_to_K_26, 48)
+uo_evaluation_parameter(score_attacks_to_K_27, 51)
+uo_evaluation_parameter(score_attacks_to_K_28, 55)
+uo_evaluation_parameter(score_attacks_to_K_29, 58)
+uo_evaluation_parameter(score_attacks_to_K_30, 61)
+uo_evaluation_parameter(score_attacks_to_K_31, 64)
+uo_evaluation_parameter(score_attacks_to_K_32, 67)
+uo_evaluation_parameter(score_attacks_to_K_33, 71)
+uo_evaluation_parameter(score_attacks_to_K_34, 74)
+uo_evaluation_parameter(score_attacks_to_K_35, 77)
+uo_evaluation_parameter(score_attacks_to_K_36, 80)
+uo_evaluation_parameter(score_attacks_to_K_37, 83)
+uo_evaluation_parameter(score_attacks_to_K_38, 87)
+uo_evaluation_parameter(score_attacks_to_K_39, 90)
+uo_evaluation_parameter(score_attacks_to_K_40, 93)
+uo_evaluation_parameter(score_attacks_to_K_41, 131)
+uo_evaluation_parameter(score_attacks_to_K_42, 168)
+uo_evaluation_parameter(score_attacks_to_K_43, 206)
+uo_evaluation_parameter(score_attacks_to_K_44, 243)
+uo_evaluation_parameter(score_attacks_to_K_45, 281)
+uo_evaluation_parameter(score_attacks_to_K_46, 318)
+uo_evaluation_parameter(score_attacks_to_K_47, 356)
+uo_evaluation_parameter(score_attacks_to_K_48, 393)
+uo_evaluation_parameter(score_attacks_to_K_49, 431)
+uo_evaluation_parameter(score_attacks_to_K_50, 468)
+uo_evaluation_parameter(score_attacks_to_K_51, 506)
+uo_evaluation_parameter(score_attacks_to_K_52, 543)
+uo_evaluation_parameter(score_attacks_to_K_53, 581)
+uo_evaluation_parameter(score_attacks_to_K_54, 618)
+uo_evaluation_parameter(score_attacks_to_K_55, 618)
+uo_evaluation_parameter(score_attacks_to_K_56, 618)
+uo_evaluation_parameter(score_attacks_to_K_57, 618)
+uo_evaluation_parameter(score_attacks_to_K_58, 618)
+uo_evaluation_parameter(score_attacks_to_K_59, 618)
+uo_evaluation_parameter(score_attacks_to_K_60, 618)
+uo_evaluation_parameter(score_attacks_to_K_61, 618)
+uo_evaluation_parameter(score_attacks_to_K_62, 618)
+uo_evaluation_parameter(score_attacks_to_K_63, 618)
+uo_evaluation_parameter(score_attacks_to_K_64, 618)
+uo_evaluation_parameter(score_attacks_to_K_65, 618)
+uo_evaluation_parameter(score_attacks_to_K_66, 618)
+uo_evaluation_parameter(score_attacks_to_K_67, 618)
+uo_evaluation_parameter(score_attacks_to_K_68, 618)
+uo_evaluation_parameter(score_attacks_to_K_69, 618)
+uo_evaluation_parameter(score_attacks_to_K_70, 618)
+uo_evaluation_parameter(score_attacks_to_K_71, 618)
+uo_evaluation_parameter(score_attacks_to_K_72, 618)
+uo_evaluation_parameter(score_attacks_to_K_73, 618)
+uo_evaluation_parameter(score_attacks_to_K_74, 618)
+uo_evaluation_parameter(score_attacks_to_K_75, 618)
+uo_evaluation_parameter(score_attacks_to_K_76, 618)
+uo_evaluation_parameter(score_attacks_to_K_77, 618)
+uo_evaluation_parameter(score_attacks_to_K_78, 618)
+uo_evaluation_parameter(score_attacks_to_K_79, 618)
+uo_evaluation_parameter(score_attacks_to_K_80, 618)
+uo_evaluation_parameter(score_attacks_to_K_81, 618)
+uo_evaluation_parameter(score_attacks_to_K_82, 618)
+uo_evaluation_parameter(score_attacks_to_K_83, 618)
+uo_evaluation_parameter(score_attacks_to_K_84, 618)
+uo_evaluation_parameter(score_attacks_to_K_85, 618)
+uo_evaluation_parameter(score_attacks_to_K_86, 618)
+uo_evaluation_parameter(score_attacks_to_K_87, 618)
+uo_evaluation_parameter(score_attacks_to_K_88, 618)
+uo_evaluation_parameter(score_attacks_to_K_89, 618)
+uo_evaluation_parameter(score_attacks_to_K_90, 618)
+uo_evaluation_parameter(score_attacks_to_K_91, 618)
+uo_evaluation_parameter(score_attacks_to_K_92, 618)
+uo_evaluation_parameter(score_attacks_to_K_93, 618)
+uo_evaluation_parameter(score_attacks_to_K_94, 618)
+uo_evaluation_parameter(score_attacks_to_K_95, 618)
+uo_evaluation_parameter(score_attacks_to_K_96, 618)
+uo_evaluation_parameter(score_attacks_to_K_97, 618)
+uo_evaluation_parameter(score_attacks_to_K_98, 618)
+uo_evaluation_parameter(score_attacks_to_K_99, 618)
+
+// pawn square scores for middle game
+uo_evaluation_parameter(score_mg_P_a2, -16)
+uo_evaluation_parameter(score_mg_P_b2, -24)
+uo_evaluation_parameter(score_mg_P_c2, -17)
+uo_evaluation_parameter(score_mg_P_d2, -22)
+uo_evaluation_parameter(score_mg_P_e2, -16)
+uo_evaluation_parameter(score_mg_P_f2, 6)
+uo_evaluation_parameter(score_mg_P_g2, 2)
+uo_evaluation_parameter(score_mg_P_h2, -16)
+
+uo_evaluation_parameter(score_mg_P_a3, -26)
+uo_evaluation_parameter(score_mg_P_b3, -12)
+uo_evaluation_parameter(score_mg_P_c3, -15)
+uo_evaluation_parameter(score_mg_P_d3, -19)
+uo_evaluation_parameter(score_mg_P_e3, -10)
+uo_evaluation_parameter(score_mg_P_f3, -5)
+uo_evaluation_parameter(score_mg_P_g3, 10)
+uo_evaluation_parameter(score_mg_P_h3, -9)
+
+uo_evaluation_parameter(score_mg_P_a4, -17)
+uo_evaluation_parameter(score_mg_P_b4, -14)
+uo_evaluation_parameter(score_mg_P_c4, -3)
+uo_evaluation_parameter(score_mg_P_d4, 0)
+uo_evaluation_parameter(score_mg_P_e4, 3)
+uo_evaluation_parameter(score_mg_P_f4, 12)
+uo_evaluation_parameter(score_mg_P_g4, -3)
+uo_evaluation_parameter(score_mg_P_h4, -13)
+
+uo_evaluation_parameter(score_mg_P_a5, -28)
+uo_evaluation_parameter(score_mg_P_b5, -13)
+uo_evaluation_parameter(score_mg_P_c5, -4)
+uo_evaluation_parameter(score_mg_P_d5, 2)
+uo_evaluation_parameter(score_mg_P_e5, 17)
+uo_evaluation_parameter(score_mg_P_f5, 16)
+uo_evaluation_parameter(score_mg_P_g5, 6)
+uo_evaluation_parameter(score_mg_P_h5, -12)
+
+uo_evaluation_parameter(score_mg_P_a6, -41)
+uo_evaluation_parameter(score_mg_P_b6, -27)
+uo_evaluation_parameter(score_mg_P_c6, -12)
+uo_evaluation_parameter(score_mg_P_d6, -2)
+uo_evaluation_parameter(score_mg_P_e6, -7)
+uo_evaluation_parameter(score_mg_P_f6, 58)
+uo_evaluation_parameter(score_mg_P_g6, 35)
+uo_evaluation_parameter(score_mg_P_h6, -2)
+
+uo_evaluation_parameter(score_mg_P_a7, 30)
+uo_evaluation_parameter(score_mg_P_b7, 37)
+uo_evaluation_parameter(score_mg_P_c7, 37)
+uo_evaluation_parameter(score_mg_P_d7, 85)
+uo_evaluation_parameter(score_mg_P_e7, 114)
+uo_evaluation_parameter(score_mg_P_f7, 98)
+uo_evaluation_parameter(score_mg_P_g7, -13)
+uo_evaluation_parameter(score_mg_P_h7, 41)
+
+// pawn square scores for endgame
+uo_evaluation_parameter(score_eg_P_a2, 2)
+uo_evaluation_parameter(score_eg_P_b2, 7)
+uo_evaluation_parameter(score_eg_P_c2, -4)
+uo_evaluation_parameter(score_eg_P_d2, 0)
+uo_evaluation_parameter(score_eg_P_e2, 34)
+uo_evaluation_parameter(score_eg_P_f2, 18)
+uo_evaluation_parameter(score_eg_P_g2, 7)
+uo_evaluation_parameter(score_eg_P_h2, 0)
+
+uo_evaluation_parameter(score_eg_P_a3, 7)
+uo_evaluation_parameter(score_eg_P_b3, 3)
+uo_evaluation_parameter(score_eg_P_c3, 4)
+uo_evaluation_parameter(score_eg_P_d3, 20)
+uo_evaluation_parameter(score_eg_P_e3, 20)
+uo_evaluation_parameter(score_eg_P_f3, 22)
+uo_evaluation_parameter(score_eg_P_g3, 17)
+uo_evaluation_parameter(score_eg_P_h3, 8)
+
+uo_evaluation_parameter(score_eg_P_a4, 23)
+uo_evaluation_parameter(score_eg_P_b4, 20)
+uo_evaluation_parameter(score_eg_P_c4, 10)
+uo_evaluation_parameter(score_eg_P_d4, 9)
+uo_evaluation_parameter(score_eg_P_e4, 10)
+uo_evaluation_parameter(score_eg_P_f4, 22)
+uo_evaluation_parameter(score_eg_P_g4, 29)
+uo_evaluation_parameter(score_eg_P_h4, 19)
+
+uo_evaluation_parameter(score_eg_P_a5, 48)
+uo_evaluation_parameter(score_eg_P_b5, 32)
+uo_evaluation_parameter(score_eg_P_c5, 22)
+uo_evaluation_parameter(score_eg_P_d5, 5)
+uo_evaluation_parameter(score_eg_P_e5, 16)
+uo_evaluation_parameter(score_eg_P_f5, 19)
+uo_evaluation_parameter(score_eg_P_g5, 35)
+uo_evaluation_parameter(score_eg_P_h5, 36)
+
+uo_evaluation_parameter(score_eg_P_a6, 80)
+uo_evaluation_parameter(score_eg_P_b6, 70)
+uo_evaluation_parameter(score_eg_P_c6, 36)
+uo_evaluation_parameter(score_eg_P_d6, 17)
+uo_evaluation_parameter(score_eg_P_e6, 3)
+uo_evaluation_parameter(score_eg_P_f6, 9)
+uo_evaluation_parameter(score_eg_P_g6, 21)
+uo_evaluation_parameter(score_eg_P_h6, 28)
+
+uo_evaluation_parameter(score_eg_P_a7, 227)
+uo_evaluation_parameter(score_eg_P_b7, 233)
+uo_evaluation_parameter(score_eg_P_c7, 228)
+uo_evaluation_parameter(score_eg_P_d7, 164)
+uo_evaluation_parameter(score_eg_P_e7, 117)
+uo_evaluation_parameter(score_eg_P_f7, 123)
+uo_evaluation_parameter(score_eg_P_g7, 139)
+uo_evaluation_parameter(score_eg_P_h7, 147)
@@ -0,0 +1,92 @@
+#ifndef UO_MATCH_H
+#define UO_MATCH_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <math.h>
+
+  typedef struct uo_match_options
+  {
+    char *engine_cmdlines[2];
+    char *openings_filepath;  // lines starting with a fen optionally followed by " pv " and moves, e.g. an opening book
+    size_t game_count;
+    size_t concurrency;       // number of games played at the same time
+    size_t random_plies;      // random moves played after the opening
+    double time_msec;         // base time of both sides
+    double inc_msec;          // increment per move
+    double time_margin_msec;  // time a move may exceed the clock before the game is lost on time
+    double elo0;              // SPRT null hypothesis
+    double elo1;              // SPRT alternative hypothesis
+    double alpha;             // SPRT false positive rate
+    double beta;              // SPRT false negative rate
+  } uo_match_options;
+
+#pragma region SPRT
+
+  static inline double uo_match_elo_to_score(double elo)
+  {
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+  }
+
+  static inline double uo_match_score_to_elo(double score)
+  {
+    score = fmax(1e-6, fmin(1.0 - 1e-6, score));
+    return 400.0 * log10(score / (1.0 - score));
+  }
+
+  // Mean and variance of the game score of the first engine. Results are losses, draws and wins of the first engine.
+  static inline void uo_match_score_stats(const size_t results[3], double *mean, double *var)
+  {
+    double n = results[0] + results[1] + results[2];
+    *mean = (results[2] + 0.5 * results[1]) / n;
+    *var = (results[2] * (1.0 - *mean) * (1.0 - *mean)
+      + results[1] * (0.5 - *mean) * (0.5 - *mean)
+      + results[0] * *mean * *mean) / n;
+  }
+
+  // Half width of the 95% confidence interval of the Elo difference
+  static inline double uo_match_elo_error(const size_t results[3])
+  {
+    double n = results[0] + results[1] + results[2];
+    double mean, var;
+    uo_match_score_stats(results, &mean, &var);
+
+    double margin = 1.96 * sqrt(var / n);
+    return (uo_match_score_to_elo(mean + margin) - uo_match_score_to_elo(mean - margin)) / 2.0;
+  }
+
+  // Log likelihood ratio of the hypotheses elo1 and elo0. Distribution of the game score is approximated as normal with
+  // the observed variance, which is the generalized SPRT used by common testing frameworks.
+  static inline double uo_match_llr(const size_t results[3], double elo0, double elo1)
+  {
+    double n = results[0] + results[1] + results[2];
+    if (n == 0) return 0.0;
+
+    double mean, var;
+    uo_match_score_stats(results, &mean, &var);
+    if (var == 0.0) return 0.0;
+
+    double s0 = uo_match_elo_to_score(elo0);
+    double s1 = uo_match_elo_to_score(elo1);
+
+    return n * (s1 - s0) * (2.0 * mean - s0 - s1) / (2.0 * var);
+  }
+
+#pragma endregion
+
+  // Plays a match between two UCI engines. Games are played in pairs from the same opening with colors swapped and
+  // several games are played at the same time. Engines are run as child processes whose output is read without blocking
+  // in a single event loop, which also enforces the time control. Result, Elo estimate and the log likelihood ratio of
+  // a sequential probability ratio test are reported after each game. Match stops early when the test is decided.
+  void uo_match_run(const uo_match_options *options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
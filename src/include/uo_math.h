@@ -11,7 +11,9 @@ extern "C"
 #include <immintrin.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <math.h>
 
 #define uo_avx_float __m256
 #define uo_floats_per_avx_float (sizeof(uo_avx_float) / sizeof(float))
@@ -309,53 +311,315 @@ extern "C"
     }
   }
 
+  // Register tile of the blocked matrix multiplication: rows of A times columns of B accumulated in twelve AVX registers
+#define uo_gemm_mr 6
+#define uo_gemm_nr 16
+
+  // Cache blocking: packed mc x kc block of A stays in L2 cache and packed kc x nc panel of B in L3 cache
+#define uo_gemm_mc 96
+#define uo_gemm_kc 256
+#define uo_gemm_nc 1024
+
+  // Blocked matrix multiplication C = alpha * op(A) * op(B) + beta * C, where op(X) is X, or its transpose if ta or tb is set.
+  // op(A) is m x k matrix and op(B) is k x n matrix. If beta is zero, C does not need to be initialized.
+  // see: https://en.wikipedia.org/wiki/Basic_Linear_Algebra_Subprograms#Level_3
+  void uo_gemm(bool ta, bool tb, size_t m, size_t n, size_t k,
+    float alpha,
+    const float *A, size_t lda,
+    const float *B, size_t ldb,
+    float beta,
+    float *C, size_t ldc);
+
+  // Same as uo_gemm, but blocks of C are computed in parallel on the engine threads. Must not be called from an engine thread.
+  void uo_gemm_parallel(bool ta, bool tb, size_t m, size_t n, size_t k,
+    float alpha,
+    const float *A, size_t lda,
+    const float *B, size_t ldb,
+    float beta,
+    float *C, size_t ldc);
+
   // C = AB, C is m x n matrix, k is "other" dimension
   static inline void uo_matmul_ps(const float *A, const float *B_t, float *C, size_t m, size_t n, size_t k, int offset_C, int offset_A, int offset_B)
   {
-    for (size_t i = 0; i < m; ++i)
+    // Matrix vector products are computed as dot products, because a register tile would be mostly padding
+    if (n < uo_gemm_nr)
     {
-      for (size_t j = 0; j < n; ++j)
+      for (size_t i = 0; i < m; ++i)
       {
-        C[i * (n + offset_C) + j] = uo_dotproduct_ps(A + i * (k + offset_A), B_t + j * (k + offset_B), k);
+        for (size_t j = 0; j < n; ++j)
+        {
+          C[i * (n + offset_C) + j] = uo_dotproduct_ps(A + i * (k + offset_A), B_t + j * (k + offset_B), k);
+        }
       }
+
+      return;
     }
+
+    uo_gemm(false, true, m, n, k, 1.0f, A, k + offset_A, B_t, k + offset_B, 0.0f, C, n + offset_C);
   }
 
   // C_t = B_t * A_t, C is m x n matrix, k is "other" dimension
   static inline void uo_matmul_t_ps(const float *A_t, const float *B, float *C_t, size_t m, size_t n, size_t k, int offset_C, int offset_A, int offset_B)
   {
-    memset(C_t, 0, m * (n + offset_C) * sizeof(float));
+    uo_gemm(true, false, n, m, k, 1.0f, B, n + offset_B, A_t, m + offset_A, 0.0f, C_t, m + offset_C);
+  }
 
-    size_t mb = m / uo_floats_per_avx_float;
-    size_t reminder = m % uo_floats_per_avx_float;
+  // Quantized kernels. Integer vectors are processed 32 bytes at a time and remaining elements are handled one by one.
+#define uo_avx_epi8_count 32
+#define uo_avx_epi16_count 16
+#define uo_avx_epi32_count 8
 
-    __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(reminder), _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+  static inline int32_t uo_mm256_hsum_epi32(__m256i v)
+  {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+  }
+
+  // Horizontal sums of four vectors
+  static inline __m128i uo_mm256_haddx4_epi32(__m256i a, __m256i b, __m256i c, __m256i d)
+  {
+    a = _mm256_hadd_epi32(a, b);
+    c = _mm256_hadd_epi32(c, d);
+    a = _mm256_hadd_epi32(a, c);
+    return _mm_add_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+  }
+
+  // Multiply unsigned and signed 8-bit integers and accumulate adjacent products to 32-bit integers.
+  // Intermediate 16-bit sums saturate, so products of pairs should stay within int16 range, e.g. a in range [0, 127].
+  static inline __m256i uo_mm256_dpbusd_epi32(__m256i sum, __m256i a, __m256i b)
+  {
+    __m256i product = _mm256_maddubs_epi16(a, b);
+    return _mm256_add_epi32(sum, _mm256_madd_epi16(product, _mm256_set1_epi16(1)));
+  }
+
+  // Dot product of unsigned 8-bit and signed 8-bit vectors
+  static inline int32_t uo_dotproduct_epu8_epi8(const uint8_t *a, const int8_t *b, size_t n)
+  {
+    size_t nb = n / uo_avx_epi8_count;
+    __m256i sum = _mm256_setzero_si256();
 
-    for (size_t _k = 0; _k < k; ++_k)
+    for (size_t i = 0; i < nb; ++i)
     {
-      for (size_t j = 0; j < n; ++j)
-      {
-        uo_avx_float b = _mm256_set1_ps(B[_k * (n + offset_B) + j]);
+      __m256i _a = _mm256_loadu_si256((const __m256i *)(a + i * uo_avx_epi8_count));
+      __m256i _b = _mm256_loadu_si256((const __m256i *)(b + i * uo_avx_epi8_count));
+      sum = uo_mm256_dpbusd_epi32(sum, _a, _b);
+    }
 
-        for (size_t ii = 0; ii < mb; ++ii)
-        {
-          uo_avx_float a = _mm256_loadu_ps(A_t + _k * (m + offset_A) + ii * uo_floats_per_avx_float);
-          uo_avx_float mul = _mm256_mul_ps(a, b);
+    int32_t dot = uo_mm256_hsum_epi32(sum);
 
-          float *c = C_t + j * m + ii * uo_floats_per_avx_float;
-          uo_avx_float _c = _mm256_loadu_ps(c);
-          uo_avx_float add = _mm256_add_ps(_c, mul);
-          _mm256_storeu_ps(c, add);
-        }
+    for (size_t i = nb * uo_avx_epi8_count; i < n; ++i)
+    {
+      dot += (int32_t)a[i] * b[i];
+    }
+
+    return dot;
+  }
+
+  // Dot product of signed 8-bit vectors. Values need to be in range [-127, 127].
+  static inline int32_t uo_dotproduct_epi8(const int8_t *a, const int8_t *b, size_t n)
+  {
+    size_t nb = n / uo_avx_epi8_count;
+    __m256i sum = _mm256_setzero_si256();
+
+    for (size_t i = 0; i < nb; ++i)
+    {
+      __m256i _a = _mm256_loadu_si256((const __m256i *)(a + i * uo_avx_epi8_count));
+      __m256i _b = _mm256_loadu_si256((const __m256i *)(b + i * uo_avx_epi8_count));
+
+      // Sign of a is moved to b so that unsigned times signed multiplication can be used
+      sum = uo_mm256_dpbusd_epi32(sum, _mm256_abs_epi8(_a), _mm256_sign_epi8(_b, _a));
+    }
 
-        uo_avx_float a = _mm256_maskload_ps(A_t + _k * (m + offset_A) + mb * uo_floats_per_avx_float, mask);
-        uo_avx_float mul = _mm256_mul_ps(a, b);
+    int32_t dot = uo_mm256_hsum_epi32(sum);
+
+    for (size_t i = nb * uo_avx_epi8_count; i < n; ++i)
+    {
+      dot += (int32_t)a[i] * b[i];
+    }
+
+    return dot;
+  }
+
+  // Dot product of signed 16-bit vectors
+  static inline int32_t uo_dotproduct_epi16(const int16_t *a, const int16_t *b, size_t n)
+  {
+    size_t nb = n / uo_avx_epi16_count;
+    __m256i sum = _mm256_setzero_si256();
+
+    for (size_t i = 0; i < nb; ++i)
+    {
+      __m256i _a = _mm256_loadu_si256((const __m256i *)(a + i * uo_avx_epi16_count));
+      __m256i _b = _mm256_loadu_si256((const __m256i *)(b + i * uo_avx_epi16_count));
+      sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_a, _b));
+    }
 
-        float *c = C_t + j * m + mb * uo_floats_per_avx_float;
-        uo_avx_float _c = _mm256_maskload_ps(c, mask);
-        uo_avx_float add = _mm256_add_ps(_c, mul);
-        _mm256_maskstore_ps(c, mask, add);
+    int32_t dot = uo_mm256_hsum_epi32(sum);
+
+    for (size_t i = nb * uo_avx_epi16_count; i < n; ++i)
+    {
+      dot += (int32_t)a[i] * b[i];
+    }
+
+    return dot;
+  }
+
+  // y = Ax + b, A is m x n matrix of signed 8-bit integers and x is vector of unsigned 8-bit integers. Bias b is optional.
+  // Four rows are processed at a time so that each block of x is loaded once per four rows.
+  static inline void uo_matvec_epu8_epi8(const int8_t *A, const uint8_t *x, const int32_t *b, int32_t *y, size_t m, size_t n)
+  {
+    size_t nb = n / uo_avx_epi8_count;
+    size_t mb = m / 4;
+
+    for (size_t j = 0; j < mb; ++j)
+    {
+      const int8_t *a0 = A + j * 4 * n;
+      const int8_t *a1 = a0 + n;
+      const int8_t *a2 = a1 + n;
+      const int8_t *a3 = a2 + n;
+
+      __m256i sum0 = _mm256_setzero_si256();
+      __m256i sum1 = _mm256_setzero_si256();
+      __m256i sum2 = _mm256_setzero_si256();
+      __m256i sum3 = _mm256_setzero_si256();
+
+      for (size_t i = 0; i < nb; ++i)
+      {
+        size_t offset = i * uo_avx_epi8_count;
+        __m256i _x = _mm256_loadu_si256((const __m256i *)(x + offset));
+        sum0 = uo_mm256_dpbusd_epi32(sum0, _x, _mm256_loadu_si256((const __m256i *)(a0 + offset)));
+        sum1 = uo_mm256_dpbusd_epi32(sum1, _x, _mm256_loadu_si256((const __m256i *)(a1 + offset)));
+        sum2 = uo_mm256_dpbusd_epi32(sum2, _x, _mm256_loadu_si256((const __m256i *)(a2 + offset)));
+        sum3 = uo_mm256_dpbusd_epi32(sum3, _x, _mm256_loadu_si256((const __m256i *)(a3 + offset)));
       }
+
+      __m128i sums = uo_mm256_haddx4_epi32(sum0, sum1, sum2, sum3);
+      if (b) sums = _mm_add_epi32(sums, _mm_loadu_si128((const __m128i *)(b + j * 4)));
+      _mm_storeu_si128((__m128i *)(y + j * 4), sums);
+
+      for (size_t i = nb * uo_avx_epi8_count; i < n; ++i)
+      {
+        y[j * 4] += (int32_t)x[i] * a0[i];
+        y[j * 4 + 1] += (int32_t)x[i] * a1[i];
+        y[j * 4 + 2] += (int32_t)x[i] * a2[i];
+        y[j * 4 + 3] += (int32_t)x[i] * a3[i];
+      }
+    }
+
+    for (size_t j = mb * 4; j < m; ++j)
+    {
+      y[j] = (b ? b[j] : 0) + uo_dotproduct_epu8_epi8(x, A + j * n, n);
+    }
+  }
+
+  // y = Ax + b, A is m x n matrix of signed 8-bit integers and x is vector of signed 8-bit integers in range [-127, 127]. Bias b is optional.
+  static inline void uo_matvec_epi8(const int8_t *A, const int8_t *x, const int32_t *b, int32_t *y, size_t m, size_t n)
+  {
+    for (size_t j = 0; j < m; ++j)
+    {
+      y[j] = (b ? b[j] : 0) + uo_dotproduct_epi8(x, A + j * n, n);
+    }
+  }
+
+  // y = Ax + b, A is m x n matrix of signed 16-bit integers and x is vector of signed 16-bit integers. Bias b is optional.
+  static inline void uo_matvec_epi16(const int16_t *A, const int16_t *x, const int32_t *b, int32_t *y, size_t m, size_t n)
+  {
+    for (size_t j = 0; j < m; ++j)
+    {
+      y[j] = (b ? b[j] : 0) + uo_dotproduct_epi16(x, A + j * n, n);
+    }
+  }
+
+  // Clamp 16-bit values to range [0, 127] and store them as unsigned 8-bit values
+  static inline void uo_vec_clipped_relu_epi16(const int16_t *a, uint8_t *dst, size_t n)
+  {
+    size_t nb = n / uo_avx_epi8_count;
+    __m256i zero = _mm256_setzero_si256();
+
+    for (size_t i = 0; i < nb; ++i)
+    {
+      __m256i lo = _mm256_loadu_si256((const __m256i *)(a + i * uo_avx_epi8_count));
+      __m256i hi = _mm256_loadu_si256((const __m256i *)(a + i * uo_avx_epi8_count + uo_avx_epi16_count));
+
+      // Saturating pack clamps values to [-128, 127] and interleaves 128-bit lanes which are then restored to order
+      __m256i packed = _mm256_max_epi8(_mm256_packs_epi16(lo, hi), zero);
+      packed = _mm256_permute4x64_epi64(packed, 0xD8);
+      _mm256_storeu_si256((__m256i *)(dst + i * uo_avx_epi8_count), packed);
+    }
+
+    for (size_t i = nb * uo_avx_epi8_count; i < n; ++i)
+    {
+      dst[i] = a[i] < 0 ? 0 : a[i] > 127 ? 127 : (uint8_t)a[i];
+    }
+  }
+
+  // Shift 32-bit values right by given number of bits, clamp them to range [0, 127] and store them as unsigned 8-bit values
+  static inline void uo_vec_clipped_relu_epi32(const int32_t *a, uint8_t *dst, size_t n, int shift)
+  {
+    size_t nb = n / uo_avx_epi8_count;
+    __m256i zero = _mm256_setzero_si256();
+    __m256i order = _mm256_set_epi32(7, 3, 6, 2, 5, 1, 4, 0);
+
+    for (size_t i = 0; i < nb; ++i)
+    {
+      const int32_t *src = a + i * uo_avx_epi8_count;
+      __m256i a0 = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(src)), shift);
+      __m256i a1 = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(src + 8)), shift);
+      __m256i a2 = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(src + 16)), shift);
+      __m256i a3 = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(src + 24)), shift);
+
+      __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(a0, a1), _mm256_packs_epi32(a2, a3));
+      packed = _mm256_max_epi8(packed, zero);
+      packed = _mm256_permutevar8x32_epi32(packed, order);
+      _mm256_storeu_si256((__m256i *)(dst + i * uo_avx_epi8_count), packed);
+    }
+
+    for (size_t i = nb * uo_avx_epi8_count; i < n; ++i)
+    {
+      int32_t value = a[i] >> shift;
+      dst[i] = value < 0 ? 0 : value > 127 ? 127 : (uint8_t)value;
+    }
+  }
+
+  // Shift 32-bit values right by given number of bits and store them as 16-bit values with saturation
+  static inline void uo_vec_requantize_epi32_epi16(const int32_t *a, int16_t *dst, size_t n, int shift)
+  {
+    size_t nb = n / uo_avx_epi16_count;
+
+    for (size_t i = 0; i < nb; ++i)
+    {
+      const int32_t *src = a + i * uo_avx_epi16_count;
+      __m256i a0 = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(src)), shift);
+      __m256i a1 = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(src + 8)), shift);
+      __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a0, a1), 0xD8);
+      _mm256_storeu_si256((__m256i *)(dst + i * uo_avx_epi16_count), packed);
+    }
+
+    for (size_t i = nb * uo_avx_epi16_count; i < n; ++i)
+    {
+      int32_t value = a[i] >> shift;
+      dst[i] = value < INT16_MIN ? INT16_MIN : value > INT16_MAX ? INT16_MAX : (int16_t)value;
+    }
+  }
+
+  // Multiply float values by scale, round them to nearest integer and store them as 8-bit values clamped to range [-127, 127]
+  static inline void uo_vec_quantize_ps_epi8(const float *a, int8_t *dst, float scale, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+    {
+      float value = roundf(a[i] * scale);
+      dst[i] = value < -127.0f ? -127 : value > 127.0f ? 127 : (int8_t)value;
+    }
+  }
+
+  // Multiply float values by scale, round them to nearest integer and store them as 16-bit values with saturation
+  static inline void uo_vec_quantize_ps_epi16(const float *a, int16_t *dst, float scale, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+    {
+      float value = roundf(a[i] * scale);
+      dst[i] = value < (float)INT16_MIN ? INT16_MIN : value > (float)INT16_MAX ? INT16_MAX : (int16_t)value;
     }
   }
 
@@ -474,6 +738,7 @@ extern "C"
   }
 
 
+  // Unblocked matrix multiplication kernels, C += alpha * op(A) * op(B). Used as reference for the blocked implementation.
   static inline void uo_gemm_nn(size_t m, size_t n, size_t k, float alpha,
     float *A, size_t lda,
     float *B, size_t ldb,
@@ -552,34 +817,10 @@ extern "C"
     }
   }
 
-  // see: https://en.wikipedia.org/wiki/Basic_Linear_Algebra_Subprograms#Level_3
-  static inline void uo_gemm(bool ta, bool tb, size_t m, size_t n, size_t k,
-    float alpha,
-    float *A, size_t lda,
-    float *B, size_t ldb,
-    float beta,
-    float *C, size_t ldc)
-  {
-    for (size_t i = 0; i < m; ++i)
-    {
-      for (size_t j = 0; j < n; ++j)
-      {
-        C[i * ldc + j] *= beta;
-      }
-    }
-
-    if (!ta && !tb)
-      uo_gemm_nn(m, n, k, alpha, A, lda, B, ldb, C, ldc);
-    else if (ta && !tb)
-      uo_gemm_tn(m, n, k, alpha, A, lda, B, ldb, C, ldc);
-    else if (!ta && tb)
-      uo_gemm_nt(m, n, k, alpha, A, lda, B, ldb, C, ldc);
-    else
-      uo_gemm_tt(m, n, k, alpha, A, lda, B, ldb, C, ldc);
-  }
-
   bool uo_test_matmul(char *test_data_dir);
 
+  void uo_benchmark_matmul(void);
+
   void uo_print_matrix(FILE *const fp, float *A, size_t m, size_t n);
 
   char *uo_parse_matrix(char *ptr, float **data, size_t *m, size_t *n);
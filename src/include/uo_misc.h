@@ -18,6 +18,7 @@ extern "C"
 
   // Time functions
 
+#ifdef WIN32
   typedef struct uo_time
   {
     LARGE_INTEGER frequency;
@@ -41,6 +42,29 @@ extern "C"
     QueryPerformanceCounter(&time_now.counter);
     return uo_time_diff_msec(time, &time_now);
   }
+#else
+  typedef struct uo_time
+  {
+    struct timespec counter;
+  } uo_time;
+
+  static inline void uo_time_now(uo_time *time)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &time->counter);
+  }
+
+  static inline double uo_time_diff_msec(const uo_time *start, const uo_time *end)
+  {
+    return (end->counter.tv_sec - start->counter.tv_sec) * 1000.0 + (end->counter.tv_nsec - start->counter.tv_nsec) / 1000000.0;
+  }
+
+  static inline double uo_time_elapsed_msec(const uo_time *time)
+  {
+    uo_time time_now;
+    uo_time_now(&time_now);
+    return uo_time_diff_msec(time, &time_now);
+  }
+#endif
 
 #ifdef WIN32
 # define uo_sleep_msec Sleep
@@ -48,7 +72,7 @@ extern "C"
   static inline void uo_sleep_msec(uint64_t msec)
   {
     struct timespec rem;
-    struct timespec req = { .tv_sec = msec / 1000, tv_nsec = (msec % 1000) * 1000000 };
+    struct timespec req = { .tv_sec = msec / 1000, .tv_nsec = (msec % 1000) * 1000000 };
     nanosleep(&req, &rem);
   }
 #endif
@@ -112,6 +136,10 @@ extern "C"
 
   char *uo_file_mmap_readline(uo_file_mmap *file_mmap);
 
+  // Reads the remaining lines skipping empty lines and comments, i.e. lines starting with '#'. Returned lines point to the
+  // mapped file. Returned array should be freed by the caller.
+  char **uo_file_mmap_readlines(uo_file_mmap *file_mmap, size_t *count);
+
   // Pipes
 
   typedef struct uo_pipe uo_pipe;
@@ -132,6 +160,10 @@ extern "C"
   size_t uo_process_write_stdin(uo_process *process, const char *ptr, size_t len);
   size_t uo_process_read_stdout(uo_process *process, char *buffer, size_t len);
 
+  // Reads output which is available without waiting. Output is null terminated. Returns false if the process has exited
+  // and all output has been read.
+  bool uo_process_read_stdout_nonblocking(uo_process *process, char *buffer, size_t len, size_t *len_read);
+
 
   // File paths
 
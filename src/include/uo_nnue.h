@@ -0,0 +1,127 @@
+#ifndef UO_NNUE_H
+#define UO_NNUE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "uo_piece.h"
+
+#include <immintrin.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+  // Efficiently updatable neural network evaluation using HalfKP features.
+  // Feature transformer input for each perspective is king square x non-king piece x piece square.
+  // Network layout: 2 x (40960 -> 256) -> 32 -> 32 -> 1
+#define UO_NNUE_FEATURE_COUNT (64 * 10 * 64)
+#define UO_NNUE_L1 256
+#define UO_NNUE_L2 32
+#define UO_NNUE_L3 32
+
+  // Quantization: feature transformer is int16, hidden layers are int8 with int32 biases
+#define UO_NNUE_WEIGHT_SCALE_BITS 6
+#define UO_NNUE_OUTPUT_SCALE 16
+
+  // Binary weight file header: magic "UONN", version and layer sizes as little endian uint32 values
+#define UO_NNUE_FILE_MAGIC 0x4E4E4F55
+#define UO_NNUE_FILE_VERSION 1
+
+#define uo_nnue_square_none 64
+#define uo_nnue_dirty_piece_max 3
+
+  // Accumulators are stored by search ply in the position. Values are kept for both colors so that the board flip
+  // after each move does not invalidate them. Pieces changed by the move leading to the position are recorded
+  // in absolute coordinates so that the accumulator can be updated lazily from the previous position.
+  typedef struct uo_nnue_accumulator
+  {
+    int16_t values[2][UO_NNUE_L1];
+    bool computed[2];
+    uint8_t dirty_count;
+    uo_piece dirty_piece[uo_nnue_dirty_piece_max];
+    uint8_t dirty_from[uo_nnue_dirty_piece_max];
+    uint8_t dirty_to[uo_nnue_dirty_piece_max];
+  } uo_nnue_accumulator;
+
+  typedef struct uo_nnue
+  {
+    char filepath[0x100];
+    int16_t *ft_biases;  // [L1]
+    int16_t *ft_weights; // [FEATURE_COUNT][L1]
+    int32_t *l1_biases;  // [L2]
+    int8_t *l1_weights;  // [L2][2 * L1]
+    int32_t *l2_biases;  // [L3]
+    int8_t *l2_weights;  // [L3][L2]
+    int32_t *out_bias;   // [1]
+    int8_t *out_weights; // [L3]
+  } uo_nnue;
+
+  // Network used by position evaluation. If not set, hand crafted evaluation is used.
+  extern uo_nnue *uo_nnue_network;
+
+  uo_nnue *uo_nnue_create(const char *filepath);
+
+  // Creates a network with all parameters set to zero, e.g. for exporting trained weights
+  uo_nnue *uo_nnue_create_empty(void);
+
+  // Writes the network to a weight file which can be loaded with uo_nnue_create
+  bool uo_nnue_save(const uo_nnue *nnue, const char *filepath);
+
+  void uo_nnue_free(uo_nnue *nnue);
+
+  // Returns evaluation in centipawns from the point of view of the side to move
+  int32_t uo_nnue_propagate(const uo_nnue *nnue, const int16_t *own, const int16_t *enemy);
+
+  // Feature index for perspective of given color. All squares and pieces are in absolute coordinates.
+  static inline size_t uo_nnue_feature_index(uint8_t color, uint8_t square_K, uo_piece piece, uint8_t square)
+  {
+    uint8_t flip = color ? 56 : 0;
+    return ((size_t)(square_K ^ flip) * 10 + ((piece ^ color) - uo_piece__P)) * 64 + (square ^ flip);
+  }
+
+  static inline void uo_nnue_accumulator_refresh(const uo_nnue *nnue, int16_t *values, const size_t *features, size_t count)
+  {
+    for (size_t i = 0; i < UO_NNUE_L1; i += 16)
+    {
+      __m256i acc = _mm256_loadu_si256((const __m256i *)(nnue->ft_biases + i));
+
+      for (size_t j = 0; j < count; ++j)
+      {
+        const int16_t *column = nnue->ft_weights + features[j] * UO_NNUE_L1;
+        acc = _mm256_add_epi16(acc, _mm256_loadu_si256((const __m256i *)(column + i)));
+      }
+
+      _mm256_storeu_si256((__m256i *)(values + i), acc);
+    }
+  }
+
+  static inline void uo_nnue_accumulator_update(const uo_nnue *nnue, int16_t *values, const int16_t *values_prev,
+    const size_t *removed, size_t removed_count, const size_t *added, size_t added_count)
+  {
+    for (size_t i = 0; i < UO_NNUE_L1; i += 16)
+    {
+      __m256i acc = _mm256_loadu_si256((const __m256i *)(values_prev + i));
+
+      for (size_t j = 0; j < removed_count; ++j)
+      {
+        const int16_t *column = nnue->ft_weights + removed[j] * UO_NNUE_L1;
+        acc = _mm256_sub_epi16(acc, _mm256_loadu_si256((const __m256i *)(column + i)));
+      }
+
+      for (size_t j = 0; j < added_count; ++j)
+      {
+        const int16_t *column = nnue->ft_weights + added[j] * UO_NNUE_L1;
+        acc = _mm256_add_epi16(acc, _mm256_loadu_si256((const __m256i *)(column + i)));
+      }
+
+      _mm256_storeu_si256((__m256i *)(values + i), acc);
+    }
+  }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -13,10 +13,12 @@ extern "C"
 #include "uo_util.h"
 #include "uo_evaluation.h"
 #include "uo_zobrist.h"
+#include "uo_nnue.h"
 
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stddef.h> 
+#include <stdlib.h>
 #include <string.h> 
 #include <assert.h>
 
@@ -51,6 +53,7 @@ extern "C"
     int16_t see_ubound;
     int16_t see_lbound;
     int16_t static_eval;
+    int16_t lazy_eval;
 
     struct
     {
@@ -59,15 +62,112 @@ extern "C"
       bool see_ubound;
       bool see_lbound;
       bool static_eval;
+      bool lazy_eval;
     } is_cached;
   } uo_move_cache;
 
+  // Pawn structure hash table entry. Entries are indexed by the pawn key and hold evaluation terms which depend only on pawns.
+  typedef struct uo_pawn_hash_entry
+  {
+    uint64_t key;
+    int16_t score; // pawn structure score from the point of view of white
+  } uo_pawn_hash_entry;
+
+#define uo_pawn_hash_size 0x2000
+
+  typedef struct uo_pawn_hash
+  {
+    uo_pawn_hash_entry entries[uo_pawn_hash_size];
+    uint64_t probes;
+    uint64_t hits;
+  } uo_pawn_hash;
+
+  // Static evaluation hash table shared by search threads. Each 8 byte entry holds the position key xor the evaluation
+  // in the lowest 16 bits. Entry is valid only if the upper 48 bits of the xor with the key are zero, so a torn or
+  // overwritten entry is detected and entries can be read and written without locking. Each search thread has its own
+  // instance which points to the shared entries and counts its own probes and hits.
+  typedef struct uo_eval_hash
+  {
+    uint64_t *entries;
+    uint64_t hash_mask;
+    uint64_t probes;
+    uint64_t hits;
+  } uo_eval_hash;
+
+  static inline void uo_eval_hash_init(uo_eval_hash *eval_hash, size_t capacity)
+  {
+    // Capacity should be zero or a power of two. Zero capacity disables the table.
+    eval_hash->entries = capacity ? calloc(capacity, sizeof * eval_hash->entries) : NULL;
+    eval_hash->hash_mask = capacity ? capacity - 1 : 0;
+    eval_hash->probes = 0;
+    eval_hash->hits = 0;
+  }
+
+  static inline void uo_eval_hash_clear(uo_eval_hash *eval_hash)
+  {
+    if (!eval_hash->entries) return;
+    memset(eval_hash->entries, 0, (eval_hash->hash_mask + 1) * sizeof * eval_hash->entries);
+  }
+
+  static inline void uo_eval_hash_free(uo_eval_hash *eval_hash)
+  {
+    free(eval_hash->entries);
+    eval_hash->entries = NULL;
+    eval_hash->hash_mask = 0;
+  }
+
+  static inline bool uo_eval_hash_get(uo_eval_hash *eval_hash, uint64_t key, int16_t *value)
+  {
+    if (!eval_hash || !eval_hash->entries) return false;
+
+    ++eval_hash->probes;
+    uint64_t data = eval_hash->entries[key & eval_hash->hash_mask] ^ key;
+    if (data >> 16) return false;
+
+    ++eval_hash->hits;
+    *value = (int16_t)(uint16_t)data;
+    return true;
+  }
+
+  static inline void uo_eval_hash_set(uo_eval_hash *eval_hash, uint64_t key, int16_t value)
+  {
+    if (!eval_hash || !eval_hash->entries) return;
+    eval_hash->entries[key & eval_hash->hash_mask] = key ^ (uint16_t)value;
+  }
+
+  struct uo_position;
+
+  // Specialised endgame evaluation. Returns score from the point of view of the side to move.
+  typedef int16_t uo_endgame_evaluation(const struct uo_position *position, uint8_t color_strong);
+
+  // Material hash table entry. Entries are indexed by the material key and hold evaluation terms which depend only on piece counts.
+  typedef struct uo_material_hash_entry
+  {
+    uint64_t key;
+    uo_endgame_evaluation *evaluate; // specialised endgame evaluation replacing the regular evaluation, if set
+    int16_t imbalance;               // material imbalance score from the point of view of white
+    uint8_t phase;                   // material percentage used to interpolate between middle game and endgame scores
+    uint8_t color_strong;            // absolute color of the stronger side for the specialised evaluation
+    uint8_t scale[2];                // scale factor by absolute color applied when the color is ahead
+    bool is_opposite_B_candidate;    // bishops and pawns only and one bishop for each side
+  } uo_material_hash_entry;
+
+#define uo_material_hash_size 0x400
+
+  typedef struct uo_material_hash
+  {
+    uo_material_hash_entry entries[uo_material_hash_size];
+    uint64_t probes;
+    uint64_t hits;
+  } uo_material_hash;
+
   typedef struct uo_move_history
   {
     uint64_t key;
     uo_move move;
     uo_bitboard checks;
     int16_t static_eval;
+    int16_t lazy_eval; // estimate of static evaluation from material and pawn terms only
     uo_position_flags flags;
     uint8_t move_count;
     uint8_t tactical_move_count;
@@ -79,6 +179,17 @@ extern "C"
     uo_move killers[2];
   } uo_move_history;
 
+  // Evaluation terms which are updated incrementally on make and unmake move. Terms are stored by absolute color.
+  // Pawn square scores are kept also with files mirrored, since which of them is used depends on king positions.
+  typedef struct uo_position_score
+  {
+    uint64_t key_P;        // zobrist key of pawns
+    uint64_t key_material; // zobrist key of piece counts
+    int16_t material[2];
+    int16_t mg_P[2][2];
+    int16_t eg_P[2][2];
+  } uo_position_score;
+
   typedef struct uo_position
   {
     union {
@@ -99,6 +210,7 @@ extern "C"
 
     uo_piece captures[30];
     uint16_t material;
+    uo_position_score score;
 
     uo_position_flags flags;
     uint16_t ply;
@@ -154,6 +266,10 @@ extern "C"
       uo_move *head;
       int16_t move_scores[0x100];
     } movelist;
+
+    // NNUE accumulators by search ply. Accumulators are large, so they are kept apart from the move history and only
+    // for the plies of the search tree.
+    uo_nnue_accumulator nnue[UO_MAX_PLY + 1];
   } uo_position;
 
 #pragma region uo_position_piece_bitboard
@@ -289,6 +405,21 @@ extern "C"
   // example fen: rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1
   uo_position *uo_position_from_fen(uo_position *position, const char *fen);
 
+  // Compact position representation for bulk storage and batched evaluation. Bitboards and flags are stored as in
+  // uo_position, i.e. from the point of view of the side to move. Everything else is derived when unpacking.
+  typedef struct uo_position_packed
+  {
+    uo_bitboard bitboards[8];
+    uo_position_flags flags;
+  } uo_position_packed;
+
+  void uo_position_pack(const uo_position *position, uo_position_packed *packed);
+
+  // Loads packed position into an existing position. Unlike uo_position_from_fen, only the state which is derived from
+  // the board and the first entries of the move history are reset, so the same position can be reused for many packed
+  // positions without clearing the whole structure.
+  uo_position *uo_position_unpack(uo_position *position, const uo_position_packed *packed);
+
   static inline uo_move_cache *uo_move_cache_get(uo_move_cache move_cache[0x1000], uint64_t key, uo_move move)
   {
     if (!move_cache) return NULL;
@@ -326,8 +457,9 @@ extern "C"
       // Copy the relevant history to the beginning of the history stack
       memmove(position->history, position->stack - relevant_history_count, relevant_history_count * sizeof * stack);
 
-      // Save the current checks
+      // Save the current checks and repetition count
       uo_bitboard checks = position->stack->checks;
+      uint8_t repetitions = position->stack->repetitions;
 
       // Clear the stack
       memset(stack, 0, (position->stack - stack) * sizeof * stack);
@@ -337,17 +469,26 @@ extern "C"
 
       // Restore the current checks and other fields on the stack
       stack->checks = checks;
+      stack->repetitions = repetitions;
     }
 
     // Reset the position key and flags on the stack
     stack->key = position->key;
     stack->flags = position->flags;
 
+    // Accumulators are updated only within the search tree, so root accumulators are computed from scratch
+    position->nnue[0].computed[0] = false;
+    position->nnue[0].computed[1] = false;
+
     // Reset the ply counter
     position->root_ply += position->ply;
     position->ply = 0;
   }
 
+  void uo_position_calculate_score(const uo_position *position, uo_position_score *score);
+
+  void uo_position_material_entry_init(const uo_position *position, uo_material_hash_entry *entry);
+
   size_t uo_position_print_fen(uo_position *position, char fen[90]);
 
   size_t uo_position_print_diagram(uo_position *position, char diagram[663]);
@@ -723,6 +864,50 @@ extern "C"
     return true;
   }
 
+  // Checks whether there is a reversible move which leads to a position that has occurred earlier.
+  // For positions before root, the side to move should be able to make the move and the position should have repeated already.
+  // see: http://web.archive.org/web/20201107002606/https://marcelk.net/2013-04-06/paper/upcoming-rep-v2.pdf
+  static inline bool uo_position_is_upcoming_repetition(const uo_position *position)
+  {
+    const uo_move_history *stack = position->stack;
+    int ply = position->ply;
+    int rule50 = uo_position_flags_rule50(position->flags);
+    int history_count = stack - position->history;
+    int end = uo_min(rule50, history_count);
+
+    if (end < 3 || !stack[-1].move) return false;
+
+    uint8_t flip_if_black = uo_color(position->flags) == uo_black ? 56 : 0;
+    uo_bitboard occupied = position->own | position->enemy;
+
+    for (int i = 3; i <= end; i += 2)
+    {
+      // Null moves are not reversible moves
+      if (!stack[-i + 1].move || !stack[-i].move) return false;
+
+      uo_move move = uo_zobrist_cuckoo_get(position->key ^ stack[-i].key);
+      if (!move) continue;
+
+      uo_square square_from = uo_move_square_from(move) ^ flip_if_black;
+      uo_square square_to = uo_move_square_to(move) ^ flip_if_black;
+
+      // Path between the squares has to be clear
+      uo_bitboard attacks = uo_bitboard_attacks_Q(square_from, occupied) | uo_bitboard_attacks_N(square_from);
+      if (!(attacks & uo_square_bitboard(square_to))) continue;
+
+      // Repetition would occur after root position
+      if (ply > i) return true;
+
+      // Piece has to belong to the side to move
+      uo_square square = position->board[square_from] ? square_from : square_to;
+      if (uo_color(position->board[square]) != uo_color_own) continue;
+
+      if (stack[-i].repetitions) return true;
+    }
+
+    return false;
+  }
+
   static inline bool uo_position_is_max_depth_reached(const uo_position *position)
   {
     return position->ply >= UO_MAX_PLY
@@ -964,11 +1149,159 @@ extern "C"
     return false;
   }
 
-  static inline int16_t uo_position_evaluate(uo_position *position)
+  int16_t uo_position_evaluate_nnue(uo_position *position);
+
+  // Pawn structure terms depend only on pawns. They are cached in the pawn hash table, if given, by the pawn key.
+  // Pawn hash table should not be given with evaluation parameters, since entries are computed with the compile time constants.
+  static inline int16_t uo_position_evaluate_pawn_structure(const uo_position *position, uo_pawn_hash *pawn_hash, const uo_evaluation_parameters *parameters)
   {
-    if (position->stack->static_eval != uo_score_unknown) return position->stack->static_eval;
+    uint8_t color = uo_color(position->flags);
+    uint64_t key = position->score.key_P;
+    uo_pawn_hash_entry *entry = NULL;
 
-    int16_t score = uo_score_tempo;
+    if (pawn_hash)
+    {
+      entry = &pawn_hash->entries[key & (uo_pawn_hash_size - 1)];
+      ++pawn_hash->probes;
+
+      if (entry->key == key)
+      {
+        ++pawn_hash->hits;
+        return color == uo_white ? entry->score : -entry->score;
+      }
+    }
+
+    int16_t score = 0;
+
+    uo_bitboard own_P = position->own & position->P;
+    uo_bitboard enemy_P = position->enemy & position->P;
+    uo_bitboard attacks_own_P = uo_bitboard_attacks_left_P(own_P) | uo_bitboard_attacks_right_P(own_P);
+    uo_bitboard attacks_enemy_P = uo_bitboard_attacks_left_enemy_P(enemy_P) | uo_bitboard_attacks_right_enemy_P(enemy_P);
+    uo_bitboard passed_own_P = 0;
+    uo_bitboard passed_enemy_P = 0;
+    uo_bitboard temp;
+
+    // pawn chains
+    int count_supported_own_P = uo_popcnt(own_P & attacks_own_P);
+    score += uo_evaluation_parameter_value(parameters, uo_score_supported_P) * count_supported_own_P;
+    int count_supported_enemy_P = uo_popcnt(enemy_P & attacks_enemy_P);
+    score -= uo_evaluation_parameter_value(parameters, uo_score_supported_P) * count_supported_enemy_P;
+
+    temp = own_P;
+    while (temp)
+    {
+      uo_square square_own_P = uo_bitboard_next_square(&temp);
+
+      // isolated pawns
+      bool is_isolated_P = !(uo_square_bitboard_adjecent_files[square_own_P] & own_P);
+      score += is_isolated_P * uo_evaluation_parameter_value(parameters, uo_score_isolated_P);
+
+      passed_own_P |= (uo_bitboard)uo_bitboard_is_passed_P(square_own_P, enemy_P) << square_own_P;
+    }
+
+    temp = enemy_P;
+    while (temp)
+    {
+      uo_square square_enemy_P = uo_bitboard_next_square(&temp);
+
+      // isolated pawns
+      bool is_isolated_P = !(uo_square_bitboard_adjecent_files[square_enemy_P] & enemy_P);
+      score -= is_isolated_P * uo_evaluation_parameter_value(parameters, uo_score_isolated_P);
+
+      passed_enemy_P |= (uo_bitboard)uo_bitboard_is_passed_enemy_P(square_enemy_P, own_P) << square_enemy_P;
+    }
+
+    // passed pawns
+    score += uo_evaluation_parameter_value(parameters, uo_score_passed_pawn_on_fifth) * (int16_t)uo_popcnt(passed_own_P & uo_bitboard_rank_fifth);
+    score += uo_evaluation_parameter_value(parameters, uo_score_passed_pawn_on_sixth) * (int16_t)uo_popcnt(passed_own_P & uo_bitboard_rank_sixth);
+    score -= uo_evaluation_parameter_value(parameters, uo_score_passed_pawn_on_fifth) * (int16_t)uo_popcnt(passed_enemy_P & uo_bitboard_rank_fourth);
+    score -= uo_evaluation_parameter_value(parameters, uo_score_passed_pawn_on_sixth) * (int16_t)uo_popcnt(passed_enemy_P & uo_bitboard_rank_third);
+
+    if (entry)
+    {
+      entry->key = key;
+
+      entry->score = color == uo_white ? score : -score;
+    }
+
+    return score;
+  }
+
+  // Terms depending only on piece counts. They are cached in the material hash table, if given, by the material key.
+  static inline const uo_material_hash_entry *uo_position_evaluate_material(const uo_position *position, uo_material_hash *material_hash, uo_material_hash_entry *entry_temp)
+  {
+    uint64_t key = position->score.key_material;
+
+    if (!material_hash)
+    {
+      uo_position_material_entry_init(position, entry_temp);
+      return entry_temp;
+    }
+
+    uo_material_hash_entry *entry = &material_hash->entries[key & (uo_material_hash_size - 1)];
+    ++material_hash->probes;
+
+    if (entry->key == key)
+    {
+      ++material_hash->hits;
+      return entry;
+    }
+
+    uo_position_material_entry_init(position, entry);
+    return entry;
+  }
+
+  // Scales down the score of the side which is ahead in drawish material configurations
+  static inline int16_t uo_position_evaluate_scale(const uo_position *position, const uo_material_hash_entry *material, int16_t score)
+  {
+    uint8_t color = uo_color(position->flags);
+    uint8_t color_ahead = score > 0 ? color : !color;
+    int32_t scale = material->scale[color_ahead];
+
+    if (material->is_opposite_B_candidate
+      && (position->B & uo_bitboard__light_squares)
+      && (position->B & uo_bitboard__dark_squares))
+    {
+      scale = uo_min(scale, uo_scale_factor_opposite_B);
+    }
+
+    return (int32_t)score * scale / uo_scale_factor_normal;
+  }
+
+  // Pawn square scores computed from the pawn bitboards. Used with evaluation parameters instead of the incrementally updated terms.
+  static inline void uo_position_evaluate_pawn_squares(const uo_position *position, const uo_evaluation_parameters *parameters,
+    bool is_own_K_queenside, bool is_enemy_K_queenside, int32_t *score_mg, int32_t *score_eg)
+  {
+    const int16_t *mg_P = &parameters->score_mg_P_a2 - 8;
+    const int16_t *eg_P = &parameters->score_eg_P_a2 - 8;
+    uint8_t flip_if_own_K_queenside = is_own_K_queenside ? 7 : 0;
+    uint8_t flip_if_enemy_K_queenside = is_enemy_K_queenside ? 7 : 0;
+
+    uo_bitboard temp = position->own & position->P;
+    while (temp)
+    {
+      uo_square square = uo_bitboard_next_square(&temp);
+      *score_mg += mg_P[square ^ flip_if_own_K_queenside];
+      *score_eg += eg_P[square ^ flip_if_enemy_K_queenside];
+    }
+
+    temp = position->enemy & position->P;
+    while (temp)
+    {
+      uo_square square = uo_bitboard_next_square(&temp) ^ 56;
+      *score_mg -= mg_P[square ^ flip_if_enemy_K_queenside];
+      *score_eg -= eg_P[square ^ flip_if_own_K_queenside];
+    }
+  }
+
+  // Hand crafted evaluation. Parameters are the compile time constants if evaluation parameters are not given.
+  // The production path passes constant null pointers for parameters and trace, so parameter lookups are folded to constants
+  // and tracing is compiled out.
+  static inline int16_t uo_position_evaluate_hce(uo_position *position, const uo_material_hash_entry *material, uo_pawn_hash *pawn_hash, const uo_evaluation_parameters *parameters, uo_evaluation_trace *trace)
+  {
+    uo_evaluation_trace_begin(trace);
+
+    int16_t score = uo_evaluation_parameter_value(parameters, uo_score_tempo);
 
     // opening & middle game
     int32_t score_mg = 0;
@@ -976,6 +1309,8 @@ extern "C"
     // endgame
     int32_t score_eg = 0;
 
+    uo_evaluation_trace_term(trace, uo_evaluation_term_tempo, score, score_mg, score_eg);
+
     uo_bitboard mask_own = position->own;
     uo_bitboard mask_enemy = position->enemy;
     uo_bitboard occupied = mask_own | mask_enemy;
@@ -1027,32 +1362,43 @@ extern "C"
     int16_t castling_right_enemy_OO = uo_position_flags_castling_enemy_OO(position->flags);
     int16_t castling_right_enemy_OOO = uo_position_flags_castling_enemy_OOO(position->flags);
 
-    // pawns
+    uint8_t color = uo_color(position->flags);
 
-    int count_own_P = uo_popcnt(own_P);
-    score += uo_score_P * count_own_P;
-    int count_enemy_P = uo_popcnt(enemy_P);
-    score -= uo_score_P * count_enemy_P;
+    uo_evaluation_trace_term(trace, uo_evaluation_term_attacks, score, score_mg, score_eg);
 
-    // pawn chains
-    int count_supported_own_P = uo_popcnt(own_P & attacks_own_P);
-    score += uo_score_supported_P * count_supported_own_P;
-    int count_supported_enemy_P = uo_popcnt(enemy_P & attacks_enemy_P);
-    score -= uo_score_supported_P * count_supported_enemy_P;
+    // material
+    score += position->score.material[color] - position->score.material[!color];
+    if (parameters)
+    {
+      score += uo_evaluation_parameter_value(parameters, uo_score_B_pair) * ((uo_popcnt(own_B) >= 2) - (uo_popcnt(enemy_B) >= 2));
+    }
+    else
+    {
+      score += color == uo_white ? material->imbalance : -material->imbalance;
+    }
+
+    uo_evaluation_trace_term(trace, uo_evaluation_term_material, score, score_mg, score_eg);
+
+    // pawn structure
+    score += uo_position_evaluate_pawn_structure(position, pawn_hash, parameters);
+
+    uo_evaluation_trace_term(trace, uo_evaluation_term_pawn_structure, score, score_mg, score_eg);
 
     // pawn mobility
 
     int mobility_own_P = uo_popcnt(pushes_own_P) +
       uo_popcnt(attacks_left_own_P & mask_enemy) +
       uo_popcnt(attacks_right_own_P & mask_enemy);
-    score += !mobility_own_P * uo_score_zero_mobility_P;
-    score += uo_score_mul_ln(uo_score_mobility_P, mobility_own_P * mobility_own_P);
+    score += !mobility_own_P * uo_evaluation_parameter_value(parameters, uo_score_zero_mobility_P);
+    score += uo_score_mul_ln(uo_evaluation_parameter_value(parameters, uo_score_mobility_P), mobility_own_P * mobility_own_P);
 
     int mobility_enemy_P = uo_popcnt(pushes_enemy_P) +
       uo_popcnt(attacks_left_enemy_P & mask_own) +
       uo_popcnt(attacks_right_enemy_P & mask_own);
-    score -= !mobility_enemy_P * uo_score_zero_mobility_P;
-    score -= uo_score_mul_ln(uo_score_mobility_P, mobility_enemy_P * mobility_enemy_P);
+    score -= !mobility_enemy_P * uo_evaluation_parameter_value(parameters, uo_score_zero_mobility_P);
+    score -= uo_score_mul_ln(uo_evaluation_parameter_value(parameters, uo_score_mobility_P), mobility_enemy_P * mobility_enemy_P);
+
+    uo_evaluation_trace_term(trace, uo_evaluation_term_mobility_P, score, score_mg, score_eg);
 
     uo_bitboard temp;
 
@@ -1069,11 +1415,9 @@ extern "C"
       uo_bitboard attacks_own_N = uo_bitboard_attacks_N(square_own_N);
 
       int mobility_own_N = uo_popcnt(mask_mobility_own & attacks_own_N);
-      score += score_mobility_N[mobility_own_N];
-
-      score += uo_score_N;
+      score += uo_evaluation_parameter_table(parameters, score_mobility_N, mobility_own_N);
 
-      attack_units_own += uo_popcnt(attacks_own_N & zone_enemy_K) * uo_attack_unit_N;
+      attack_units_own += uo_popcnt(attacks_own_N & zone_enemy_K) * uo_evaluation_parameter_value(parameters, uo_attack_unit_N);
     }
 
     temp = enemy_N;
@@ -1083,13 +1427,12 @@ extern "C"
       uo_bitboard attacks_enemy_N = uo_bitboard_attacks_N(square_enemy_N);
 
       int mobility_enemy_N = uo_popcnt(mask_mobility_enemy & attacks_enemy_N);
-      score -= score_mobility_N[mobility_enemy_N];
+      score -= uo_evaluation_parameter_table(parameters, score_mobility_N, mobility_enemy_N);
 
-      score -= uo_score_N;
-
-      attack_units_enemy += uo_popcnt(attacks_enemy_N & zone_own_K) * uo_attack_unit_N;
+      attack_units_enemy += uo_popcnt(attacks_enemy_N & zone_own_K) * uo_evaluation_parameter_value(parameters, uo_attack_unit_N);
     }
 
+    uo_evaluation_trace_term(trace, uo_evaluation_term_mobility_N, score, score_mg, score_eg);
 
     // bishops
     temp = own_B;
@@ -1099,11 +1442,9 @@ extern "C"
       uo_bitboard attacks_own_B = uo_bitboard_attacks_B(square_own_B, occupied);
 
       int mobility_own_B = uo_popcnt(mask_mobility_own & attacks_own_B);
-      score += score_mobility_B[mobility_own_B];
-
-      score += uo_score_B;
+      score += uo_evaluation_parameter_table(parameters, score_mobility_B, mobility_own_B);
 
-      attack_units_own += uo_popcnt(attacks_own_B & zone_enemy_K) * uo_attack_unit_B;
+      attack_units_own += uo_popcnt(attacks_own_B & zone_enemy_K) * uo_evaluation_parameter_value(parameters, uo_attack_unit_B);
     }
 
     temp = enemy_B;
@@ -1113,13 +1454,13 @@ extern "C"
       uo_bitboard attacks_enemy_B = uo_bitboard_attacks_B(square_enemy_B, occupied);
 
       int mobility_enemy_B = uo_popcnt(mask_mobility_enemy & attacks_enemy_B);
-      score -= score_mobility_B[mobility_enemy_B];
+      score -= uo_evaluation_parameter_table(parameters, score_mobility_B, mobility_enemy_B);
 
-      score -= uo_score_B;
-
-      attack_units_enemy += uo_popcnt(attacks_enemy_B & zone_own_K) * uo_attack_unit_B;
+      attack_units_enemy += uo_popcnt(attacks_enemy_B & zone_own_K) * uo_evaluation_parameter_value(parameters, uo_attack_unit_B);
     }
 
+    uo_evaluation_trace_term(trace, uo_evaluation_term_mobility_B, score, score_mg, score_eg);
+
     // rooks
     temp = own_R;
     while (temp)
@@ -1128,11 +1469,9 @@ extern "C"
       uo_bitboard attacks_own_R = uo_bitboard_attacks_R(square_own_R, occupied);
 
       int mobility_own_R = uo_popcnt(mask_mobility_own & attacks_own_R);
-      score += score_mobility_R[mobility_own_R];
+      score += uo_evaluation_parameter_table(parameters, score_mobility_R, mobility_own_R);
 
-      score += uo_score_R;
-
-      attack_units_own += uo_popcnt(attacks_own_R & zone_enemy_K) * uo_attack_unit_R;
+      attack_units_own += uo_popcnt(attacks_own_R & zone_enemy_K) * uo_evaluation_parameter_value(parameters, uo_attack_unit_R);
     }
 
     temp = enemy_R;
@@ -1142,13 +1481,13 @@ extern "C"
       uo_bitboard attacks_enemy_R = uo_bitboard_attacks_R(square_enemy_R, occupied);
 
       int mobility_enemy_R = uo_popcnt(mask_mobility_enemy & attacks_enemy_R);
-      score -= score_mobility_R[mobility_enemy_R];
-
-      score -= uo_score_R;
+      score -= uo_evaluation_parameter_table(parameters, score_mobility_R, mobility_enemy_R);
 
-      attack_units_enemy += uo_popcnt(attacks_enemy_R & zone_own_K) * uo_attack_unit_R;
+      attack_units_enemy += uo_popcnt(attacks_enemy_R & zone_own_K) * uo_evaluation_parameter_value(parameters, uo_attack_unit_R);
     }
 
+    uo_evaluation_trace_term(trace, uo_evaluation_term_mobility_R, score, score_mg, score_eg);
+
     // queens
     temp = own_Q;
     while (temp)
@@ -1157,11 +1496,9 @@ extern "C"
       uo_bitboard attacks_own_Q = uo_bitboard_attacks_Q(square_own_Q, occupied);
 
       int mobility_own_Q = uo_popcnt(mask_mobility_own & attacks_own_Q);
-      score += score_mobility_Q[mobility_own_Q];
-
-      score += uo_score_Q;
+      score += uo_evaluation_parameter_table(parameters, score_mobility_Q, mobility_own_Q);
 
-      attack_units_own += uo_popcnt(attacks_own_Q & zone_enemy_K) * uo_attack_unit_Q;
+      attack_units_own += uo_popcnt(attacks_own_Q & zone_enemy_K) * uo_evaluation_parameter_value(parameters, uo_attack_unit_Q);
     }
 
     temp = enemy_Q;
@@ -1171,136 +1508,220 @@ extern "C"
       uo_bitboard attacks_enemy_Q = uo_bitboard_attacks_Q(square_enemy_Q, occupied);
 
       int mobility_enemy_Q = uo_popcnt(mask_mobility_enemy & attacks_enemy_Q);
-      score -= score_mobility_Q[mobility_enemy_Q];
+      score -= uo_evaluation_parameter_table(parameters, score_mobility_Q, mobility_enemy_Q);
 
-      score -= uo_score_Q;
-
-      attack_units_enemy += uo_popcnt(attacks_enemy_Q & zone_own_K) * uo_attack_unit_Q;
+      attack_units_enemy += uo_popcnt(attacks_enemy_Q & zone_own_K) * uo_evaluation_parameter_value(parameters, uo_attack_unit_Q);
     }
 
+    uo_evaluation_trace_term(trace, uo_evaluation_term_mobility_Q, score, score_mg, score_eg);
+
     // king safety
 
     uo_bitboard undefended_zone_own_K = uo_andn(attacks_own, zone_own_K);
     uo_bitboard undefended_zone_enemy_K = uo_andn(attacks_enemy, zone_enemy_K);
 
     supported_contact_check_by_R |= own_R & attacks_own & (attacks_enemy_K & uo_bitboard_attacks_R(square_enemy_K, 0));
-    attack_units_own += uo_popcnt(supported_contact_check_by_R & undefended_zone_enemy_K) * uo_attack_unit_supported_contact_R;
+    attack_units_own += uo_popcnt(supported_contact_check_by_R & undefended_zone_enemy_K) * uo_evaluation_parameter_value(parameters, uo_attack_unit_supported_contact_R);
 
     supported_contact_check_by_Q |= own_Q & attacks_own & attacks_enemy_K;
-    attack_units_own += uo_popcnt(supported_contact_check_by_Q & undefended_zone_enemy_K) * uo_attack_unit_supported_contact_Q;
+    attack_units_own += uo_popcnt(supported_contact_check_by_Q & undefended_zone_enemy_K) * uo_evaluation_parameter_value(parameters, uo_attack_unit_supported_contact_Q);
+
+    // attack units can exceed the table size only with evaluation parameters
+    if (parameters)
+    {
+      attack_units_own = uo_min(attack_units_own, 99);
+      attack_units_enemy = uo_min(attack_units_enemy, 99);
+    }
 
     assert(attack_units_own < 100);
-    score += score_attacks_to_K[attack_units_own];
+    score += uo_evaluation_parameter_table(parameters, score_attacks_to_K, attack_units_own);
 
     assert(attack_units_enemy < 100);
-    score -= score_attacks_to_K[attack_units_enemy];
+    score -= uo_evaluation_parameter_table(parameters, score_attacks_to_K, attack_units_enemy);
+
+    uo_evaluation_trace_term(trace, uo_evaluation_term_king_attacks, score, score_mg, score_eg);
 
     int mobility_own_K = uo_popcnt(uo_andn(attacks_enemy_K | attacks_enemy, attacks_own_K));
-    score += uo_score_zero_mobility_K * !mobility_own_K;
+    score += uo_evaluation_parameter_value(parameters, uo_score_zero_mobility_K) * !mobility_own_K;
 
     int mobility_enemy_K = uo_popcnt(uo_andn(attacks_own_K | attacks_own, attacks_enemy_K));
-    score -= uo_score_zero_mobility_K * !mobility_enemy_K;
+    score -= uo_evaluation_parameter_value(parameters, uo_score_zero_mobility_K) * !mobility_enemy_K;
 
-    score += uo_score_king_cover_pawn * (int32_t)uo_popcnt(attacks_own_K & own_P);
-    score -= uo_score_king_cover_pawn * (int32_t)uo_popcnt(attacks_enemy_K & enemy_P);
+    score += uo_evaluation_parameter_value(parameters, uo_score_king_cover_pawn) * (int32_t)uo_popcnt(attacks_own_K & own_P);
+    score -= uo_evaluation_parameter_value(parameters, uo_score_king_cover_pawn) * (int32_t)uo_popcnt(attacks_enemy_K & enemy_P);
 
-    // flip middle game pawn square scores if own king is on queen side and
-    // flip end game pawn square scores if enemy king is on queen side
-    uint8_t flip_if_own_K_queenside = (uo_square_file(square_own_K) < 4) * 7;
-    uint8_t flip_if_enemy_K_queenside = (uo_square_file(square_enemy_K) < 4) * 7;
+    uo_evaluation_trace_term(trace, uo_evaluation_term_king_safety, score, score_mg, score_eg);
 
-    // pawns
-    temp = own_P;
-    while (temp)
+    bool is_own_K_queenside = uo_square_file(square_own_K) < 4;
+    bool is_enemy_K_queenside = uo_square_file(square_enemy_K) < 4;
+
+    // pawn square scores, files are mirrored in middle game if own king is on queen side and in endgame if enemy king is on queen side
+    if (parameters)
     {
-      uo_square square_own_P = uo_bitboard_next_square(&temp);
+      uo_position_evaluate_pawn_squares(position, parameters, is_own_K_queenside, is_enemy_K_queenside, &score_mg, &score_eg);
+    }
+    else
+    {
+      score_mg += position->score.mg_P[color][is_own_K_queenside] - position->score.mg_P[!color][is_enemy_K_queenside];
+      score_eg += position->score.eg_P[color][is_enemy_K_queenside] - position->score.eg_P[!color][is_own_K_queenside];
+    }
 
-      // isolated pawns
-      bool is_isolated_P = !(uo_square_bitboard_adjecent_files[square_own_P] & own_P);
-      score += is_isolated_P * uo_score_isolated_P;
+    uo_evaluation_trace_term(trace, uo_evaluation_term_pawn_squares, score, score_mg, score_eg);
 
-      score_mg += score_mg_P[square_own_P ^ flip_if_own_K_queenside];
-      score_eg += score_eg_P[square_own_P ^ flip_if_enemy_K_queenside];
-    }
+    // castling rights
+    score_mg += uo_evaluation_parameter_value(parameters, uo_score_casting_right) * (castling_right_own_OO + castling_right_own_OOO - castling_right_enemy_OO - castling_right_enemy_OOO);
 
-    temp = enemy_P;
-    while (temp)
-    {
-      uo_square square_flipped_enemy_P = uo_bitboard_next_square(&temp) ^ 56;
+    bool both_rooks_undeveloped_own = uo_popcnt(own_R & (uo_square_bitboard(uo_square__a1) | uo_square_bitboard(uo_square__h1))) == 2;
+    bool both_rooks_undeveloped_enemy = uo_popcnt(enemy_R & (uo_square_bitboard(uo_square__a8) | uo_square_bitboard(uo_square__h8))) == 2;
 
-      // isolated pawns
-      bool is_isolated_P = !(uo_square_bitboard_adjecent_files[square_flipped_enemy_P] & enemy_P);
-      score -= is_isolated_P * uo_score_isolated_P;
+    score_mg += uo_evaluation_parameter_value(parameters, uo_score_rook_stuck_in_corner) * both_rooks_undeveloped_own * !(castling_right_own_OO + castling_right_own_OOO);
+    score_mg -= uo_evaluation_parameter_value(parameters, uo_score_rook_stuck_in_corner) * both_rooks_undeveloped_enemy * !(castling_right_enemy_OO + castling_right_enemy_OOO);
+
+    uo_evaluation_trace_term(trace, uo_evaluation_term_castling, score, score_mg, score_eg);
+
+    // king safety
+    score_mg += (uo_evaluation_parameter_value(parameters, uo_score_king_in_the_center) * (0 != (own_K & (uo_bitboard_file(2) | uo_bitboard_file(3) | uo_bitboard_file(4) | uo_bitboard_file(5)))))
+      - (uo_evaluation_parameter_value(parameters, uo_score_king_in_the_center) * (0 != (enemy_K & (uo_bitboard_file(2) | uo_bitboard_file(3) | uo_bitboard_file(4) | uo_bitboard_file(5)))));
+
+    score_mg += (uo_evaluation_parameter_value(parameters, uo_score_castled_king) * (square_own_K == uo_square__g1))
+      - (uo_evaluation_parameter_value(parameters, uo_score_castled_king) * (square_enemy_K == uo_square__g8));
+
+    score_mg += (uo_evaluation_parameter_value(parameters, uo_score_castled_king) * (square_own_K == uo_square__b1))
+      - (uo_evaluation_parameter_value(parameters, uo_score_castled_king) * (square_enemy_K == uo_square__b8));
+
+    uo_evaluation_trace_term(trace, uo_evaluation_term_king_placement, score, score_mg, score_eg);
+
+    int32_t material_percentage = material->phase;
 
-      score_mg -= score_mg_P[square_flipped_enemy_P ^ flip_if_enemy_K_queenside];
-      score_eg -= score_eg_P[square_flipped_enemy_P ^ flip_if_own_K_queenside];
+    score += score_mg * material_percentage / 100;
+    score += score_eg * (100 - material_percentage) / 100;
+
+    if (trace)
+    {
+      trace->phase = material_percentage;
+      trace->score_unscaled = score;
     }
 
-    // passed pawns
-    temp = own_P & uo_bitboard_rank_fifth;
-    while (temp)
+    score = uo_position_evaluate_scale(position, material, score);
+
+    if (trace) trace->score = score;
+
+    assert(score < uo_score_tb_win_threshold && score > -uo_score_tb_win_threshold);
+
+    return score;
+  }
+
+  static inline int16_t uo_position_evaluate(uo_position *position, uo_pawn_hash *pawn_hash, uo_material_hash *material_hash)
+  {
+    if (position->stack->static_eval != uo_score_unknown) return position->stack->static_eval;
+
+    uo_material_hash_entry material_temp;
+    const uo_material_hash_entry *material = uo_position_evaluate_material(position, material_hash, &material_temp);
+
+    if (material->evaluate) return position->stack->static_eval = material->evaluate(position, material->color_strong);
+
+    if (uo_nnue_network) return position->stack->static_eval = uo_position_evaluate_scale(position, material, uo_position_evaluate_nnue(position));
+
+    const uo_evaluation_parameters *parameters = uo_evaluation_parameters_current();
+    if (parameters) return position->stack->static_eval = uo_position_evaluate_hce(position, material, NULL, parameters, NULL);
+
+    return position->stack->static_eval = uo_position_evaluate_hce(position, material, pawn_hash, NULL, NULL);
+  }
+
+  // Evaluation with given parameters. Score is not cached and hash tables are not used.
+  int16_t uo_position_evaluate_with_parameters(uo_position *position, const uo_evaluation_parameters *parameters);
+
+  // Hand crafted evaluation which records contributions of the evaluation terms to the trace. Parameters are the compile time
+  // constants if evaluation parameters are not given. Specialised endgame evaluations have no terms, so only the score is
+  // recorded for those. Score is not cached and hash tables are not used.
+  int16_t uo_position_evaluate_trace(uo_position *position, const uo_evaluation_parameters *parameters, uo_evaluation_trace *trace);
+
+  // Estimate of static evaluation which uses only terms which are updated incrementally or cached by material and pawn keys.
+  // With evaluation parameters, the same terms are computed from the bitboards.
+  static inline int16_t uo_position_evaluate_lazy(const uo_position *position, const uo_material_hash_entry *material, uo_pawn_hash *pawn_hash, const uo_evaluation_parameters *parameters)
+  {
+    uint8_t color = uo_color(position->flags);
+    int32_t score = uo_evaluation_parameter_value(parameters, uo_score_tempo);
+
+    // material
+    score += position->score.material[color] - position->score.material[!color];
+    if (parameters)
     {
-      uo_square square_own_P = uo_bitboard_next_square(&temp);
-      score += uo_score_passed_pawn_on_fifth * uo_bitboard_is_passed_P(square_own_P, enemy_P);
+      score += uo_evaluation_parameter_value(parameters, uo_score_B_pair) * ((uo_popcnt(position->own & position->B) >= 2) - (uo_popcnt(position->enemy & position->B) >= 2));
     }
-    temp = own_P & uo_bitboard_rank_sixth;
-    while (temp)
+    else
     {
-      uo_square square_own_P = uo_bitboard_next_square(&temp);
-      score += uo_score_passed_pawn_on_sixth * uo_bitboard_is_passed_P(square_own_P, enemy_P);
+      score += color == uo_white ? material->imbalance : -material->imbalance;
     }
 
-    temp = enemy_P & uo_bitboard_rank_fourth;
-    while (temp)
+    // pawn structure
+    score += uo_position_evaluate_pawn_structure(position, pawn_hash, parameters);
+
+    // piece-square tables for pawns
+    bool is_own_K_queenside = uo_square_file(uo_tzcnt(position->own & position->K)) < 4;
+    bool is_enemy_K_queenside = uo_square_file(uo_tzcnt(position->enemy & position->K)) < 4;
+    int32_t score_mg = 0;
+    int32_t score_eg = 0;
+
+    if (parameters)
     {
-      uo_square square_enemy_P = uo_bitboard_next_square(&temp);
-      score -= uo_score_passed_pawn_on_fifth * uo_bitboard_is_passed_enemy_P(square_enemy_P, own_P);
+      uo_position_evaluate_pawn_squares(position, parameters, is_own_K_queenside, is_enemy_K_queenside, &score_mg, &score_eg);
     }
-    temp = enemy_P & uo_bitboard_rank_third;
-    while (temp)
+    else
     {
-      uo_square square_enemy_P = uo_bitboard_next_square(&temp);
-      score -= uo_score_passed_pawn_on_sixth * uo_bitboard_is_passed_enemy_P(square_enemy_P, own_P);
+      score_mg = position->score.mg_P[color][is_own_K_queenside] - position->score.mg_P[!color][is_enemy_K_queenside];
+      score_eg = position->score.eg_P[color][is_enemy_K_queenside] - position->score.eg_P[!color][is_own_K_queenside];
     }
 
-    // castling rights
-    score_mg += uo_score_casting_right * (castling_right_own_OO + castling_right_own_OOO - castling_right_enemy_OO - castling_right_enemy_OOO);
+    int32_t material_percentage = material->phase;
 
-    bool both_rooks_undeveloped_own = uo_popcnt(own_R & (uo_square_bitboard(uo_square__a1) | uo_square_bitboard(uo_square__h1))) == 2;
-    bool both_rooks_undeveloped_enemy = uo_popcnt(enemy_R & (uo_square_bitboard(uo_square__a8) | uo_square_bitboard(uo_square__h8))) == 2;
+    score += score_mg * material_percentage / 100;
+    score += score_eg * (100 - material_percentage) / 100;
 
-    score_mg += uo_score_rook_stuck_in_corner * both_rooks_undeveloped_own * !(castling_right_own_OO + castling_right_own_OOO);
-    score_mg -= uo_score_rook_stuck_in_corner * both_rooks_undeveloped_enemy * !(castling_right_enemy_OO + castling_right_enemy_OOO);
+    return uo_position_evaluate_scale(position, material, score);
+  }
 
-    // king safety
-    score_mg += (uo_score_king_in_the_center * (0 != (own_K & (uo_bitboard_file(2) | uo_bitboard_file(3) | uo_bitboard_file(4) | uo_bitboard_file(5)))))
-      - (uo_score_king_in_the_center * (0 != (enemy_K & (uo_bitboard_file(2) | uo_bitboard_file(3) | uo_bitboard_file(4) | uo_bitboard_file(5)))));
+  // Static evaluation which returns the lazy evaluation instead, if it is by margin outside of the window [alpha, beta].
+  // Lazy evaluation is stored separately from static evaluation on the move history stack.
+  static inline int16_t uo_position_evaluate_bounded(uo_position *position, int16_t alpha, int16_t beta, uo_pawn_hash *pawn_hash, uo_material_hash *material_hash)
+  {
+    uo_move_history *stack = position->stack;
 
-    score_mg += (uo_score_castled_king * (square_own_K == uo_square__g1))
-      - (uo_score_castled_king * (square_enemy_K == uo_square__g8));
+    if (stack->static_eval != uo_score_unknown) return stack->static_eval;
 
-    score_mg += (uo_score_castled_king * (square_own_K == uo_square__b1))
-      - (uo_score_castled_king * (square_enemy_K == uo_square__b8));
+    // Neural network evaluation is not separable to cheap and expensive terms
+    if (uo_nnue_network) return uo_position_evaluate(position, pawn_hash, material_hash);
 
-    int32_t material_percentage = uo_position_material_percentage(position);
+    if (stack->lazy_eval == uo_score_unknown)
+    {
+      uo_material_hash_entry material_temp;
+      const uo_material_hash_entry *material = uo_position_evaluate_material(position, material_hash, &material_temp);
 
-    score += score_mg * material_percentage / 100;
-    score += score_eg * (100 - material_percentage) / 100;
+      // Specialised endgame evaluations are cheap
+      if (material->evaluate) return stack->static_eval = material->evaluate(position, material->color_strong);
 
-    assert(score < uo_score_tb_win_threshold && score > -uo_score_tb_win_threshold);
+      const uo_evaluation_parameters *parameters = uo_evaluation_parameters_current();
+      stack->lazy_eval = parameters
+        ? uo_position_evaluate_lazy(position, material, NULL, parameters)
+        : uo_position_evaluate_lazy(position, material, pawn_hash, NULL);
+    }
+
+    if ((int32_t)stack->lazy_eval - uo_score_lazy_eval_margin >= beta
+      || (int32_t)stack->lazy_eval + uo_score_lazy_eval_margin <= alpha)
+    {
+      return stack->lazy_eval;
+    }
 
-    return position->stack->static_eval = score;;
+    return uo_position_evaluate(position, pawn_hash, material_hash);
   }
 
-  static inline int16_t uo_position_evaluate_and_cache(uo_position *position, uo_move_cache *move_cache)
+  // Static evaluation using the move cache. If the result is lazy evaluation, static evaluation of the stack is left unknown.
+  static inline int16_t uo_position_evaluate_and_cache(uo_position *position, int16_t alpha, int16_t beta, uo_move_cache *move_cache, uo_pawn_hash *pawn_hash, uo_material_hash *material_hash, uo_eval_hash *eval_hash)
   {
     uo_move_history *stack = position->stack;
 
-    int16_t static_eval = stack->static_eval;
-
     if (stack->static_eval != uo_score_unknown) return stack->static_eval;
 
-
     if (stack[-1].move == 0
       && stack[-1].static_eval != uo_score_unknown)
     {
@@ -1309,21 +1730,41 @@ extern "C"
 
     move_cache = uo_move_cache_get(move_cache, stack[-1].key, stack[-1].move);
 
-    if (move_cache
-      && move_cache->is_cached.static_eval)
+    if (move_cache)
     {
-      return stack->static_eval = move_cache->static_eval;
+      if (move_cache->is_cached.static_eval) return stack->static_eval = move_cache->static_eval;
+      if (move_cache->is_cached.lazy_eval) stack->lazy_eval = move_cache->lazy_eval;
     }
 
-    stack->static_eval = uo_position_evaluate(position);
+    int16_t value;
+    bool is_shared = uo_eval_hash_get(eval_hash, position->key, &value);
 
-    if (move_cache)
+    if (is_shared)
+    {
+      stack->static_eval = value;
+    }
+    else
+    {
+      value = uo_position_evaluate_bounded(position, alpha, beta, pawn_hash, material_hash);
+    }
+
+    if (stack->static_eval != uo_score_unknown)
+    {
+      if (!is_shared) uo_eval_hash_set(eval_hash, position->key, stack->static_eval);
+
+      if (move_cache)
+      {
+        move_cache->is_cached.static_eval = true;
+        move_cache->static_eval = stack->static_eval;
+      }
+    }
+    else if (move_cache)
     {
-      move_cache->is_cached.static_eval = true;
-      move_cache->static_eval = stack->static_eval;
+      move_cache->is_cached.lazy_eval = true;
+      move_cache->lazy_eval = stack->lazy_eval;
     }
 
-    return stack->static_eval;
+    return value;
   }
 
   static inline int16_t uo_position_move_evaluation(const uo_position *position, uo_move move, uo_move_cache *move_cache)
@@ -2667,13 +3108,17 @@ extern "C"
 
   uo_move uo_position_parse_move(const uo_position *position, char str[5]);
 
+  // Parses move in long algebraic notation and returns matching legal move or zero if the move is not legal
+  uo_move uo_position_parse_legal_move(uo_position *position, char str[5]);
+
   uo_move uo_position_parse_pgn_move(uo_position *position, char *pgn);
 
   size_t uo_position_print_move(const uo_position *position, uo_move move, char str[6]);
 
   size_t uo_position_perft(uo_position *position, size_t depth, bool tactical);
 
-  uo_position *uo_position_randomize(uo_position *position, const char *pieces /* e.g. KQRPPvKRRBNP */);
+  // Sets up a random position. Random numbers are taken from the state if given, otherwise from the process-wide generator.
+  uo_position *uo_position_randomize(uo_position *position, const char *pieces /* e.g. KQRPPvKRRBNP */, uint64_t *rand_state);
 
 #ifdef __cplusplus
   }
@@ -0,0 +1,55 @@
+#ifndef UO_PROCESS_H
+#define UO_PROCESS_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+
+  // Process manager drives child processes from a single thread. Output of each child is split into lines which are
+  // passed to a callback. Writes are buffered, so that a child which is not reading its input does not block the caller,
+  // and each child can have a deadline after which a timeout callback is called. On POSIX systems, pipes are
+  // non-blocking and events are waited with epoll. On Windows, anonymous pipes cannot be waited for, so output is
+  // polled without blocking and input is written when queued.
+
+  typedef struct uo_process_manager uo_process_manager;
+  typedef struct uo_managed_process uo_managed_process;
+
+  typedef struct uo_managed_process_callbacks
+  {
+    void (*line)(void *data, char *line); // line of output without the line ending
+    void (*timeout)(void *data);          // deadline has passed, deadline is cleared before the call
+    void (*exit)(void *data);             // output has been closed, e.g. the process has exited
+  } uo_managed_process_callbacks;
+
+  uo_process_manager *uo_process_manager_create(void);
+
+  // Closes the remaining processes and waits for them to exit
+  void uo_process_manager_free(uo_process_manager *manager);
+
+  // Starts a child process. Callbacks are called with the data pointer. Returns null if the process cannot be started.
+  uo_managed_process *uo_process_manager_start(uo_process_manager *manager, char *cmdline, const uo_managed_process_callbacks *callbacks, void *data);
+
+  // Waits for events at most the given time and calls the callbacks of the events. Negative time waits until an event
+  // occurs or a deadline passes. Callbacks may start, write to and close processes. Returns the number of handled events.
+  size_t uo_process_manager_poll(uo_process_manager *manager, double timeout_msec);
+
+  // Queues text to be written to the standard input of the process
+  void uo_managed_process_write(uo_managed_process *process, const char *str);
+
+  // Sets the deadline in milliseconds from now. Negative time clears the deadline.
+  void uo_managed_process_set_timeout(uo_managed_process *process, double timeout_msec);
+
+  // Closes the pipes of the process. Callbacks are not called for the process after this. Process is expected to have
+  // been asked to exit, e.g. by writing quit. On POSIX systems, the process is reaped by polling once it has exited and
+  // a process which is still running after a grace period is killed.
+  void uo_managed_process_close(uo_managed_process *process);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
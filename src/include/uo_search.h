@@ -9,6 +9,7 @@ extern "C"
 #include "uo_thread.h"
 #include "uo_move.h"
 #include "uo_misc.h"
+#include "uo_def.h"
 
 #include <stdbool.h>
 #include <stdint.h>
@@ -30,6 +31,15 @@ extern "C"
 
   typedef struct uo_engine_thread uo_engine_thread;
 
+  typedef struct uo_root_move
+  {
+    uo_move move;
+    int16_t score;
+    int16_t previous_score;
+    size_t nodes;
+    uo_move pv[UO_PV_MAX_LENGTH];
+  } uo_root_move;
+
   typedef struct uo_search_params
   {
     uint8_t seach_type;
@@ -42,15 +52,39 @@ extern "C"
     uint64_t nodes;
     uint8_t mate;
     uint16_t movestogo;
-    bool ponder;
+    uo_atomic_int ponder; // cleared on ponderhit after time_start is updated
+    uo_time time_start;
     uo_move *searchmoves;
     int16_t alpha;
     int16_t beta;
   } uo_search_params;
 
+  // Tunable search parameters. All fields are int, so parameters can also be accessed as an array.
+  typedef struct uo_search_parameters
+  {
+#define uo_search_parameter(name, option, value, min, max) int name;
+#include "uo_search_parameters.h"
+#undef uo_search_parameter
+  } uo_search_parameters;
+
+#define uo_search_parameter_count (sizeof(uo_search_parameters) / sizeof(int))
+
+  typedef struct uo_search_parameter_option
+  {
+    const char *name;
+    int min;
+    int max;
+  } uo_search_parameter_option;
+
+  extern const uo_search_parameters uo_search_parameters_default;
+
+  // UCI option names and ranges of the parameters in the order of the description
+  extern const uo_search_parameter_option uo_search_parameter_options[];
+
   typedef struct uo_search_info
   {
     size_t nodes;
+    size_t nodes_limit; // search is stopped when node count reaches the limit if not zero
     uo_time time_start;
     uint16_t multipv;
     uint8_t depth;
@@ -64,6 +98,8 @@ extern "C"
     double movetime_remaining_msec;
     uo_move *pv;
     uo_move **secondary_pvs;
+    uo_root_move *root_moves;
+    size_t root_move_count;
   } uo_search_info;
 
   void *uo_engine_thread_start_timer(void *arg);
@@ -74,6 +110,16 @@ extern "C"
 
   void *uo_engine_thread_run_quiescence_search(void *arg);
 
+  // Searches the position of the thread by iterative deepening without time management or output. Search stops at given depth
+  // or, if node limit is not zero, when the node count reaches the limit after the first iteration. Result of the last
+  // completed iteration is used. Zero depth means no depth limit. Returns the score from the point of view of the side
+  // to move and sets best move.
+  int16_t uo_engine_thread_search(uo_engine_thread *thread, size_t depth, size_t nodes, uo_move *bestmove);
+
+  // Runs quiescence search on the position of the thread without output. Principal variation leading to the quiescent
+  // position is left to the first line of the PV table. Returns the score from the point of view of the side to move.
+  int16_t uo_engine_thread_quiesce(uo_engine_thread *thread);
+
 #ifdef __cplusplus
   }
 #endif
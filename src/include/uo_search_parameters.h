@@ -0,0 +1,30 @@
+// Tunable search parameters. This file is the single description of the parameters and it is included multiple times with
+// different definitions of uo_search_parameter(name, option, value, min, max), so it has no include guard.
+// Each parameter is exposed as an UCI spin option with the given option name, default value and range.
+// Depth extensions and reductions are in thousandths of a ply and factors are in per mille unless stated otherwise.
+
+// aspiration window
+uo_search_parameter(aspiration_window_minimum, AspirationWindowMinimum, 25, 5, 200)
+uo_search_parameter(aspiration_window_factor, AspirationWindowFactor, 1500, 1000, 4000)
+
+// null move pruning
+uo_search_parameter(nmp_depth_min, NullMoveDepthMin, 4, 2, 10)
+uo_search_parameter(nmp_depth_factor, NullMoveDepthFactor, 750, 250, 1000)
+uo_search_parameter(nmp_reduction, NullMoveReduction, 1, 0, 4)
+uo_search_parameter(nmp_verification_factor, NullMoveVerificationFactor, 750, 0, 1000)
+
+// quiescence search delta pruning
+uo_search_parameter(qsearch_delta_margin, QSearchDeltaMargin, 0, -300, 500)
+uo_search_parameter(qsearch_delta_depth_factor, QSearchDeltaDepthFactor, 76, 0, 300)
+
+// depth extensions
+uo_search_parameter(extension_passed_pawn, ExtensionPassedPawn, 1000, 0, 2000)
+uo_search_parameter(extension_check, ExtensionCheck, 600, 0, 2000)
+
+// late move reductions
+uo_search_parameter(lmr_depth_min, LmrDepthMin, 4, 2, 10)
+uo_search_parameter(lmr_depth_factor, LmrDepthFactor, 200, 0, 600)
+uo_search_parameter(lmr_move_factor, LmrMoveFactor, 50, 0, 300)
+uo_search_parameter(lmr_improvement_factor, LmrImprovementFactor, 500, 0, 1500)
+uo_search_parameter(lmr_max_base, LmrMaxBase, 1000, 0, 3000)
+uo_search_parameter(lmr_max_depth_factor, LmrMaxDepthFactor, 400, 0, 1000)
@@ -92,6 +92,36 @@ extern "C"
 
   size_t uo_squares_between(uo_square from, uo_square to, uo_square between[6]);
 
+  // Number of king moves between squares
+  static inline int uo_square_distance(uo_square square_a, uo_square square_b)
+  {
+    int file_distance = uo_square_file(square_a) - uo_square_file(square_b);
+    int rank_distance = uo_square_rank(square_a) - uo_square_rank(square_b);
+    if (file_distance < 0) file_distance = -file_distance;
+    if (rank_distance < 0) rank_distance = -rank_distance;
+    return file_distance > rank_distance ? file_distance : rank_distance;
+  }
+
+  // Sum of file and rank distances between squares
+  static inline int uo_square_distance_manhattan(uo_square square_a, uo_square square_b)
+  {
+    int file_distance = uo_square_file(square_a) - uo_square_file(square_b);
+    int rank_distance = uo_square_rank(square_a) - uo_square_rank(square_b);
+    if (file_distance < 0) file_distance = -file_distance;
+    if (rank_distance < 0) rank_distance = -rank_distance;
+    return file_distance + rank_distance;
+  }
+
+  // Manhattan distance to the nearest of the four center squares. Ranges from 0 to 6.
+  static inline int uo_square_distance_center(uo_square square)
+  {
+    int file = uo_square_file(square);
+    int rank = uo_square_rank(square);
+    int file_distance = file < 4 ? 3 - file : file - 4;
+    int rank_distance = rank < 4 ? 3 - rank : rank - 4;
+    return file_distance + rank_distance;
+  }
+
 #ifdef __cplusplus
 }
 #endif
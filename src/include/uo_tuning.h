@@ -14,9 +14,38 @@ extern "C"
 
 #include <math.h>
 
-  void uo_tuning_generate_dataset(char *dataset_filepath, char *engine_filepath, char *engine_option_commands, size_t position_count);
+  // Generates dataset of random quiescent positions labeled by searching each position to given depth or node count.
+  // Positions are generated in parallel on the engine threads and appended to the dataset file.
+  void uo_tuning_generate_dataset(char *dataset_filepath, size_t position_count, size_t depth, size_t nodes);
 
-  bool uo_tuning_train_evaluation_parameters(char *dataset_filepath);
+  // Generates dataset by playing games against itself. Games start from a random line of the openings file or from the start
+  // position followed by random moves. Each move is searched to given depth or node count. Every searched position is
+  // recorded with its score and the game result. Games are played in parallel on the engine threads.
+  void uo_tuning_generate_selfplay(char *dataset_filepath, char *openings_filepath, size_t game_count, size_t random_plies, size_t depth, size_t nodes);
+
+  // Tunes search parameters by SPSA. Game pairs between two randomly perturbed copies of the search parameters are played
+  // concurrently on the engine threads, starting from the engine options. Each move is searched to given depth or node count.
+  // Games start as in self-play and each side searches with its own transposition table which is cleared before every game.
+  // Tuned values are printed as setoption commands.
+  void uo_tuning_tune_search_parameters(char *openings_filepath, size_t game_count, size_t random_plies, size_t depth, size_t nodes);
+
+  // Preprocesses a dataset for training. Each position is replaced with the leaf of its quiescence search principal variation,
+  // or dropped if the leaf is not quiescent. Positions are deduplicated by key and written to the output in random order.
+  // Positions are processed in parallel on the engine threads and buffered in temporary files next to the output, so that
+  // only a part of the dataset set by the memory limit is held in memory at a time.
+  void uo_tuning_preprocess_dataset(char *input_filepath, char *output_filepath, size_t memory_mb);
+
+  // Evaluates packed positions and stores the scores from the point of view of the side to move. Chunks of positions are
+  // claimed by the engine threads, which unpack them into their own position. Without evaluation parameters, the current
+  // evaluation is used with the pawn and material hash tables of the thread.
+  void uo_tuning_evaluate_batch(const uo_position_packed *positions, int16_t *scores, size_t count, const uo_evaluation_parameters *parameters);
+
+  bool uo_tuning_train_evaluation_parameters(char *dataset_filepath, char *parameters_filepath, size_t epochs);
+
+  // Trains the evaluation network on a binary dataset using mini-batches split between the engine threads and Adam.
+  // Training resumes from the checkpoint file if it exists and the checkpoint is saved after each epoch.
+  // Quantized network is saved to the network file, which can be loaded as the evaluation file.
+  bool uo_tuning_train_nnue(char *dataset_filepath, char *nnue_filepath, char *checkpoint_filepath, size_t epochs, size_t batch_size);
   
 #ifdef __cplusplus
 }
@@ -284,6 +284,27 @@ extern "C"
     srand(seed);
   }
 
+  // Random numbers from an explicit state (splitmix64). Unlike with rand, each thread can have a sequence of its own
+  // which is reproducible from its seed.
+  static inline uint64_t uo_rand_u64_r(uint64_t *state)
+  {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+  }
+
+  static inline float uo_rand_percent_excl_r(uint64_t *state)
+  {
+    return (float)(uo_rand_u64_r(state) >> 40) / (float)(1 << 24);
+  }
+
+  static inline float uo_rand_between_excl_r(uint64_t *state, float min, float max_ex)
+  {
+    float range = max_ex - min;
+    return uo_rand_percent_excl_r(state) * range + min;
+  }
+
   static inline char *uo_timestr(char buf[uo_strlen("yyyymmddMMSS") + 1])
   {
     size_t size = (uo_strlen("yyyymmddMMSS") + 1) * sizeof(char);
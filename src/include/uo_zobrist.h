@@ -6,7 +6,10 @@ extern "C"
 {
 #endif
 
+#include "uo_move.h"
+
 #include <stdint.h>
+#include <stddef.h>
 
   void uo_zobrist_init();
 
@@ -17,6 +20,36 @@ extern "C"
 
 #define uo_zobkey(piece, square) uo_zobrist[((size_t)(piece) << 6) + (square)]
 
+  // Cuckoo tables of zobrist key differences of reversible moves for detecting upcoming repetitions
+  // see: http://web.archive.org/web/20201107002606/https://marcelk.net/2013-04-06/paper/upcoming-rep-v2.pdf
+#define uo_zobrist_cuckoo_size 0x2000
+
+  extern uint64_t uo_zobrist_cuckoo_keys[uo_zobrist_cuckoo_size];
+  extern uo_move uo_zobrist_cuckoo_moves[uo_zobrist_cuckoo_size];
+
+  static inline size_t uo_zobrist_cuckoo_hash1(uint64_t key)
+  {
+    return key & (uo_zobrist_cuckoo_size - 1);
+  }
+
+  static inline size_t uo_zobrist_cuckoo_hash2(uint64_t key)
+  {
+    return (key >> 16) & (uo_zobrist_cuckoo_size - 1);
+  }
+
+  // Returns the reversible move, in absolute square coordinates, which changes the zobrist key by given difference.
+  // Returns zero if there is no such move.
+  static inline uo_move uo_zobrist_cuckoo_get(uint64_t key_diff)
+  {
+    size_t i = uo_zobrist_cuckoo_hash1(key_diff);
+    if (uo_zobrist_cuckoo_keys[i] == key_diff) return uo_zobrist_cuckoo_moves[i];
+
+    i = uo_zobrist_cuckoo_hash2(key_diff);
+    if (uo_zobrist_cuckoo_keys[i] == key_diff) return uo_zobrist_cuckoo_moves[i];
+
+    return 0;
+  }
+
 #ifdef __cplusplus
 }
 #endif
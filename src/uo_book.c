@@ -1,4 +1,5 @@
 #include "uo_book.h"
+#include "uo_process.h"
 #include "uo_misc.h"
 #include "uo_util.h"
 
@@ -164,98 +165,136 @@ uo_book *uo_book_create(const char *filepath)
   return book;
 }
 
-// TODO
-void uo_nn_generate_dataset(char *dataset_filepath, char *engine_filepath, char *engine_option_commands, size_t position_count)
+typedef struct uo_nn_generate_dataset_state
+{
+  uo_managed_process *engine;
+  FILE *fp;
+  uo_position position;
+  size_t position_count;
+  size_t positions_generated;
+  int16_t score;
+  bool has_score;
+  bool is_mate;
+  bool done;
+} uo_nn_generate_dataset_state;
+
+static void uo_nn_generate_dataset_handle_line(void *data, char *line)
 {
+  uo_nn_generate_dataset_state *state = data;
+  char buffer[0x200];
   char *ptr;
-  char buffer[0x1000];
-
-  uo_rand_init(time(NULL));
-
-  uo_process *engine_process = uo_process_create(engine_filepath);
-  FILE *fp = fopen(dataset_filepath, "a");
 
-  uo_process_write_stdin(engine_process, "uci\n", 0);
-  if (engine_option_commands)
+  // Step 1. Search a random quiescent position when the engine is ready
+  if (strcmp(line, "readyok") == 0)
   {
-    uo_process_write_stdin(engine_process, engine_option_commands, 0);
-  }
+    uo_position_randomize(&state->position, NULL, NULL);
 
-  uo_position position;
+    while (!uo_position_is_quiescent(&state->position))
+    {
+      uo_position_randomize(&state->position, NULL, NULL);
+    }
+
+    state->has_score = false;
+    state->is_mate = false;
 
-  for (size_t i = 0; i < position_count; ++i)
-  {
-    uo_process_write_stdin(engine_process, "isready\n", 0);
     ptr = buffer;
-    do
-    {
-      uo_process_read_stdout(engine_process, buffer, sizeof buffer);
-      ptr = strstr(buffer, "readyok");
-    } while (!ptr);
+    ptr += sprintf(buffer, "position fen ");
+    ptr += uo_position_print_fen(&state->position, ptr);
+    ptr += sprintf(ptr, "\ngo depth 6\n");
 
-    uo_position_randomize(&position, NULL);
+    uo_managed_process_write(state->engine, buffer);
+    return;
+  }
+
+  // Step 2. Read the score of the search. Positions with mate scores are skipped.
+  if (strncmp(line, "info ", uo_strlen("info ")) == 0)
+  {
+    if (strstr(line, " score mate ")) state->is_mate = true;
 
-    while (!uo_position_is_quiescent(&position))
+    ptr = strstr(line, " score cp ");
+    if (strncmp(line, "info depth 6 ", uo_strlen("info depth 6 ")) == 0 && ptr)
     {
-      uo_position_randomize(&position, NULL);
+      state->has_score = sscanf(ptr, " score cp %hd", &state->score) == 1;
     }
 
-    ptr = buffer;
-    ptr += sprintf(buffer, "position fen ");
-    ptr += uo_position_print_fen(&position, ptr);
-    ptr += sprintf(ptr, "\n");
+    return;
+  }
 
-    uo_process_write_stdin(engine_process, buffer, 0);
+  if (strncmp(line, "bestmove ", uo_strlen("bestmove ")) != 0) return;
+
+  // Step 3. Write the position and the score from the point of view of white
+  if (state->has_score && !state->is_mate)
+  {
+    int16_t score = state->score;
+    if (uo_color(state->position.flags) == uo_black) score *= -1;
 
-    uo_process_write_stdin(engine_process, "isready\n", 0);
     ptr = buffer;
-    do
+    ptr += uo_position_print_fen(&state->position, ptr);
+    ptr += sprintf(ptr, ",%+d\n", score);
+    fprintf(state->fp, "%s", buffer);
+
+    if (++state->positions_generated % 1000 == 0)
     {
-      uo_process_read_stdout(engine_process, buffer, sizeof buffer);
-      ptr = strstr(buffer, "readyok");
-    } while (!ptr);
+      printf("positions generated: %zu\n", state->positions_generated);
+    }
+  }
 
-    uo_process_write_stdin(engine_process, "go depth 6\n", 0);
+  // Step 4. Start next position
+  if (state->positions_generated == state->position_count)
+  {
+    state->done = true;
+    return;
+  }
 
-    do
-    {
-      uo_process_read_stdout(engine_process, buffer, sizeof buffer);
+  uo_managed_process_write(state->engine, "ucinewgame\nisready\n");
+}
 
-      char *mate = strstr(buffer, "score mate ");
-      char *nomoves = strstr(buffer, "bestmove (none)");
-      if (mate || nomoves)
-      {
-        --i;
-        goto next_position;
-      }
+static void uo_nn_generate_dataset_handle_exit(void *data)
+{
+  uo_nn_generate_dataset_state *state = data;
+  printf("engine exited\n");
+  state->done = true;
+}
+
+void uo_nn_generate_dataset(char *dataset_filepath, char *engine_filepath, char *engine_option_commands, size_t position_count)
+{
+  static const uo_managed_process_callbacks callbacks = {
+    .line = uo_nn_generate_dataset_handle_line,
+    .exit = uo_nn_generate_dataset_handle_exit
+  };
 
-      ptr = strstr(buffer, "info depth 6");
-    } while (!ptr);
+  uo_rand_init(time(NULL));
 
-    ptr = strstr(ptr, "score");
+  uo_nn_generate_dataset_state state = {
+    .position_count = position_count,
+    .done = position_count == 0
+  };
 
-    int16_t score;
-    if (sscanf(ptr, "score cp %hd", &score) == 1)
-    {
-      if (uo_color(position.flags) == uo_black) score *= -1.0f;
+  uo_process_manager *manager = uo_process_manager_create();
+  state.engine = uo_process_manager_start(manager, engine_filepath, &callbacks, &state);
 
-      char *ptr = buffer;
-      ptr += uo_position_print_fen(&position, ptr);
-      ptr += sprintf(ptr, ",%+d\n", score);
-      fprintf(fp, "%s", buffer);
-    }
+  if (!state.engine)
+  {
+    printf("Unable to start engine '%s'\n", engine_filepath);
+    uo_process_manager_free(manager);
+    return;
+  }
 
-    if ((i + 1) % 1000 == 0)
-    {
-      printf("positions generated: %zu\n", i + 1);
-    }
+  state.fp = fopen(dataset_filepath, "a");
 
-  next_position:
-    uo_process_write_stdin(engine_process, "ucinewgame\n", 0);
+  uo_managed_process_write(state.engine, "uci\n");
+  if (engine_option_commands)
+  {
+    uo_managed_process_write(state.engine, engine_option_commands);
   }
+  uo_managed_process_write(state.engine, "isready\n");
 
-  uo_process_write_stdin(engine_process, "quit\n", 0);
+  while (!state.done)
+  {
+    uo_process_manager_poll(manager, -1);
+  }
 
-  uo_process_free(engine_process);
-  fclose(fp);
+  uo_managed_process_write(state.engine, "quit\n");
+  uo_process_manager_free(manager);
+  fclose(state.fp);
 }
@@ -0,0 +1,269 @@
+#include "uo_dataset.h"
+#include "uo_misc.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct uo_dataset_file_header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t reserved;
+} uo_dataset_file_header;
+
+bool uo_dataset_record_pack(const uo_position *position, int16_t score, int8_t result, uo_dataset_record *record)
+{
+  uo_bitboard occupied = position->own | position->enemy;
+  if (uo_popcnt(occupied) > 2 * sizeof record->pieces) return false;
+
+  memset(record, 0, sizeof * record);
+
+  record->occupied = occupied;
+  record->flags = position->flags;
+  record->score = score;
+  record->ply = position->root_ply + position->ply;
+  record->result = result;
+
+  size_t i = 0;
+
+  while (occupied)
+  {
+    uo_square square = uo_bitboard_next_square(&occupied);
+    uo_bitboard mask = uo_square_bitboard(square);
+
+    // Piece type from bitboards and color bit set for pieces of the side not to move
+    uo_piece piece = uo_piece__P;
+    while (!(position->bitboards[1 + (piece >> 1)] & mask)) piece += 2;
+    if (position->enemy & mask) piece |= 1;
+
+    record->pieces[i >> 1] |= piece << ((i & 1) << 2);
+    ++i;
+  }
+
+  return true;
+}
+
+bool uo_dataset_record_parse_csv(uo_position *position, char *line, uo_dataset_record *record)
+{
+  // Step 1. Parse position
+  char *eval = strchr(line, ',');
+  if (!eval || !uo_position_from_fen(position, line)) return false;
+
+  ++eval;
+
+  // Step 2. Parse score from white's point of view
+  int16_t score;
+
+  if (eval[0] == '#')
+  {
+    score = eval[1] == '-' ? -uo_score_checkmate : uo_score_checkmate;
+  }
+  else
+  {
+    char *end;
+    long cp = strtol(eval, &end, 10);
+    if (end == eval) return false;
+    score = cp > uo_score_mate_in_threshold ? uo_score_mate_in_threshold
+      : cp < -uo_score_mate_in_threshold ? -uo_score_mate_in_threshold
+      : cp;
+  }
+
+  // Step 3. Parse optional game result from white's point of view
+  int8_t result = uo_dataset_result_unknown;
+  char *result_str = strchr(eval, ',');
+
+  if (result_str)
+  {
+    char *end;
+    long value = strtol(result_str + 1, &end, 10);
+    if (end != result_str + 1 && value >= -1 && value <= 1) result = value;
+  }
+
+  // Step 4. Store record from the point of view of the side to move
+  if (uo_color(position->flags) == uo_black)
+  {
+    score = -score;
+    if (result != uo_dataset_result_unknown) result = -result;
+  }
+
+  return uo_dataset_record_pack(position, score, result, record);
+}
+
+size_t uo_dataset_record_print_csv(uo_position *position, const uo_dataset_record *record, char line[0x100])
+{
+  uo_position_packed packed;
+  uo_dataset_record_unpack(record, &packed);
+  uo_position_unpack(position, &packed);
+  position->root_ply = record->ply;
+
+  bool is_black = uo_color(record->flags) == uo_black;
+  int16_t score = is_black ? -record->score : record->score;
+
+  char *ptr = line;
+  ptr += uo_position_print_fen(position, ptr);
+
+  if (uo_score_is_checkmate(score))
+  {
+    ptr += sprintf(ptr, score > 0 ? ",#+1" : ",#-1");
+  }
+  else
+  {
+    ptr += sprintf(ptr, ",%+d", score);
+  }
+
+  if (record->result != uo_dataset_result_unknown)
+  {
+    ptr += sprintf(ptr, ",%d", is_black ? -record->result : record->result);
+  }
+
+  *ptr++ = '\n';
+  *ptr = '\0';
+
+  return ptr - line;
+}
+
+static bool uo_dataset_write_header(FILE *fp)
+{
+  uo_dataset_file_header header = {
+    .magic = UO_DATASET_FILE_MAGIC,
+    .version = UO_DATASET_FILE_VERSION,
+    .record_size = sizeof(uo_dataset_record)
+  };
+
+  return fwrite(&header, sizeof header, 1, fp) == 1;
+}
+
+FILE *uo_dataset_open_append(const char *filepath)
+{
+  FILE *fp = fopen(filepath, "ab");
+  if (!fp) return NULL;
+
+  // Stream position of a new file is zero after seeking to the end
+  fseek(fp, 0, SEEK_END);
+
+  if (ftell(fp) == 0 && !uo_dataset_write_header(fp))
+  {
+    fclose(fp);
+    return NULL;
+  }
+
+  return fp;
+}
+
+FILE *uo_dataset_open_write(const char *filepath)
+{
+  FILE *fp = fopen(filepath, "wb");
+  if (!fp) return NULL;
+
+  if (!uo_dataset_write_header(fp))
+  {
+    fclose(fp);
+    return NULL;
+  }
+
+  return fp;
+}
+
+uo_dataset *uo_dataset_open_read(const char *filepath)
+{
+  // Step 1. Map dataset file into memory
+  uo_file_mmap *file_mmap = uo_file_mmap_open_read(filepath);
+  if (!file_mmap) return NULL;
+
+  // Step 2. Validate header
+  uo_dataset_file_header header;
+
+  if (file_mmap->size < sizeof header)
+  {
+    uo_file_mmap_close(file_mmap);
+    return NULL;
+  }
+
+  memcpy(&header, file_mmap->ptr, sizeof header);
+
+  if (header.magic != UO_DATASET_FILE_MAGIC
+    || header.version != UO_DATASET_FILE_VERSION
+    || header.record_size != sizeof(uo_dataset_record))
+  {
+    uo_file_mmap_close(file_mmap);
+    return NULL;
+  }
+
+  // Step 3. Records follow the header. Incomplete record at the end of the file, e.g. from an interrupted write, is ignored.
+  uo_dataset *dataset = malloc(sizeof * dataset);
+  dataset->file_mmap = file_mmap;
+  dataset->records = (const uo_dataset_record *)(file_mmap->ptr + sizeof header);
+  dataset->count = (file_mmap->size - sizeof header) / sizeof(uo_dataset_record);
+
+  return dataset;
+}
+
+void uo_dataset_close(uo_dataset *dataset)
+{
+  uo_file_mmap_close(dataset->file_mmap);
+  free(dataset);
+}
+
+size_t uo_dataset_convert(const char *input_filepath, const char *output_filepath)
+{
+  uo_position *position = malloc(sizeof * position);
+  size_t count = 0;
+  FILE *fp = NULL;
+
+  uo_dataset *dataset = uo_dataset_open_read(input_filepath);
+
+  if (dataset)
+  {
+    // Step 1a. Binary to csv
+    fp = fopen(output_filepath, "w");
+    if (!fp) goto cleanup;
+
+    char line[0x100];
+
+    for (; count < dataset->count; ++count)
+    {
+      uo_dataset_record_print_csv(position, dataset->records + count, line);
+      fputs(line, fp);
+    }
+  }
+  else
+  {
+    // Step 1b. Csv to binary
+    uo_file_mmap *file_mmap = uo_file_mmap_open_read(input_filepath);
+    if (!file_mmap) goto cleanup;
+
+    fp = uo_dataset_open_write(output_filepath);
+
+    if (!fp)
+    {
+      uo_file_mmap_close(file_mmap);
+      goto cleanup;
+    }
+
+    uo_dataset_record record;
+    char *line = uo_file_mmap_readline(file_mmap);
+
+    while (line && *line)
+    {
+      if (uo_dataset_record_parse_csv(position, line, &record))
+      {
+        fwrite(&record, sizeof record, 1, fp);
+        ++count;
+      }
+
+      line = uo_file_mmap_readline(file_mmap);
+    }
+
+    uo_file_mmap_close(file_mmap);
+  }
+
+cleanup:
+  if (fp) fclose(fp);
+  if (dataset) uo_dataset_close(dataset);
+  free(position);
+
+  return count;
+}
@@ -43,8 +43,17 @@ void uo_engine_load_default_options()
     }
   }
 
+  engine_options.eval_hash_size = 16;
+  envopt = getenv("UO_OPT_EVALHASH");
+  if (envopt)
+  {
+    engine_options.eval_hash_size = strtoul(envopt, NULL, 10);
+  }
+
   engine_options.move_overhead = 10;
 
+  engine_options.search_parameters = uo_search_parameters_default;
+
   engine_options.use_own_book = true;
 
   strcpy(engine_options.book_filename, "books/default-book.txt");
@@ -141,12 +150,47 @@ void *uo_engine_thread_run(void *arg)
     uo_semaphore_wait(thread->semaphore);
     uo_atomic_store(&thread->cutoff, 0);
     thread->owner = NULL;
+    thread->search_parameters = &engine_options.search_parameters;
+    thread->ttable = &engine.ttable;
+    thread->eval_hash.entries = engine.eval_hash.entries;
+    thread->eval_hash.hash_mask = engine.eval_hash.hash_mask;
     thread_return = thread->function(thread);
   }
 
   return thread_return;
 }
 
+static void uo_engine_init_eval_hash()
+{
+  size_t capacity = engine_options.eval_hash_size * (size_t)1000000 / sizeof * engine.eval_hash.entries;
+  uo_eval_hash_init(&engine.eval_hash, capacity ? (size_t)1 << uo_msb(capacity) : 0);
+}
+
+// Evaluation file is loaded as a network or, if it is not a network file, as hand crafted evaluation parameters.
+// Hand crafted evaluation with the compile time constants is used if neither can be loaded.
+static void uo_engine_load_eval_file()
+{
+  if (uo_nnue_network)
+  {
+    uo_nnue_free(uo_nnue_network);
+    uo_nnue_network = NULL;
+  }
+
+  if (uo_evaluation_parameters_active)
+  {
+    uo_evaluation_parameters_free(uo_evaluation_parameters_active);
+    uo_evaluation_parameters_active = NULL;
+  }
+
+  strcpy(engine.eval_filename, engine_options.eval_filename);
+  if (!*engine.eval_filename) return;
+
+  uo_nnue_network = uo_nnue_create(engine.eval_filename);
+  if (uo_nnue_network) return;
+
+  uo_evaluation_parameters_active = uo_evaluation_parameters_create(engine.eval_filename);
+}
+
 void uo_engine_init()
 {
   // stopped flag
@@ -168,9 +212,6 @@ void uo_engine_init()
   // search_queue
   uo_atomic_queue_init(&engine.search_queue, UO_PARALLEL_MAX_COUNT, NULL);
 
-  // nn eval_filename
-  char *eval_filename = engine_options.eval_filename[0] ? engine_options.eval_filename : NULL;
-
   for (size_t i = 0; i < engine.thread_count; ++i)
   {
     uo_engine_thread *thread = engine.threads + i;
@@ -185,12 +226,18 @@ void uo_engine_init()
   size_t capacity = engine_options.hash_size * (size_t)1000000 / sizeof * engine.ttable.entries;
   uo_ttable_init(&engine.ttable, uo_msb(capacity) + 1);
 
+  // evaluation hash table
+  uo_engine_init_eval_hash();
+
   // opening book
   if (engine_options.use_own_book && *engine_options.book_filename)
   {
     engine.book = uo_book_create(engine_options.book_filename);
   }
 
+  // evaluation file
+  uo_engine_load_eval_file();
+
   // syzygy
   engine.tb.enabled = *engine_options.tb.syzygy.dir != '\0';
   if (engine.tb.enabled)
@@ -267,6 +314,10 @@ void uo_engine_reconfigure()
   size_t capacity = engine_options.hash_size * (size_t)1000000 / sizeof * engine.ttable.entries;
   uo_ttable_init(&engine.ttable, uo_msb(capacity) + 1);
 
+  // evaluation hash table
+  uo_eval_hash_free(&engine.eval_hash);
+  uo_engine_init_eval_hash();
+
   // opening book
   if (engine.book)
   {
@@ -277,6 +328,18 @@ void uo_engine_reconfigure()
   {
     engine.book = uo_book_create(engine_options.book_filename);
   }
+
+  // evaluation file
+  if (strcmp(engine.eval_filename, engine_options.eval_filename))
+  {
+    uo_engine_load_eval_file();
+
+    uo_eval_hash_clear(&engine.eval_hash);
+    engine.position.nnue[engine.position.ply].computed[0] = false;
+    engine.position.nnue[engine.position.ply].computed[1] = false;
+    engine.position.stack->static_eval = uo_score_unknown;
+    engine.position.stack->lazy_eval = uo_score_unknown;
+  }
 }
 
 static uo_thread_function *uo_search_thread_run_function[] = {
@@ -286,6 +349,7 @@ static uo_thread_function *uo_search_thread_run_function[] = {
 
 void uo_engine_start_search()
 {
+  uo_time_now(&engine.search_params.time_start);
   uo_atomic_store(&engine.stopped, 0);
   uo_engine_run_thread(uo_search_thread_run_function[engine.search_params.seach_type], NULL);
 }
@@ -1,18 +1,116 @@
 #include "uo_evaluation.h"
+#include "uo_misc.h"
 
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const uo_evaluation_parameters uo_evaluation_parameters_default = {
+#define uo_evaluation_parameter(name, value) .name = value,
+#include "uo_evaluation_parameters.h"
+#undef uo_evaluation_parameter
+};
+
+const char *const uo_evaluation_parameter_names[] = {
+#define uo_evaluation_parameter(name, value) #name,
+#include "uo_evaluation_parameters.h"
+#undef uo_evaluation_parameter
+};
+
+uo_evaluation_parameters *uo_evaluation_parameters_active = NULL;
+
+const char *const uo_evaluation_term_names[uo_evaluation_term_count] = {
+  [uo_evaluation_term_tempo] = "tempo",
+  [uo_evaluation_term_attacks] = "attacks",
+  [uo_evaluation_term_material] = "material",
+  [uo_evaluation_term_pawn_structure] = "pawn structure",
+  [uo_evaluation_term_mobility_P] = "mobility P",
+  [uo_evaluation_term_mobility_N] = "mobility N",
+  [uo_evaluation_term_mobility_B] = "mobility B",
+  [uo_evaluation_term_mobility_R] = "mobility R",
+  [uo_evaluation_term_mobility_Q] = "mobility Q",
+  [uo_evaluation_term_king_attacks] = "king attacks",
+  [uo_evaluation_term_king_safety] = "king safety",
+  [uo_evaluation_term_pawn_squares] = "pawn squares",
+  [uo_evaluation_term_castling] = "castling",
+  [uo_evaluation_term_king_placement] = "king placement"
+};
+
+typedef struct uo_evaluation_parameters_file_header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t count;
+} uo_evaluation_parameters_file_header;
+
+uo_evaluation_parameters *uo_evaluation_parameters_create(const char *filepath)
+{
+  // Step 1. Open parameter file for reading
+  uo_file_mmap *file_mmap = uo_file_mmap_open_read(filepath);
+  if (!file_mmap) return NULL;
+
+  // Step 2. Validate header and file size
+  uo_evaluation_parameters_file_header header;
+
+  if (file_mmap->size != sizeof header + sizeof(uo_evaluation_parameters))
+  {
+    uo_file_mmap_close(file_mmap);
+    return NULL;
+  }
+
+  memcpy(&header, file_mmap->ptr, sizeof header);
+
+  if (header.magic != UO_EVALUATION_PARAMETERS_FILE_MAGIC
+    || header.version != UO_EVALUATION_PARAMETERS_FILE_VERSION
+    || header.count != uo_evaluation_parameter_count)
+  {
+    uo_file_mmap_close(file_mmap);
+    return NULL;
+  }
+
+  // Step 3. Copy parameters
+  uo_evaluation_parameters *parameters = malloc(sizeof * parameters);
+  memcpy(parameters, file_mmap->ptr + sizeof header, sizeof * parameters);
+  uo_file_mmap_close(file_mmap);
+
+  return parameters;
+}
+
+void uo_evaluation_parameters_free(uo_evaluation_parameters *parameters)
+{
+  free(parameters);
+}
+
+bool uo_evaluation_parameters_save(const uo_evaluation_parameters *parameters, const char *filepath)
+{
+  FILE *fp = fopen(filepath, "wb");
+  if (!fp) return false;
+
+  uo_evaluation_parameters_file_header header = {
+    .magic = UO_EVALUATION_PARAMETERS_FILE_MAGIC,
+    .version = UO_EVALUATION_PARAMETERS_FILE_VERSION,
+    .count = uo_evaluation_parameter_count
+  };
+
+  bool success = fwrite(&header, sizeof header, 1, fp) == 1
+    && fwrite(parameters, sizeof * parameters, 1, fp) == 1;
+
+  fclose(fp);
+  return success;
+}
 
 const int16_t score_attacks_to_K[100] = {
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-  0, 0, 3, 6, 10, 13, 16, 19, 22, 26, 
-  29, 32, 35, 38, 42, 45, 48, 51, 55, 58, 
-  61, 64, 67, 71, 74, 77, 80, 83, 87, 90, 
-  93, 131, 168, 206, 243, 281, 318, 356, 393, 431, 
-  468, 506, 543, 581, 618, 618, 618, 618, 618, 618, 
-  618, 618, 618, 618, 618, 618, 618, 618, 618, 618, 
-  618, 618, 618, 618, 618, 618, 618, 618, 618, 618, 
-  618, 618, 618, 618, 618, 618, 618, 618, 618, 618, 
-  618, 618, 618, 618, 618, 618, 618, 618, 618, 618
+  score_attacks_to_K_0, score_attacks_to_K_1, score_attacks_to_K_2, score_attacks_to_K_3, score_attacks_to_K_4, score_attacks_to_K_5, score_attacks_to_K_6, score_attacks_to_K_7, score_attacks_to_K_8, score_attacks_to_K_9,
+  score_attacks_to_K_10, score_attacks_to_K_11, score_attacks_to_K_12, score_attacks_to_K_13, score_attacks_to_K_14, score_attacks_to_K_15, score_attacks_to_K_16, score_attacks_to_K_17, score_attacks_to_K_18, score_attacks_to_K_19,
+  score_attacks_to_K_20, score_attacks_to_K_21, score_attacks_to_K_22, score_attacks_to_K_23, score_attacks_to_K_24, score_attacks_to_K_25, score_attacks_to_K_26, score_attacks_to_K_27, score_attacks_to_K_28, score_attacks_to_K_29,
+  score_attacks_to_K_30, score_attacks_to_K_31, score_attacks_to_K_32, score_attacks_to_K_33, score_attacks_to_K_34, score_attacks_to_K_35, score_attacks_to_K_36, score_attacks_to_K_37, score_attacks_to_K_38, score_attacks_to_K_39,
+  score_attacks_to_K_40, score_attacks_to_K_41, score_attacks_to_K_42, score_attacks_to_K_43, score_attacks_to_K_44, score_attacks_to_K_45, score_attacks_to_K_46, score_attacks_to_K_47, score_attacks_to_K_48, score_attacks_to_K_49,
+  score_attacks_to_K_50, score_attacks_to_K_51, score_attacks_to_K_52, score_attacks_to_K_53, score_attacks_to_K_54, score_attacks_to_K_55, score_attacks_to_K_56, score_attacks_to_K_57, score_attacks_to_K_58, score_attacks_to_K_59,
+  score_attacks_to_K_60, score_attacks_to_K_61, score_attacks_to_K_62, score_attacks_to_K_63, score_attacks_to_K_64, score_attacks_to_K_65, score_attacks_to_K_66, score_attacks_to_K_67, score_attacks_to_K_68, score_attacks_to_K_69,
+  score_attacks_to_K_70, score_attacks_to_K_71, score_attacks_to_K_72, score_attacks_to_K_73, score_attacks_to_K_74, score_attacks_to_K_75, score_attacks_to_K_76, score_attacks_to_K_77, score_attacks_to_K_78, score_attacks_to_K_79,
+  score_attacks_to_K_80, score_attacks_to_K_81, score_attacks_to_K_82, score_attacks_to_K_83, score_attacks_to_K_84, score_attacks_to_K_85, score_attacks_to_K_86, score_attacks_to_K_87, score_attacks_to_K_88, score_attacks_to_K_89,
+  score_attacks_to_K_90, score_attacks_to_K_91, score_attacks_to_K_92, score_attacks_to_K_93, score_attacks_to_K_94, score_attacks_to_K_95, score_attacks_to_K_96, score_attacks_to_K_97, score_attacks_to_K_98, score_attacks_to_K_99
 };
 
 const int16_t score_piece_attacked_by_enemy[] = {
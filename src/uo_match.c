@@ -0,0 +1,559 @@
+#include "uo_match.h"
+#include "uo_position.h"
+#include "uo_process.h"
+#include "uo_misc.h"
+#include "uo_util.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define uo_match_command_size 0x4000
+
+// Time an engine has to send the best move after stop before it is restarted
+#define uo_match_stop_timeout_msec 1000.0
+
+// Commands sent to the engines after start. Threads and hash are kept small, so that concurrent games do not compete
+// for the cores, and engines are required to search the openings.
+#define uo_match_engine_setup_commands \
+  "uci\n" \
+  "setoption name Threads value 1\n" \
+  "setoption name Hash value 16\n" \
+  "setoption name OwnBook value false\n" \
+  "isready\n"
+
+typedef enum uo_match_engine_state
+{
+  uo_match_engine_state__starting, // waiting for readyok
+  uo_match_engine_state__ready,
+  uo_match_engine_state__thinking
+} uo_match_engine_state;
+
+typedef struct uo_match uo_match;
+typedef struct uo_match_game uo_match_game;
+
+typedef struct uo_match_engine
+{
+  uo_match *match;
+  uo_match_game *game;
+  char *cmdline;
+  uo_managed_process *process;
+  uo_match_engine_state state;
+  bool stopping; // best move of a search which was stopped after the game was decided is discarded
+  char name[0x10];
+} uo_match_engine;
+
+typedef enum uo_match_game_state
+{
+  uo_match_game_state__none,
+  uo_match_game_state__starting,
+  uo_match_game_state__playing
+} uo_match_game_state;
+
+struct uo_match_game
+{
+  uo_match_engine engines[2];
+  uo_match_game_state state;
+  size_t index;
+  size_t white;         // index of the engine playing white
+  size_t ply;
+  double clock_msec[2]; // remaining time of white and black
+  uo_time time_go;
+  uo_position position;
+  char *command_end;
+  char command[uo_match_command_size]; // position command of the game
+};
+
+struct uo_match
+{
+  const uo_match_options *options;
+  char **openings;
+  size_t opening_count;
+  uint64_t seed;
+  uo_process_manager *manager;
+  uo_match_game *games;
+  size_t games_started;
+  size_t games_finished;
+  size_t results[3]; // losses, draws and wins of the first engine
+  double llr_lower;
+  double llr_upper;
+  bool decided;
+  uo_time time_start;
+};
+
+static void uo_match_print_report(uo_match *match)
+{
+  const size_t *results = match->results;
+  double n = match->games_finished;
+  double mean, var;
+  uo_match_score_stats(results, &mean, &var);
+
+  // Elo difference and its 95% confidence interval. Interval is omitted until there are different results.
+  double elo = uo_match_score_to_elo(mean);
+  char elo_error[0x20] = "";
+  if (var > 0.0) sprintf(elo_error, " +- %.1f", uo_match_elo_error(results));
+
+  double llr = uo_match_llr(results, match->options->elo0, match->options->elo1);
+  double time_msec = uo_time_elapsed_msec(&match->time_start);
+
+  printf("games: %zu (+%zu =%zu -%zu), score: %.1f%%, elo: %.1f%s, llr: %.2f (%.2f, %.2f), games per second: %.2f\n",
+    match->games_finished, results[2], results[1], results[0], mean * 100.0, elo, elo_error,
+    llr, match->llr_lower, match->llr_upper, n / time_msec * 1000.0);
+  fflush(stdout);
+}
+
+static inline void uo_match_engine_write(uo_match_engine *engine, const char *command)
+{
+  uo_managed_process_write(engine->process, command);
+}
+
+static void uo_match_engine_handle_line(void *data, char *line);
+static void uo_match_engine_handle_timeout(void *data);
+static void uo_match_engine_handle_exit(void *data);
+
+static const uo_managed_process_callbacks uo_match_engine_callbacks = {
+  .line = uo_match_engine_handle_line,
+  .timeout = uo_match_engine_handle_timeout,
+  .exit = uo_match_engine_handle_exit
+};
+
+static bool uo_match_engine_start(uo_match_engine *engine)
+{
+  engine->process = uo_process_manager_start(engine->match->manager, engine->cmdline, &uo_match_engine_callbacks, engine);
+  if (!engine->process) return false;
+
+  engine->state = uo_match_engine_state__starting;
+  engine->stopping = false;
+  uo_match_engine_write(engine, uo_match_engine_setup_commands);
+
+  return true;
+}
+
+static void uo_match_engine_stop(uo_match_engine *engine)
+{
+  if (!engine->process) return;
+
+  uo_match_engine_write(engine, "quit\n");
+  uo_managed_process_close(engine->process);
+  engine->process = NULL;
+}
+
+// Replaces the process of an engine which has exited or is not responding
+static void uo_match_engine_restart(uo_match_engine *engine)
+{
+  uo_match_engine_stop(engine);
+
+  if (!uo_match_engine_start(engine))
+  {
+    printf("Unable to start engine '%s'\n", engine->cmdline);
+    engine->match->decided = true;
+  }
+}
+
+// Sets up the opening position of a game pair: a line of the openings file and its moves followed by random moves.
+// Returns false if the game ended during the opening.
+static bool uo_match_opening(uo_match *match, size_t pair, uo_position *position)
+{
+  uint64_t state = match->seed + pair;
+  const char *line = match->opening_count ? match->openings[(match->seed + pair) % match->opening_count] : uo_fen_startpos;
+
+  if (!uo_position_from_fen(position, line)) return false;
+
+  // Step 1. Play the moves of the opening line
+  const char *pv = strstr(line, " pv ");
+
+  if (pv)
+  {
+    char token[0x10];
+    int len;
+    pv += uo_strlen(" pv ");
+
+    while (sscanf(pv, "%15s%n", token, &len) == 1)
+    {
+      uo_move move = uo_position_parse_legal_move(position, token);
+      if (!move) break;
+
+      uo_position_make_move(position, move, 0, 0);
+      uo_position_reset_root(position);
+      pv += len;
+    }
+  }
+
+  // Step 2. Play random moves
+  for (size_t i = 0; i < match->options->random_plies; ++i)
+  {
+    size_t move_count = uo_position_generate_moves(position);
+    if (move_count == 0) return false;
+
+    uo_move move = position->movelist.head[uo_rand_u64_r(&state) % move_count];
+    uo_position_make_move(position, move, 0, 0);
+    uo_position_reset_root(position);
+  }
+
+  return uo_position_generate_moves(position) > 0;
+}
+
+static inline bool uo_match_is_insufficient_material(const uo_position *position)
+{
+  size_t piece_count = uo_popcnt(position->own | position->enemy);
+  return piece_count == 2 || (piece_count == 3 && (position->N | position->B));
+}
+
+static void uo_match_game_finish(uo_match *match, uo_match_game *game, int result_white, const char *reason)
+{
+  // Step 1. Stop search which is still running
+  for (size_t i = 0; i < 2; ++i)
+  {
+    uo_match_engine *engine = game->engines + i;
+
+    if (engine->state == uo_match_engine_state__thinking && !engine->stopping)
+    {
+      uo_match_engine_write(engine, "stop\n");
+      uo_managed_process_set_timeout(engine->process, uo_match_stop_timeout_msec);
+      engine->stopping = true;
+    }
+  }
+
+  game->state = uo_match_game_state__none;
+
+  // Step 2. Record result from the point of view of the first engine
+  int result = game->white == 0 ? result_white : -result_white;
+  ++match->results[result + 1];
+  ++match->games_finished;
+
+  const char *result_str = result_white > 0 ? "1-0" : result_white < 0 ? "0-1" : "1/2-1/2";
+  printf("game %zu: %s - %s %s (%s)\n", game->index + 1,
+    game->engines[game->white].name, game->engines[!game->white].name, result_str, reason);
+
+  // Step 3. Report and check whether the test is decided
+  uo_match_print_report(match);
+
+  double llr = uo_match_llr(match->results, match->options->elo0, match->options->elo1);
+
+  if (!match->decided && (llr >= match->llr_upper || llr <= match->llr_lower))
+  {
+    match->decided = true;
+    printf("sprt: %s accepted\n", llr >= match->llr_upper ? "H1" : "H0");
+    fflush(stdout);
+  }
+}
+
+static void uo_match_game_go(uo_match *match, uo_match_game *game)
+{
+  char go[0x100];
+  bool is_white = uo_color(game->position.flags) == uo_white;
+  uo_match_engine *engine = game->engines + (is_white ? game->white : !game->white);
+
+  sprintf(go, "\ngo wtime %.0f btime %.0f winc %.0f binc %.0f\n",
+    uo_max(game->clock_msec[0], 1.0), uo_max(game->clock_msec[1], 1.0), match->options->inc_msec, match->options->inc_msec);
+
+  uo_match_engine_write(engine, game->command);
+  uo_match_engine_write(engine, go);
+  engine->state = uo_match_engine_state__thinking;
+  uo_time_now(&game->time_go);
+
+  // Game is lost on time if the engine does not move before the clock and the margin have run out
+  double clock_msec = game->clock_msec[!is_white];
+  uo_managed_process_set_timeout(engine->process, uo_max(0.0, clock_msec + match->options->time_margin_msec));
+}
+
+static void uo_match_game_start(uo_match *match, uo_match_game *game)
+{
+  // Step 1. Set up opening. Games of a pair are played from the same opening with colors swapped.
+  game->index = match->games_started++;
+  game->white = game->index & 1;
+  game->ply = 0;
+
+  while (!uo_match_opening(match, game->index / 2, &game->position))
+  {
+    // Opening line ends the game, so skip to another one
+    match->seed += 0x10000;
+  }
+
+  char *ptr = game->command;
+  ptr += sprintf(ptr, "position fen ");
+  ptr += uo_position_print_fen(&game->position, ptr);
+  game->command_end = ptr;
+
+  game->clock_msec[0] = match->options->time_msec;
+  game->clock_msec[1] = match->options->time_msec;
+
+  // Step 2. Start new game on both engines and wait for them to be ready
+  for (size_t i = 0; i < 2; ++i)
+  {
+    uo_match_engine_write(game->engines + i, "ucinewgame\nisready\n");
+    game->engines[i].state = uo_match_engine_state__starting;
+  }
+
+  game->state = uo_match_game_state__starting;
+}
+
+static void uo_match_game_bestmove(uo_match *match, uo_match_game *game, uo_match_engine *engine, char *move_str)
+{
+  uo_position *position = &game->position;
+  bool is_white = uo_color(position->flags) == uo_white;
+  const char *name = engine->name;
+
+  // Step 1. Update clock
+  uo_managed_process_set_timeout(engine->process, -1);
+  double *clock_msec = game->clock_msec + !is_white;
+  *clock_msec -= uo_time_elapsed_msec(&game->time_go);
+
+  if (*clock_msec < -match->options->time_margin_msec)
+  {
+    uo_match_game_finish(match, game, is_white ? -1 : 1, "loss on time");
+    return;
+  }
+
+  *clock_msec += match->options->inc_msec;
+
+  // Step 2. Make move
+  char move_token[0x10] = { 0 };
+  sscanf(move_str, "%15s", move_token);
+  uo_move move = uo_position_parse_legal_move(position, move_token);
+
+  if (!move)
+  {
+    printf("illegal move from %s: %s\n", name, move_token);
+    uo_match_game_finish(match, game, is_white ? -1 : 1, "illegal move");
+    return;
+  }
+
+  if (game->command_end + 8 >= game->command + uo_match_command_size)
+  {
+    uo_match_game_finish(match, game, 0, "move limit");
+    return;
+  }
+
+  if (game->ply++ == 0) game->command_end += sprintf(game->command_end, " moves");
+  *game->command_end++ = ' ';
+  game->command_end += uo_position_print_move(position, move, game->command_end);
+
+  uo_position_make_move(position, move, 0, 0);
+  uo_position_reset_root(position);
+
+  // Step 3. Check whether the game is over
+  if (uo_position_generate_moves(position) == 0)
+  {
+    if (uo_position_is_check(position))
+    {
+      uo_match_game_finish(match, game, is_white ? 1 : -1, "checkmate");
+    }
+    else
+    {
+      uo_match_game_finish(match, game, 0, "stalemate");
+    }
+
+    return;
+  }
+
+  if (uo_position_is_rule50_draw(position))
+  {
+    uo_match_game_finish(match, game, 0, "fifty move rule");
+    return;
+  }
+
+  if (uo_position_repetition_count(position) >= 2)
+  {
+    uo_match_game_finish(match, game, 0, "threefold repetition");
+    return;
+  }
+
+  if (uo_match_is_insufficient_material(position))
+  {
+    uo_match_game_finish(match, game, 0, "insufficient material");
+    return;
+  }
+
+  // Step 4. Let the opponent move
+  uo_match_game_go(match, game);
+}
+
+// Starts the next game when the engines of the slot are ready and lets the first engine move when a game has started
+static void uo_match_game_update(uo_match *match, uo_match_game *game)
+{
+  uo_match_engine *engines = game->engines;
+  bool ready = engines[0].process && engines[1].process
+    && engines[0].state == uo_match_engine_state__ready
+    && engines[1].state == uo_match_engine_state__ready;
+
+  if (!ready) return;
+
+  if (game->state == uo_match_game_state__none
+    && !match->decided
+    && match->games_started < match->options->game_count)
+  {
+    uo_match_game_start(match, game);
+  }
+  else if (game->state == uo_match_game_state__starting)
+  {
+    game->state = uo_match_game_state__playing;
+    uo_match_game_go(match, game);
+  }
+}
+
+static void uo_match_engine_handle_line(void *data, char *line)
+{
+  uo_match_engine *engine = data;
+  uo_match *match = engine->match;
+  uo_match_game *game = engine->game;
+
+  if (engine->state == uo_match_engine_state__starting && strcmp(line, "readyok") == 0)
+  {
+    engine->state = uo_match_engine_state__ready;
+    uo_match_game_update(match, game);
+    return;
+  }
+
+  if (engine->state == uo_match_engine_state__thinking && strncmp(line, "bestmove ", uo_strlen("bestmove ")) == 0)
+  {
+    engine->state = uo_match_engine_state__ready;
+
+    if (engine->stopping)
+    {
+      uo_managed_process_set_timeout(engine->process, -1);
+      engine->stopping = false;
+    }
+    else
+    {
+      uo_match_game_bestmove(match, game, engine, line + uo_strlen("bestmove "));
+    }
+
+    uo_match_game_update(match, game);
+  }
+}
+
+// Enforces time control without waiting for the engine to move. Engine which does not stop searching is restarted.
+static void uo_match_engine_handle_timeout(void *data)
+{
+  uo_match_engine *engine = data;
+  uo_match *match = engine->match;
+  uo_match_game *game = engine->game;
+
+  if (engine->state != uo_match_engine_state__thinking) return;
+
+  if (engine->stopping)
+  {
+    printf("engine not responding to stop: %s\n", engine->name);
+    uo_match_engine_restart(engine);
+    return;
+  }
+
+  if (game->state != uo_match_game_state__playing) return;
+
+  bool is_white = (size_t)(engine - game->engines) == game->white;
+  uo_match_game_finish(match, game, is_white ? -1 : 1, "loss on time");
+}
+
+// Engine which has exited loses the game and is restarted
+static void uo_match_engine_handle_exit(void *data)
+{
+  uo_match_engine *engine = data;
+  uo_match *match = engine->match;
+  uo_match_game *game = engine->game;
+
+  printf("engine exited: %s\n", engine->name);
+  uo_managed_process_close(engine->process);
+  engine->process = NULL;
+  engine->state = uo_match_engine_state__starting;
+
+  if (game->state != uo_match_game_state__none)
+  {
+    bool is_white = (size_t)(engine - game->engines) == game->white;
+    uo_match_game_finish(match, game, is_white ? -1 : 1, "engine exited");
+  }
+
+  uo_match_engine_restart(engine);
+}
+
+void uo_match_run(const uo_match_options *options)
+{
+  if (!options->game_count || !options->concurrency) return;
+
+  // Step 1. Load opening positions
+  uo_file_mmap *file_mmap = NULL;
+
+  uo_match match = {
+    .options = options,
+    .seed = time(NULL),
+    .llr_lower = log(options->beta / (1.0 - options->alpha)),
+    .llr_upper = log((1.0 - options->beta) / options->alpha)
+  };
+
+  if (options->openings_filepath)
+  {
+    file_mmap = uo_file_mmap_open_read(options->openings_filepath);
+    if (!file_mmap)
+    {
+      printf("Unable to open file '%s'\n", options->openings_filepath);
+      return;
+    }
+
+    match.openings = uo_file_mmap_readlines(file_mmap, &match.opening_count);
+  }
+
+  // Step 2. Start engines of each concurrent game
+  size_t game_slot_count = uo_min(options->concurrency, options->game_count);
+  match.games = calloc(game_slot_count, sizeof * match.games);
+  match.manager = uo_process_manager_create();
+
+  for (size_t i = 0; i < game_slot_count; ++i)
+  {
+    for (size_t j = 0; j < 2; ++j)
+    {
+      uo_match_engine *engine = match.games[i].engines + j;
+      engine->match = &match;
+      engine->game = match.games + i;
+      engine->cmdline = options->engine_cmdlines[j];
+      snprintf(engine->name, sizeof engine->name, "engine%zu", j + 1);
+
+      if (!uo_match_engine_start(engine))
+      {
+        printf("Unable to start engine '%s'\n", engine->cmdline);
+        match.decided = true;
+        break;
+      }
+    }
+
+    if (match.decided)
+    {
+      game_slot_count = i;
+      break;
+    }
+  }
+
+  uo_time_now(&match.time_start);
+
+  // Step 3. Event loop which handles the output of all engines. Games are started and played by the callbacks and time
+  // control is enforced by the deadlines of the engines.
+  while (true)
+  {
+    bool active = !match.decided && match.games_started < options->game_count;
+
+    for (size_t i = 0; i < game_slot_count; ++i)
+    {
+      if (match.games[i].state != uo_match_game_state__none) active = true;
+    }
+
+    if (!active) break;
+
+    uo_process_manager_poll(match.manager, -1);
+  }
+
+  // Step 4. Quit engines
+  for (size_t i = 0; i < uo_min(options->concurrency, options->game_count); ++i)
+  {
+    uo_match_engine_stop(match.games[i].engines + 0);
+    uo_match_engine_stop(match.games[i].engines + 1);
+  }
+
+  uo_process_manager_free(match.manager);
+
+  if (match.games_finished) uo_match_print_report(&match);
+
+  free(match.games);
+  free(match.openings);
+  if (file_mmap) uo_file_mmap_close(file_mmap);
+}
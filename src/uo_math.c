@@ -1,9 +1,403 @@
 #include "uo_math.h"
 #include "uo_global.h"
 #include "uo_misc.h"
+#include "uo_engine.h"
+#include "uo_thread.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <math.h>
+
+// Packs mc x kc block of op(A) into panels of uo_gemm_mr rows. Each panel is stored column by column and padded with zeros.
+static void uo_gemm_pack_A(bool ta, size_t mc, size_t kc, const float *A, size_t lda, float *packed)
+{
+  for (size_t i = 0; i < mc; i += uo_gemm_mr)
+  {
+    size_t mr = uo_min(uo_gemm_mr, mc - i);
+
+    for (size_t p = 0; p < kc; ++p)
+    {
+      for (size_t r = 0; r < mr; ++r)
+      {
+        *packed++ = ta ? A[p * lda + i + r] : A[(i + r) * lda + p];
+      }
+
+      for (size_t r = mr; r < uo_gemm_mr; ++r)
+      {
+        *packed++ = 0.0f;
+      }
+    }
+  }
+}
+
+// Packs kc x nc panel of op(B) into panels of uo_gemm_nr columns. Each panel is stored row by row and padded with zeros.
+static void uo_gemm_pack_B(bool tb, size_t kc, size_t nc, const float *B, size_t ldb, float *packed)
+{
+  for (size_t j = 0; j < nc; j += uo_gemm_nr)
+  {
+    size_t nr = uo_min(uo_gemm_nr, nc - j);
+
+    for (size_t p = 0; p < kc; ++p)
+    {
+      if (!tb && nr == uo_gemm_nr)
+      {
+        memcpy(packed, B + p * ldb + j, uo_gemm_nr * sizeof(float));
+        packed += uo_gemm_nr;
+        continue;
+      }
+
+      for (size_t c = 0; c < nr; ++c)
+      {
+        *packed++ = tb ? B[(j + c) * ldb + p] : B[p * ldb + j + c];
+      }
+
+      for (size_t c = nr; c < uo_gemm_nr; ++c)
+      {
+        *packed++ = 0.0f;
+      }
+    }
+  }
+}
+
+// Multiplies packed panels of A and B and adds alpha times the product to mr x nr tile of C. Tile is accumulated in registers.
+// Each step loads one row of the B panel and broadcasts one value of the A panel per row of the tile.
+static void uo_gemm_kernel(size_t kc, float alpha, const float *a, const float *b, float *C, size_t ldc, size_t mr, size_t nr)
+{
+  __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+  __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+  __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+  __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+  __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+  __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+  for (size_t p = 0; p < kc; ++p)
+  {
+    __m256 b0 = _mm256_loadu_ps(b);
+    __m256 b1 = _mm256_loadu_ps(b + 8);
+    __m256 a_i;
+
+    a_i = _mm256_broadcast_ss(a + 0);
+    c00 = _mm256_fmadd_ps(a_i, b0, c00);
+    c01 = _mm256_fmadd_ps(a_i, b1, c01);
+
+    a_i = _mm256_broadcast_ss(a + 1);
+    c10 = _mm256_fmadd_ps(a_i, b0, c10);
+    c11 = _mm256_fmadd_ps(a_i, b1, c11);
+
+    a_i = _mm256_broadcast_ss(a + 2);
+    c20 = _mm256_fmadd_ps(a_i, b0, c20);
+    c21 = _mm256_fmadd_ps(a_i, b1, c21);
+
+    a_i = _mm256_broadcast_ss(a + 3);
+    c30 = _mm256_fmadd_ps(a_i, b0, c30);
+    c31 = _mm256_fmadd_ps(a_i, b1, c31);
+
+    a_i = _mm256_broadcast_ss(a + 4);
+    c40 = _mm256_fmadd_ps(a_i, b0, c40);
+    c41 = _mm256_fmadd_ps(a_i, b1, c41);
+
+    a_i = _mm256_broadcast_ss(a + 5);
+    c50 = _mm256_fmadd_ps(a_i, b0, c50);
+    c51 = _mm256_fmadd_ps(a_i, b1, c51);
+
+    a += uo_gemm_mr;
+    b += uo_gemm_nr;
+  }
+
+  __m256 tile[uo_gemm_mr][2] = {
+    { c00, c01 }, { c10, c11 }, { c20, c21 }, { c30, c31 }, { c40, c41 }, { c50, c51 }
+  };
+
+  __m256 _alpha = _mm256_set1_ps(alpha);
+
+  // Full tiles are added to C directly. Partial tiles at the edges of C are stored to memory first.
+  if (mr == uo_gemm_mr && nr == uo_gemm_nr)
+  {
+    for (size_t r = 0; r < uo_gemm_mr; ++r)
+    {
+      float *c = C + r * ldc;
+      _mm256_storeu_ps(c, _mm256_fmadd_ps(_alpha, tile[r][0], _mm256_loadu_ps(c)));
+      _mm256_storeu_ps(c + 8, _mm256_fmadd_ps(_alpha, tile[r][1], _mm256_loadu_ps(c + 8)));
+    }
+
+    return;
+  }
+
+  float values[uo_gemm_mr][uo_gemm_nr];
+
+  for (size_t r = 0; r < mr; ++r)
+  {
+    _mm256_storeu_ps(values[r], _mm256_mul_ps(_alpha, tile[r][0]));
+    _mm256_storeu_ps(values[r] + 8, _mm256_mul_ps(_alpha, tile[r][1]));
+
+    for (size_t c = 0; c < nr; ++c)
+    {
+      C[r * ldc + c] += values[r][c];
+    }
+  }
+}
+
+// Loop order and blocking follow the BLIS design: panel of B is packed once
+// per kc x nc block and reused for all blocks of A, and packed block of A is reused for all column panels of B.
+// see: https://www.cs.utexas.edu/~flame/pubs/BLISTOMSrev2.pdf
+void uo_gemm(bool ta, bool tb, size_t m, size_t n, size_t k,
+  float alpha,
+  const float *A, size_t lda,
+  const float *B, size_t ldb,
+  float beta,
+  float *C, size_t ldc)
+{
+  // Step 1. Scale C by beta. If beta is zero, C is cleared so that it can be uninitialized.
+  for (size_t i = 0; i < m; ++i)
+  {
+    float *c = C + i * ldc;
+
+    if (beta == 0.0f)
+    {
+      memset(c, 0, n * sizeof(float));
+    }
+    else if (beta != 1.0f)
+    {
+      uo_vec_mul1_ps(c, beta, c, n);
+    }
+  }
+
+  if (alpha == 0.0f || k == 0) return;
+
+  // Step 2. Allocate packing buffers for the block sizes actually needed
+  size_t mc_max = uo_min(uo_gemm_mc, (m + uo_gemm_mr - 1) / uo_gemm_mr * uo_gemm_mr);
+  size_t nc_max = uo_min(uo_gemm_nc, (n + uo_gemm_nr - 1) / uo_gemm_nr * uo_gemm_nr);
+  size_t kc_max = uo_min(uo_gemm_kc, k);
+  float *packed_A = malloc(mc_max * kc_max * sizeof(float));
+  float *packed_B = malloc(kc_max * nc_max * sizeof(float));
+
+  // Step 3. Multiply blocks
+  for (size_t jc = 0; jc < n; jc += uo_gemm_nc)
+  {
+    size_t nc = uo_min(uo_gemm_nc, n - jc);
+
+    for (size_t pc = 0; pc < k; pc += uo_gemm_kc)
+    {
+      size_t kc = uo_min(uo_gemm_kc, k - pc);
+      uo_gemm_pack_B(tb, kc, nc, tb ? B + jc * ldb + pc : B + pc * ldb + jc, ldb, packed_B);
+
+      for (size_t ic = 0; ic < m; ic += uo_gemm_mc)
+      {
+        size_t mc = uo_min(uo_gemm_mc, m - ic);
+        uo_gemm_pack_A(ta, mc, kc, ta ? A + pc * lda + ic : A + ic * lda + pc, lda, packed_A);
+
+        for (size_t jr = 0; jr < nc; jr += uo_gemm_nr)
+        {
+          for (size_t ir = 0; ir < mc; ir += uo_gemm_mr)
+          {
+            uo_gemm_kernel(kc, alpha, packed_A + ir * kc, packed_B + jr * kc,
+              C + (ic + ir) * ldc + jc + jr, ldc,
+              uo_min(uo_gemm_mr, mc - ir), uo_min(uo_gemm_nr, nc - jr));
+          }
+        }
+      }
+    }
+  }
+
+  free(packed_B);
+  free(packed_A);
+}
+
+typedef struct uo_gemm_parallel_params
+{
+  bool ta;
+  bool tb;
+  size_t m;
+  size_t n;
+  size_t k;
+  float alpha;
+  const float *A;
+  size_t lda;
+  const float *B;
+  size_t ldb;
+  float beta;
+  float *C;
+  size_t ldc;
+
+  // C is split into stripes of rows or columns, whichever dimension is larger
+  bool split_rows;
+  size_t stripe_size;
+  size_t stripe_count;
+  volatile uo_atomic_int claimed;
+  uo_semaphore *semaphore;
+} uo_gemm_parallel_params;
+
+static void *uo_gemm_parallel_thread_run(void *arg)
+{
+  uo_engine_thread *thread = arg;
+  uo_gemm_parallel_params *params = thread->data;
+
+  uo_atomic_unlock(&thread->busy);
+
+  size_t stripe;
+  while ((stripe = uo_atomic_increment(&params->claimed) - 1) < params->stripe_count)
+  {
+    size_t offset = stripe * params->stripe_size;
+
+    if (params->split_rows)
+    {
+      size_t m = uo_min(params->stripe_size, params->m - offset);
+      const float *A = params->ta ? params->A + offset : params->A + offset * params->lda;
+      uo_gemm(params->ta, params->tb, m, params->n, params->k, params->alpha, A, params->lda,
+        params->B, params->ldb, params->beta, params->C + offset * params->ldc, params->ldc);
+    }
+    else
+    {
+      size_t n = uo_min(params->stripe_size, params->n - offset);
+      const float *B = params->tb ? params->B + offset * params->ldb : params->B + offset;
+      uo_gemm(params->ta, params->tb, params->m, n, params->k, params->alpha, params->A, params->lda,
+        B, params->ldb, params->beta, params->C + offset, params->ldc);
+    }
+  }
+
+  uo_semaphore_release(params->semaphore);
+
+  return NULL;
+}
+
+void uo_gemm_parallel(bool ta, bool tb, size_t m, size_t n, size_t k,
+  float alpha,
+  const float *A, size_t lda,
+  const float *B, size_t ldb,
+  float beta,
+  float *C, size_t ldc)
+{
+  size_t thread_count = engine.thread_count;
+
+  if (thread_count <= 1)
+  {
+    uo_gemm(ta, tb, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+    return;
+  }
+
+  // Stripes are multiples of the register tile and small enough that each thread gets a few of them to balance the load
+  bool split_rows = m >= n;
+  size_t size = split_rows ? m : n;
+  size_t unit = split_rows ? uo_gemm_mr : uo_gemm_nr;
+  size_t stripe_size = (size + 4 * thread_count - 1) / (4 * thread_count);
+  stripe_size = (stripe_size + unit - 1) / unit * unit;
+  size_t stripe_count = (size + stripe_size - 1) / stripe_size;
+
+  if (stripe_count == 1)
+  {
+    uo_gemm(ta, tb, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+    return;
+  }
+
+  uo_gemm_parallel_params params = {
+    .ta = ta, .tb = tb, .m = m, .n = n, .k = k,
+    .alpha = alpha, .A = A, .lda = lda, .B = B, .ldb = ldb, .beta = beta, .C = C, .ldc = ldc,
+    .split_rows = split_rows,
+    .stripe_size = stripe_size,
+    .stripe_count = stripe_count,
+    .semaphore = uo_semaphore_create(0)
+  };
+
+  uo_atomic_init(&params.claimed, 0);
+
+  size_t dispatch_count = uo_min(thread_count, stripe_count);
+
+  for (size_t i = 0; i < dispatch_count; ++i)
+  {
+    uo_engine_run_thread(uo_gemm_parallel_thread_run, &params);
+  }
+
+  for (size_t i = 0; i < dispatch_count; ++i)
+  {
+    uo_semaphore_wait(params.semaphore);
+  }
+
+  uo_semaphore_destroy(params.semaphore);
+}
+
+static bool uo_test_is_quantizable(const float *a, size_t n, float min, float max)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    if (a[i] != roundf(a[i]) || a[i] < min || a[i] > max) return false;
+  }
+
+  return true;
+}
+
+// Compares quantized matrix vector products against expected results. Test cases with values that are not integers in
+// range of the quantized types are skipped for the corresponding kernels.
+static bool uo_test_matmul_quantized(float *A, float *B_t, float *C_expected, size_t m, size_t n, size_t k)
+{
+  bool passed = true;
+
+  bool quantizable_epi8 = uo_test_is_quantizable(A, m * k, -127.0f, 127.0f) && uo_test_is_quantizable(B_t, n * k, -127.0f, 127.0f);
+  bool quantizable_epu8 = quantizable_epi8 && uo_test_is_quantizable(B_t, n * k, 0.0f, 127.0f);
+  bool quantizable_epi16 = uo_test_is_quantizable(A, m * k, INT16_MIN, INT16_MAX) && uo_test_is_quantizable(B_t, n * k, INT16_MIN, INT16_MAX);
+
+  if (!quantizable_epi16) return true;
+
+  int8_t *A_epi8 = malloc(m * k * sizeof(int8_t));
+  int8_t *B_t_epi8 = malloc(n * k * sizeof(int8_t));
+  int16_t *A_epi16 = malloc(m * k * sizeof(int16_t));
+  int16_t *B_t_epi16 = malloc(n * k * sizeof(int16_t));
+  int32_t *y = malloc(m * sizeof(int32_t));
+  uint8_t *y_relu = malloc(m * sizeof(uint8_t));
+
+  uo_vec_quantize_ps_epi8(A, A_epi8, 1.0f, m * k);
+  uo_vec_quantize_ps_epi8(B_t, B_t_epi8, 1.0f, n * k);
+  uo_vec_quantize_ps_epi16(A, A_epi16, 1.0f, m * k);
+  uo_vec_quantize_ps_epi16(B_t, B_t_epi16, 1.0f, n * k);
+
+  for (size_t j = 0; j < n; ++j)
+  {
+    uo_matvec_epi16(A_epi16, B_t_epi16 + j * k, NULL, y, m, k);
+
+    for (size_t i = 0; i < m; ++i)
+    {
+      passed &= y[i] == (int32_t)C_expected[i * n + j];
+    }
+
+    if (quantizable_epi8)
+    {
+      uo_matvec_epi8(A_epi8, B_t_epi8 + j * k, NULL, y, m, k);
+
+      for (size_t i = 0; i < m; ++i)
+      {
+        passed &= y[i] == (int32_t)C_expected[i * n + j];
+      }
+    }
+
+    if (quantizable_epu8)
+    {
+      uo_matvec_epu8_epi8(A_epi8, (uint8_t *)B_t_epi8 + j * k, NULL, y, m, k);
+
+      for (size_t i = 0; i < m; ++i)
+      {
+        passed &= y[i] == (int32_t)C_expected[i * n + j];
+      }
+
+      // Clipped ReLU of the result
+      uo_vec_clipped_relu_epi32(y, y_relu, m, 0);
+
+      for (size_t i = 0; i < m; ++i)
+      {
+        int32_t expected = (int32_t)C_expected[i * n + j];
+        passed &= y_relu[i] == (expected < 0 ? 0 : expected > 127 ? 127 : expected);
+      }
+    }
+  }
+
+  free(A_epi8);
+  free(B_t_epi8);
+  free(A_epi16);
+  free(B_t_epi16);
+  free(y);
+  free(y_relu);
+
+  return passed;
+}
 
 bool uo_test_matmul_A_dot_B_eq_C(float *A, float *B, float *C_expected, size_t m, size_t n, size_t k)
 {
@@ -109,6 +503,29 @@ bool uo_test_matmul_A_dot_B_eq_C(float *A, float *B, float *C_expected, size_t m
     return false;
   }
 
+  uo_gemm_parallel(false, false, m_A, n_B, n_A, 1.0,
+    A, n_A,
+    B, n_B,
+    0.0,
+    C, n_C);
+
+  // compare matrix multiplication results against expected results
+  for (size_t i = 0; i < m_C * n_C; i++)
+  {
+    float d = C_expected[i] - C[i];
+    passed &= uo_approx_eq_ps(d, 0);
+  }
+
+  if (!passed)
+  {
+    free(A_t);
+    free(B_t);
+    free(C);
+    return false;
+  }
+
+  passed &= uo_test_matmul_quantized(A, B_t, C_expected, m, n, k);
+
   free(A_t);
   free(B_t);
   free(C);
@@ -117,6 +534,67 @@ bool uo_test_matmul_A_dot_B_eq_C(float *A, float *B, float *C_expected, size_t m
 #undef uo_approx_eq_ps
 }
 
+// Compares blocked matrix multiplication against the unblocked kernels for all transpositions. Matrix dimensions are chosen so
+// that blocks and register tiles at the edges of the matrices are partial.
+static bool uo_test_gemm_blocked(size_t m, size_t n, size_t k)
+{
+  float *A = malloc(m * k * sizeof(float));
+  float *B = malloc(k * n * sizeof(float));
+  float *C = malloc(m * n * sizeof(float));
+  float *C_expected = malloc(m * n * sizeof(float));
+  bool passed = true;
+
+  for (size_t i = 0; i < m * k; ++i) A[i] = uo_rand_between(-1.0f, 1.0f);
+  for (size_t i = 0; i < k * n; ++i) B[i] = uo_rand_between(-1.0f, 1.0f);
+
+  for (int t = 0; t < 4 && passed; ++t)
+  {
+    bool ta = t & 1;
+    bool tb = t & 2;
+    size_t lda = ta ? m : k;
+    size_t ldb = tb ? k : n;
+
+    for (size_t i = 0; i < m * n; ++i) C[i] = C_expected[i] = uo_rand_between(-1.0f, 1.0f);
+
+    // Reference kernels accumulate to C, so C is scaled by beta first
+    for (size_t i = 0; i < m * n; ++i) C_expected[i] *= 0.5f;
+
+    if (!ta && !tb) uo_gemm_nn(m, n, k, 2.0f, A, lda, B, ldb, C_expected, n);
+    else if (ta && !tb) uo_gemm_tn(m, n, k, 2.0f, A, lda, B, ldb, C_expected, n);
+    else if (!ta && tb) uo_gemm_nt(m, n, k, 2.0f, A, lda, B, ldb, C_expected, n);
+    else uo_gemm_tt(m, n, k, 2.0f, A, lda, B, ldb, C_expected, n);
+
+    float *C_parallel = malloc(m * n * sizeof(float));
+    memcpy(C_parallel, C, m * n * sizeof(float));
+
+    uo_gemm(ta, tb, m, n, k, 2.0f, A, lda, B, ldb, 0.5f, C, n);
+    uo_gemm_parallel(ta, tb, m, n, k, 2.0f, A, lda, B, ldb, 0.5f, C_parallel, n);
+
+    // Error of float sums grows with the number of terms
+    float tolerance = 1e-5f * k + 1e-5f;
+
+    for (size_t i = 0; i < m * n; ++i)
+    {
+      passed &= fabsf(C[i] - C_expected[i]) < tolerance;
+      passed &= fabsf(C_parallel[i] - C_expected[i]) < tolerance;
+    }
+
+    free(C_parallel);
+  }
+
+  if (!passed)
+  {
+    printf("Blocked matrix multiplication of size %zux%zux%zu does not match the reference\n", m, n, k);
+  }
+
+  free(A);
+  free(B);
+  free(C);
+  free(C_expected);
+
+  return passed;
+}
+
 char *uo_parse_matrix(char *ptr, float **data, size_t *m, size_t *n)
 {
   char *end = strchr(ptr, ']');
@@ -324,6 +802,14 @@ bool uo_test_matmul(char *test_data_dir)
 
   uo_file_mmap_close(file_mmap);
 
+  if (passed)
+  {
+    passed &= uo_test_gemm_blocked(1, 1, 1);
+    passed &= uo_test_gemm_blocked(uo_gemm_mr + 1, uo_gemm_nr + 1, 3);
+    passed &= uo_test_gemm_blocked(uo_gemm_mc + 5, uo_gemm_nc + 3, uo_gemm_kc + 7);
+    test_count += 3;
+  }
+
   if (passed)
   {
     printf("TEST 'math' PASSED: total of %zd tested.", test_count);
@@ -337,6 +823,132 @@ failed_err_data:
   return false;
 }
 
+// Throughput of matrix vector products of float and quantized kernels and of matrix multiplication. Matrix dimensions of the
+// matrix vector products match the first hidden layer of the network.
+void uo_benchmark_matmul(void)
+{
+  const size_t m = 32;
+  const size_t k = 512;
+  const size_t iterations = 20000;
+
+  float *A = malloc(m * k * sizeof(float));
+  float *x = malloc(k * sizeof(float));
+  float *y = malloc(m * sizeof(float));
+  int8_t *A_epi8 = malloc(m * k * sizeof(int8_t));
+  uint8_t *x_epu8 = malloc(k * sizeof(uint8_t));
+  int16_t *A_epi16 = malloc(m * k * sizeof(int16_t));
+  int16_t *x_epi16 = malloc(k * sizeof(int16_t));
+  int32_t *y_epi32 = malloc(m * sizeof(int32_t));
+
+  for (size_t i = 0; i < m * k; ++i) A[i] = (float)((int)(i * 7919 % 255) - 127) / 64.0f;
+  for (size_t i = 0; i < k; ++i) x[i] = (float)(i * 104729 % 128) / 128.0f;
+
+  uo_vec_quantize_ps_epi8(A, A_epi8, 64.0f, m * k);
+  uo_vec_quantize_ps_epi16(A, A_epi16, 64.0f, m * k);
+  uo_vec_quantize_ps_epi16(x, x_epi16, 127.0f, k);
+  uo_vec_clipped_relu_epi16(x_epi16, x_epu8, k);
+
+  double mmacs = (double)(m * k * iterations) / 1000000.0;
+  volatile float sink_ps = 0;
+  volatile int32_t sink_epi32 = 0;
+  uo_time time;
+
+  uo_time_now(&time);
+  for (size_t i = 0; i < iterations; ++i)
+  {
+    x[i % k] += 1.0f;
+    uo_matmul_ps(A, x, y, m, 1, k, 0, 0, 0);
+    sink_ps += y[0];
+  }
+  double msec_ps = uo_time_elapsed_msec(&time);
+
+  uo_time_now(&time);
+  for (size_t i = 0; i < iterations; ++i)
+  {
+    x_epi16[i % k] ^= 1;
+    uo_matvec_epi16(A_epi16, x_epi16, NULL, y_epi32, m, k);
+    sink_epi32 += y_epi32[0];
+  }
+  double msec_epi16 = uo_time_elapsed_msec(&time);
+
+  uo_time_now(&time);
+  for (size_t i = 0; i < iterations; ++i)
+  {
+    x_epu8[i % k] ^= 1;
+    uo_matvec_epu8_epi8(A_epi8, x_epu8, NULL, y_epi32, m, k);
+    sink_epi32 += y_epi32[0];
+  }
+  double msec_epi8 = uo_time_elapsed_msec(&time);
+
+  printf("matvec %zux%zu float: %.0f MMAC/s\n", m, k, mmacs * 1000.0 / msec_ps);
+  printf("matvec %zux%zu int16: %.0f MMAC/s (%.1fx)\n", m, k, mmacs * 1000.0 / msec_epi16, msec_ps / msec_epi16);
+  printf("matvec %zux%zu int8:  %.0f MMAC/s (%.1fx)\n", m, k, mmacs * 1000.0 / msec_epi8, msec_ps / msec_epi8);
+
+  // Matrix multiplication throughput of dot products of rows and columns, which uo_matmul_ps used before blocking,
+  // against the blocked kernel on one thread and on the engine threads
+  const size_t size = 512;
+  const size_t gemm_iterations = 20;
+
+  float *A_gemm = malloc(size * size * sizeof(float));
+  float *B_t_gemm = malloc(size * size * sizeof(float));
+  float *C_gemm = malloc(size * size * sizeof(float));
+
+  for (size_t i = 0; i < size * size; ++i)
+  {
+    A_gemm[i] = (float)((int)(i * 7919 % 255) - 127) / 64.0f;
+    B_t_gemm[i] = (float)(i * 104729 % 128) / 128.0f;
+  }
+
+  double gflops = 2.0 * size * size * size * gemm_iterations / 1000000000.0;
+
+  uo_time_now(&time);
+  for (size_t iteration = 0; iteration < gemm_iterations; ++iteration)
+  {
+    for (size_t i = 0; i < size; ++i)
+    {
+      for (size_t j = 0; j < size; ++j)
+      {
+        C_gemm[i * size + j] = uo_dotproduct_ps(A_gemm + i * size, B_t_gemm + j * size, size);
+      }
+    }
+    sink_ps += C_gemm[iteration];
+  }
+  double msec_dot = uo_time_elapsed_msec(&time);
+
+  uo_time_now(&time);
+  for (size_t iteration = 0; iteration < gemm_iterations; ++iteration)
+  {
+    uo_gemm(false, true, size, size, size, 1.0f, A_gemm, size, B_t_gemm, size, 0.0f, C_gemm, size);
+    sink_ps += C_gemm[iteration];
+  }
+  double msec_gemm = uo_time_elapsed_msec(&time);
+
+  uo_time_now(&time);
+  for (size_t iteration = 0; iteration < gemm_iterations; ++iteration)
+  {
+    uo_gemm_parallel(false, true, size, size, size, 1.0f, A_gemm, size, B_t_gemm, size, 0.0f, C_gemm, size);
+    sink_ps += C_gemm[iteration];
+  }
+  double msec_gemm_parallel = uo_time_elapsed_msec(&time);
+
+  printf("gemm %zux%zux%zu dot product: %.1f GFLOP/s\n", size, size, size, gflops * 1000.0 / msec_dot);
+  printf("gemm %zux%zux%zu blocked: %.1f GFLOP/s (%.1fx)\n", size, size, size, gflops * 1000.0 / msec_gemm, msec_dot / msec_gemm);
+  printf("gemm %zux%zux%zu blocked, %zu threads: %.1f GFLOP/s (%.1fx)\n", size, size, size, engine.thread_count,
+    gflops * 1000.0 / msec_gemm_parallel, msec_dot / msec_gemm_parallel);
+
+  free(A_gemm);
+  free(B_t_gemm);
+  free(C_gemm);
+  free(A);
+  free(x);
+  free(y);
+  free(A_epi8);
+  free(x_epu8);
+  free(A_epi16);
+  free(x_epi16);
+  free(y_epi32);
+}
+
 void uo_print_matrix(FILE *const fp, float *A, size_t m, size_t n)
 {
   fprintf(fp, "[\n");
@@ -122,6 +122,32 @@ char *uo_file_mmap_readline(uo_file_mmap *file_mmap)
   return line;
 }
 
+char **uo_file_mmap_readlines(uo_file_mmap *file_mmap, size_t *count)
+{
+  size_t capacity = 0x100;
+  char **lines = malloc(capacity * sizeof * lines);
+  char *line = uo_file_mmap_readline(file_mmap);
+  *count = 0;
+
+  while (line)
+  {
+    if (*line && *line != '#')
+    {
+      if (*count == capacity)
+      {
+        capacity *= 2;
+        lines = realloc(lines, capacity * sizeof * lines);
+      }
+
+      lines[(*count)++] = line;
+    }
+
+    line = uo_file_mmap_readline(file_mmap);
+  }
+
+  return lines;
+}
+
 // Pipes
 
 typedef struct uo_pipe
@@ -287,4 +313,19 @@ size_t uo_process_read_stdout(uo_process *process, char *buffer, size_t len)
   return uo_pipe_read(process->stdout_pipe, buffer, len);
 }
 
+bool uo_process_read_stdout_nonblocking(uo_process *process, char *buffer, size_t len, size_t *len_read)
+{
+  DWORD len_available;
+  *len_read = 0;
+  buffer[0] = '\0';
+
+  // Pipe is broken when the process has exited and all output has been read
+  if (!PeekNamedPipe(process->stdout_pipe->rd, NULL, 0, NULL, &len_available, NULL)) return false;
+  if (len_available == 0) return true;
+
+  // Read only the available bytes, so that the read does not block
+  *len_read = uo_pipe_read(process->stdout_pipe, buffer, len_available < len ? len_available + 1 : len);
+  return true;
+}
+
 #endif
@@ -0,0 +1,147 @@
+#include "uo_nnue.h"
+#include "uo_misc.h"
+#include "uo_math.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+uo_nnue *uo_nnue_network = NULL;
+
+typedef struct uo_nnue_file_header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t feature_count;
+  uint32_t l1;
+  uint32_t l2;
+  uint32_t l3;
+} uo_nnue_file_header;
+
+#define uo_nnue_parameter_size (                           \
+    UO_NNUE_L1 * sizeof(int16_t) +                         \
+    UO_NNUE_FEATURE_COUNT * UO_NNUE_L1 * sizeof(int16_t) + \
+    UO_NNUE_L2 * sizeof(int32_t) +                         \
+    UO_NNUE_L2 * 2 * UO_NNUE_L1 * sizeof(int8_t) +         \
+    UO_NNUE_L3 * sizeof(int32_t) +                         \
+    UO_NNUE_L3 * UO_NNUE_L2 * sizeof(int8_t) +             \
+    sizeof(int32_t) +                                      \
+    UO_NNUE_L3 * sizeof(int8_t))
+
+// Sets parameter pointers to consecutive arrays of the parameter memory in the order of the weight file
+static void uo_nnue_init_parameters(uo_nnue *nnue, char *mem)
+{
+  nnue->ft_biases = (int16_t *)mem;
+  mem += UO_NNUE_L1 * sizeof(int16_t);
+  nnue->ft_weights = (int16_t *)mem;
+  mem += UO_NNUE_FEATURE_COUNT * UO_NNUE_L1 * sizeof(int16_t);
+  nnue->l1_biases = (int32_t *)mem;
+  mem += UO_NNUE_L2 * sizeof(int32_t);
+  nnue->l1_weights = (int8_t *)mem;
+  mem += UO_NNUE_L2 * 2 * UO_NNUE_L1 * sizeof(int8_t);
+  nnue->l2_biases = (int32_t *)mem;
+  mem += UO_NNUE_L3 * sizeof(int32_t);
+  nnue->l2_weights = (int8_t *)mem;
+  mem += UO_NNUE_L3 * UO_NNUE_L2 * sizeof(int8_t);
+  nnue->out_bias = (int32_t *)mem;
+  mem += sizeof(int32_t);
+  nnue->out_weights = (int8_t *)mem;
+}
+
+uo_nnue *uo_nnue_create(const char *filepath)
+{
+  // Step 1. Open weight file for reading
+  uo_file_mmap *file_mmap = uo_file_mmap_open_read(filepath);
+  if (!file_mmap) return NULL;
+
+  // Step 2. Validate header and file size
+  uo_nnue_file_header header;
+
+  if (file_mmap->size != sizeof header + uo_nnue_parameter_size)
+  {
+    uo_file_mmap_close(file_mmap);
+    return NULL;
+  }
+
+  memcpy(&header, file_mmap->ptr, sizeof header);
+
+  if (header.magic != UO_NNUE_FILE_MAGIC
+    || header.version != UO_NNUE_FILE_VERSION
+    || header.feature_count != UO_NNUE_FEATURE_COUNT
+    || header.l1 != UO_NNUE_L1
+    || header.l2 != UO_NNUE_L2
+    || header.l3 != UO_NNUE_L3)
+  {
+    uo_file_mmap_close(file_mmap);
+    return NULL;
+  }
+
+  // Step 3. Copy parameters. Parameter arrays are stored in the same order as in the file.
+  uo_nnue *nnue = malloc(sizeof * nnue + uo_nnue_parameter_size);
+  char *mem = (char *)(nnue + 1);
+  memcpy(mem, file_mmap->ptr + sizeof header, uo_nnue_parameter_size);
+  uo_file_mmap_close(file_mmap);
+
+  strncpy(nnue->filepath, filepath, sizeof nnue->filepath - 1);
+  nnue->filepath[sizeof nnue->filepath - 1] = '\0';
+
+  uo_nnue_init_parameters(nnue, mem);
+
+  return nnue;
+}
+
+uo_nnue *uo_nnue_create_empty(void)
+{
+  uo_nnue *nnue = calloc(1, sizeof * nnue + uo_nnue_parameter_size);
+  uo_nnue_init_parameters(nnue, (char *)(nnue + 1));
+  return nnue;
+}
+
+bool uo_nnue_save(const uo_nnue *nnue, const char *filepath)
+{
+  FILE *fp = fopen(filepath, "wb");
+  if (!fp) return false;
+
+  uo_nnue_file_header header = {
+    .magic = UO_NNUE_FILE_MAGIC,
+    .version = UO_NNUE_FILE_VERSION,
+    .feature_count = UO_NNUE_FEATURE_COUNT,
+    .l1 = UO_NNUE_L1,
+    .l2 = UO_NNUE_L2,
+    .l3 = UO_NNUE_L3
+  };
+
+  // Parameter arrays are contiguous after the pointers are initialized by uo_nnue_init_parameters
+  bool success = fwrite(&header, sizeof header, 1, fp) == 1
+    && fwrite(nnue->ft_biases, uo_nnue_parameter_size, 1, fp) == 1;
+
+  return fclose(fp) == 0 && success;
+}
+
+void uo_nnue_free(uo_nnue *nnue)
+{
+  free(nnue);
+}
+
+int32_t uo_nnue_propagate(const uo_nnue *nnue, const int16_t *own, const int16_t *enemy)
+{
+  uint8_t input[2 * UO_NNUE_L1];
+  int32_t values1[UO_NNUE_L2];
+  uint8_t hidden1[UO_NNUE_L2];
+  int32_t values2[UO_NNUE_L3];
+  uint8_t hidden2[UO_NNUE_L3];
+
+  // Step 1. Feature transformer output, side to move first
+  uo_vec_clipped_relu_epi16(own, input, UO_NNUE_L1);
+  uo_vec_clipped_relu_epi16(enemy, input + UO_NNUE_L1, UO_NNUE_L1);
+
+  // Step 2. Hidden layers
+  uo_matvec_epu8_epi8(nnue->l1_weights, input, nnue->l1_biases, values1, UO_NNUE_L2, 2 * UO_NNUE_L1);
+  uo_vec_clipped_relu_epi32(values1, hidden1, UO_NNUE_L2, UO_NNUE_WEIGHT_SCALE_BITS);
+  uo_matvec_epu8_epi8(nnue->l2_weights, hidden1, nnue->l2_biases, values2, UO_NNUE_L3, UO_NNUE_L2);
+  uo_vec_clipped_relu_epi32(values2, hidden2, UO_NNUE_L3, UO_NNUE_WEIGHT_SCALE_BITS);
+
+  // Step 3. Output layer
+  int32_t output = *nnue->out_bias + uo_dotproduct_epu8_epi8(hidden2, nnue->out_weights, UO_NNUE_L3);
+  return output / UO_NNUE_OUTPUT_SCALE;
+}
@@ -64,6 +64,97 @@ uint64_t uo_position_calculate_key(const uo_position *position)
   return key;
 }
 
+static inline void uo_position_score_update_P(uo_position_score *score, uint8_t color, uo_square square, int16_t sign)
+{
+  // Square is relative to the color of the pawn
+  score->mg_P[color][0] += sign * score_mg_P[square];
+  score->mg_P[color][1] += sign * score_mg_P[square ^ 7];
+  score->eg_P[color][0] += sign * score_eg_P[square];
+  score->eg_P[color][1] += sign * score_eg_P[square ^ 7];
+}
+
+void uo_position_calculate_score(const uo_position *position, uo_position_score *score)
+{
+  memset(score, 0, sizeof * score);
+
+  uint8_t color = uo_color(position->flags);
+  uint8_t flip_if_black = color == uo_black ? 56 : 0;
+  uo_bitboard pieces = uo_andn(position->K, position->own | position->enemy);
+
+  while (pieces)
+  {
+    uo_square square = uo_bitboard_next_square(&pieces);
+    uo_piece piece = position->board[square];
+    uint8_t piece_color = uo_color(piece) == uo_color_own ? color : !color;
+    uo_square square_relative = uo_color(piece) == uo_color_own ? square : square ^ 56;
+
+    score->material[piece_color] += uo_piece_value(piece);
+
+    if (uo_piece_type(piece) == uo_piece__P)
+    {
+      score->key_P ^= uo_zobkey(piece ^ color, square ^ flip_if_black);
+      uo_position_score_update_P(score, piece_color, square_relative, 1);
+    }
+  }
+
+  // Material key has a key for each piece up to the piece count. Kings are always included so that the key is never zero.
+  score->key_material = uo_zobkey(uo_piece__K, 0) ^ uo_zobkey(uo_piece__k, 0);
+
+  for (uo_piece piece = uo_piece__P; piece < uo_piece__K; piece += 2)
+  {
+    uo_bitboard bitboard = position->bitboards[1 + (piece >> 1)];
+    size_t count_own = uo_popcnt(position->own & bitboard);
+    size_t count_enemy = uo_popcnt(position->enemy & bitboard);
+
+    for (size_t i = 0; i < count_own; ++i) score->key_material ^= uo_zobkey(piece ^ color, i);
+    for (size_t i = 0; i < count_enemy; ++i) score->key_material ^= uo_zobkey(piece ^ !color, i);
+  }
+}
+
+// Updates incrementally maintained evaluation terms. Position needs to be in the state before the move.
+// Sign is positive when making the move and negative when unmaking it.
+static inline void uo_position_update_score(uo_position *position, uo_move move, int16_t sign)
+{
+  uo_position_score *score = &position->score;
+  uint8_t color = uo_color(position->flags);
+  uint8_t flip_if_black = color == uo_black ? 56 : 0;
+  uo_square square_from = uo_move_square_from(move);
+  uo_square square_to = uo_move_square_to(move);
+  const uo_piece *board = position->board;
+  uo_move_type move_type = uo_move_get_type(move);
+
+  if (uo_move_is_capture(move))
+  {
+    uo_square square_captured = move_type == uo_move_type__enpassant ? square_to - 8 : square_to;
+    uo_piece piece_captured = board[square_captured];
+    score->material[!color] -= sign * uo_piece_value(piece_captured);
+    score->key_material ^= uo_zobkey(piece_captured ^ color, uo_popcnt(position->enemy & *uo_position_piece_bitboard(position, piece_captured)) - 1);
+
+    if (uo_piece_type(piece_captured) == uo_piece__P)
+    {
+      score->key_P ^= uo_zobkey(piece_captured ^ color, square_captured ^ flip_if_black);
+      uo_position_score_update_P(score, !color, square_captured ^ 56, -sign);
+    }
+  }
+
+  if (uo_move_is_promotion(move))
+  {
+    // Promotion types are ordered N, B, R, Q as are the piece codes
+    uo_piece piece_promo = uo_piece__N + ((move_type & 3) << 1);
+    score->material[color] += sign * (uo_piece_value(piece_promo) - uo_score_P);
+    score->key_material ^= uo_zobkey(uo_piece__P ^ color, uo_popcnt(position->own & position->P) - 1);
+    score->key_material ^= uo_zobkey(piece_promo ^ color, uo_popcnt(position->own & *uo_position_piece_bitboard(position, piece_promo)));
+    score->key_P ^= uo_zobkey(uo_piece__P ^ color, square_from ^ flip_if_black);
+    uo_position_score_update_P(score, color, square_from, -sign);
+  }
+  else if (board[square_from] == uo_piece__P)
+  {
+    score->key_P ^= uo_zobkey(uo_piece__P ^ color, square_from ^ flip_if_black) ^ uo_zobkey(uo_piece__P ^ color, square_to ^ flip_if_black);
+    uo_position_score_update_P(score, color, square_from, -sign);
+    uo_position_score_update_P(score, color, square_to, sign);
+  }
+}
+
 bool uo_position_is_ok(uo_position *position)
 {
   if (position->movelist.head - position->movelist.moves > UO_MAX_PLY * UO_BRANCING_FACTOR)
@@ -176,6 +267,14 @@ bool uo_position_is_ok(uo_position *position)
     return false;
   }
 
+  uo_position_score score;
+  uo_position_calculate_score(position, &score);
+
+  if (memcmp(&score, &position->score, sizeof score) != 0)
+  {
+    return false;
+  }
+
   return true;
 }
 
@@ -277,6 +376,7 @@ static inline void uo_position_do_switch_turn(uo_position *position, uint64_t ke
   position->stack->tactical_moves_generated = false;
   position->stack->moves_sorted = false;
   position->stack->static_eval = uo_score_unknown;
+  position->stack->lazy_eval = uo_score_unknown;
   position->stack->flags = position->flags = flags;
   position->stack->key = position->key = key;
 
@@ -695,6 +795,7 @@ uo_position *uo_position_from_fen(uo_position *position, const char *fen)
   position->stack[-2].static_eval = uo_score_unknown;
   position->stack[-1].static_eval = uo_score_unknown;
   position->stack[0].static_eval = uo_score_unknown;
+  position->stack[0].lazy_eval = uo_score_unknown;
 
   position->flags = flags;
   uo_position_reset_root(position);
@@ -718,6 +819,75 @@ uo_position *uo_position_from_fen(uo_position *position, const char *fen)
     uo_score_R * uo_popcnt(position->R) +
     uo_score_Q * uo_popcnt(position->Q));
 
+  uo_position_calculate_score(position, &position->score);
+
+  assert(uo_position_is_ok(position));
+
+  return position;
+}
+
+void uo_position_pack(const uo_position *position, uo_position_packed *packed)
+{
+  memcpy(packed->bitboards, position->bitboards, sizeof packed->bitboards);
+  packed->flags = position->flags;
+}
+
+uo_position *uo_position_unpack(uo_position *position, const uo_position_packed *packed)
+{
+  // Step 1. Copy bitboards and flags
+  memcpy(position->bitboards, packed->bitboards, sizeof position->bitboards);
+  position->flags = packed->flags;
+  position->ply = 0;
+  position->root_ply = 0;
+
+  // Step 2. Fill piece placement from bitboards. Board flips toggle the color bit also on empty squares.
+  memset(position->board, uo_color(position->flags), sizeof position->board);
+
+  for (uo_piece piece = uo_piece__P; piece <= uo_piece__K; piece += 2)
+  {
+    uo_bitboard bitboard = position->bitboards[1 + (piece >> 1)];
+    uo_bitboard own = position->own & bitboard;
+    uo_bitboard enemy = position->enemy & bitboard;
+
+    while (own) position->board[uo_bitboard_next_square(&own)] = piece;
+    while (enemy) position->board[uo_bitboard_next_square(&enemy)] = piece + 1;
+  }
+
+  // Step 3. Reset move history and cached attacks and pins
+  memset(position->history, 0, 5 * sizeof * position->history);
+  position->stack = &position->history[4];
+  position->stack[-4].static_eval = uo_score_unknown;
+  position->stack[-3].static_eval = uo_score_unknown;
+  position->stack[-2].static_eval = uo_score_unknown;
+  position->stack[-1].static_eval = uo_score_unknown;
+  position->stack[0].static_eval = uo_score_unknown;
+  position->stack[0].lazy_eval = uo_score_unknown;
+  position->nnue[0].computed[0] = false;
+  position->nnue[0].computed[1] = false;
+
+  position->piece_captured = position->captures;
+  position->movelist.head = position->movelist.moves;
+  position->attacks.own.updated = false;
+  position->attacks.enemy.updated = false;
+  position->pins.updated = false;
+
+  // Step 4. Calculate key, checks, pins and incrementally maintained evaluation terms
+  position->key = uo_position_calculate_key(position);
+  position->stack->key = position->key;
+  position->stack->flags = position->flags;
+
+  uo_position_update_checks(position);
+  uo_position_update_pins(position);
+
+  position->material = (
+    uo_score_P * uo_popcnt(position->P) +
+    uo_score_N * uo_popcnt(position->N) +
+    uo_score_B * uo_popcnt(position->B) +
+    uo_score_R * uo_popcnt(position->R) +
+    uo_score_Q * uo_popcnt(position->Q));
+
+  uo_position_calculate_score(position, &position->score);
+
   assert(uo_position_is_ok(position));
 
   return position;
@@ -871,11 +1041,65 @@ void uo_position_copy(uo_position *uo_restrict dst, const uo_position *uo_restri
 
   size_t size = offsetof(uo_position, movelist) + ((movelist_advance + generated_move_count) * sizeof(uo_move));
   memcpy(dst, src, size);
+
+  // Accumulators of deeper plies are recomputed when moves are made
+  if (uo_nnue_network) memcpy(dst->nnue, src->nnue, (src->ply + 1) * sizeof * src->nnue);
+
   dst->piece_captured = &dst->captures[src->piece_captured - (uo_piece *)src->captures];
   dst->movelist.head = &dst->movelist.moves[movelist_advance];
   dst->stack = &dst->history[src->stack - (uo_move_history *)src->history];
 }
 
+static inline void uo_position_nnue_add_dirty_piece(uo_nnue_accumulator *nnue, uo_piece piece, uint8_t square_from, uint8_t square_to)
+{
+  uint8_t i = nnue->dirty_count++;
+  nnue->dirty_piece[i] = piece;
+  nnue->dirty_from[i] = square_from;
+  nnue->dirty_to[i] = square_to;
+}
+
+// Records pieces changed by the move so that the accumulators of the next position can be updated from the current ones
+static inline void uo_position_nnue_record_move(const uo_position *position, uo_move move, uo_nnue_accumulator *nnue)
+{
+  uint8_t color = uo_color(position->flags);
+  uint8_t flip = color == uo_black ? 56 : 0;
+  uo_square square_from = uo_move_square_from(move);
+  uo_square square_to = uo_move_square_to(move);
+  const uo_piece *board = position->board;
+
+  nnue->computed[0] = false;
+  nnue->computed[1] = false;
+  nnue->dirty_count = 0;
+
+  uo_move_type move_type = uo_move_get_type(move);
+
+  if (uo_move_is_capture(move))
+  {
+    uo_square square_captured = move_type == uo_move_type__enpassant ? square_to - 8 : square_to;
+    uo_position_nnue_add_dirty_piece(nnue, board[square_captured] ^ color, square_captured ^ flip, uo_nnue_square_none);
+  }
+
+  if (uo_move_is_promotion(move))
+  {
+    // Promotion types are ordered N, B, R, Q as are the piece codes
+    uo_piece piece_promo = (uo_piece__N + ((move_type & 3) << 1)) ^ color;
+    uo_position_nnue_add_dirty_piece(nnue, uo_piece__P ^ color, square_from ^ flip, uo_nnue_square_none);
+    uo_position_nnue_add_dirty_piece(nnue, piece_promo, uo_nnue_square_none, square_to ^ flip);
+    return;
+  }
+
+  uo_position_nnue_add_dirty_piece(nnue, board[square_from] ^ color, square_from ^ flip, square_to ^ flip);
+
+  if (move_type == uo_move_type__OO)
+  {
+    uo_position_nnue_add_dirty_piece(nnue, uo_piece__R ^ color, uo_square__h1 ^ flip, uo_square__f1 ^ flip);
+  }
+  else if (move_type == uo_move_type__OOO)
+  {
+    uo_position_nnue_add_dirty_piece(nnue, uo_piece__R ^ color, uo_square__a1 ^ flip, uo_square__d1 ^ flip);
+  }
+}
+
 void uo_position_make_move(uo_position *position, uo_move move, uint64_t key, uo_position_flags flags)
 {
   if (!key || !flags) key = uo_position_move_key(position, move, &flags);
@@ -890,6 +1114,10 @@ void uo_position_make_move(uo_position *position, uo_move move, uint64_t key, uo
 
   uo_move_type move_type = uo_move_get_type(move);
 
+  assert(position->ply < UO_MAX_PLY);
+  if (uo_nnue_network) uo_position_nnue_record_move(position, move, &position->nnue[position->ply + 1]);
+  uo_position_update_score(position, move, 1);
+
   switch (move_type)
   {
     case uo_move_type__quiet:
@@ -1059,6 +1287,7 @@ void uo_position_unmake_move(uo_position *position)
   }
 
   uo_position_undo_switch_turn(position);
+  uo_position_update_score(position, move, -1);
 
   assert(uo_position_is_ok(position));
 }
@@ -1084,6 +1313,14 @@ void uo_position_make_null_move(uo_position *position)
   castling = uo_position_flags_castling(flags);
   key ^= uo_zobrist_castling[castling];
 
+  if (uo_nnue_network)
+  {
+    uo_nnue_accumulator *nnue = &position->nnue[position->ply + 1];
+    nnue->computed[0] = false;
+    nnue->computed[1] = false;
+    nnue->dirty_count = 0;
+  }
+
   uo_position_do_switch_turn(position, key, flags);
   position->stack->checks = uo_move_history__checks_none;
 
@@ -1098,6 +1335,255 @@ void uo_position_unmake_null_move(uo_position *position)
   assert(uo_position_is_ok(position));
 }
 
+// Collects features of all non-king pieces for the perspective of given color
+static inline size_t uo_position_nnue_features(const uo_position *position, uint8_t perspective, uint8_t square_K, size_t *features)
+{
+  uint8_t color = uo_color(position->flags);
+  uint8_t flip = color == uo_black ? 56 : 0;
+  uo_bitboard pieces = uo_andn(position->K, position->own | position->enemy);
+  size_t count = 0;
+
+  while (pieces)
+  {
+    uo_square square = uo_bitboard_next_square(&pieces);
+    features[count++] = uo_nnue_feature_index(perspective, square_K, position->board[square] ^ color, square ^ flip);
+  }
+
+  return count;
+}
+
+int16_t uo_position_evaluate_nnue(uo_position *position)
+{
+  const uo_nnue *nnue = uo_nnue_network;
+  uint8_t color = uo_color(position->flags);
+  uint8_t flip = color == uo_black ? 56 : 0;
+  uo_nnue_accumulator *accumulator = &position->nnue[position->ply];
+
+  for (uint8_t perspective = 0; perspective < 2; ++perspective)
+  {
+    if (accumulator->computed[perspective]) continue;
+
+    uo_bitboard K = position->K & (perspective == color ? position->own : position->enemy);
+    uint8_t square_K = uo_tzcnt(K) ^ flip;
+    uo_piece piece_K = uo_piece__K ^ perspective;
+
+    // Step 1. Find the closest position within the search tree with a computed accumulator.
+    //         If the king of the perspective has moved since, the accumulator has to be refreshed.
+    uo_nnue_accumulator *stack = accumulator;
+    uo_nnue_accumulator *stack_root = position->nnue;
+    bool refresh = false;
+
+    while (!refresh && !stack->computed[perspective])
+    {
+      if (stack == stack_root)
+      {
+        refresh = true;
+        break;
+      }
+
+      for (uint8_t i = 0; i < stack->dirty_count; ++i)
+      {
+        refresh |= stack->dirty_piece[i] == piece_K;
+      }
+
+      --stack;
+    }
+
+    // Step 2. Refresh the accumulator from all active features
+    if (refresh)
+    {
+      size_t features[32];
+      size_t count = uo_position_nnue_features(position, perspective, square_K, features);
+      uo_nnue_accumulator_refresh(nnue, accumulator->values[perspective], features, count);
+      accumulator->computed[perspective] = true;
+      continue;
+    }
+
+    // Step 3. Update accumulators incrementally up to the current position
+    while (stack++ != accumulator)
+    {
+      size_t removed[uo_nnue_dirty_piece_max];
+      size_t added[uo_nnue_dirty_piece_max];
+      size_t removed_count = 0;
+      size_t added_count = 0;
+
+      for (uint8_t i = 0; i < stack->dirty_count; ++i)
+      {
+        uo_piece piece = stack->dirty_piece[i];
+
+        // Kings are not features. Moves of the opposing king do not affect the accumulator of the perspective.
+        if (uo_piece_type(piece) == uo_piece__K) continue;
+
+        uint8_t square_from = stack->dirty_from[i];
+        uint8_t square_to = stack->dirty_to[i];
+
+        if (square_from != uo_nnue_square_none) removed[removed_count++] = uo_nnue_feature_index(perspective, square_K, piece, square_from);
+        if (square_to != uo_nnue_square_none) added[added_count++] = uo_nnue_feature_index(perspective, square_K, piece, square_to);
+      }
+
+      uo_nnue_accumulator_update(nnue, stack->values[perspective], stack[-1].values[perspective], removed, removed_count, added, added_count);
+      stack->computed[perspective] = true;
+    }
+  }
+
+  // Step 4. Propagate accumulator values through the network, side to move first
+  int32_t score = uo_nnue_propagate(nnue, accumulator->values[color], accumulator->values[!color]);
+  return uo_max(-uo_score_tb_win_threshold + 1, uo_min(uo_score_tb_win_threshold - 1, score));
+}
+
+static int16_t uo_position_evaluate_endgame_draw(const uo_position *position, uint8_t color_strong)
+{
+  return uo_score_draw;
+}
+
+// Lone king against enough material to force mate. Lone king is driven to the edge and kings are brought close.
+static int16_t uo_position_evaluate_endgame_KXK(const uo_position *position, uint8_t color_strong)
+{
+  uint8_t color = uo_color(position->flags);
+  uo_bitboard mask_strong = color == color_strong ? position->own : position->enemy;
+  uo_square square_strong_K = uo_tzcnt(mask_strong & position->K);
+  uo_square square_weak_K = uo_tzcnt(uo_andn(mask_strong, position->K));
+
+  // Bishops of the same color cannot mate alone
+  if (!(mask_strong & (position->P | position->N | position->R | position->Q))
+    && (!(position->B & uo_bitboard__light_squares) || !(position->B & uo_bitboard__dark_squares)))
+  {
+    return uo_score_draw;
+  }
+
+  int32_t score = uo_score_endgame_known_win + position->score.material[color_strong];
+  score += uo_score_endgame_push_to_edge * uo_square_distance_center(square_weak_K);
+  score += uo_score_endgame_push_close * (7 - uo_square_distance(square_strong_K, square_weak_K));
+  score = uo_min(score, uo_score_tb_win_threshold - 1);
+
+  return color == color_strong ? score : -score;
+}
+
+// Lone king against bishop and knight. Lone king is driven to a corner of the same color as the bishop.
+static int16_t uo_position_evaluate_endgame_KBNK(const uo_position *position, uint8_t color_strong)
+{
+  uint8_t color = uo_color(position->flags);
+  uo_bitboard mask_strong = color == color_strong ? position->own : position->enemy;
+  uo_square square_strong_K = uo_tzcnt(mask_strong & position->K);
+  uo_square square_weak_K = uo_tzcnt(uo_andn(mask_strong, position->K));
+
+  // Corners a1 and h8 are dark squares
+  bool is_dark_B = position->B & uo_bitboard__dark_squares;
+  uo_square square_corner_1 = is_dark_B ? uo_square__a1 : uo_square__a8;
+  uo_square square_corner_2 = is_dark_B ? uo_square__h8 : uo_square__h1;
+  int distance_corner = uo_min(
+    uo_square_distance_manhattan(square_weak_K, square_corner_1),
+    uo_square_distance_manhattan(square_weak_K, square_corner_2));
+
+  int32_t score = uo_score_endgame_known_win + position->score.material[color_strong];
+  score += uo_score_endgame_push_to_corner * (7 - uo_min(distance_corner, 7));
+  score += uo_score_endgame_push_close * (7 - uo_square_distance(square_strong_K, square_weak_K));
+
+  return color == color_strong ? score : -score;
+}
+
+void uo_position_material_entry_init(const uo_position *position, uo_material_hash_entry *entry)
+{
+  // Step 1. Count pieces by absolute color
+  uint8_t color = uo_color(position->flags);
+  uo_bitboard mask[2];
+  mask[color] = position->own;
+  mask[!color] = position->enemy;
+
+  int count_P[2], count_N[2], count_B[2], count_R[2], count_Q[2];
+  int16_t material_non_P[2];
+
+  for (uint8_t c = uo_white; c <= uo_black; ++c)
+  {
+    count_P[c] = uo_popcnt(mask[c] & position->P);
+    count_N[c] = uo_popcnt(mask[c] & position->N);
+    count_B[c] = uo_popcnt(mask[c] & position->B);
+    count_R[c] = uo_popcnt(mask[c] & position->R);
+    count_Q[c] = uo_popcnt(mask[c] & position->Q);
+    material_non_P[c] = position->score.material[c] - count_P[c] * uo_score_P;
+  }
+
+  entry->key = position->score.key_material;
+  entry->evaluate = NULL;
+  entry->color_strong = uo_white;
+  entry->scale[uo_white] = uo_scale_factor_normal;
+  entry->scale[uo_black] = uo_scale_factor_normal;
+
+  // Step 2. Game phase
+  entry->phase = uo_position_material_percentage(position);
+
+  // Step 3. Material imbalance
+  entry->imbalance = uo_score_B_pair * ((count_B[uo_white] >= 2) - (count_B[uo_black] >= 2));
+
+  // Step 4. Specialised endgame evaluation
+  if (!count_P[uo_white] && !count_P[uo_black]
+    && material_non_P[uo_white] < uo_score_R && material_non_P[uo_black] < uo_score_R)
+  {
+    // Insufficient material for either side
+    entry->evaluate = uo_position_evaluate_endgame_draw;
+  }
+
+  for (uint8_t c = uo_white; c <= uo_black && !entry->evaluate; ++c)
+  {
+    // Only for lone king
+    if (count_P[!c] || material_non_P[!c]) continue;
+
+    entry->color_strong = c;
+
+    if (!count_P[c] && count_N[c] == 1 && count_B[c] == 1 && !count_R[c] && !count_Q[c])
+    {
+      entry->evaluate = uo_position_evaluate_endgame_KBNK;
+    }
+    else if (!count_P[c] && count_N[c] == 2 && material_non_P[c] == 2 * uo_score_N)
+    {
+      entry->evaluate = uo_position_evaluate_endgame_draw;
+    }
+    else if (material_non_P[c] >= uo_score_R)
+    {
+      entry->evaluate = uo_position_evaluate_endgame_KXK;
+    }
+  }
+
+  // Step 5. Scale factors for the side without pawns and with little or no extra material
+  for (uint8_t c = uo_white; c <= uo_black; ++c)
+  {
+    if (count_P[c] || material_non_P[c] - material_non_P[!c] > uo_score_B) continue;
+
+    entry->scale[c] = material_non_P[c] < uo_score_R ? uo_scale_factor_draw
+      : material_non_P[!c] <= uo_score_B ? 4 : 14;
+  }
+
+  // Step 6. Opposite colored bishops are detected at evaluation time
+  entry->is_opposite_B_candidate = count_B[uo_white] == 1 && count_B[uo_black] == 1
+    && !count_N[uo_white] && !count_N[uo_black]
+    && !count_R[uo_white] && !count_R[uo_black]
+    && !count_Q[uo_white] && !count_Q[uo_black];
+}
+
+int16_t uo_position_evaluate_with_parameters(uo_position *position, const uo_evaluation_parameters *parameters)
+{
+  uo_material_hash_entry material;
+  uo_position_material_entry_init(position, &material);
+
+  if (material.evaluate) return material.evaluate(position, material.color_strong);
+
+  return uo_position_evaluate_hce(position, &material, NULL, parameters, NULL);
+}
+
+int16_t uo_position_evaluate_trace(uo_position *position, const uo_evaluation_parameters *parameters, uo_evaluation_trace *trace)
+{
+  uo_material_hash_entry material;
+  uo_position_material_entry_init(position, &material);
+
+  if (material.evaluate)
+  {
+    uo_evaluation_trace_begin(trace);
+    return trace->score = trace->score_unscaled = material.evaluate(position, material.color_strong);
+  }
+
+  return uo_position_evaluate_hce(position, &material, NULL, parameters, trace);
+}
+
 static inline void uo_movegenlist_init(uo_movegenlist *movegenlist, uo_move *root, size_t tactical_move_count_guess)
 {
   movegenlist->moves.tactical.head = movegenlist->moves.tactical.root = root;
@@ -2149,6 +2635,38 @@ uo_move uo_position_parse_move(const uo_position *position, char str[5])
   return uo_move_encode(square_from, square_to, move_type);
 }
 
+// Parses move in long algebraic notation and returns matching legal move or zero if the move is not legal
+uo_move uo_position_parse_legal_move(uo_position *position, char str[5])
+{
+  uo_move move = uo_position_parse_move(position, str);
+  if (!move) return 0;
+
+  uo_square square_from = uo_move_square_from(move);
+  uo_square square_to = uo_move_square_to(move);
+  uo_move_type move_type_promo = uo_move_get_type(move) & uo_move_type__promo_Q;
+
+  size_t move_count = uo_position_generate_moves(position);
+
+  for (size_t i = 0; i < move_count; ++i)
+  {
+    uo_move move = position->movelist.head[i];
+    if (square_from == uo_move_square_from(move)
+      && square_to == uo_move_square_to(move))
+    {
+      uo_move_type move_type = uo_move_get_type(move);
+
+      if ((move_type & uo_move_type__promo) && move_type_promo != (move_type & uo_move_type__promo_Q))
+      {
+        continue;
+      }
+
+      return move;
+    }
+  }
+
+  return 0;
+}
+
 size_t uo_position_print_move(const uo_position *position, uo_move move, char str[6])
 {
   if (uo_color(position->flags) == uo_black)
@@ -2159,7 +2677,8 @@ size_t uo_position_print_move(const uo_position *position, uo_move move, char st
 
   uo_square square_from = uo_move_square_from(move);
   uo_square square_to = uo_move_square_to(move);
-  uo_move_type move_type_promo = uo_move_get_type(move) & uo_move_type__promo_Q;
+  uo_move_type move_type = uo_move_get_type(move);
+  uo_move_type move_type_promo = (move_type & uo_move_type__promo) ? move_type & uo_move_type__promo_Q : 0;
 
   sprintf(str, "%c%d%c%d",
     'a' + uo_square_file(square_from), 1 + uo_square_rank(square_from),
@@ -2248,7 +2767,13 @@ size_t uo_position_perft(uo_position *position, size_t depth, bool tactical)
   return node_count;
 }
 
-uo_position *uo_position_randomize(uo_position *position, const char *pieces /* e.g. KQRPPvKRRBNP */)
+// Random number from the given state or from the process-wide generator if there is no state
+static inline float uo_position_rand_between_excl(uint64_t *rand_state, float min, float max_ex)
+{
+  return rand_state ? uo_rand_between_excl_r(rand_state, min, max_ex) : uo_rand_between_excl(min, max_ex);
+}
+
+uo_position *uo_position_randomize(uo_position *position, const char *pieces /* e.g. KQRPPvKRRBNP */, uint64_t *rand_state)
 {
   // Step 1. Clear position
   memset(position, 0, sizeof * position);
@@ -2257,7 +2782,7 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
   uo_position_flags flags = 0;
   uint8_t color = uo_white;
 
-  if (uo_rand_percent() > 0.5f)
+  if (uo_position_rand_between_excl(rand_state, 0.0f, 1.0f) >= 0.5f)
   {
     color = uo_black;
     flags = uo_position_flags_update_color_to_move(flags, uo_black);
@@ -2315,17 +2840,17 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
   }
   else
   {
-    count_own_P = uo_rand_between_excl(0, 8);
-    count_own_Q = uo_rand_between_excl(0, count_own_P < uo_rand_between_excl(0, 8) ? 2 : 1);
-    count_own_R = uo_rand_between_excl(0, 2);
-    count_own_B = uo_rand_between_excl(0, 2);
-    count_own_N = uo_rand_between_excl(0, 2);
+    count_own_P = uo_position_rand_between_excl(rand_state, 0, 8);
+    count_own_Q = uo_position_rand_between_excl(rand_state, 0, count_own_P < uo_position_rand_between_excl(rand_state, 0, 8) ? 2 : 1);
+    count_own_R = uo_position_rand_between_excl(rand_state, 0, 2);
+    count_own_B = uo_position_rand_between_excl(rand_state, 0, 2);
+    count_own_N = uo_position_rand_between_excl(rand_state, 0, 2);
 
-    count_enemy_P = uo_rand_between_excl(0, 8);
-    count_enemy_Q = uo_rand_between_excl(0, count_own_P < uo_rand_between_excl(0, 8) ? 2 : 1);
-    count_enemy_R = uo_rand_between_excl(0, 2);
-    count_enemy_B = uo_rand_between_excl(0, 2);
-    count_enemy_N = uo_rand_between_excl(0, 2);
+    count_enemy_P = uo_position_rand_between_excl(rand_state, 0, 8);
+    count_enemy_Q = uo_position_rand_between_excl(rand_state, 0, count_own_P < uo_position_rand_between_excl(rand_state, 0, 8) ? 2 : 1);
+    count_enemy_R = uo_position_rand_between_excl(rand_state, 0, 2);
+    count_enemy_B = uo_position_rand_between_excl(rand_state, 0, 2);
+    count_enemy_N = uo_position_rand_between_excl(rand_state, 0, 2);
   }
 
   // Step 4. Piece placement
@@ -2334,12 +2859,12 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
 
   while (count_own_P--)
   {
-    size_t i = uo_rand_between_excl(8, 56);
+    size_t i = uo_position_rand_between_excl(rand_state, 8, 56);
     uo_bitboard mask = uo_square_bitboard(i);
 
     while (mask & occupied)
     {
-      i = uo_rand_between_excl(8, 56);
+      i = uo_position_rand_between_excl(rand_state, 8, 56);
       mask = uo_square_bitboard(i);
     }
 
@@ -2351,12 +2876,12 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
 
   while (count_enemy_P--)
   {
-    size_t i = uo_rand_between_excl(8, 56);
+    size_t i = uo_position_rand_between_excl(rand_state, 8, 56);
     uo_bitboard mask = uo_square_bitboard(i);
 
     while (mask & occupied)
     {
-      i = uo_rand_between_excl(8, 56);
+      i = uo_position_rand_between_excl(rand_state, 8, 56);
       mask = uo_square_bitboard(i);
     }
 
@@ -2368,12 +2893,12 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
 
   while (count_own_Q--)
   {
-    size_t i = uo_rand_between_excl(0, 64);
+    size_t i = uo_position_rand_between_excl(rand_state, 0, 64);
     uo_bitboard mask = uo_square_bitboard(i);
 
     while (mask & occupied)
     {
-      i = uo_rand_between_excl(0, 64);
+      i = uo_position_rand_between_excl(rand_state, 0, 64);
       mask = uo_square_bitboard(i);
     }
 
@@ -2385,12 +2910,12 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
 
   while (count_enemy_Q--)
   {
-    size_t i = uo_rand_between_excl(0, 64);
+    size_t i = uo_position_rand_between_excl(rand_state, 0, 64);
     uo_bitboard mask = uo_square_bitboard(i);
 
     while (mask & occupied)
     {
-      i = uo_rand_between_excl(0, 64);
+      i = uo_position_rand_between_excl(rand_state, 0, 64);
       mask = uo_square_bitboard(i);
     }
 
@@ -2402,12 +2927,12 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
 
   while (count_own_R--)
   {
-    size_t i = uo_rand_between_excl(0, 64);
+    size_t i = uo_position_rand_between_excl(rand_state, 0, 64);
     uo_bitboard mask = uo_square_bitboard(i);
 
     while (mask & occupied)
     {
-      i = uo_rand_between_excl(0, 64);
+      i = uo_position_rand_between_excl(rand_state, 0, 64);
       mask = uo_square_bitboard(i);
     }
 
@@ -2419,12 +2944,12 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
 
   while (count_enemy_R--)
   {
-    size_t i = uo_rand_between_excl(0, 64);
+    size_t i = uo_position_rand_between_excl(rand_state, 0, 64);
     uo_bitboard mask = uo_square_bitboard(i);
 
     while (mask & occupied)
     {
-      i = uo_rand_between_excl(0, 64);
+      i = uo_position_rand_between_excl(rand_state, 0, 64);
       mask = uo_square_bitboard(i);
     }
 
@@ -2436,12 +2961,12 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
 
   while (count_own_B--)
   {
-    size_t i = uo_rand_between_excl(0, 64);
+    size_t i = uo_position_rand_between_excl(rand_state, 0, 64);
     uo_bitboard mask = uo_square_bitboard(i);
 
     while (mask & occupied)
     {
-      i = uo_rand_between_excl(0, 64);
+      i = uo_position_rand_between_excl(rand_state, 0, 64);
       mask = uo_square_bitboard(i);
     }
 
@@ -2453,12 +2978,12 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
 
   while (count_enemy_B--)
   {
-    size_t i = uo_rand_between_excl(0, 64);
+    size_t i = uo_position_rand_between_excl(rand_state, 0, 64);
     uo_bitboard mask = uo_square_bitboard(i);
 
     while (mask & occupied)
     {
-      i = uo_rand_between_excl(0, 64);
+      i = uo_position_rand_between_excl(rand_state, 0, 64);
       mask = uo_square_bitboard(i);
     }
 
@@ -2470,12 +2995,12 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
 
   while (count_own_N--)
   {
-    size_t i = uo_rand_between_excl(0, 64);
+    size_t i = uo_position_rand_between_excl(rand_state, 0, 64);
     uo_bitboard mask = uo_square_bitboard(i);
 
     while (mask & occupied)
     {
-      i = uo_rand_between_excl(0, 64);
+      i = uo_position_rand_between_excl(rand_state, 0, 64);
       mask = uo_square_bitboard(i);
     }
 
@@ -2487,12 +3012,12 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
 
   while (count_enemy_N--)
   {
-    size_t i = uo_rand_between_excl(0, 64);
+    size_t i = uo_position_rand_between_excl(rand_state, 0, 64);
     uo_bitboard mask = uo_square_bitboard(i);
 
     while (mask & occupied)
     {
-      i = uo_rand_between_excl(0, 64);
+      i = uo_position_rand_between_excl(rand_state, 0, 64);
       mask = uo_square_bitboard(i);
     }
 
@@ -2502,12 +3027,12 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
     position->board[i] = uo_piece__n;
   }
 
-  size_t square_own_K = uo_rand_between_excl(0, 64);
+  size_t square_own_K = uo_position_rand_between_excl(rand_state, 0, 64);
   uo_bitboard own_K = uo_square_bitboard(square_own_K);
 
   while (own_K & occupied)
   {
-    square_own_K = uo_rand_between_excl(0, 64);
+    square_own_K = uo_position_rand_between_excl(rand_state, 0, 64);
     own_K = uo_square_bitboard(square_own_K);
   }
 
@@ -2518,12 +3043,12 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
 
   uo_bitboard unavailable_to_enemy_K = occupied | uo_position_own_attacks(position);
 
-  size_t square_enemy_K = uo_rand_between_excl(0, 64);
+  size_t square_enemy_K = uo_position_rand_between_excl(rand_state, 0, 64);
   uo_bitboard enemy_K = uo_square_bitboard(square_enemy_K);
 
   while (enemy_K & unavailable_to_enemy_K)
   {
-    square_enemy_K = uo_rand_between_excl(0, 64);
+    square_enemy_K = uo_position_rand_between_excl(rand_state, 0, 64);
     enemy_K = uo_square_bitboard(square_enemy_K);
   }
 
@@ -2551,6 +3076,7 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
   position->stack[-2].static_eval = uo_score_unknown;
   position->stack[-1].static_eval = uo_score_unknown;
   position->stack[0].static_eval = uo_score_unknown;
+  position->stack[0].lazy_eval = uo_score_unknown;
 
   position->flags = flags;
   position->key = uo_position_calculate_key(position);
@@ -2566,6 +3092,8 @@ uo_position *uo_position_randomize(uo_position *position, const char *pieces /*
     uo_score_R * uo_popcnt(position->R) +
     uo_score_Q * uo_popcnt(position->Q));
 
+  uo_position_calculate_score(position, &position->score);
+
   assert(uo_position_is_ok(position));
   return position;
 }
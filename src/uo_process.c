@@ -0,0 +1,490 @@
+#include "uo_process.h"
+#include "uo_misc.h"
+#include "uo_util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#define uo_managed_process_line_size 0x2000
+#define uo_managed_process_read_size 0x1000
+#define uo_managed_process_exit_timeout_msec 1000.0
+
+#ifndef WIN32
+# include <unistd.h>
+# include <fcntl.h>
+# include <signal.h>
+# include <errno.h>
+# include <sys/types.h>
+# include <sys/wait.h>
+# include <sys/epoll.h>
+#endif
+
+typedef struct uo_managed_process
+{
+  uo_process_manager *manager;
+  uo_managed_process *next;
+  uo_managed_process_callbacks callbacks;
+  void *data;
+  bool closed;
+  bool exited;
+  bool has_deadline;
+  double timeout_msec;
+  uo_time time_timeout_set;
+  char line[uo_managed_process_line_size];
+  size_t line_len;
+  char *write_buffer;
+  size_t write_len;
+  size_t write_capacity;
+#ifdef WIN32
+  uo_process *process;
+#else
+  pid_t pid;
+  int stdin_fd;
+  int stdout_fd;
+  bool write_pending; // input is watched for becoming writable
+#endif
+} uo_managed_process;
+
+typedef struct uo_process_manager
+{
+  uo_managed_process *head;
+  uo_managed_process *tail;
+#ifndef WIN32
+  int epoll_fd;
+#endif
+} uo_process_manager;
+
+// Splits output into lines. Characters of too long lines are dropped.
+static void uo_managed_process_handle_output(uo_managed_process *process, const char *buffer, size_t len)
+{
+  for (size_t i = 0; i < len && !process->closed; ++i)
+  {
+    char c = buffer[i];
+
+    if (c == '\n')
+    {
+      if (process->line_len && process->line[process->line_len - 1] == '\r') --process->line_len;
+      process->line[process->line_len] = '\0';
+      process->line_len = 0;
+      if (process->callbacks.line) process->callbacks.line(process->data, process->line);
+    }
+    else if (process->line_len < uo_managed_process_line_size - 1)
+    {
+      process->line[process->line_len++] = c;
+    }
+  }
+}
+
+#ifdef WIN32
+
+static bool uo_managed_process_spawn(uo_managed_process *process, char *cmdline)
+{
+  process->process = uo_process_create(cmdline);
+  return process->process != NULL;
+}
+
+static void uo_managed_process_release(uo_managed_process *process)
+{
+  uo_process_free(process->process);
+}
+
+// Process handles are freed when the process is closed
+static bool uo_managed_process_reap(uo_managed_process *process)
+{
+  return true;
+}
+
+static void uo_managed_process_handle_exit(uo_managed_process *process);
+
+// Anonymous pipes do not support non-blocking writes, so queued input is written right away
+static void uo_managed_process_flush(uo_managed_process *process)
+{
+  if (process->exited) process->write_len = 0;
+  if (!process->write_len) return;
+
+  uo_process_write_stdin(process->process, process->write_buffer, process->write_len);
+  process->write_len = 0;
+}
+
+static bool uo_process_manager_init(uo_process_manager *manager)
+{
+  return true;
+}
+
+static void uo_process_manager_release(uo_process_manager *manager) {}
+
+// Polls output of the processes until there is output or the wait time has passed
+static size_t uo_process_manager_wait(uo_process_manager *manager, double timeout_msec)
+{
+  char buffer[uo_managed_process_read_size];
+  uo_time time_start;
+  uo_time_now(&time_start);
+
+  while (true)
+  {
+    size_t count = 0;
+
+    for (uo_managed_process *process = manager->head; process; process = process->next)
+    {
+      if (process->closed || process->exited) continue;
+
+      size_t len;
+      if (!uo_process_read_stdout_nonblocking(process->process, buffer, sizeof buffer, &len))
+      {
+        uo_managed_process_handle_exit(process);
+        ++count;
+      }
+      else if (len)
+      {
+        uo_managed_process_handle_output(process, buffer, len);
+        ++count;
+      }
+    }
+
+    if (count) return count;
+    if (timeout_msec >= 0 && uo_time_elapsed_msec(&time_start) >= timeout_msec) return 0;
+
+    uo_sleep_msec(1);
+  }
+}
+
+#else
+
+static bool uo_managed_process_spawn(uo_managed_process *process, char *cmdline)
+{
+  int stdin_pipe[2];
+  int stdout_pipe[2];
+
+  // Pipes are not inherited by other children. Standard streams of the child are duplicated, which clears the flag.
+  if (pipe2(stdin_pipe, O_CLOEXEC)) return false;
+
+  if (pipe2(stdout_pipe, O_CLOEXEC))
+  {
+    close(stdin_pipe[0]);
+    close(stdin_pipe[1]);
+    return false;
+  }
+
+  pid_t pid = fork();
+
+  if (pid == 0)
+  {
+    dup2(stdin_pipe[0], STDIN_FILENO);
+    dup2(stdout_pipe[1], STDOUT_FILENO);
+    dup2(stdout_pipe[1], STDERR_FILENO);
+    execl("/bin/sh", "sh", "-c", cmdline, (char *)NULL);
+    _exit(127);
+  }
+
+  close(stdin_pipe[0]);
+  close(stdout_pipe[1]);
+
+  if (pid < 0)
+  {
+    close(stdin_pipe[1]);
+    close(stdout_pipe[0]);
+    return false;
+  }
+
+  process->pid = pid;
+  process->stdin_fd = stdin_pipe[1];
+  process->stdout_fd = stdout_pipe[0];
+  fcntl(process->stdin_fd, F_SETFL, fcntl(process->stdin_fd, F_GETFL) | O_NONBLOCK);
+  fcntl(process->stdout_fd, F_SETFL, fcntl(process->stdout_fd, F_GETFL) | O_NONBLOCK);
+
+  // Output is identified by the process pointer and input by the pointer with the low bit set
+  struct epoll_event event = { .events = EPOLLIN, .data.u64 = (uintptr_t)process };
+  epoll_ctl(process->manager->epoll_fd, EPOLL_CTL_ADD, process->stdout_fd, &event);
+
+  return true;
+}
+
+static void uo_managed_process_close_stdout(uo_managed_process *process)
+{
+  if (process->stdout_fd < 0) return;
+
+  epoll_ctl(process->manager->epoll_fd, EPOLL_CTL_DEL, process->stdout_fd, NULL);
+  close(process->stdout_fd);
+  process->stdout_fd = -1;
+}
+
+static void uo_managed_process_release(uo_managed_process *process)
+{
+  uo_managed_process_close_stdout(process);
+
+  if (process->write_pending) epoll_ctl(process->manager->epoll_fd, EPOLL_CTL_DEL, process->stdin_fd, NULL);
+  close(process->stdin_fd);
+
+  // Process sees the end of its input and is given time to exit before it is killed
+  uo_managed_process_set_timeout(process, uo_managed_process_exit_timeout_msec);
+}
+
+// Reaps a closed process without blocking. Process which is still running after the deadline is killed.
+// Returns true if the process has been reaped.
+static bool uo_managed_process_reap(uo_managed_process *process)
+{
+  if (waitpid(process->pid, NULL, WNOHANG) != 0) return true;
+  if (uo_time_elapsed_msec(&process->time_timeout_set) < process->timeout_msec) return false;
+
+  kill(process->pid, SIGKILL);
+  return waitpid(process->pid, NULL, WNOHANG) != 0;
+}
+
+// Writes queued input until the pipe is full. Input is watched for becoming writable while there is input left.
+static void uo_managed_process_flush(uo_managed_process *process)
+{
+  size_t written = 0;
+
+  while (written < process->write_len)
+  {
+    ssize_t len = write(process->stdin_fd, process->write_buffer + written, process->write_len - written);
+
+    if (len > 0)
+    {
+      written += len;
+    }
+    else if (len < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    else if (len < 0 && errno == EAGAIN)
+    {
+      break;
+    }
+    else
+    {
+      // Process has closed its input
+      written = process->write_len;
+    }
+  }
+
+  process->write_len -= written;
+  memmove(process->write_buffer, process->write_buffer + written, process->write_len);
+
+  bool write_pending = process->write_len > 0;
+  if (write_pending == process->write_pending) return;
+
+  struct epoll_event event = { .events = EPOLLOUT, .data.u64 = (uintptr_t)process | 1 };
+  epoll_ctl(process->manager->epoll_fd, write_pending ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, process->stdin_fd, &event);
+  process->write_pending = write_pending;
+}
+
+static bool uo_process_manager_init(uo_process_manager *manager)
+{
+  // Writing to a process which has exited fails instead of raising a signal
+  signal(SIGPIPE, SIG_IGN);
+
+  manager->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  return manager->epoll_fd >= 0;
+}
+
+static void uo_process_manager_release(uo_process_manager *manager)
+{
+  close(manager->epoll_fd);
+}
+
+static void uo_managed_process_handle_exit(uo_managed_process *process);
+
+static size_t uo_process_manager_wait(uo_process_manager *manager, double timeout_msec)
+{
+  struct epoll_event events[0x40];
+  char buffer[uo_managed_process_read_size];
+
+  int event_count = epoll_wait(manager->epoll_fd, events, 0x40, timeout_msec < 0 ? -1 : (int)ceil(timeout_msec));
+  if (event_count <= 0) return 0;
+
+  for (int i = 0; i < event_count; ++i)
+  {
+    uo_managed_process *process = (uo_managed_process *)(uintptr_t)(events[i].data.u64 & ~(uint64_t)1);
+    bool is_input = events[i].data.u64 & 1;
+
+    // Process may have been closed by a callback of a previous event
+    if (process->closed) continue;
+
+    if (is_input)
+    {
+      uo_managed_process_flush(process);
+      continue;
+    }
+
+    ssize_t len;
+    while (!process->closed && (len = read(process->stdout_fd, buffer, sizeof buffer)) > 0)
+    {
+      uo_managed_process_handle_output(process, buffer, len);
+    }
+
+    if (!process->closed && (len == 0 || (errno != EAGAIN && errno != EINTR)))
+    {
+      uo_managed_process_close_stdout(process);
+      uo_managed_process_handle_exit(process);
+    }
+  }
+
+  return event_count;
+}
+
+#endif
+
+static void uo_managed_process_handle_exit(uo_managed_process *process)
+{
+  process->exited = true;
+  if (process->callbacks.exit) process->callbacks.exit(process->data);
+}
+
+uo_process_manager *uo_process_manager_create(void)
+{
+  uo_process_manager *manager = calloc(1, sizeof * manager);
+
+  if (!uo_process_manager_init(manager))
+  {
+    free(manager);
+    return NULL;
+  }
+
+  return manager;
+}
+
+// Frees processes which have been closed and reaped
+static void uo_process_manager_remove_closed(uo_process_manager *manager)
+{
+  uo_managed_process **next = &manager->head;
+  manager->tail = NULL;
+
+  while (*next)
+  {
+    uo_managed_process *process = *next;
+
+    if (process->closed && uo_managed_process_reap(process))
+    {
+      *next = process->next;
+      free(process->write_buffer);
+      free(process);
+    }
+    else
+    {
+      manager->tail = process;
+      next = &process->next;
+    }
+  }
+}
+
+void uo_process_manager_free(uo_process_manager *manager)
+{
+  for (uo_managed_process *process = manager->head; process; process = process->next)
+  {
+    if (!process->closed) uo_managed_process_close(process);
+  }
+
+  // Closed processes are waited until they exit or are killed after the deadline
+  uo_process_manager_remove_closed(manager);
+
+  while (manager->head)
+  {
+    uo_sleep_msec(1);
+    uo_process_manager_remove_closed(manager);
+  }
+
+  uo_process_manager_release(manager);
+  free(manager);
+}
+
+uo_managed_process *uo_process_manager_start(uo_process_manager *manager, char *cmdline, const uo_managed_process_callbacks *callbacks, void *data)
+{
+  uo_managed_process *process = calloc(1, sizeof * process);
+  process->manager = manager;
+  process->callbacks = *callbacks;
+  process->data = data;
+
+  if (!uo_managed_process_spawn(process, cmdline))
+  {
+    free(process);
+    return NULL;
+  }
+
+  if (manager->tail)
+  {
+    manager->tail->next = process;
+  }
+  else
+  {
+    manager->head = process;
+  }
+
+  manager->tail = process;
+
+  return process;
+}
+
+size_t uo_process_manager_poll(uo_process_manager *manager, double timeout_msec)
+{
+  // Step 1. Wait time is limited by the nearest deadline. Deadline of a closed process is the time it is killed.
+  bool is_open = false;
+
+  for (uo_managed_process *process = manager->head; process; process = process->next)
+  {
+    if (!process->closed && !process->exited) is_open = true;
+    if (!process->has_deadline) continue;
+
+    double remaining_msec = uo_max(0.0, process->timeout_msec - uo_time_elapsed_msec(&process->time_timeout_set));
+    if (timeout_msec < 0 || remaining_msec < timeout_msec) timeout_msec = remaining_msec;
+  }
+
+  // Without processes and deadlines there is nothing to wait for
+  if (!is_open && timeout_msec < 0) return 0;
+
+  // Step 2. Wait for output and handle it
+  size_t event_count = is_open ? uo_process_manager_wait(manager, timeout_msec) : 0;
+  if (!is_open) uo_sleep_msec((uint64_t)ceil(timeout_msec));
+
+  // Step 3. Handle passed deadlines
+  for (uo_managed_process *process = manager->head; process; process = process->next)
+  {
+    if (process->closed || !process->has_deadline) continue;
+    if (uo_time_elapsed_msec(&process->time_timeout_set) < process->timeout_msec) continue;
+
+    process->has_deadline = false;
+    ++event_count;
+    if (process->callbacks.timeout) process->callbacks.timeout(process->data);
+  }
+
+  // Step 4. Free processes closed by the callbacks once they have exited
+  uo_process_manager_remove_closed(manager);
+
+  return event_count;
+}
+
+void uo_managed_process_write(uo_managed_process *process, const char *str)
+{
+  if (process->closed) return;
+
+  size_t len = strlen(str);
+
+  if (process->write_len + len > process->write_capacity)
+  {
+    process->write_capacity = uo_max(process->write_capacity * 2, process->write_len + len);
+    process->write_buffer = realloc(process->write_buffer, process->write_capacity);
+  }
+
+  memcpy(process->write_buffer + process->write_len, str, len);
+  process->write_len += len;
+
+  uo_managed_process_flush(process);
+}
+
+void uo_managed_process_set_timeout(uo_managed_process *process, double timeout_msec)
+{
+  process->has_deadline = timeout_msec >= 0;
+  process->timeout_msec = timeout_msec;
+  uo_time_now(&process->time_timeout_set);
+}
+
+void uo_managed_process_close(uo_managed_process *process)
+{
+  if (process->closed) return;
+
+  process->closed = true;
+  process->has_deadline = false;
+  uo_managed_process_release(process);
+}
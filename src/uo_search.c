@@ -15,6 +15,18 @@
 #include <inttypes.h>
 #include <assert.h>
 
+const uo_search_parameters uo_search_parameters_default = {
+#define uo_search_parameter(name, option, value, min, max) .name = value,
+#include "uo_search_parameters.h"
+#undef uo_search_parameter
+};
+
+const uo_search_parameter_option uo_search_parameter_options[] = {
+#define uo_search_parameter(name, option, value, min, max) { #option, min, max },
+#include "uo_search_parameters.h"
+#undef uo_search_parameter
+};
+
 typedef struct uo_parallel_search_params
 {
   uo_engine_thread *thread;
@@ -24,15 +36,56 @@ typedef struct uo_parallel_search_params
   int16_t alpha;
   int16_t beta;
   uo_move move;
-  uo_move *line;
 } uo_parallel_search_params;
 
+static inline uo_root_move *uo_search_find_root_move(uo_search_info *info, uo_move move)
+{
+  for (size_t i = 0; i < info->root_move_count; ++i)
+  {
+    if (info->root_moves[i].move == move) return &info->root_moves[i];
+  }
+
+  return NULL;
+}
+
+// Returns the fraction of root nodes which were spent searching the current best move
+static inline double uo_search_bestmove_nodes_fraction(uo_engine_thread *thread)
+{
+  uo_search_info *info = &thread->info;
+  uo_move bestmove = engine.pv[0];
+  size_t nodes_total = 0;
+  size_t nodes_bestmove = 0;
+
+  for (size_t i = 0; i < info->root_move_count; ++i)
+  {
+    uo_root_move *root_move = &info->root_moves[i];
+    nodes_total += root_move->nodes;
+
+    if (root_move->move == bestmove)
+    {
+      nodes_bestmove = root_move->nodes;
+    }
+  }
+
+  // Node counts from shallow searches are not reliable
+  if (!nodes_bestmove || info->depth < 8) return 0.0;
+
+  return (double)nodes_bestmove / (double)nodes_total;
+}
+
 static inline void uo_search_stop_if_movetime_over(uo_engine_thread *thread)
 {
   uo_search_info *info = &thread->info;
   uo_search_params *params = &engine.search_params;
   int64_t movetime = params->movetime;
 
+  // While pondering, search is not limited by time
+  if (uo_atomic_load(&params->ponder))
+  {
+    info->movetime_remaining_msec = INFINITY;
+    return;
+  }
+
   // TODO: make better decisions about how much time to use
   if (!movetime && params->time_own)
   {
@@ -57,6 +110,13 @@ static inline void uo_search_stop_if_movetime_over(uo_engine_thread *thread)
     int64_t bestmove_age = info->depth - info->bestmove_change_depth;
     movetime = uo_max(1, movetime - bestmove_age_reduction * bestmove_age);
 
+    // If most of the search effort has been spent on the best move, it is unlikely to change. Let's reduce thinking time.
+    double bestmove_nodes_fraction = uo_search_bestmove_nodes_fraction(thread);
+    if (bestmove_nodes_fraction > 0.5)
+    {
+      movetime = uo_max(1, movetime * (1.5 - bestmove_nodes_fraction));
+    }
+
     // If opponent did play the expected move, reduce move time a bit
     if (engine.ponder.is_ponderhit)
     {
@@ -79,8 +139,9 @@ static inline void uo_search_stop_if_movetime_over(uo_engine_thread *thread)
 
   if (movetime)
   {
+    // Move time is measured from the go command or from ponderhit
     const double margin_msec = engine_options.move_overhead / 2;
-    double time_msec = uo_time_elapsed_msec(&thread->info.time_start);
+    double time_msec = uo_time_elapsed_msec(&params->time_start);
 
     info->movetime_remaining_msec = (double)movetime - time_msec - margin_msec;
 
@@ -127,8 +188,8 @@ static void uo_search_print_info(uo_engine_thread *thread)
   double time_msec = uo_time_elapsed_msec(&info->time_start);
   uint64_t nps = (double)thread->info.nodes / time_msec * 1000.0;
 
-  size_t tentry_count = uo_atomic_load(&engine.ttable.count);
-  uint64_t hashfull = (tentry_count * 1000) / (engine.ttable.hash_mask + 1);
+  size_t tentry_count = uo_atomic_load(&thread->ttable->count);
+  uint64_t hashfull = (tentry_count * 1000) / (thread->ttable->hash_mask + 1);
 
   char move_str[6];
 
@@ -274,7 +335,7 @@ static inline void uo_search_sort_and_filter_moves(uo_engine_thread *thread, uo_
 
     uint64_t key = uo_position_move_key(position, move, NULL);
     uo_tdata data;
-    bool found = uo_ttable_get(&engine.ttable, key, position->root_ply, &data);
+    bool found = uo_ttable_get(thread->ttable, key, position->root_ply, &data);
 
     if (!found)
     {
@@ -306,45 +367,68 @@ static inline void uo_search_sort_and_filter_moves(uo_engine_thread *thread, uo_
   position->stack->moves_sorted = true;
 }
 
-static inline void uo_position_extend_pv(uo_position *position, uo_move bestmove, uo_move *line, size_t depth)
+static inline void uo_search_clear_pv(uo_engine_thread *thread, size_t ply)
 {
-  line[0] = bestmove;
-  line[1] = 0;
+  thread->pv_table[ply][0] = 0;
+  thread->pv_length[ply] = 0;
+}
 
-  if (!depth) return;
+static inline void uo_search_extend_pv(uo_engine_thread *thread, uo_move bestmove, size_t depth)
+{
+  uo_position *position = &thread->position;
+  size_t ply = position->ply;
+  uo_move *pv = thread->pv_table[ply];
+  size_t length_max = uo_min(depth + 1, UO_MAX_PLY - ply);
+  size_t length = 0;
+  size_t made_move_count = 0;
+  uo_move move = bestmove;
+
+  // Step 1. Follow exact transposition table entries but do not extend beyond maximum ply
+  while (length < length_max)
+  {
+    pv[length++] = move;
+    if (length == length_max) break;
 
-  uo_position_make_move(position, bestmove, 0, 0);
+    uo_position_make_move(position, move, 0, 0);
+    ++made_move_count;
 
-  int16_t alpha = -uo_score_checkmate;
-  int16_t beta = uo_score_checkmate;
-  uo_abtentry entry = { &alpha, &beta, depth };
+    int16_t alpha = -uo_score_checkmate;
+    int16_t beta = uo_score_checkmate;
+    uo_abtentry entry = { &alpha, &beta, depth + 1 - length };
 
-  if (uo_engine_lookup_entry(position, &entry)
-    && entry.bestmove
-    && entry.data.type == uo_score_type__exact)
+    if (!uo_engine_lookup_entry(thread->ttable, position, &entry)
+      || !entry.bestmove
+      || entry.data.type != uo_score_type__exact)
+    {
+      break;
+    }
+
+    move = entry.bestmove;
+  }
+
+  while (made_move_count--)
   {
-    uo_position_extend_pv(position, entry.bestmove, line + 1, depth - 1);
+    uo_position_unmake_move(position);
   }
 
-  uo_position_unmake_move(position);
+  // Step 2. Null terminate the principal variation line
+  pv[length] = 0;
+  thread->pv_length[ply] = length;
 }
 
-static inline void uo_position_update_pv(uo_position *position, uo_move *pline, uo_move bestmove, uo_move *line)
+static inline void uo_search_update_pv(uo_engine_thread *thread, uo_move bestmove)
 {
-  // Step 1. Set best move as first in parent position principal variation line
-  pline[0] = bestmove;
+  size_t ply = thread->position.ply;
+  uo_move *pv = thread->pv_table[ply];
+  size_t length = thread->pv_length[ply + 1];
 
-  size_t i = 0;
+  // Step 1. Set best move as first in principal variation line
+  pv[0] = bestmove;
 
-  // Step 2. Copy moves from child position principal variation but do not extend beyond end of the array
-  while (line[i] && position->ply + i < UO_MAX_PLY)
-  {
-    pline[i + 1] = line[i];
-    ++i;
-  }
-
-  // Step 3. Null terminate the principal variation array
-  pline[i + 1] = 0;
+  // Step 2. Copy principal variation line of the child node including the null terminator.
+  // Line of ply N is at most UO_MAX_PLY - N moves long, so the copy stays within the row.
+  memcpy(pv + 1, thread->pv_table[ply + 1], (length + 1) * sizeof * pv);
+  thread->pv_length[ply] = length + 1;
 }
 
 static inline void uo_pv_copy(uo_move *line_dst, uo_move *line_src)
@@ -358,10 +442,102 @@ static inline void uo_pv_copy(uo_move *line_dst, uo_move *line_src)
   line_dst[i] = 0;
 }
 
+static inline void uo_search_init_root_moves(uo_engine_thread *thread)
+{
+  uo_position *position = &thread->position;
+  uo_move_history *stack = position->stack;
+  uo_search_info *info = &thread->info;
+  uo_move *searchmoves = engine.search_params.searchmoves;
+
+  // Step 1. Generate and sort legal moves unless already done e.g. by tablebase probe
+  if (!stack->moves_generated)
+  {
+    uo_position_generate_moves(position);
+  }
+
+  uo_position_sort_moves(position, 0, thread->move_cache);
+
+  size_t move_count = stack->move_count - stack->skipped_move_count;
+
+  // Step 2. If search is restricted to specific moves, mark other moves as skipped moves
+  if (searchmoves)
+  {
+    size_t searchmove_count = 0;
+
+    for (size_t i = 0; i < move_count; ++i)
+    {
+      uo_move move = position->movelist.head[i];
+      uo_move *searchmove = searchmoves;
+
+      while (*searchmove && *searchmove != move)
+      {
+        ++searchmove;
+      }
+
+      position->movelist.move_scores[i] = *searchmove ? 0 : uo_move_score_skip;
+      searchmove_count += *searchmove != 0;
+    }
+
+    if (searchmove_count)
+    {
+      size_t skipped_move_count = stack->skipped_move_count;
+      skipped_move_count += uo_position_sort_skipped_moves(position, position->movelist.head, 0, move_count - 1);
+      stack->skipped_move_count = skipped_move_count;
+      move_count = searchmove_count;
+    }
+  }
+
+  // Step 3. Initialize root move list
+  info->root_move_count = move_count;
+
+  for (size_t i = 0; i < move_count; ++i)
+  {
+    info->root_moves[i] = (uo_root_move){
+      .move = position->movelist.head[i],
+      .score = uo_score_unknown,
+      .previous_score = uo_score_unknown
+    };
+  }
+}
+
+static inline void uo_search_update_root_move(uo_engine_thread *thread, uo_move move, int16_t value, int16_t alpha, size_t nodes, uo_move *line)
+{
+  uo_root_move *root_move = uo_search_find_root_move(&thread->info, move);
+  if (!root_move) return;
+
+  root_move->nodes += nodes;
+  root_move->score = value;
+
+  if (value <= alpha) return;
+
+  // Save principal variation for the move but do not extend beyond end of the array
+  size_t i = 0;
+  root_move->pv[0] = move;
+
+  while (line[i] && i + 2 < UO_PV_MAX_LENGTH)
+  {
+    root_move->pv[i + 1] = line[i];
+    ++i;
+  }
+
+  root_move->pv[i + 1] = 0;
+}
+
+static inline void uo_search_start_root_move_iteration(uo_engine_thread *thread)
+{
+  uo_search_info *info = &thread->info;
+
+  for (size_t i = 0; i < info->root_move_count; ++i)
+  {
+    info->root_moves[i].previous_score = info->root_moves[i].score;
+  }
+}
+
 static inline int uo_search_determine_depth_reduction_or_extension(uo_engine_thread *thread, size_t move_num, size_t depth, int16_t alpha, int16_t beta, int improvement_count)
 {
   // Step 1. Initialize variables
   uo_search_info *info = &thread->info;
+  const uo_search_parameters *parameters = thread->search_parameters;
   uo_position *position = &thread->position;
   uo_move_history *stack = position->stack;
   bool is_check = uo_position_is_check(position);
@@ -382,11 +558,11 @@ static inline int uo_search_determine_depth_reduction_or_extension(uo_engine_thr
     && depth < 6
     && square_to >= uo_square__a7)
   {
-    extension += 1000;
+    extension += parameters->extension_passed_pawn;
   }
 
   // Check extension
-  if (is_check) extension += 600;
+  if (is_check) extension += parameters->extension_check;
 
   // If search extension is specified, return depth extension in plies.
   if (extension > 0)
@@ -398,12 +574,12 @@ static inline int uo_search_determine_depth_reduction_or_extension(uo_engine_thr
   // Step 4. No extension. Determine reductions.
 
   // Also limit reductions to avoid missing threats
-  int max_reduction = uo_min((int)depth * 400 + 1000, (int)info->depth * 600 - uo_max(0, -net_extension_plies * 1000));
+  int max_reduction = uo_min((int)depth * parameters->lmr_max_depth_factor + parameters->lmr_max_base, (int)info->depth * 600 - uo_max(0, -net_extension_plies * 1000));
   if (max_reduction <= 0) return 0;
 
   if (
     // no reduction for shallow depth
-    depth <= 3
+    (int)depth < parameters->lmr_depth_min
     // no reduction if aspiration window is really wide
     || alpha <= -uo_score_tb_win_threshold
     // no reduction if looking for mate
@@ -419,22 +595,31 @@ static inline int uo_search_determine_depth_reduction_or_extension(uo_engine_thr
   }
 
   // Default reduction is one fifth of the depth but capped at two plies
-  int reduction = depth * 200;
+  int reduction = (int)depth * parameters->lmr_depth_factor;
 
   // Reduction based on move ordering
-  reduction += move_num * 50;
+  reduction += (int)move_num * parameters->lmr_move_factor;
 
   // Reduction based on how many times alpha has been improved already
-  reduction += improvement_count * 500;
+  reduction += improvement_count * parameters->lmr_improvement_factor;
 
   // Return depth reduction in plies.
   reduction = uo_min(reduction, max_reduction);
   return -lround((double)reduction / 1000.0);
 }
 
+// Tightens static evaluation using the bound of the transposition table entry
+static inline int16_t uo_search_adjust_static_eval(uo_abtentry *entry, int16_t static_eval)
+{
+  return
+    entry->data.type == uo_score_type__lower_bound ? uo_max(entry->data.value, static_eval) :
+    entry->data.type == uo_score_type__upper_bound ? uo_min(entry->data.value, static_eval) : // <- this might be a bit dubious
+    static_eval;
+}
+
 // The quiescence search is a used to evaluate the board position when the game is not in non-quiet state,
 // i.e., there are pieces that can be captured.
-static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_t beta, uint8_t depth, uo_move *pline, bool *incomplete)
+static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_t beta, uint8_t depth, bool pv, bool *incomplete)
 {
   // Step 1. Initialize variables
   uo_search_info *info = &thread->info;
@@ -466,6 +651,13 @@ static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_
   // Step 4. Check for draw by threefold repetition
   if (uo_position_is_repetition_draw(position)) return uo_score_draw;
 
+  // Step 4.1 If side to move can force a repetition, draw score is a lower bound for the position
+  if (alpha < uo_score_draw && uo_position_is_upcoming_repetition(position))
+  {
+    alpha = uo_score_draw;
+    if (alpha >= beta) return alpha;
+  }
+
   // Step 5. Mate distance pruning
   alpha = uo_max(-score_checkmate, alpha);
   beta = uo_min(score_checkmate - 1, beta);
@@ -473,7 +665,7 @@ static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_
 
   // Step 6. Lookup position from transposition table and return if exact score for equal or higher depth is found
   uo_abtentry entry = { &alpha, &beta, 0 };
-  if (uo_engine_lookup_entry(position, &entry))
+  if (uo_engine_lookup_entry(thread->ttable, position, &entry))
   {
     return entry.value;
   }
@@ -486,7 +678,7 @@ static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_
   }
 
   // Step 8. If maximum search depth is reached return static evaluation
-  if (uo_position_is_max_depth_reached(position)) return uo_position_evaluate_and_cache(position, thread->move_cache);
+  if (uo_position_is_max_depth_reached(position)) return uo_position_evaluate_and_cache(position, -uo_score_checkmate, uo_score_checkmate, thread->move_cache, &thread->pawn_hash, &thread->material_hash, &thread->eval_hash);
 
   // Step 9. If position is check, perform quiesence search for all moves
   if (uo_position_is_check(position))
@@ -499,9 +691,8 @@ static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_
     // Step 9.2. If there are no legal moves, return checkmate
     if (move_count == 0) return -score_checkmate;
 
-    // Step 9.3 Allocate principal variation line on the stack
-    uo_move line[UO_MAX_PLY];
-    line[0] = 0;
+    // Step 9.3 Clear principal variation line of child nodes
+    uo_search_clear_pv(thread, position->ply + 1);
 
     // Step 9.4. Initialize score to be checkmate
     entry.value = -score_checkmate;
@@ -515,10 +706,10 @@ static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_
       uo_move move = position->movelist.head[i];
       uo_position_flags flags;
       uint64_t key = uo_position_move_key(position, move, &flags);
-      uo_engine_prefetch_entry(key);
+      uo_engine_prefetch_entry(thread->ttable, key);
       uo_position_make_move(position, move, key, flags);
       assert(!key || key == position->key);
-      int16_t node_value = -uo_search_quiesce(thread, -beta, -alpha, depth + 1, line, incomplete);
+      int16_t node_value = -uo_search_quiesce(thread, -beta, -alpha, depth + 1, pv, incomplete);
       uo_position_unmake_move(position);
 
       if (*incomplete) return uo_score_unknown;
@@ -531,17 +722,17 @@ static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_
         if (entry.value > alpha)
         {
           // Update principal variation
-          if (pline) uo_position_update_pv(position, pline, entry.bestmove, line);
+          if (pv) uo_search_update_pv(thread, entry.bestmove);
 
           // Beta cutoff
-          if (entry.value >= beta) return uo_engine_store_entry(position, &entry);
+          if (entry.value >= beta) return uo_engine_store_entry(thread->ttable, position, &entry);
 
           alpha = entry.value;
         }
       }
 
       // Step 5.6. Reset pv line
-      line[0] = 0;
+      uo_search_clear_pv(thread, position->ply + 1);
     }
 
     return entry.value;
@@ -549,48 +740,57 @@ static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_
 
   // Position is not check. Examine only tactical moves and the possible transposition table move.
 
-  // Step 10. Initialize score to static evaluation. "Stand pat"
-  int16_t static_eval = uo_position_evaluate_and_cache(position, thread->move_cache);
-  assert(stack->static_eval != uo_score_unknown);
-
-  // Step 11. Adjust value if position was found from transposition table
-  entry.value =
-    entry.data.type == uo_score_type__lower_bound ? uo_max(entry.data.value, static_eval) :
-    entry.data.type == uo_score_type__upper_bound ? uo_min(entry.data.value, static_eval) : // <- this might be a bit dubious
-    static_eval;
-
-  // Step 12. Cutoff if static evaluation is higher or equal to beta.
-  if (entry.value >= beta) return beta;
-
-  // Step 13. Delta pruning
+  // Step 10. Determine delta for delta pruning
+  const uo_search_parameters *parameters = thread->search_parameters;
   bool is_promotion_possible = (position->P & position->own) >= uo_square_bitboard(uo_square__a7);
   int16_t delta
     // Large material gain from capture
     = ((position->Q & position->enemy) ? uo_score_Q : uo_score_R)
     // Promotion
     + is_promotion_possible * uo_score_Q
+    + parameters->qsearch_delta_margin
     // Reduction from quiscence search depth
-    - uo_score_mul_ln(uo_score_P, depth * depth);
+    - uo_score_mul_ln(parameters->qsearch_delta_depth_factor, depth * depth);
+
+  // Step 11. Initialize score to static evaluation. "Stand pat"
+  //          Evaluation is lazy if it is clear that it leads to cutoff or delta pruning.
+  int16_t static_eval = uo_position_evaluate_and_cache(position, alpha - delta, beta, thread->move_cache, &thread->pawn_hash, &thread->material_hash, &thread->eval_hash);
+  assert(static_eval != uo_score_unknown);
+
+  // Step 12. Adjust value if position was found from transposition table
+  entry.value = uo_search_adjust_static_eval(&entry, static_eval);
 
+  // Step 13. Lazy evaluation is not enough if the transposition table bound prevents the cutoff
+  if (stack->static_eval == uo_score_unknown
+    && entry.value < beta
+    && entry.value + delta >= alpha)
+  {
+    static_eval = uo_position_evaluate_and_cache(position, -uo_score_checkmate, uo_score_checkmate, thread->move_cache, &thread->pawn_hash, &thread->material_hash, &thread->eval_hash);
+    entry.value = uo_search_adjust_static_eval(&entry, static_eval);
+  }
+
+  // Step 14. Cutoff if static evaluation is higher or equal to beta.
+  if (entry.value >= beta) return beta;
+
+  // Step 15. Delta pruning
   if (entry.value + delta < alpha) return alpha;
 
-  // Step 14. Update alpha
+  // Step 16. Update alpha
   alpha = uo_max(alpha, entry.value);
 
-  // Step 15. Allocate principal variation line on the stack
-  uo_move line[UO_MAX_PLY];
-  line[0] = 0;
+  // Step 17. Clear principal variation line of child nodes
+  uo_search_clear_pv(thread, position->ply + 1);
 
-  // Step 16. Search transposition table move if it is not a tactical move
+  // Step 18. Search transposition table move if it is not a tactical move
   if (entry.bestmove
     && !uo_move_is_tactical(entry.bestmove))
   {
     uo_position_flags flags;
     uint64_t key = uo_position_move_key(position, entry.bestmove, &flags);
-    uo_engine_prefetch_entry(key);
+    uo_engine_prefetch_entry(thread->ttable, key);
     uo_position_make_move(position, entry.bestmove, key, flags);
     assert(!key || key == position->key);
-    int16_t node_value = -uo_search_quiesce(thread, -beta, -alpha, depth + 1, line, incomplete);
+    int16_t node_value = -uo_search_quiesce(thread, -beta, -alpha, depth + 1, pv, incomplete);
     uo_position_unmake_move(position);
 
     if (*incomplete) return uo_score_unknown;
@@ -602,7 +802,7 @@ static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_
       if (entry.value > alpha)
       {
         // Update principal variation
-        if (pline) uo_position_update_pv(position, pline, entry.bestmove, line);
+        if (pv) uo_search_update_pv(thread, entry.bestmove);
 
         // Beta cutoff
         if (node_value >= beta) return node_value;
@@ -611,26 +811,26 @@ static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_
       }
     }
 
-    // Step 16.1. Reset pv line
-    line[0] = 0;
+    // Step 18.1. Reset pv line
+    uo_search_clear_pv(thread, position->ply + 1);
   }
 
-  // Step 17. Determine futility threshold for pruning unpotential moves
+  // Step 19. Determine futility threshold for pruning unpotential moves
   const int16_t futility_base = static_eval + uo_score_P * 3 / 2;
   int16_t futility_threshold = alpha < futility_base ? 0 : alpha - futility_base;
 
-  // Step 18. Generate tactical moves with potential to raise alpha
+  // Step 20. Generate tactical moves with potential to raise alpha
   size_t tactical_move_count = uo_position_generate_tactical_moves(position, futility_threshold);
 
-  //// Step 19. Sort tactical moves
+  //// Step 21. Sort tactical moves
   //uo_position_sort_tactical_moves(position, thread->move_cache);
 
-  // Step 19. Search tactical moves
+  // Step 21. Search tactical moves
   for (size_t i = 0; i < tactical_move_count; ++i)
   {
     uo_move move = position->movelist.head[i];
 
-    // Step 19.1. Futility pruning for captures
+    // Step 21.1. Futility pruning for captures
     if (uo_move_is_capture(move)
       && !uo_move_is_promotion(move)
       && !uo_move_is_enpassant(move)
@@ -639,14 +839,14 @@ static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_
       continue;
     }
 
-    // Step 19.2. Quiescence search
+    // Step 21.2. Quiescence search
 
     uo_position_flags flags;
     uint64_t key = uo_position_move_key(position, move, &flags);
-    uo_engine_prefetch_entry(key);
+    uo_engine_prefetch_entry(thread->ttable, key);
     uo_position_make_move(position, move, key, flags);
     assert(!key || key == position->key);
-    int16_t node_value = -uo_search_quiesce(thread, -beta, -alpha, depth + 1, line, incomplete);
+    int16_t node_value = -uo_search_quiesce(thread, -beta, -alpha, depth + 1, pv, incomplete);
     uo_position_unmake_move(position);
 
     if (*incomplete) return uo_score_unknown;
@@ -659,7 +859,7 @@ static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_
       if (entry.value > alpha)
       {
         // Update principal variation
-        if (pline) uo_position_update_pv(position, pline, entry.bestmove, line);
+        if (pv) uo_search_update_pv(thread, entry.bestmove);
 
         // Beta cutoff
         if (node_value >= beta) return node_value;
@@ -669,8 +869,8 @@ static int16_t uo_search_quiesce(uo_engine_thread *thread, int16_t alpha, int16_
       }
     }
 
-    // Step 19.3. Reset pv line
-    line[0] = 0;
+    // Step 21.3. Reset pv line
+    uo_search_clear_pv(thread, position->ply + 1);
   }
 
   return entry.value;
@@ -684,10 +884,10 @@ static inline void uo_search_cutoff_parallel_search(uo_engine_thread **threads,
   }
 }
 
-static int16_t uo_search_principal_variation(uo_engine_thread *thread, size_t depth, int16_t alpha, int16_t beta, uo_move *pline, bool cut, bool *incomplete)
+static int16_t uo_search_principal_variation(uo_engine_thread *thread, size_t depth, int16_t alpha, int16_t beta, bool pv, bool cut, bool *incomplete)
 {
   // Step 1. If specified search depth is reached, perform quiescence search and return evaluation if search was completed
-  if (depth == 0) return uo_search_quiesce(thread, alpha, beta, 0, pline, incomplete);
+  if (depth == 0) return uo_search_quiesce(thread, alpha, beta, 0, pv, incomplete);
 
   // Step 2. Initialize variables
   uo_search_info *info = &thread->info;
@@ -728,6 +928,15 @@ static int16_t uo_search_principal_variation(uo_engine_thread *thread, size_t de
     return uo_score_draw;
   }
 
+  // Step 4.1 If side to move can force a repetition, draw score is a lower bound for the position
+  if (!is_root_node
+    && alpha < uo_score_draw
+    && uo_position_is_upcoming_repetition(position))
+  {
+    alpha = uo_score_draw;
+    if (alpha >= beta) return alpha;
+  }
+
   // Step 5. Mate distance pruning
   if (!is_root_node)
   {
@@ -738,31 +947,33 @@ static int16_t uo_search_principal_variation(uo_engine_thread *thread, size_t de
 
   // Step 6. Lookup position from transposition table and return if exact score for equal or higher depth is found
   uo_abtentry entry = { &alpha, &beta, depth };
-  if (uo_engine_lookup_entry(position, &entry))
+  bool found = uo_engine_lookup_entry(thread->ttable, position, &entry);
+
+  // For root node, some of the moves may be excluded from search by searchmoves or tablebase probe.
+  // Let's verify that the tt move is not one of them.
+  if (is_root_node
+    && entry.bestmove
+    && stack->skipped_move_count
+    && uo_position_is_skipped_move(position, entry.bestmove))
   {
-    // For root node, in case the position is in tablebase, let's verify that the tt move is preserving win or draw.
-    if (is_root_node
-      && info->is_tb_position
-      && entry.bestmove != pline[0]
-      && uo_position_is_skipped_move(position, entry.bestmove))
-    {
-      goto continue_search;
-    }
+    entry.bestmove = 0;
+    found = false;
+  }
 
+  if (found)
+  {
     // Let's update principal variation line if transposition table score is better than current best score
-    if (pline
+    if (pv
       && entry.bestmove
       && entry.value > alpha)
     {
-      uo_position_extend_pv(position, entry.bestmove, pline, depth);
+      uo_search_extend_pv(thread, entry.bestmove, depth);
     }
 
     // On root node, best move is required
     if (!is_root_node || entry.bestmove) return entry.value;
   }
 
-continue_search:
-
   // Step 7. If search is stopped, return unknown value
   if (!is_root_node && uo_engine_thread_is_stopped(thread))
   {
@@ -774,7 +985,7 @@ continue_search:
   ++thread->info.nodes;
 
   // Step 9. If maximum search depth is reached return static evaluation
-  if (uo_position_is_max_depth_reached(position)) return uo_position_evaluate_and_cache(position, thread->move_cache);
+  if (uo_position_is_max_depth_reached(position)) return uo_position_evaluate_and_cache(position, -uo_score_checkmate, uo_score_checkmate, thread->move_cache, &thread->pawn_hash, &thread->material_hash, &thread->eval_hash);
 
   // Step 10. Tablebase probe
   // Do not probe on root node or if search depth is too shallow
@@ -806,12 +1017,13 @@ continue_search:
     }
   }
 
-  // Step 11. Allocate principal variation line on the stack
-  uo_move line[UO_MAX_PLY];
-  line[0] = 0;
+  // Step 11. Clear principal variation line of child nodes
+  uo_move *line = thread->pv_table[position->ply + 1];
+  uo_search_clear_pv(thread, position->ply + 1);
 
   // Step 12. Search bestmove even before move generation
-  entry.bestmove = pline && pline[0] ? pline[0] : entry.bestmove;
+  uo_move pv_move = thread->pv_table[position->ply][0];
+  entry.bestmove = pv && pv_move ? pv_move : entry.bestmove;
 
   if (entry.bestmove)
   {
@@ -824,25 +1036,31 @@ continue_search:
       uo_search_print_currmove(thread, entry.bestmove, 1);
     }
 
+    size_t nodes = info->nodes;
     uo_position_flags flags;
     uint64_t key = uo_position_move_key(position, entry.bestmove, &flags);
-    uo_engine_prefetch_entry(key);
+    uo_engine_prefetch_entry(thread->ttable, key);
     uo_position_make_move(position, entry.bestmove, key, flags);
     assert(key == position->key);
     int depth_extension = uo_max(0, uo_search_determine_depth_reduction_or_extension(thread, 0, depth, alpha, beta, improvement_count));
-    entry.value = -uo_search_principal_variation(thread, depth + depth_extension - 1, -beta, -alpha, line, false, incomplete);
+    entry.value = -uo_search_principal_variation(thread, depth + depth_extension - 1, -beta, -alpha, pv, false, incomplete);
     uo_position_unmake_move(position);
 
     if (*incomplete) return uo_score_unknown;
 
+    if (is_root_node && is_main_thread)
+    {
+      uo_search_update_root_move(thread, entry.bestmove, entry.value, alpha, info->nodes - nodes, line);
+    }
+
     if (entry.value > alpha)
     {
-      if (pline) uo_position_update_pv(position, pline, entry.bestmove, line);
+      if (pv) uo_search_update_pv(thread, entry.bestmove);
 
       if (entry.value >= beta)
       {
         uo_position_update_killer_move(position, entry.bestmove, depth);
-        return uo_engine_store_entry(position, &entry);
+        return uo_engine_store_entry(thread->ttable, position, &entry);
       }
 
       ++improvement_count;
@@ -859,7 +1077,7 @@ continue_search:
   if (move_count == 0) return is_check ? -score_checkmate : 0;
 
   // Step 15. Static evaluation and calculation of improvement margin
-  int16_t static_eval = uo_position_evaluate_and_cache(position, thread->move_cache);
+  int16_t static_eval = uo_position_evaluate_and_cache(position, -uo_score_checkmate, uo_score_checkmate, thread->move_cache, &thread->pawn_hash, &thread->material_hash, &thread->eval_hash);
   assert(is_check || static_eval != uo_score_unknown);
 
   bool is_improving
@@ -872,15 +1090,16 @@ continue_search:
     && !is_root_node
     && static_eval >= beta
     && !entry.bestmove
-    && depth > 3
+    && (int)depth >= thread->search_parameters->nmp_depth_min
     && position->ply >= thread->nmp_min_ply
     && uo_position_is_null_move_allowed(position))
   {
-    // depth * 3/4 - 1
-    size_t depth_nmp = depth * 3 / 4 - 1;
+    // depth * 3/4 - 1 by default
+    const uo_search_parameters *parameters = thread->search_parameters;
+    size_t depth_nmp = uo_max(0, (int)depth * parameters->nmp_depth_factor / 1000 - parameters->nmp_reduction);
 
     uo_position_make_null_move(position);
-    int16_t null_value = -uo_search_principal_variation(thread, depth_nmp, -beta, -beta + 1, NULL, false, incomplete);
+    int16_t null_value = -uo_search_principal_variation(thread, depth_nmp, -beta, -beta + 1, false, false, incomplete);
     uo_position_unmake_null_move(position);
 
     if (*incomplete) return uo_score_unknown;
@@ -889,10 +1108,13 @@ continue_search:
     if (null_value >= beta)
     {
       // 15.1. Verification
-      thread->nmp_min_ply = position->ply + depth_nmp * 3 / 4;
-      int16_t value = uo_search_principal_variation(thread, depth_nmp, beta - 1, beta, pline, false, incomplete);
+      thread->nmp_min_ply = position->ply + (int)depth_nmp * parameters->nmp_verification_factor / 1000;
+      int16_t value = uo_search_principal_variation(thread, depth_nmp, beta - 1, beta, pv, false, incomplete);
       thread->nmp_min_ply = 0;
 
+      // Verification search shares the principal variation table rows with this node
+      uo_search_clear_pv(thread, position->ply + 1);
+
       if (value >= beta) return null_value;
     }
   }
@@ -923,7 +1145,7 @@ continue_search:
     {
     increase_depth_iid:
       iid = false;
-      line[0] = 0;
+      uo_search_clear_pv(thread, position->ply + 1);
       improvement_count = 0;
       entry.depth = depth = depth_initial;
       alpha = entry.alpha_initial;
@@ -933,26 +1155,32 @@ continue_search:
     // Step 18. Perform full alpha-beta search for the first move
 
     // Search extensions
+    size_t nodes = info->nodes;
     uo_position_flags flags;
     uint64_t key = uo_position_move_key(position, move, &flags);
-    uo_engine_prefetch_entry(key);
+    uo_engine_prefetch_entry(thread->ttable, key);
     uo_position_make_move(position, move, key, flags);
     assert(key == position->key);
     int depth_extension = uo_max(0, uo_search_determine_depth_reduction_or_extension(thread, 0, depth, alpha, beta, improvement_count));
-    entry.value = -uo_search_principal_variation(thread, depth + depth_extension - 1, -beta, -alpha, line, false, incomplete);
+    entry.value = -uo_search_principal_variation(thread, depth + depth_extension - 1, -beta, -alpha, pv, false, incomplete);
     uo_position_unmake_move(position);
 
     if (*incomplete) return uo_score_unknown;
 
+    if (is_root_node && is_main_thread)
+    {
+      uo_search_update_root_move(thread, move, entry.value, alpha, info->nodes - nodes, line);
+    }
+
     if (entry.value > alpha)
     {
-      if (pline && !iid) uo_position_update_pv(position, pline, entry.bestmove, line);
+      if (pv && !iid) uo_search_update_pv(thread, entry.bestmove);
 
       if (entry.value >= beta)
       {
         if (iid) goto increase_depth_iid;
         uo_position_update_cutoff_history(position, 0, depth);
-        return uo_engine_store_entry(position, &entry);
+        return uo_engine_store_entry(thread->ttable, position, &entry);
       }
 
       ++improvement_count;
@@ -987,12 +1215,13 @@ continue_search:
     }
 
     // Step 19.1 Reset pv line
-    line[0] = 0;
+    uo_search_clear_pv(thread, position->ply + 1);
 
     // Step 19.2 Determine search depth extension or reduction
+    size_t nodes = info->nodes;
     uo_position_flags flags;
     uint64_t key = uo_position_move_key(position, move, &flags);
-    uo_engine_prefetch_entry(key);
+    uo_engine_prefetch_entry(thread->ttable, key);
     uo_position_make_move(position, move, key, flags);
     assert(!key || key == position->key);
     int depth_extension_or_reduction = is_check ? 0 : uo_search_determine_depth_reduction_or_extension(thread, i, depth, alpha, beta, improvement_count);
@@ -1002,7 +1231,7 @@ continue_search:
     // Step 19.3 Perform zero window search for reduced depth
     if (is_zw_search || depth_extension_or_reduction < 0)
     {
-      node_value = -uo_search_principal_variation(thread, depth_lmr - 1, -alpha - 1, -alpha, is_zw_search ? NULL : line, !cut, incomplete);
+      node_value = -uo_search_principal_variation(thread, depth_lmr - 1, -alpha - 1, -alpha, !is_zw_search, !cut, incomplete);
 
       if (*incomplete)
       {
@@ -1018,7 +1247,7 @@ continue_search:
     {
       int depth_extension = uo_max(0, depth_extension_or_reduction);
       depth_lmr = depth + depth_extension;
-      node_value = -uo_search_principal_variation(thread, depth_lmr - 1, -beta, -alpha, line, false, incomplete);
+      node_value = -uo_search_principal_variation(thread, depth_lmr - 1, -beta, -alpha, pv, false, incomplete);
 
       if (*incomplete)
       {
@@ -1029,6 +1258,11 @@ continue_search:
 
     uo_position_unmake_move(position);
 
+    if (is_root_node && is_main_thread)
+    {
+      uo_search_update_root_move(thread, move, node_value, alpha, info->nodes - nodes, line);
+    }
+
     if (node_value > entry.value)
     {
       entry.value = node_value;
@@ -1038,14 +1272,14 @@ continue_search:
       if (entry.value > alpha)
       {
         // Update principal variation
-        if (pline && !iid) uo_position_update_pv(position, pline, entry.bestmove, line);
+        if (pv && !iid) uo_search_update_pv(thread, entry.bestmove);
 
         // Beta cutoff
         if (entry.value >= beta)
         {
           if (iid) goto increase_depth_iid;
           uo_position_update_cutoff_history(position, i, depth);
-          return uo_engine_store_entry(position, &entry);
+          return uo_engine_store_entry(thread->ttable, position, &entry);
         }
 
         // Update alpha
@@ -1062,7 +1296,7 @@ continue_search:
   }
 
   if (iid) goto increase_depth_iid;
-  return uo_engine_store_entry(position, &entry);
+  return uo_engine_store_entry(thread->ttable, position, &entry);
 }
 
 static inline void uo_engine_thread_load_position(uo_engine_thread *thread)
@@ -1093,18 +1327,19 @@ void *uo_engine_thread_start_timer(void *arg)
 //  1 on fail high
 //  0 when value is within window
 // -1 on fail low
-static inline int uo_search_adjust_alpha_beta(int16_t value, int16_t *alpha, int16_t *beta)
+static inline int uo_search_adjust_alpha_beta(const uo_search_parameters *parameters, int16_t value, int16_t *alpha, int16_t *beta)
 {
   const int fail_high = 1;
   const int exact = 0;
   const int fail_low = -1;
 
-  const int16_t aspiration_window_minimum = uo_score_P / 3;
-  const float aspiration_window_factor = 1.5;
-  const int16_t aspiration_window_mate = (uo_score_checkmate - 1) / aspiration_window_factor;
+  // Window is a per mille factor of the absolute value
+  const int16_t aspiration_window_minimum = parameters->aspiration_window_minimum;
+  const int aspiration_window_factor = parameters->aspiration_window_factor;
+  const int16_t aspiration_window_mate = (uo_score_checkmate - 1) * 1000 / aspiration_window_factor;
 
   int16_t value_abs = value > 0 ? value : -value;
-  int16_t aspiration_window = (float)value_abs * aspiration_window_factor;
+  int16_t aspiration_window = uo_min(value_abs * aspiration_window_factor / 1000, uo_score_checkmate);
 
   if (aspiration_window < aspiration_window_minimum)
   {
@@ -1157,7 +1392,8 @@ void *uo_engine_thread_run_parallel_principal_variation_search(void *arg)
   int16_t alpha = params->alpha;
   int16_t beta = params->beta;
   uo_move move = params->move;
-  uo_move *line = params->line;
+  uo_move *line = thread->pv_table[0];
+  uo_search_clear_pv(thread, 0);
 
   uo_atomic_lock(&thread->busy);
   uo_atomic_unlock(&thread->busy);
@@ -1166,14 +1402,15 @@ void *uo_engine_thread_run_parallel_principal_variation_search(void *arg)
     .depth = depth,
     .multipv = engine_options.multipv,
     .nodes = 0,
-    .pv = thread->pv,
+    .pv = thread->pv_table[0],
     .secondary_pvs = thread->secondary_pvs,
+    .root_moves = thread->root_moves,
     .movetime_remaining_msec = INFINITY
   };
 
   bool incomplete = false;
 
-  int16_t value = uo_search_principal_variation(thread, depth, alpha, beta, line, false, &incomplete);
+  int16_t value = uo_search_principal_variation(thread, depth, alpha, beta, true, false, &incomplete);
 
   *result = (uo_search_queue_item){
     .thread = thread,
@@ -1208,15 +1445,16 @@ void *uo_engine_thread_run_principal_variation_search(void *arg)
     .depth = 1,
     .multipv = engine_options.multipv,
     .nodes = 0,
-    .pv = thread->pv,
+    .pv = thread->pv_table[0],
     .secondary_pvs = thread->secondary_pvs,
-    .movetime_remaining_msec = params->time_own ? params->time_own : INFINITY
+    .root_moves = thread->root_moves,
+    .movetime_remaining_msec = params->time_own && !uo_atomic_load(&params->ponder) ? params->time_own : INFINITY
   };
 
   uo_search_info *info = &thread->info;
 
-  uo_move *line = thread->pv;
-  line[0] = 0;
+  uo_move *line = thread->pv_table[0];
+  uo_search_clear_pv(thread, 0);
 
   // Start timer
   uo_time_now(&info->time_start);
@@ -1228,6 +1466,17 @@ void *uo_engine_thread_run_principal_variation_search(void *arg)
   // Load position
   uo_engine_thread_load_position(thread);
 
+  // Reset evaluation, pawn and material hash table statistics
+  for (size_t i = 0; i < engine.thread_count; ++i)
+  {
+    engine.threads[i].eval_hash.probes = 0;
+    engine.threads[i].eval_hash.hits = 0;
+    engine.threads[i].pawn_hash.probes = 0;
+    engine.threads[i].pawn_hash.hits = 0;
+    engine.threads[i].material_hash.probes = 0;
+    engine.threads[i].material_hash.hits = 0;
+  }
+
   // Initialize aspiration window
   int16_t alpha = params->alpha;
   int16_t beta = params->beta;
@@ -1281,7 +1530,7 @@ void *uo_engine_thread_run_principal_variation_search(void *arg)
 
     // Probe transposition table
     uo_tdata tentry;
-    bool found = uo_ttable_get(&engine.ttable, position->key, position->root_ply, &tentry);
+    bool found = uo_ttable_get(thread->ttable, position->key, position->root_ply, &tentry);
 
     if (found)
     {
@@ -1351,20 +1600,34 @@ void *uo_engine_thread_run_principal_variation_search(void *arg)
     }
   }
 
+  // Initialize root moves and restrict search to specified moves
+  uo_search_init_root_moves(thread);
+
+  // Make sure that the tablebase move and the initial principal variation are not excluded moves
+  if (tb_move && !uo_search_find_root_move(info, tb_move))
+  {
+    tb_move = position->movelist.head[0];
+  }
+
+  if (line[0] && !uo_search_find_root_move(info, line[0]))
+  {
+    line[0] = 0;
+  }
+
   // Perform search for first depth
-  value = uo_search_principal_variation(thread, info->depth, alpha, beta, line, false, &incomplete);
+  value = uo_search_principal_variation(thread, info->depth, alpha, beta, true, false, &incomplete);
 
   // If search failed low perform re-search
-  if (uo_search_adjust_alpha_beta(value, &alpha, &beta) < 0)
+  if (uo_search_adjust_alpha_beta(thread->search_parameters, value, &alpha, &beta) < 0)
   {
-    value = uo_search_principal_variation(thread, info->depth, alpha, beta, line, false, &incomplete);
+    value = uo_search_principal_variation(thread, info->depth, alpha, beta, true, false, &incomplete);
 
     // If search failed low again, let's clear transposition table and start over
-    if (uo_search_adjust_alpha_beta(value, &alpha, &beta) < 0)
+    if (uo_search_adjust_alpha_beta(thread->search_parameters, value, &alpha, &beta) < 0)
     {
       info->depth = 1;
       uo_engine_clear_hash();
-      value = uo_search_principal_variation(thread, info->depth, alpha, beta, line, false, &incomplete);
+      value = uo_search_principal_variation(thread, info->depth, alpha, beta, true, false, &incomplete);
     }
   }
 
@@ -1394,7 +1657,7 @@ void *uo_engine_thread_run_principal_variation_search(void *arg)
 
   // Stop search if not enough time left
   if (!incomplete
-    && uo_time_elapsed_msec(&info->time_start) > info->movetime_remaining_msec / 2)
+    && uo_time_elapsed_msec(&params->time_start) > info->movetime_remaining_msec / 2)
   {
     goto search_completed;
   }
@@ -1403,23 +1666,16 @@ void *uo_engine_thread_run_principal_variation_search(void *arg)
 
   uo_engine_thread *lazy_smp_threads[UO_PARALLEL_MAX_COUNT];
   uo_search_queue_item lazy_smp_results[UO_PARALLEL_MAX_COUNT];
-  uo_move lazy_smp_lines[UO_PARALLEL_MAX_COUNT][UO_MAX_PLY];
 
   size_t lazy_smp_count = 0;
   size_t lazy_smp_max_count = uo_max(0, uo_min(UO_PARALLEL_MAX_COUNT, (int)engine.thread_count - 1 - UO_LAZY_SMP_FREE_THREAD_COUNT));
 
-  for (size_t i = 0; i < lazy_smp_max_count; ++i)
-  {
-    lazy_smp_lines[i][0] = 0;
-  }
-
   uo_parallel_search_params lazy_smp_params = {
     .thread = thread,
     .result = &lazy_smp_results[0],
     .queue = &engine.search_queue,
     .alpha = alpha,
-    .beta = beta,
-    .line = lazy_smp_lines[0]
+    .beta = beta
   };
 
   size_t fail_count;
@@ -1443,6 +1699,9 @@ void *uo_engine_thread_run_principal_variation_search(void *arg)
     // Update search depth info
     thread->info.depth = lazy_smp_params.depth = depth;
 
+    // Save root move scores from previous iteration
+    uo_search_start_root_move_iteration(thread);
+
     // Report search info
     if (thread->info.nodes)
     {
@@ -1479,13 +1738,11 @@ void *uo_engine_thread_run_principal_variation_search(void *arg)
 
         if (!can_delegate) break;
 
-        lazy_smp_params.line = lazy_smp_lines[lazy_smp_count];
         lazy_smp_params.result = &lazy_smp_results[lazy_smp_count];
-        lazy_smp_params.line[0] = 0;
       }
 
       // Start search on main search thread
-      value = uo_search_principal_variation(thread, depth, alpha, beta, line, false, &incomplete);
+      value = uo_search_principal_variation(thread, depth, alpha, beta, true, false, &incomplete);
 
       // Wait for parallel searches to finish
       if (lazy_smp_count > 0)
@@ -1540,7 +1797,7 @@ void *uo_engine_thread_run_principal_variation_search(void *arg)
       }
 
       // Check if search returned a value that is within aspiration window
-      switch (uo_search_adjust_alpha_beta(value, &alpha, &beta))
+      switch (uo_search_adjust_alpha_beta(thread->search_parameters, value, &alpha, &beta))
       {
         // Fail-low
         case -1:
@@ -1612,8 +1869,42 @@ search_completed:
     }
   }
 
+  // While pondering, best move is not reported before ponderhit or stop command
+  while (uo_atomic_load(&params->ponder) && !uo_engine_is_stopped())
+  {
+    uo_sleep_msec(1);
+  }
+
   engine.ponder.value = thread->info.value;
   thread->info.completed = true;
+
+  if (engine_options.debug)
+  {
+    uint64_t eval_hash_probes = 0;
+    uint64_t eval_hash_hits = 0;
+    uint64_t pawn_hash_probes = 0;
+    uint64_t pawn_hash_hits = 0;
+    uint64_t material_hash_probes = 0;
+    uint64_t material_hash_hits = 0;
+
+    for (size_t i = 0; i < engine.thread_count; ++i)
+    {
+      eval_hash_probes += engine.threads[i].eval_hash.probes;
+      eval_hash_hits += engine.threads[i].eval_hash.hits;
+      pawn_hash_probes += engine.threads[i].pawn_hash.probes;
+      pawn_hash_hits += engine.threads[i].pawn_hash.hits;
+      material_hash_probes += engine.threads[i].material_hash.probes;
+      material_hash_hits += engine.threads[i].material_hash.hits;
+    }
+
+    uo_search_print_info_string(thread, "evalhash probes %" PRIu64 " hits %" PRIu64 " hitrate %.1f %%",
+      eval_hash_probes, eval_hash_hits, eval_hash_probes ? 100.0 * eval_hash_hits / eval_hash_probes : 0.0);
+    uo_search_print_info_string(thread, "pawnhash probes %" PRIu64 " hits %" PRIu64 " hitrate %.1f %%",
+      pawn_hash_probes, pawn_hash_hits, pawn_hash_probes ? 100.0 * pawn_hash_hits / pawn_hash_probes : 0.0);
+    uo_search_print_info_string(thread, "materialhash probes %" PRIu64 " hits %" PRIu64 " hitrate %.1f %%",
+      material_hash_probes, material_hash_hits, material_hash_probes ? 100.0 * material_hash_hits / material_hash_probes : 0.0);
+  }
+
   uo_search_print_info(thread);
 
   uo_engine_lock_position();
@@ -1640,8 +1931,9 @@ void *uo_engine_thread_run_quiescence_search(void *arg)
     .depth = 0,
     .multipv = engine_options.multipv,
     .nodes = 0,
-    .pv = thread->pv,
-    .secondary_pvs = thread->secondary_pvs
+    .pv = thread->pv_table[0],
+    .secondary_pvs = thread->secondary_pvs,
+    .root_moves = thread->root_moves
   };
 
   uo_time_now(&thread->info.time_start);
@@ -1650,16 +1942,16 @@ void *uo_engine_thread_run_quiescence_search(void *arg)
 
   bool incomplete = false;
 
-  uo_move pv[UO_MAX_PLY];
   int16_t alpha = params->alpha;
   int16_t beta = params->beta;
-  int16_t value = uo_search_quiesce(thread, alpha, beta, 0, pv, &incomplete);
+  uo_search_clear_pv(thread, 0);
+  int16_t value = uo_search_quiesce(thread, alpha, beta, 0, true, &incomplete);
 
   double time_msec = uo_time_elapsed_msec(&thread->info.time_start);
   uint64_t nps = (double)thread->info.nodes / time_msec * 1000.0;
 
-  size_t tentry_count = uo_atomic_load(&engine.ttable.count);
-  uint64_t hashfull = (tentry_count * 1000) / (engine.ttable.hash_mask + 1);
+  size_t tentry_count = uo_atomic_load(&thread->ttable->count);
+  uint64_t hashfull = (tentry_count * 1000) / (thread->ttable->hash_mask + 1);
 
   uo_engine_lock_stdout();
 
@@ -1699,3 +1991,79 @@ void *uo_engine_thread_run_quiescence_search(void *arg)
 
   return NULL;
 }
+
+int16_t uo_engine_thread_search(uo_engine_thread *thread, size_t depth, size_t nodes, uo_move *bestmove)
+{
+  uo_search_info *info = &thread->info;
+
+  // Step 1. Search is run as a helper thread which is its own owner, so that root moves are not tracked and no output is printed
+  thread->owner = thread;
+  uo_atomic_store(&thread->cutoff, 0);
+
+  thread->info = (uo_search_info){
+    .depth = 1,
+    .multipv = 1,
+    .nodes = 0,
+    .pv = thread->pv_table[0],
+    .secondary_pvs = thread->secondary_pvs,
+    .root_moves = thread->root_moves,
+    .movetime_remaining_msec = INFINITY
+  };
+
+  uo_time_now(&info->time_start);
+  uo_search_clear_pv(thread, 0);
+
+  int16_t value = uo_score_unknown;
+  *bestmove = 0;
+
+  // Step 2. Iterative deepening using full window until depth is reached or node count reaches the limit.
+  // Node limit is applied after the first iteration, so that there is always a best move.
+  size_t depth_max = depth ? uo_min(depth, UO_MAX_PLY - 1) : UO_MAX_PLY - 1;
+
+  for (size_t depth_iter = 1; depth_iter <= depth_max; ++depth_iter)
+  {
+    info->depth = depth_iter;
+
+    bool incomplete = false;
+    int16_t value_iter = uo_search_principal_variation(thread, depth_iter, -uo_score_checkmate, uo_score_checkmate, true, false, &incomplete);
+    if (incomplete) break;
+
+    value = value_iter;
+    *bestmove = thread->pv_table[0][0];
+
+    if (nodes && info->nodes >= nodes) break;
+    info->nodes_limit = nodes;
+  }
+
+  thread->owner = NULL;
+
+  return value;
+}
+
+int16_t uo_engine_thread_quiesce(uo_engine_thread *thread)
+{
+  // Step 1. Search is run as a helper thread which is its own owner, so that no output is printed
+  thread->owner = thread;
+  uo_atomic_store(&thread->cutoff, 0);
+
+  thread->info = (uo_search_info){
+    .depth = 0,
+    .multipv = 1,
+    .nodes = 0,
+    .pv = thread->pv_table[0],
+    .secondary_pvs = thread->secondary_pvs,
+    .root_moves = thread->root_moves,
+    .movetime_remaining_msec = INFINITY
+  };
+
+  uo_time_now(&thread->info.time_start);
+  uo_search_clear_pv(thread, 0);
+
+  // Step 2. Quiescence search using full window
+  bool incomplete = false;
+  int16_t value = uo_search_quiesce(thread, -uo_score_checkmate, uo_score_checkmate, 0, true, &incomplete);
+
+  thread->owner = NULL;
+
+  return incomplete ? uo_score_unknown : value;
+}
@@ -6,12 +6,17 @@
 #include "uo_search.h"
 #include "uo_engine.h"
 #include "uo_strmap.h"
+#include "uo_math.h"
+#include "uo_tuning.h"
+#include "uo_match.h"
+#include "uo_process.h"
 
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <math.h>
 
 typedef struct uo_test_info
 {
@@ -236,7 +241,7 @@ bool uo_test__eval(uo_test_info *info)
 
         if (cp < cp_lower_bound || cp > cp_upper_bound)
         {
-          int16_t static_eval = uo_position_evaluate(&info->position);
+          int16_t static_eval = uo_position_evaluate(&info->position, NULL, NULL);
           assert(static_eval == cp);
 
           sprintf(info->message, "Static evaluation %d for fen '%s' is not between [%d,%d].", cp, info->fen, cp_lower_bound, cp_upper_bound);
@@ -317,6 +322,373 @@ bool uo_test__test_see(uo_test_info *info)
   return info->passed;
 }
 
+static bool uo_test__test_eval_parameters_recursive(uo_test_info *info, size_t depth)
+{
+  uo_position *position = &info->position;
+
+  // Step 1. Compare evaluation using compile time constants to evaluation using default parameters
+  position->stack->static_eval = uo_score_unknown;
+  int16_t static_eval = uo_position_evaluate(position, NULL, NULL);
+  int16_t static_eval_parameters = uo_position_evaluate_with_parameters(position, &uo_evaluation_parameters_default);
+
+  if (static_eval != static_eval_parameters)
+  {
+    uo_position_print_fen(position, info->buffer);
+    sprintf(info->message, "Static evaluation %d for fen '%s' was not matching evaluation with default parameters: %d.", static_eval, info->buffer, static_eval_parameters);
+    return false;
+  }
+
+  // Step 2. Compare lazy evaluations
+  uo_material_hash_entry material;
+  uo_position_evaluate_material(position, NULL, &material);
+
+  if (!material.evaluate)
+  {
+    int16_t lazy_eval = uo_position_evaluate_lazy(position, &material, NULL, NULL);
+    int16_t lazy_eval_parameters = uo_position_evaluate_lazy(position, &material, NULL, &uo_evaluation_parameters_default);
+
+    if (lazy_eval != lazy_eval_parameters)
+    {
+      uo_position_print_fen(position, info->buffer);
+      sprintf(info->message, "Lazy evaluation %d for fen '%s' was not matching lazy evaluation with default parameters: %d.", lazy_eval, info->buffer, lazy_eval_parameters);
+      return false;
+    }
+  }
+
+  if (depth == 0) return true;
+
+  // Step 3. Repeat for positions after each legal move
+  size_t move_count = uo_position_generate_moves(position);
+
+  for (size_t i = 0; i < move_count; ++i)
+  {
+    uo_position_make_move(position, position->movelist.head[i], 0, 0);
+    bool passed = uo_test__test_eval_parameters_recursive(info, depth - 1);
+    uo_position_unmake_move(position);
+
+    if (!passed) return false;
+  }
+
+  return true;
+}
+
+bool uo_test__test_eval_parameters(uo_test_info *info)
+{
+  size_t depth = 0;
+  sscanf(info->ptr, "test eval_parameters depth %zu", &depth);
+
+  return uo_test__test_eval_parameters_recursive(info, depth) && info->passed;
+}
+
+static size_t uo_test__test_evaluate_batch_recursive(uo_position *position, size_t depth, uo_position_packed *positions, int16_t *scores, size_t capacity)
+{
+  if (!capacity) return 0;
+
+  position->stack->static_eval = uo_score_unknown;
+  uo_position_pack(position, positions);
+  scores[0] = uo_position_evaluate(position, NULL, NULL);
+  size_t count = 1;
+
+  if (depth == 0) return count;
+
+  size_t move_count = uo_position_generate_moves(position);
+
+  for (size_t i = 0; i < move_count; ++i)
+  {
+    uo_position_make_move(position, position->movelist.head[i], 0, 0);
+    count += uo_test__test_evaluate_batch_recursive(position, depth - 1, positions + count, scores + count, capacity - count);
+    uo_position_unmake_move(position);
+  }
+
+  return count;
+}
+
+bool uo_test__test_evaluate_batch(uo_test_info *info)
+{
+  size_t depth = 0;
+  sscanf(info->ptr, "test evaluate_batch depth %zu", &depth);
+
+  const size_t capacity = 0x10000;
+  uo_position_packed *positions = malloc(capacity * sizeof * positions);
+  int16_t *scores_expected = malloc(capacity * sizeof * scores_expected);
+  int16_t *scores = malloc(capacity * sizeof * scores);
+
+  // Step 1. Collect positions of the tree and their static evaluations
+  size_t count = uo_test__test_evaluate_batch_recursive(&info->position, depth, positions, scores_expected, capacity);
+
+  // Step 2. Compare to batched evaluation with the hash tables of the engine threads and with default parameters
+  for (size_t k = 0; k < 2 && info->passed; ++k)
+  {
+    const uo_evaluation_parameters *parameters = k ? &uo_evaluation_parameters_default : NULL;
+    uo_tuning_evaluate_batch(positions, scores, count, parameters);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (scores[i] != scores_expected[i])
+      {
+        uo_position_unpack(&info->position, positions + i);
+        uo_position_print_fen(&info->position, info->buffer);
+        sprintf(info->message, "Batched evaluation %d for fen '%s' was not matching static evaluation: %d.", scores[i], info->buffer, scores_expected[i]);
+        info->passed = false;
+        break;
+      }
+    }
+  }
+
+  free(scores);
+  free(scores_expected);
+  free(positions);
+
+  return info->passed;
+}
+
+bool uo_test__test_move_notation(uo_test_info *info)
+{
+  uo_position *position = &info->position;
+  char move_str[6];
+
+  while ((info->ptr = uo_file_mmap_readline(info->file_mmap)))
+  {
+    if (strlen(info->ptr) == 0) break;
+    if (info->ptr[0] == '#') continue;
+
+    char move_str_expected[6];
+    char legality[8] = "";
+    sscanf(info->ptr, "%5s %7s", move_str_expected, legality);
+    bool is_legal_expected = strcmp(legality, "illegal") != 0;
+
+    uo_move move = uo_position_parse_legal_move(position, move_str_expected);
+
+    if (!move)
+    {
+      if (!is_legal_expected) continue;
+
+      sprintf(info->message, "Move '%s' was not parsed as legal move for fen '%s'.", move_str_expected, info->fen);
+      return false;
+    }
+
+    if (!is_legal_expected)
+    {
+      sprintf(info->message, "Move '%s' was parsed as legal move for fen '%s'.", move_str_expected, info->fen);
+      return false;
+    }
+
+    size_t len = uo_position_print_move(position, move, move_str);
+    if (strcmp(move_str, move_str_expected) != 0 || len != strlen(move_str_expected))
+    {
+      sprintf(info->message, "Move '%s' was printed as '%s' of length %zu for fen '%s'.", move_str_expected, move_str, len, info->fen);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool uo_test__test_repetition(uo_test_info *info)
+{
+  uo_position *position = &info->position;
+
+  while ((info->ptr = uo_file_mmap_readline(info->file_mmap)))
+  {
+    if (strlen(info->ptr) == 0) break;
+    if (info->ptr[0] == '#') continue;
+
+    char move_str[6];
+    unsigned repetition_count_expected;
+
+    if (sscanf(info->ptr, "%5s %u", move_str, &repetition_count_expected) != 2)
+    {
+      sprintf(info->message, "Expected to read move and repetition count, instead read '%s'", info->ptr);
+      return false;
+    }
+
+    uo_move move = uo_position_parse_legal_move(position, move_str);
+    if (!move)
+    {
+      sprintf(info->message, "Error while parsing move '%s'", move_str);
+      return false;
+    }
+
+    // Moves are played as in a game, so the history is truncated after each move
+    uo_position_make_move(position, move, 0, 0);
+    uo_position_reset_root(position);
+
+    unsigned repetition_count = uo_position_repetition_count(position);
+    if (repetition_count != repetition_count_expected)
+    {
+      uo_position_print_fen(position, info->buffer);
+      sprintf(info->message, "Repetition count %u after move '%s' for fen '%s' was not matching expected value: %u.",
+        repetition_count, move_str, info->buffer, repetition_count_expected);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool uo_test__test_match_statistics(uo_test_info *info)
+{
+  size_t results[3];
+  double elo0, elo1, elo_expected, elo_error_expected, llr_expected;
+
+  if (sscanf(info->ptr, "test match_statistics losses %zu draws %zu wins %zu elo0 %lf elo1 %lf elo %lf +- %lf llr %lf",
+    results, results + 1, results + 2, &elo0, &elo1, &elo_expected, &elo_error_expected, &llr_expected) != 8)
+  {
+    sprintf(info->message, "Expected to read 'test match_statistics', instead read '%s'", info->ptr);
+    return false;
+  }
+
+  const double tolerance = 0.01;
+  double mean, var;
+  uo_match_score_stats(results, &mean, &var);
+
+  double elo = uo_match_score_to_elo(mean);
+  double elo_error = var > 0.0 ? uo_match_elo_error(results) : 0.0;
+  double llr = uo_match_llr(results, elo0, elo1);
+
+  if (fabs(elo - elo_expected) > tolerance
+    || fabs(elo_error - elo_error_expected) > tolerance
+    || fabs(llr - llr_expected) > tolerance)
+  {
+    sprintf(info->message, "Match statistics elo %.2f +- %.2f, llr %.2f were not matching expected values elo %.2f +- %.2f, llr %.2f.",
+      elo, elo_error, llr, elo_expected, elo_error_expected, llr_expected);
+    return false;
+  }
+
+  return true;
+}
+
+typedef struct uo_test_process_manager_state
+{
+  size_t uciok_count;
+  size_t readyok_count;
+  size_t timeout_count;
+  size_t exit_count;
+  bool is_line_broken;
+} uo_test_process_manager_state;
+
+static void uo_test_process_manager_handle_line(void *data, char *line)
+{
+  uo_test_process_manager_state *state = data;
+
+  if (strcmp(line, "uciok") == 0) ++state->uciok_count;
+  else if (strcmp(line, "readyok") == 0) ++state->readyok_count;
+  else if (strpbrk(line, "\r\n") || strstr(line, "uciok") || strstr(line, "readyok")) state->is_line_broken = true;
+}
+
+static void uo_test_process_manager_handle_timeout(void *data)
+{
+  uo_test_process_manager_state *state = data;
+  ++state->timeout_count;
+}
+
+static void uo_test_process_manager_handle_exit(void *data)
+{
+  uo_test_process_manager_state *state = data;
+  ++state->exit_count;
+}
+
+// Polls the process manager until the count has reached the expected value or the time limit has passed
+static bool uo_test_process_manager_poll(uo_process_manager *manager, const size_t *count, size_t count_expected, double time_limit_msec)
+{
+  uo_time time_start;
+  uo_time_now(&time_start);
+
+  while (*count < count_expected)
+  {
+    double remaining_msec = time_limit_msec - uo_time_elapsed_msec(&time_start);
+    if (remaining_msec <= 0) return false;
+    uo_process_manager_poll(manager, remaining_msec);
+  }
+
+  return *count == count_expected;
+}
+
+bool uo_test__test_process_manager(uo_test_info *info)
+{
+  static const uo_managed_process_callbacks callbacks = {
+    .line = uo_test_process_manager_handle_line,
+    .timeout = uo_test_process_manager_handle_timeout,
+    .exit = uo_test_process_manager_handle_exit
+  };
+
+  size_t isready_count;
+  double timeout_msec;
+
+  if (sscanf(info->ptr, "test process_manager isready %zu timeout %lf", &isready_count, &timeout_msec) != 2)
+  {
+    sprintf(info->message, "Expected to read 'test process_manager', instead read '%s'", info->ptr);
+    return false;
+  }
+
+  const double time_limit_msec = 10000.0;
+  uo_test_process_manager_state state = { 0 };
+  uo_process_manager *manager = uo_process_manager_create();
+  uo_managed_process *process = uo_process_manager_start(manager, engine.process_info.argv[0], &callbacks, &state);
+
+  if (!process)
+  {
+    sprintf(info->message, "Unable to start engine process.");
+    uo_process_manager_free(manager);
+    return false;
+  }
+
+  // Step 1. Queue all commands with a single write, so that the replies are read in several parts
+  char *commands = malloc(uo_strlen("uci\n") + isready_count * uo_strlen("isready\n") + 1);
+  char *ptr = commands;
+  ptr += sprintf(ptr, "uci\n");
+  for (size_t i = 0; i < isready_count; ++i) ptr += sprintf(ptr, "isready\n");
+  uo_managed_process_write(process, commands);
+  free(commands);
+
+  if (!uo_test_process_manager_poll(manager, &state.readyok_count, isready_count, time_limit_msec)
+    || state.uciok_count != 1
+    || state.is_line_broken)
+  {
+    sprintf(info->message, "Expected to read 'uciok' once and 'readyok' %zu times as whole lines, instead read 'uciok' %zu times and 'readyok' %zu times.",
+      isready_count, state.uciok_count, state.readyok_count);
+    info->passed = false;
+  }
+
+  // Step 2. Wait for the deadline while the engine is idle
+  if (info->passed)
+  {
+    uo_time time_timeout_set;
+    uo_time_now(&time_timeout_set);
+    uo_managed_process_set_timeout(process, timeout_msec);
+
+    bool is_timeout = uo_test_process_manager_poll(manager, &state.timeout_count, 1, time_limit_msec);
+    double elapsed_msec = uo_time_elapsed_msec(&time_timeout_set);
+
+    // Deadline is cleared before the callback, so it is not called again
+    uo_process_manager_poll(manager, timeout_msec);
+
+    if (!is_timeout || state.timeout_count != 1 || elapsed_msec < timeout_msec)
+    {
+      sprintf(info->message, "Timeout callback was called %zu times after %.0f ms, expected once after %.0f ms.",
+        state.timeout_count, elapsed_msec, timeout_msec);
+      info->passed = false;
+    }
+  }
+
+  // Step 3. Quit the engine and wait for its output to close
+  if (info->passed)
+  {
+    uo_managed_process_write(process, "quit\n");
+
+    if (!uo_test_process_manager_poll(manager, &state.exit_count, 1, time_limit_msec))
+    {
+      sprintf(info->message, "Exit callback was called %zu times after quit, expected once.", state.exit_count);
+      info->passed = false;
+    }
+  }
+
+  uo_managed_process_close(process);
+  uo_process_manager_free(manager);
+
+  return info->passed;
+}
+
 bool uo_test__go_perft(uo_test_info *info)
 {
   size_t depth;
@@ -439,7 +811,8 @@ bool uo_test__go_depth(uo_test_info *info)
     return false;
   }
 
-  sprintf(info->buffer, "go depth %zu\n", depth);
+  // Pass rest of the search parameters, e.g. searchmoves, as is
+  sprintf(info->buffer, "%s\n", info->ptr);
   uo_process_write_stdin(info->engine_process, info->buffer, 0);
 
   char *bestmove;
@@ -571,6 +944,12 @@ bool uo_test__test(uo_test_info *info)
 
     // Register all 'test xxxx' test commands here
     uo_strmap_add(test_command_map__test, "see", uo_test__test_see);
+    uo_strmap_add(test_command_map__test, "eval_parameters", uo_test__test_eval_parameters);
+    uo_strmap_add(test_command_map__test, "evaluate_batch", uo_test__test_evaluate_batch);
+    uo_strmap_add(test_command_map__test, "move_notation", uo_test__test_move_notation);
+    uo_strmap_add(test_command_map__test, "repetition", uo_test__test_repetition);
+    uo_strmap_add(test_command_map__test, "match_statistics", uo_test__test_match_statistics);
+    uo_strmap_add(test_command_map__test, "process_manager", uo_test__test_process_manager);
   }
 
   char *command_str = buf;
@@ -628,6 +1007,9 @@ bool uo_test(char *test_data_dir, char *test_name)
   if (!test_data_dir) return false;
   if (!test_name) return false;
 
+  // Math kernels are tested without an engine process
+  if (strcmp(test_name, "math") == 0) return uo_test_matmul(test_data_dir);
+
   if (!test_command_map)
   {
     test_command_map = uo_strmap_create();
@@ -1,1428 +1,2466 @@
 #include "uo_tuning.h"
 #include "uo_misc.h"
 #include "uo_engine.h"
+#include "uo_thread.h"
+#include "uo_dataset.h"
+#include "uo_nnue.h"
+#include "uo_math.h"
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
-void uo_tuning_generate_dataset(char *dataset_filepath, char *engine_filepath, char *engine_option_commands, size_t position_count)
+typedef struct uo_tuning_generate_dataset_params
 {
-  char *ptr;
-  char buffer[0x1000];
+  FILE *fp;
+  bool binary;
+  size_t position_count;
+  size_t depth;
+  size_t nodes;
+  uint64_t seed;
+  volatile uo_atomic_int claimed;
+  volatile uo_atomic_int generated;
+  uo_semaphore *semaphore;
+} uo_tuning_generate_dataset_params;
+
+static void *uo_tuning_generate_dataset_thread_run(void *arg)
+{
+  uo_engine_thread *thread = arg;
+  uo_tuning_generate_dataset_params *params = thread->data;
+  uo_position *position = &thread->position;
+  char buffer[0x100];
 
-  uo_rand_init(time(NULL));
+  uint64_t rand_state = params->seed + thread->index;
 
-  uo_process *engine_process = uo_process_create(engine_filepath);
-  FILE *fp = fopen(dataset_filepath, "a");
+  uo_atomic_unlock(&thread->busy);
 
-  uo_process_write_stdin(engine_process, "uci\n", 0);
-  if (engine_option_commands)
+  while (uo_atomic_increment(&params->claimed) <= (int)params->position_count)
   {
-    uo_process_write_stdin(engine_process, engine_option_commands, 0);
-  }
-
-  uo_position position;
+    int16_t score;
+    uo_move bestmove;
 
-  for (size_t i = 0; i < position_count; ++i)
-  {
-    uo_process_write_stdin(engine_process, "isready\n", 0);
-    ptr = buffer;
     do
     {
-      uo_process_read_stdout(engine_process, buffer, sizeof buffer);
-      ptr = strstr(buffer, "readyok");
-    } while (!ptr);
+      // Step 1. Generate random quiescent position
+      do
+      {
+        uo_position_randomize(position, NULL, &rand_state);
+      } while (!uo_position_is_quiescent(position));
 
-    uo_position_randomize(&position, NULL);
+      // Step 2. Search the position. Positions without legal moves or with a forced mate are skipped.
+      score = uo_engine_thread_search(thread, params->depth, params->nodes, &bestmove);
+    } while (!bestmove || uo_score_is_checkmate(score));
 
-    while (!uo_position_is_quiescent(&position))
+    // Step 3. Write record or fen and score from white's point of view. Each entry is written with a single call, which locks the stream.
+    if (params->binary)
     {
-      uo_position_randomize(&position, NULL);
+      uo_dataset_record record;
+      if (uo_dataset_record_pack(position, score, uo_dataset_result_unknown, &record)) fwrite(&record, sizeof record, 1, params->fp);
     }
+    else
+    {
+      if (uo_color(position->flags) == uo_black) score = -score;
 
-    ptr = buffer;
-    ptr += sprintf(buffer, "position fen ");
-    ptr += uo_position_print_fen(&position, ptr);
-    ptr += sprintf(ptr, "\n");
-
-    uo_process_write_stdin(engine_process, buffer, 0);
+      char *ptr = buffer;
+      ptr += uo_position_print_fen(position, ptr);
+      ptr += sprintf(ptr, ",%+d\n", score);
+      fputs(buffer, params->fp);
+    }
 
-    uo_process_write_stdin(engine_process, "isready\n", 0);
-    ptr = buffer;
-    do
+    int generated = uo_atomic_increment(&params->generated);
+    if (generated % 1000 == 0)
     {
-      uo_process_read_stdout(engine_process, buffer, sizeof buffer);
-      ptr = strstr(buffer, "readyok");
-    } while (!ptr);
+      printf("positions generated: %4d\n", generated);
+      fflush(stdout);
+    }
+  }
 
-    uo_process_write_stdin(engine_process, "go depth 1\n", 0);
+  uo_semaphore_release(params->semaphore);
 
-    do
-    {
-      uo_process_read_stdout(engine_process, buffer, sizeof buffer);
+  return NULL;
+}
 
-      char *mate = strstr(buffer, "score mate ");
-      char *nomoves = strstr(buffer, "bestmove (none)");
-      if (mate || nomoves)
-      {
-        --i;
-        goto next_position;
-      }
+void uo_tuning_generate_dataset(char *dataset_filepath, size_t position_count, size_t depth, size_t nodes)
+{
+  if (!dataset_filepath || !position_count) return;
 
-      ptr = strstr(buffer, "info depth 1");
-    } while (!ptr);
+  bool binary = uo_dataset_filepath_is_binary(dataset_filepath);
+  FILE *fp = binary ? uo_dataset_open_append(dataset_filepath) : fopen(dataset_filepath, "a");
+  if (!fp)
+  {
+    printf("Unable to open file '%s'\n", dataset_filepath);
+    return;
+  }
 
-    ptr = strstr(ptr, "score");
+  uo_tuning_generate_dataset_params params = {
+    .fp = fp,
+    .binary = binary,
+    .position_count = position_count,
+    .depth = depth,
+    .nodes = nodes,
+    .seed = time(NULL),
+    .semaphore = uo_semaphore_create(0)
+  };
 
-    int16_t score;
-    if (sscanf(ptr, "score cp %hd", &score) == 1)
-    {
-      if (uo_color(position.flags) == uo_black) score *= -1.0f;
+  uo_atomic_init(&params.claimed, 0);
+  uo_atomic_init(&params.generated, 0);
 
-      char *ptr = buffer;
-      ptr += uo_position_print_fen(&position, ptr);
-      ptr += sprintf(ptr, ",%+d\n", score);
-      fprintf(fp, "%s", buffer);
-    }
+  uo_time time_start;
+  uo_time_now(&time_start);
 
-    if ((i + 1) % 1000 == 0)
-    {
-      printf("positions generated: %4zu\n", i + 1);
-    }
+  // Step 1. Run a generator on each thread of the engine thread pool. Search is not stopped while generators are running.
+  uo_atomic_store(&engine.stopped, 0);
+
+  for (size_t i = 0; i < engine.thread_count; ++i)
+  {
+    uo_engine_run_thread(uo_tuning_generate_dataset_thread_run, &params);
+  }
 
-  next_position:
-    uo_process_write_stdin(engine_process, "ucinewgame\n", 0);
+  // Step 2. Wait for generators to finish
+  for (size_t i = 0; i < engine.thread_count; ++i)
+  {
+    uo_semaphore_wait(params.semaphore);
   }
 
-  uo_process_write_stdin(engine_process, "quit\n", 0);
+  uo_engine_stop_search();
 
-  uo_process_free(engine_process);
+  double time_msec = uo_time_elapsed_msec(&time_start);
+  printf("positions generated: %zu, time: %.1f s, positions per second: %.1f\n",
+    position_count, time_msec / 1000.0, position_count / time_msec * 1000.0);
+
+  uo_semaphore_destroy(params.semaphore);
   fclose(fp);
 }
 
-#define uo_score_attacks_to_K_min_units 11
-#define uo_score_attacks_to_K_max_units 54
-#define uo_score_attacks_to_K_max_score 618
-#define uo_score_attacks_to_K_mid_units 40
-#define uo_score_attacks_to_K_mid_score 93
-
-int tuning_params[] = {
-
-  //// piece values
-  //uo_score_P,
-  //uo_score_N,
-  //uo_score_B,
-  //uo_score_R,
-  //uo_score_Q,
-
-  uo_score_king_cover_pawn,
-
-  uo_score_attacks_to_K_min_units,
-  uo_score_attacks_to_K_max_units,
-  uo_score_attacks_to_K_max_score,
-  uo_score_attacks_to_K_mid_units,
-  uo_score_attacks_to_K_mid_score
-
-  //// mobility
-  //uo_score_mobility_P,
-
-  //uo_score_zero_mobility_P,
-  //uo_score_zero_mobility_K,
-
-  //score_mobility_N_0,
-  //score_mobility_N_1,
-  //score_mobility_N_2,
-  //score_mobility_N_3,
-  //score_mobility_N_4,
-  //score_mobility_N_5,
-  //score_mobility_N_6,
-  //score_mobility_N_7,
-  //score_mobility_N_8,
-
-  //score_mobility_B_0,
-  //score_mobility_B_1,
-  //score_mobility_B_2,
-  //score_mobility_B_3,
-  //score_mobility_B_4,
-  //score_mobility_B_5,
-  //score_mobility_B_6,
-  //score_mobility_B_7,
-  //score_mobility_B_8,
-  //score_mobility_B_9,
-  //score_mobility_B_10,
-  //score_mobility_B_11,
-  //score_mobility_B_12,
-  //score_mobility_B_13,
-
-  //score_mobility_R_0,
-  //score_mobility_R_1,
-  //score_mobility_R_2,
-  //score_mobility_R_3,
-  //score_mobility_R_4,
-  //score_mobility_R_5,
-  //score_mobility_R_6,
-  //score_mobility_R_7,
-  //score_mobility_R_8,
-  //score_mobility_R_9,
-  //score_mobility_R_10,
-  //score_mobility_R_11,
-  //score_mobility_R_12,
-  //score_mobility_R_13,
-  //score_mobility_R_14,
-
-  //score_mobility_Q_0,
-  //score_mobility_Q_1,
-  //score_mobility_Q_2,
-  //score_mobility_Q_3,
-  //score_mobility_Q_4,
-  //score_mobility_Q_5,
-  //score_mobility_Q_6,
-  //score_mobility_Q_7,
-  //score_mobility_Q_8,
-  //score_mobility_Q_9,
-  //score_mobility_Q_10,
-  //score_mobility_Q_11,
-  //score_mobility_Q_12,
-  //score_mobility_Q_13,
-  //score_mobility_Q_14,
-  //score_mobility_Q_15,
-  //score_mobility_Q_16,
-  //score_mobility_Q_17,
-  //score_mobility_Q_18,
-  //score_mobility_Q_19,
-  //score_mobility_Q_20,
-  //score_mobility_Q_21,
-  //score_mobility_Q_22,
-  //score_mobility_Q_23,
-  //score_mobility_Q_24,
-  //score_mobility_Q_25,
-  //score_mobility_Q_26,
-  //score_mobility_Q_27,
-
-  //// pawns
-  //uo_score_supported_P,
-  //uo_score_isolated_P,
-
-  //// piece development
-  //uo_score_rook_stuck_in_corner,
-
-  //// king safety and castling
-  //uo_score_king_cover_pawn,
-
-  //// piece square tables for pawns
-  //score_mg_P_a2,
-  //score_mg_P_b2,
-  //score_mg_P_c2,
-  //score_mg_P_d2,
-  //score_mg_P_e2,
-  //score_mg_P_f2,
-  //score_mg_P_g2,
-  //score_mg_P_h2,
-
-  //score_mg_P_a3,
-  //score_mg_P_b3,
-  //score_mg_P_c3,
-  //score_mg_P_d3,
-  //score_mg_P_e3,
-  //score_mg_P_f3,
-  //score_mg_P_g3,
-  //score_mg_P_h3,
-
-  //score_mg_P_a4,
-  //score_mg_P_b4,
-  //score_mg_P_c4,
-  //score_mg_P_d4,
-  //score_mg_P_e4,
-  //score_mg_P_f4,
-  //score_mg_P_g4,
-  //score_mg_P_h4,
-
-  //score_mg_P_a5,
-  //score_mg_P_b5,
-  //score_mg_P_c5,
-  //score_mg_P_d5,
-  //score_mg_P_e5,
-  //score_mg_P_f5,
-  //score_mg_P_g5,
-  //score_mg_P_h5,
-
-  //score_mg_P_a6,
-  //score_mg_P_b6,
-  //score_mg_P_c6,
-  //score_mg_P_d6,
-  //score_mg_P_e6,
-  //score_mg_P_f6,
-  //score_mg_P_g6,
-  //score_mg_P_h6,
-
-  //score_mg_P_a7,
-  //score_mg_P_b7,
-  //score_mg_P_c7,
-  //score_mg_P_d7,
-  //score_mg_P_e7,
-  //score_mg_P_f7,
-  //score_mg_P_g7,
-  //score_mg_P_h7,
-
-
-  //score_eg_P_a2,
-  //score_eg_P_b2,
-  //score_eg_P_c2,
-  //score_eg_P_d2,
-  //score_eg_P_e2,
-  //score_eg_P_f2,
-  //score_eg_P_g2,
-  //score_eg_P_h2,
-
-  //score_eg_P_a3,
-  //score_eg_P_b3,
-  //score_eg_P_c3,
-  //score_eg_P_d3,
-  //score_eg_P_e3,
-  //score_eg_P_f3,
-  //score_eg_P_g3,
-  //score_eg_P_h3,
-
-  //score_eg_P_a4,
-  //score_eg_P_b4,
-  //score_eg_P_c4,
-  //score_eg_P_d4,
-  //score_eg_P_e4,
-  //score_eg_P_f4,
-  //score_eg_P_g4,
-  //score_eg_P_h4,
-
-  //score_eg_P_a5,
-  //score_eg_P_b5,
-  //score_eg_P_c5,
-  //score_eg_P_d5,
-  //score_eg_P_e5,
-  //score_eg_P_f5,
-  //score_eg_P_g5,
-  //score_eg_P_h5,
-
-  //score_eg_P_a6,
-  //score_eg_P_b6,
-  //score_eg_P_c6,
-  //score_eg_P_d6,
-  //score_eg_P_e6,
-  //score_eg_P_f6,
-  //score_eg_P_g6,
-  //score_eg_P_h6,
-
-  //score_eg_P_a7,
-  //score_eg_P_b7,
-  //score_eg_P_c7,
-  //score_eg_P_d7,
-  //score_eg_P_e7,
-  //score_eg_P_f7,
-  //score_eg_P_g7,
-  //score_eg_P_h7,
-
-  //uo_score_passed_pawn_on_fifth,
-  //uo_score_passed_pawn_on_sixth,
-
-};
-
-//// piece values
-//#undef uo_score_P
-//#define uo_score_P (tuning_params[0])
-//#undef uo_score_N
-//#define uo_score_N (tuning_params[1])
-//#undef uo_score_B
-//#define uo_score_B (tuning_params[2])
-//#undef uo_score_R
-//#define uo_score_R (tuning_params[3])
-//#undef uo_score_Q
-//#define uo_score_Q (tuning_params[4])
-
-#undef uo_score_king_cover_pawn
-#define uo_score_king_cover_pawn (tuning_params[0])
-
-#undef uo_score_attacks_to_K_min_units
-#define uo_score_attacks_to_K_min_units (tuning_params[1])
-#undef uo_score_attacks_to_K_max_units
-#define uo_score_attacks_to_K_max_units (tuning_params[2])
-#undef uo_score_attacks_to_K_max_score
-#define uo_score_attacks_to_K_max_score (tuning_params[3])
-#undef uo_score_attacks_to_K_mid_units
-#define uo_score_attacks_to_K_mid_units (tuning_params[4])
-#undef uo_score_attacks_to_K_mid_score
-#define uo_score_attacks_to_K_mid_score (tuning_params[5])
-
-//// mobility
-//#undef uo_score_mobility_P
-//#define uo_score_mobility_P (tuning_params[6])
-//
-//#undef uo_score_zero_mobility_P
-//#define uo_score_zero_mobility_P (tuning_params[7])
-//#undef uo_score_zero_mobility_K
-//#define uo_score_zero_mobility_K (tuning_params[8])
-//
-//
-//#undef score_mobility_N_0
-//#define score_mobility_N_0 (tuning_params[9])
-//#undef score_mobility_N_1
-//#define score_mobility_N_1 (tuning_params[10])
-//#undef score_mobility_N_2
-//#define score_mobility_N_2 (tuning_params[11])
-//#undef score_mobility_N_3
-//#define score_mobility_N_3 (tuning_params[12])
-//#undef score_mobility_N_4
-//#define score_mobility_N_4 (tuning_params[13])
-//#undef score_mobility_N_5
-//#define score_mobility_N_5 (tuning_params[14])
-//#undef score_mobility_N_6
-//#define score_mobility_N_6 (tuning_params[15])
-//#undef score_mobility_N_7
-//#define score_mobility_N_7 (tuning_params[16])
-//#undef score_mobility_N_8
-//#define score_mobility_N_8 (tuning_params[17])
-//
-//#undef score_mobility_B_0
-//#define score_mobility_B_0 (tuning_params[18])
-//#undef score_mobility_B_1
-//#define score_mobility_B_1 (tuning_params[19])
-//#undef score_mobility_B_2
-//#define score_mobility_B_2 (tuning_params[20])
-//#undef score_mobility_B_3
-//#define score_mobility_B_3 (tuning_params[21])
-//#undef score_mobility_B_4
-//#define score_mobility_B_4 (tuning_params[22])
-//#undef score_mobility_B_5
-//#define score_mobility_B_5 (tuning_params[23])
-//#undef score_mobility_B_6
-//#define score_mobility_B_6 (tuning_params[24])
-//#undef score_mobility_B_7
-//#define score_mobility_B_7 (tuning_params[25])
-//#undef score_mobility_B_8
-//#define score_mobility_B_8 (tuning_params[26])
-//#undef score_mobility_B_9
-//#define score_mobility_B_9 (tuning_params[27])
-//#undef score_mobility_B_10
-//#define score_mobility_B_10 (tuning_params[28])
-//#undef score_mobility_B_11
-//#define score_mobility_B_11 (tuning_params[29])
-//#undef score_mobility_B_12
-//#define score_mobility_B_12 (tuning_params[30])
-//#undef score_mobility_B_13
-//#define score_mobility_B_13 (tuning_params[31])
-//
-//#undef score_mobility_R_0
-//#define score_mobility_R_0 (tuning_params[32])
-//#undef score_mobility_R_1
-//#define score_mobility_R_1 (tuning_params[33])
-//#undef score_mobility_R_2
-//#define score_mobility_R_2 (tuning_params[34])
-//#undef score_mobility_R_3
-//#define score_mobility_R_3 (tuning_params[35])
-//#undef score_mobility_R_4
-//#define score_mobility_R_4 (tuning_params[36])
-//#undef score_mobility_R_5
-//#define score_mobility_R_5 (tuning_params[37])
-//#undef score_mobility_R_6
-//#define score_mobility_R_6 (tuning_params[38])
-//#undef score_mobility_R_7
-//#define score_mobility_R_7 (tuning_params[39])
-//#undef score_mobility_R_8
-//#define score_mobility_R_8 (tuning_params[40])
-//#undef score_mobility_R_9
-//#define score_mobility_R_9 (tuning_params[41])
-//#undef score_mobility_R_10
-//#define score_mobility_R_10 (tuning_params[42])
-//#undef score_mobility_R_11
-//#define score_mobility_R_11 (tuning_params[43])
-//#undef score_mobility_R_12
-//#define score_mobility_R_12 (tuning_params[44])
-//#undef score_mobility_R_13
-//#define score_mobility_R_13 (tuning_params[45])
-//#undef score_mobility_R_14
-//#define score_mobility_R_14 (tuning_params[46])
-//
-//#undef score_mobility_Q_0
-//#define score_mobility_Q_0 (tuning_params[47])
-//#undef score_mobility_Q_1
-//#define score_mobility_Q_1 (tuning_params[48])
-//#undef score_mobility_Q_2
-//#define score_mobility_Q_2 (tuning_params[49])
-//#undef score_mobility_Q_3
-//#define score_mobility_Q_3 (tuning_params[50])
-//#undef score_mobility_Q_4
-//#define score_mobility_Q_4 (tuning_params[51])
-//#undef score_mobility_Q_5
-//#define score_mobility_Q_5 (tuning_params[52])
-//#undef score_mobility_Q_6
-//#define score_mobility_Q_6 (tuning_params[53])
-//#undef score_mobility_Q_7
-//#define score_mobility_Q_7 (tuning_params[54])
-//#undef score_mobility_Q_8
-//#define score_mobility_Q_8 (tuning_params[55])
-//#undef score_mobility_Q_9
-//#define score_mobility_Q_9 (tuning_params[56])
-//#undef score_mobility_Q_10
-//#define score_mobility_Q_10 (tuning_params[57])
-//#undef score_mobility_Q_11
-//#define score_mobility_Q_11 (tuning_params[58])
-//#undef score_mobility_Q_12
-//#define score_mobility_Q_12 (tuning_params[59])
-//#undef score_mobility_Q_13
-//#define score_mobility_Q_13 (tuning_params[60])
-//#undef score_mobility_Q_14
-//#define score_mobility_Q_14 (tuning_params[61])
-//#undef score_mobility_Q_15
-//#define score_mobility_Q_15 (tuning_params[62])
-//#undef score_mobility_Q_16
-//#define score_mobility_Q_16 (tuning_params[63])
-//#undef score_mobility_Q_17
-//#define score_mobility_Q_17 (tuning_params[64])
-//#undef score_mobility_Q_18
-//#define score_mobility_Q_18 (tuning_params[65])
-//#undef score_mobility_Q_19
-//#define score_mobility_Q_19 (tuning_params[66])
-//#undef score_mobility_Q_20
-//#define score_mobility_Q_20 (tuning_params[67])
-//#undef score_mobility_Q_21
-//#define score_mobility_Q_21 (tuning_params[68])
-//#undef score_mobility_Q_22
-//#define score_mobility_Q_22 (tuning_params[69])
-//#undef score_mobility_Q_23
-//#define score_mobility_Q_23 (tuning_params[70])
-//#undef score_mobility_Q_24
-//#define score_mobility_Q_24 (tuning_params[71])
-//#undef score_mobility_Q_25
-//#define score_mobility_Q_25 (tuning_params[72])
-//#undef score_mobility_Q_26
-//#define score_mobility_Q_26 (tuning_params[73])
-//#undef score_mobility_Q_27
-//#define score_mobility_Q_27 (tuning_params[74])
-
-//// pawns
-//#undef uo_score_supported_P
-//#define uo_score_supported_P (tuning_params[75])
-//
-//#undef uo_score_isolated_P
-//#define uo_score_isolated_P (tuning_params[76])
-//
-//  // piece development
-//#undef uo_score_rook_stuck_in_corner
-//#define uo_score_rook_stuck_in_corner (tuning_params[80])
-//
-//  // king safety and castling
-//#undef uo_score_king_cover_pawn
-//#define uo_score_king_cover_pawn (tuning_params[81])
-
-//// piece square tables for pawns
-//#undef score_mg_P_a2
-//#define score_mg_P_a2 (tuning_params[1])
-//#undef score_mg_P_b2
-//#define score_mg_P_b2 (tuning_params[2])
-//#undef score_mg_P_c2
-//#define score_mg_P_c2 (tuning_params[3])
-//#undef score_mg_P_d2
-//#define score_mg_P_d2 (tuning_params[4])
-//#undef score_mg_P_e2
-//#define score_mg_P_e2 (tuning_params[5])
-//#undef score_mg_P_f2
-//#define score_mg_P_f2 (tuning_params[6])
-//#undef score_mg_P_g2
-//#define score_mg_P_g2 (tuning_params[7])
-//#undef score_mg_P_h2
-//#define score_mg_P_h2 (tuning_params[8])
-//
-//#undef score_mg_P_a3
-//#define score_mg_P_a3 (tuning_params[9])
-//#undef score_mg_P_b3
-//#define score_mg_P_b3 (tuning_params[10])
-//#undef score_mg_P_c3
-//#define score_mg_P_c3 (tuning_params[11])
-//#undef score_mg_P_d3
-//#define score_mg_P_d3 (tuning_params[12])
-//#undef score_mg_P_e3
-//#define score_mg_P_e3 (tuning_params[13])
-//#undef score_mg_P_f3
-//#define score_mg_P_f3 (tuning_params[14])
-//#undef score_mg_P_g3
-//#define score_mg_P_g3 (tuning_params[15])
-//#undef score_mg_P_h3
-//#define score_mg_P_h3 (tuning_params[16])
-//
-//#undef score_mg_P_a4
-//#define score_mg_P_a4 (tuning_params[17])
-//#undef score_mg_P_b4
-//#define score_mg_P_b4 (tuning_params[18])
-//#undef score_mg_P_c4
-//#define score_mg_P_c4 (tuning_params[19])
-//#undef score_mg_P_d4
-//#define score_mg_P_d4 (tuning_params[20])
-//#undef score_mg_P_e4
-//#define score_mg_P_e4 (tuning_params[21])
-//#undef score_mg_P_f4
-//#define score_mg_P_f4 (tuning_params[22])
-//#undef score_mg_P_g4
-//#define score_mg_P_g4 (tuning_params[23])
-//#undef score_mg_P_h4
-//#define score_mg_P_h4 (tuning_params[24])
-//
-//#undef score_mg_P_a5
-//#define score_mg_P_a5 (tuning_params[25])
-//#undef score_mg_P_b5
-//#define score_mg_P_b5 (tuning_params[26])
-//#undef score_mg_P_c5
-//#define score_mg_P_c5 (tuning_params[27])
-//#undef score_mg_P_d5
-//#define score_mg_P_d5 (tuning_params[28])
-//#undef score_mg_P_e5
-//#define score_mg_P_e5 (tuning_params[29])
-//#undef score_mg_P_f5
-//#define score_mg_P_f5 (tuning_params[30])
-//#undef score_mg_P_g5
-//#define score_mg_P_g5 (tuning_params[31])
-//#undef score_mg_P_h5
-//#define score_mg_P_h5 (tuning_params[32])
-//
-//#undef score_mg_P_a6
-//#define score_mg_P_a6 (tuning_params[33])
-//#undef score_mg_P_b6
-//#define score_mg_P_b6 (tuning_params[34])
-//#undef score_mg_P_c6
-//#define score_mg_P_c6 (tuning_params[35])
-//#undef score_mg_P_d6
-//#define score_mg_P_d6 (tuning_params[36])
-//#undef score_mg_P_e6
-//#define score_mg_P_e6 (tuning_params[37])
-//#undef score_mg_P_f6
-//#define score_mg_P_f6 (tuning_params[38])
-//#undef score_mg_P_g6
-//#define score_mg_P_g6 (tuning_params[39])
-//#undef score_mg_P_h6
-//#define score_mg_P_h6 (tuning_params[40])
-//
-//#undef score_mg_P_a7
-//#define score_mg_P_a7 (tuning_params[41])
-//#undef score_mg_P_b7
-//#define score_mg_P_b7 (tuning_params[42])
-//#undef score_mg_P_c7
-//#define score_mg_P_c7 (tuning_params[43])
-//#undef score_mg_P_d7
-//#define score_mg_P_d7 (tuning_params[44])
-//#undef score_mg_P_e7
-//#define score_mg_P_e7 (tuning_params[45])
-//#undef score_mg_P_f7
-//#define score_mg_P_f7 (tuning_params[46])
-//#undef score_mg_P_g7
-//#define score_mg_P_g7 (tuning_params[47])
-//#undef score_mg_P_h7
-//#define score_mg_P_h7 (tuning_params[48])
-//
-//#undef score_eg_P_a2
-//#define score_eg_P_a2 (tuning_params[49])
-//#undef score_eg_P_b2
-//#define score_eg_P_b2 (tuning_params[50])
-//#undef score_eg_P_c2
-//#define score_eg_P_c2 (tuning_params[51])
-//#undef score_eg_P_d2
-//#define score_eg_P_d2 (tuning_params[52])
-//#undef score_eg_P_e2
-//#define score_eg_P_e2 (tuning_params[53])
-//#undef score_eg_P_f2
-//#define score_eg_P_f2 (tuning_params[54])
-//#undef score_eg_P_g2
-//#define score_eg_P_g2 (tuning_params[55])
-//#undef score_eg_P_h2
-//#define score_eg_P_h2 (tuning_params[56])
-//
-//#undef score_eg_P_a3
-//#define score_eg_P_a3 (tuning_params[57])
-//#undef score_eg_P_b3
-//#define score_eg_P_b3 (tuning_params[58])
-//#undef score_eg_P_c3
-//#define score_eg_P_c3 (tuning_params[59])
-//#undef score_eg_P_d3
-//#define score_eg_P_d3 (tuning_params[60])
-//#undef score_eg_P_e3
-//#define score_eg_P_e3 (tuning_params[61])
-//#undef score_eg_P_f3
-//#define score_eg_P_f3 (tuning_params[62])
-//#undef score_eg_P_g3
-//#define score_eg_P_g3 (tuning_params[63])
-//#undef score_eg_P_h3
-//#define score_eg_P_h3 (tuning_params[64])
-//
-//#undef score_eg_P_a4
-//#define score_eg_P_a4 (tuning_params[65])
-//#undef score_eg_P_b4
-//#define score_eg_P_b4 (tuning_params[66])
-//#undef score_eg_P_c4
-//#define score_eg_P_c4 (tuning_params[67])
-//#undef score_eg_P_d4
-//#define score_eg_P_d4 (tuning_params[68])
-//#undef score_eg_P_e4
-//#define score_eg_P_e4 (tuning_params[69])
-//#undef score_eg_P_f4
-//#define score_eg_P_f4 (tuning_params[70])
-//#undef score_eg_P_g4
-//#define score_eg_P_g4 (tuning_params[71])
-//#undef score_eg_P_h4
-//#define score_eg_P_h4 (tuning_params[72])
-//
-//#undef score_eg_P_a5
-//#define score_eg_P_a5 (tuning_params[73])
-//#undef score_eg_P_b5
-//#define score_eg_P_b5 (tuning_params[74])
-//#undef score_eg_P_c5
-//#define score_eg_P_c5 (tuning_params[75])
-//#undef score_eg_P_d5
-//#define score_eg_P_d5 (tuning_params[76])
-//#undef score_eg_P_e5
-//#define score_eg_P_e5 (tuning_params[77])
-//#undef score_eg_P_f5
-//#define score_eg_P_f5 (tuning_params[78])
-//#undef score_eg_P_g5
-//#define score_eg_P_g5 (tuning_params[79])
-//#undef score_eg_P_h5
-//#define score_eg_P_h5 (tuning_params[80])
-//
-//#undef score_eg_P_a6
-//#define score_eg_P_a6 (tuning_params[81])
-//#undef score_eg_P_b6
-//#define score_eg_P_b6 (tuning_params[82])
-//#undef score_eg_P_c6
-//#define score_eg_P_c6 (tuning_params[83])
-//#undef score_eg_P_d6
-//#define score_eg_P_d6 (tuning_params[84])
-//#undef score_eg_P_e6
-//#define score_eg_P_e6 (tuning_params[85])
-//#undef score_eg_P_f6
-//#define score_eg_P_f6 (tuning_params[86])
-//#undef score_eg_P_g6
-//#define score_eg_P_g6 (tuning_params[87])
-//#undef score_eg_P_h6
-//#define score_eg_P_h6 (tuning_params[88])
-//
-//#undef score_eg_P_a7
-//#define score_eg_P_a7 (tuning_params[89])
-//#undef score_eg_P_b7
-//#define score_eg_P_b7 (tuning_params[90])
-//#undef score_eg_P_c7
-//#define score_eg_P_c7 (tuning_params[91])
-//#undef score_eg_P_d7
-//#define score_eg_P_d7 (tuning_params[92])
-//#undef score_eg_P_e7
-//#define score_eg_P_e7 (tuning_params[93])
-//#undef score_eg_P_f7
-//#define score_eg_P_f7 (tuning_params[94])
-//#undef score_eg_P_g7
-//#define score_eg_P_g7 (tuning_params[95])
-//#undef score_eg_P_h7
-//#define score_eg_P_h7 (tuning_params[96])
-//
-//#undef uo_score_passed_pawn_on_fifth
-//#define uo_score_passed_pawn_on_fifth (tuning_params[97])
-//#undef uo_score_passed_pawn_on_sixth
-//#define uo_score_passed_pawn_on_sixth (tuning_params[98])
-
-#define uo_tuning_param_count (sizeof tuning_params / sizeof *tuning_params)
-
-typedef struct uo_tuning_param_info
+// Self-play adjudication. Game is adjudicated as a win if the score from white's point of view stays above the win
+// threshold or below its negation for the given number of consecutive plies, and as a draw if the absolute score stays
+// within the draw threshold after the given ply. Longer games are draws.
+#define uo_selfplay_win_score 1000
+#define uo_selfplay_win_plies 4
+#define uo_selfplay_draw_score 10
+#define uo_selfplay_draw_plies 10
+#define uo_selfplay_draw_ply_min 80
+#define uo_selfplay_ply_max 400
+
+typedef struct uo_tuning_generate_selfplay_params
+{
+  FILE *fp;
+  bool binary;
+  char **openings;
+  size_t opening_count;
+  size_t game_count;
+  size_t random_plies;
+  size_t depth;
+  size_t nodes;
+  uint64_t seed;
+  uo_time time_start;
+  volatile uo_atomic_int claimed;
+  volatile uo_atomic_int games;
+  volatile uo_atomic_int positions;
+  volatile uo_atomic_int results[3]; // black wins, draws, white wins
+  volatile uo_atomic_int adjudicated;
+  uo_semaphore *semaphore;
+} uo_tuning_generate_selfplay_params;
+
+static inline void uo_tuning_selfplay_print_progress(uo_tuning_generate_selfplay_params *params, int games, int positions)
 {
-  int increment;
-  double mse;
-  bool aimd_double;
-} uo_tuning_param_info;
+  double time_msec = uo_time_elapsed_msec(&params->time_start);
 
-uo_tuning_param_info tuning_param_infos[uo_tuning_param_count];
+  printf("games: %d (+%d =%d -%d, adjudicated %d), positions: %d, games per hour: %.0f, positions per second: %.1f\n",
+    games, uo_atomic_load(&params->results[2]), uo_atomic_load(&params->results[1]), uo_atomic_load(&params->results[0]),
+    uo_atomic_load(&params->adjudicated), positions, games / time_msec * 3600000.0, positions / time_msec * 1000.0);
+  fflush(stdout);
+}
 
-static inline int16_t uo_score_mobility_N(int mobility)
+// Sets up the opening of a game: a random opening position or the start position followed by random moves.
+// Returns false if the game ended during the random moves.
+static bool uo_tuning_selfplay_opening(char **openings, size_t opening_count, size_t random_plies, uo_position *position, uint64_t *rand_state)
 {
-  switch (mobility)
+  const char *fen = opening_count
+    ? openings[uo_rand_u64_r(rand_state) % opening_count]
+    : uo_fen_startpos;
+
+  if (!uo_position_from_fen(position, fen)) return false;
+
+  for (size_t i = 0; i < random_plies; ++i)
   {
-    case 0: return score_mobility_N_0;
-    case 1: return score_mobility_N_1;
-    case 2: return score_mobility_N_2;
-    case 3: return score_mobility_N_3;
-    case 4: return score_mobility_N_4;
-    case 5: return score_mobility_N_5;
-    case 6: return score_mobility_N_6;
-    case 7: return score_mobility_N_7;
-    case 8: return score_mobility_N_8;
-  }
+    size_t move_count = uo_position_generate_moves(position);
+    if (move_count == 0) return false;
 
-  exit(1);
-}
+    uo_move move = position->movelist.head[uo_rand_u64_r(rand_state) % move_count];
+    uo_position_make_move(position, move, 0, 0);
+    uo_position_reset_root(position);
+  }
 
-static inline int16_t uo_score_mobility_B(int mobility)
-{
-  switch (mobility)
-  {
-    case 0: return score_mobility_B_0;
-    case 1: return score_mobility_B_1;
-    case 2: return score_mobility_B_2;
-    case 3: return score_mobility_B_3;
-    case 4: return score_mobility_B_4;
-    case 5: return score_mobility_B_5;
-    case 6: return score_mobility_B_6;
-    case 7: return score_mobility_B_7;
-    case 8: return score_mobility_B_8;
-    case 9: return score_mobility_B_9;
-    case 10: return score_mobility_B_10;
-    case 11: return score_mobility_B_11;
-    case 12: return score_mobility_B_12;
-    case 13: return score_mobility_B_13;
-  }
-
-  exit(1);
+  return true;
 }
 
-static inline int16_t uo_score_mobility_R(int mobility)
+// Game result from the point of view of the side to move if the game is over or can be adjudicated by tablebases
+static int8_t uo_tuning_selfplay_result(uo_position *position, bool *adjudicated)
 {
-  switch (mobility)
-  {
-    case 0: return score_mobility_R_0;
-    case 1: return score_mobility_R_1;
-    case 2: return score_mobility_R_2;
-    case 3: return score_mobility_R_3;
-    case 4: return score_mobility_R_4;
-    case 5: return score_mobility_R_5;
-    case 6: return score_mobility_R_6;
-    case 7: return score_mobility_R_7;
-    case 8: return score_mobility_R_8;
-    case 9: return score_mobility_R_9;
-    case 10: return score_mobility_R_10;
-    case 11: return score_mobility_R_11;
-    case 12: return score_mobility_R_12;
-    case 13: return score_mobility_R_13;
-    case 14: return score_mobility_R_14;
-  }
-
-  exit(1);
-}
+  // Step 1. Draw by fifty move rule or threefold repetition
+  if (uo_position_is_rule50_draw(position)
+    || uo_position_repetition_count(position) >= 2
+    || position->root_ply >= uo_selfplay_ply_max)
+  {
+    return 0;
+  }
 
-static inline int16_t uo_score_mobility_Q(int mobility)
-{
-  switch (mobility)
-  {
-    case 0: return score_mobility_Q_0;
-    case 1: return score_mobility_Q_1;
-    case 2: return score_mobility_Q_2;
-    case 3: return score_mobility_Q_3;
-    case 4: return score_mobility_Q_4;
-    case 5: return score_mobility_Q_5;
-    case 6: return score_mobility_Q_6;
-    case 7: return score_mobility_Q_7;
-    case 8: return score_mobility_Q_8;
-    case 9: return score_mobility_Q_9;
-    case 10: return score_mobility_Q_10;
-    case 11: return score_mobility_Q_11;
-    case 12: return score_mobility_Q_12;
-    case 13: return score_mobility_Q_13;
-    case 14: return score_mobility_Q_14;
-    case 15: return score_mobility_Q_15;
-    case 16: return score_mobility_Q_16;
-    case 17: return score_mobility_Q_17;
-    case 18: return score_mobility_Q_18;
-    case 19: return score_mobility_Q_19;
-    case 20: return score_mobility_Q_20;
-    case 21: return score_mobility_Q_21;
-    case 22: return score_mobility_Q_22;
-    case 23: return score_mobility_Q_23;
-    case 24: return score_mobility_Q_24;
-    case 25: return score_mobility_Q_25;
-    case 26: return score_mobility_Q_26;
-    case 27: return score_mobility_Q_27;
-  }
-
-  exit(1);
-}
+  // Step 2. Tablebase adjudication
+  if (engine.tb.enabled
+    && uo_position_flags_rule50(position->flags) == 0
+    && uo_position_flags_castling(position->flags) == 0
+    && uo_popcnt(position->own | position->enemy) <= uo_min(TBlargest, engine.tb.probe_limit))
+  {
+    int success;
+    int wdl = uo_tb_probe_wdl(position, &success);
 
-static inline int16_t uo_score_mg_P(uo_square square)
-{
-  switch (square)
-  {
-    case uo_square__a2: return score_mg_P_a2;
-    case uo_square__b2: return score_mg_P_b2;
-    case uo_square__c2: return score_mg_P_c2;
-    case uo_square__d2: return score_mg_P_d2;
-    case uo_square__e2: return score_mg_P_e2;
-    case uo_square__f2: return score_mg_P_f2;
-    case uo_square__g2: return score_mg_P_g2;
-    case uo_square__h2: return score_mg_P_h2;
-
-    case uo_square__a3: return score_mg_P_a3;
-    case uo_square__b3: return score_mg_P_b3;
-    case uo_square__c3: return score_mg_P_c3;
-    case uo_square__d3: return score_mg_P_d3;
-    case uo_square__e3: return score_mg_P_e3;
-    case uo_square__f3: return score_mg_P_f3;
-    case uo_square__g3: return score_mg_P_g3;
-    case uo_square__h3: return score_mg_P_h3;
-
-    case uo_square__a4: return score_mg_P_a4;
-    case uo_square__b4: return score_mg_P_b4;
-    case uo_square__c4: return score_mg_P_c4;
-    case uo_square__d4: return score_mg_P_d4;
-    case uo_square__e4: return score_mg_P_e4;
-    case uo_square__f4: return score_mg_P_f4;
-    case uo_square__g4: return score_mg_P_g4;
-    case uo_square__h4: return score_mg_P_h4;
-
-    case uo_square__a5: return score_mg_P_a5;
-    case uo_square__b5: return score_mg_P_b5;
-    case uo_square__c5: return score_mg_P_c5;
-    case uo_square__d5: return score_mg_P_d5;
-    case uo_square__e5: return score_mg_P_e5;
-    case uo_square__f5: return score_mg_P_f5;
-    case uo_square__g5: return score_mg_P_g5;
-    case uo_square__h5: return score_mg_P_h5;
-
-    case uo_square__a6: return score_mg_P_a6;
-    case uo_square__b6: return score_mg_P_b6;
-    case uo_square__c6: return score_mg_P_c6;
-    case uo_square__d6: return score_mg_P_d6;
-    case uo_square__e6: return score_mg_P_e6;
-    case uo_square__f6: return score_mg_P_f6;
-    case uo_square__g6: return score_mg_P_g6;
-    case uo_square__h6: return score_mg_P_h6;
-
-    case uo_square__a7: return score_mg_P_a7;
-    case uo_square__b7: return score_mg_P_b7;
-    case uo_square__c7: return score_mg_P_c7;
-    case uo_square__d7: return score_mg_P_d7;
-    case uo_square__e7: return score_mg_P_e7;
-    case uo_square__f7: return score_mg_P_f7;
-    case uo_square__g7: return score_mg_P_g7;
-    case uo_square__h7: return score_mg_P_h7;
-  }
-
-  exit(1);
-}
+    if (success)
+    {
+      *adjudicated = true;
+      return wdl > engine.tb.score_wdl_draw ? 1
+        : wdl < -engine.tb.score_wdl_draw ? -1
+        : 0;
+    }
+  }
 
-static inline int16_t uo_score_eg_P(uo_square square)
-{
-  switch (square)
-  {
-    case uo_square__a2: return score_eg_P_a2;
-    case uo_square__b2: return score_eg_P_b2;
-    case uo_square__c2: return score_eg_P_c2;
-    case uo_square__d2: return score_eg_P_d2;
-    case uo_square__e2: return score_eg_P_e2;
-    case uo_square__f2: return score_eg_P_f2;
-    case uo_square__g2: return score_eg_P_g2;
-    case uo_square__h2: return score_eg_P_h2;
-
-    case uo_square__a3: return score_eg_P_a3;
-    case uo_square__b3: return score_eg_P_b3;
-    case uo_square__c3: return score_eg_P_c3;
-    case uo_square__d3: return score_eg_P_d3;
-    case uo_square__e3: return score_eg_P_e3;
-    case uo_square__f3: return score_eg_P_f3;
-    case uo_square__g3: return score_eg_P_g3;
-    case uo_square__h3: return score_eg_P_h3;
-
-    case uo_square__a4: return score_eg_P_a4;
-    case uo_square__b4: return score_eg_P_b4;
-    case uo_square__c4: return score_eg_P_c4;
-    case uo_square__d4: return score_eg_P_d4;
-    case uo_square__e4: return score_eg_P_e4;
-    case uo_square__f4: return score_eg_P_f4;
-    case uo_square__g4: return score_eg_P_g4;
-    case uo_square__h4: return score_eg_P_h4;
-
-    case uo_square__a5: return score_eg_P_a5;
-    case uo_square__b5: return score_eg_P_b5;
-    case uo_square__c5: return score_eg_P_c5;
-    case uo_square__d5: return score_eg_P_d5;
-    case uo_square__e5: return score_eg_P_e5;
-    case uo_square__f5: return score_eg_P_f5;
-    case uo_square__g5: return score_eg_P_g5;
-    case uo_square__h5: return score_eg_P_h5;
-
-    case uo_square__a6: return score_eg_P_a6;
-    case uo_square__b6: return score_eg_P_b6;
-    case uo_square__c6: return score_eg_P_c6;
-    case uo_square__d6: return score_eg_P_d6;
-    case uo_square__e6: return score_eg_P_e6;
-    case uo_square__f6: return score_eg_P_f6;
-    case uo_square__g6: return score_eg_P_g6;
-    case uo_square__h6: return score_eg_P_h6;
-
-    case uo_square__a7: return score_eg_P_a7;
-    case uo_square__b7: return score_eg_P_b7;
-    case uo_square__c7: return score_eg_P_c7;
-    case uo_square__d7: return score_eg_P_d7;
-    case uo_square__e7: return score_eg_P_e7;
-    case uo_square__f7: return score_eg_P_f7;
-    case uo_square__g7: return score_eg_P_g7;
-    case uo_square__h7: return score_eg_P_h7;
-  }
-
-  exit(1);
+  return uo_dataset_result_unknown;
 }
 
-static inline int16_t uo_score_attacks_to_K(int attack_units)
+static void *uo_tuning_generate_selfplay_thread_run(void *arg)
 {
-  return
-    attack_units <= uo_score_attacks_to_K_min_units ? 0 :
-    attack_units >= uo_score_attacks_to_K_max_units ? uo_score_attacks_to_K_max_score :
-    attack_units <= uo_score_attacks_to_K_mid_units ? uo_score_attacks_to_K_mid_score * (attack_units - uo_score_attacks_to_K_min_units) / (uo_score_attacks_to_K_mid_units - uo_score_attacks_to_K_min_units) :
-    uo_score_attacks_to_K_mid_score + (uo_score_attacks_to_K_max_score - uo_score_attacks_to_K_mid_score) * (attack_units - uo_score_attacks_to_K_mid_units) / (uo_score_attacks_to_K_max_units - uo_score_attacks_to_K_mid_units);
-}
+  uo_engine_thread *thread = arg;
+  uo_tuning_generate_selfplay_params *params = thread->data;
+  uo_position *position = &thread->position;
+  uo_dataset_record *records = malloc(uo_selfplay_ply_max * sizeof * records);
+  char buffer[0x100];
 
-static inline int16_t uo_tuning_position_evaluate(uo_position *position)
-{
-  int16_t score = uo_score_tempo;
+  uint64_t rand_state = params->seed + thread->index;
 
-  // opening & middle game
-  int32_t score_mg = 0;
+  uo_atomic_unlock(&thread->busy);
 
-  // endgame
-  int32_t score_eg = 0;
+  while (uo_atomic_increment(&params->claimed) <= (int)params->game_count)
+  {
+    size_t record_count;
+    int8_t result_white;
+    bool adjudicated;
 
-  uo_bitboard mask_own = position->own;
-  uo_bitboard mask_enemy = position->enemy;
-  uo_bitboard occupied = mask_own | mask_enemy;
-  uo_bitboard empty = ~occupied;
+    do
+    {
+      // Step 1. Play opening
+      record_count = 0;
+      adjudicated = false;
+      result_white = uo_dataset_result_unknown;
+      if (!uo_tuning_selfplay_opening(params->openings, params->opening_count, params->random_plies, position, &rand_state)) continue;
 
-  uo_bitboard own_P = mask_own & position->P;
-  uo_bitboard own_N = mask_own & position->N;
-  uo_bitboard own_B = mask_own & position->B;
-  uo_bitboard own_R = mask_own & position->R;
-  uo_bitboard own_Q = mask_own & position->Q;
-  uo_bitboard own_K = mask_own & position->K;
+      int win_plies = 0;
+      int loss_plies = 0;
+      int draw_plies = 0;
 
-  uo_bitboard enemy_P = mask_enemy & position->P;
-  uo_bitboard enemy_N = mask_enemy & position->N;
-  uo_bitboard enemy_B = mask_enemy & position->B;
-  uo_bitboard enemy_R = mask_enemy & position->R;
-  uo_bitboard enemy_Q = mask_enemy & position->Q;
-  uo_bitboard enemy_K = mask_enemy & position->K;
+      while (true)
+      {
+        bool is_white = uo_color(position->flags) == uo_white;
 
-  uo_bitboard attacks_own = uo_position_own_attacks(position);
-  uo_bitboard attacks_enemy = uo_position_enemy_attacks(position);
+        // Step 2. Check whether the game is over by rules or by tablebases
+        int8_t result = uo_tuning_selfplay_result(position, &adjudicated);
+        if (result != uo_dataset_result_unknown)
+        {
+          result_white = is_white ? result : -result;
+          break;
+        }
 
-  uo_square square_own_K = uo_tzcnt(own_K);
-  uo_bitboard attacks_own_K = uo_bitboard_attacks_K(square_own_K);
-  uo_bitboard zone_own_K = attacks_own_K | own_K | attacks_own_K << 8;
-  int attack_units_own = 0;
+        // Step 3. Search the position
+        uo_move bestmove;
+        int16_t score = uo_engine_thread_search(thread, params->depth, params->nodes, &bestmove);
 
-  uo_square square_enemy_K = uo_tzcnt(enemy_K);
-  uo_bitboard attacks_enemy_K = uo_bitboard_attacks_K(square_enemy_K);
-  uo_bitboard zone_enemy_K = attacks_enemy_K | enemy_K | attacks_enemy_K >> 8;
-  int attack_units_enemy = 0;
+        // Checkmate or stalemate
+        if (!bestmove)
+        {
+          result = uo_position_is_check(position) ? -1 : 0;
+          result_white = is_white ? result : -result;
+          break;
+        }
 
-  uo_bitboard pushes_own_P = uo_bitboard_single_push_P(own_P, empty) | uo_bitboard_double_push_P(own_P, empty);
-  uo_bitboard pushes_enemy_P = uo_bitboard_single_push_enemy_P(enemy_P, empty) | uo_bitboard_double_push_enemy_P(enemy_P, empty);
+        // Unbalanced opening, start again
+        if (record_count == 0 && (score > uo_selfplay_win_score || score < -uo_selfplay_win_score)) break;
 
-  uo_bitboard attacks_left_own_P = uo_bitboard_attacks_left_P(own_P);
-  uo_bitboard attacks_right_own_P = uo_bitboard_attacks_right_P(own_P);
-  uo_bitboard attacks_own_P = attacks_left_own_P | attacks_right_own_P;
+        // Step 4. Record position and score
+        if (uo_dataset_record_pack(position, score, uo_dataset_result_unknown, records + record_count)) ++record_count;
 
-  uo_bitboard attacks_left_enemy_P = uo_bitboard_attacks_left_enemy_P(enemy_P);
-  uo_bitboard attacks_right_enemy_P = uo_bitboard_attacks_right_enemy_P(enemy_P);
-  uo_bitboard attacks_enemy_P = attacks_left_enemy_P | attacks_right_enemy_P;
+        // Step 5. Adjudicate by score
+        int16_t score_white = is_white ? score : -score;
+        win_plies = score_white >= uo_selfplay_win_score ? win_plies + 1 : 0;
+        loss_plies = score_white <= -uo_selfplay_win_score ? loss_plies + 1 : 0;
+        draw_plies = position->root_ply >= uo_selfplay_draw_ply_min && score_white <= uo_selfplay_draw_score && score_white >= -uo_selfplay_draw_score ? draw_plies + 1 : 0;
 
-  uo_bitboard mask_mobility_own = ~(mask_own | attacks_enemy_P);
-  uo_bitboard mask_mobility_enemy = ~(mask_enemy | attacks_own_P);
+        if (win_plies >= uo_selfplay_win_plies || loss_plies >= uo_selfplay_win_plies || draw_plies >= uo_selfplay_draw_plies)
+        {
+          adjudicated = true;
+          result_white = win_plies ? 1 : loss_plies ? -1 : 0;
+          break;
+        }
 
-  int16_t castling_right_own_OO = uo_position_flags_castling_OO(position->flags);
-  int16_t castling_right_own_OOO = uo_position_flags_castling_OOO(position->flags);
-  int16_t castling_right_enemy_OO = uo_position_flags_castling_enemy_OO(position->flags);
-  int16_t castling_right_enemy_OOO = uo_position_flags_castling_enemy_OOO(position->flags);
+        // Step 6. Play best move
+        uo_position_make_move(position, bestmove, 0, 0);
+        uo_position_reset_root(position);
+      }
+    } while (result_white == uo_dataset_result_unknown || record_count == 0);
 
-  // pawns
+    // Step 7. Label recorded positions with the game result from the point of view of the side to move
+    for (size_t i = 0; i < record_count; ++i)
+    {
+      records[i].result = uo_color(records[i].flags) == uo_white ? result_white : -result_white;
+    }
 
-  int count_own_P = uo_popcnt(own_P);
-  score += uo_score_P * count_own_P;
-  int count_enemy_P = uo_popcnt(enemy_P);
-  score -= uo_score_P * count_enemy_P;
+    // Step 8. Write the game. Binary records are written with a single call, which locks the stream.
+    if (params->binary)
+    {
+      fwrite(records, sizeof * records, record_count, params->fp);
+    }
+    else
+    {
+      for (size_t i = 0; i < record_count; ++i)
+      {
+        uo_dataset_record_print_csv(position, records + i, buffer);
+        fputs(buffer, params->fp);
+      }
+    }
 
-  // pawn chains
-  int count_supported_own_P = uo_popcnt(own_P & attacks_own_P);
-  score += uo_score_supported_P * count_supported_own_P;
-  int count_supported_enemy_P = uo_popcnt(enemy_P & attacks_enemy_P);
-  score -= uo_score_supported_P * count_supported_enemy_P;
+    uo_atomic_increment(&params->results[result_white + 1]);
+    if (adjudicated) uo_atomic_increment(&params->adjudicated);
+    int positions = uo_atomic_add(&params->positions, record_count);
+    int games = uo_atomic_increment(&params->games);
 
-  // pawn mobility
+    if (games % 100 == 0)
+    {
+      uo_tuning_selfplay_print_progress(params, games, positions);
+    }
+  }
 
-  int mobility_own_P = uo_popcnt(pushes_own_P) +
-    uo_popcnt(attacks_left_own_P & mask_enemy) +
-    uo_popcnt(attacks_right_own_P & mask_enemy);
-  score += !mobility_own_P * uo_score_zero_mobility_P;
-  score += uo_score_mul_ln(uo_score_mobility_P, mobility_own_P * mobility_own_P);
+  free(records);
 
-  int mobility_enemy_P = uo_popcnt(pushes_enemy_P) +
-    uo_popcnt(attacks_left_enemy_P & mask_own) +
-    uo_popcnt(attacks_right_enemy_P & mask_own);
-  score -= !mobility_enemy_P * uo_score_zero_mobility_P;
-  score -= uo_score_mul_ln(uo_score_mobility_P, mobility_enemy_P * mobility_enemy_P);
+  uo_semaphore_release(params->semaphore);
 
-  uo_bitboard temp;
+  return NULL;
+}
 
-  // bitboards marking attacked squares by pieces of the same type
+void uo_tuning_generate_selfplay(char *dataset_filepath, char *openings_filepath, size_t game_count, size_t random_plies, size_t depth, size_t nodes)
+{
+  if (!dataset_filepath || !game_count) return;
 
-  uo_bitboard supported_contact_check_by_R = 0;
-  uo_bitboard supported_contact_check_by_Q = 0;
+  // Step 1. Load opening positions
+  uo_file_mmap *file_mmap = NULL;
+  char **openings = NULL;
+  size_t opening_count = 0;
 
-  // knights
-  temp = own_N;
-  while (temp)
+  if (openings_filepath)
   {
-    uo_square square_own_N = uo_bitboard_next_square(&temp);
-    uo_bitboard attacks_own_N = uo_bitboard_attacks_N(square_own_N);
-
-    int mobility_own_N = uo_popcnt(mask_mobility_own & attacks_own_N);
-    score += uo_score_mobility_N(mobility_own_N);
+    file_mmap = uo_file_mmap_open_read(openings_filepath);
+    if (!file_mmap)
+    {
+      printf("Unable to open file '%s'\n", openings_filepath);
+      return;
+    }
 
-    score += uo_score_N;
+    openings = uo_file_mmap_readlines(file_mmap, &opening_count);
+  }
 
-    attack_units_own += uo_popcnt(attacks_own_N & zone_enemy_K) * uo_attack_unit_N;
+  // Step 2. Open dataset file
+  bool binary = uo_dataset_filepath_is_binary(dataset_filepath);
+  FILE *fp = binary ? uo_dataset_open_append(dataset_filepath) : fopen(dataset_filepath, "a");
+  if (!fp)
+  {
+    printf("Unable to open file '%s'\n", dataset_filepath);
+    free(openings);
+    if (file_mmap) uo_file_mmap_close(file_mmap);
+    return;
   }
 
-  temp = enemy_N;
-  while (temp)
+  uo_tuning_generate_selfplay_params params = {
+    .fp = fp,
+    .binary = binary,
+    .openings = openings,
+    .opening_count = opening_count,
+    .game_count = game_count,
+    .random_plies = random_plies,
+    .depth = depth,
+    .nodes = nodes,
+    .seed = time(NULL),
+    .semaphore = uo_semaphore_create(0)
+  };
+
+  uo_atomic_init(&params.claimed, 0);
+  uo_atomic_init(&params.games, 0);
+  uo_atomic_init(&params.positions, 0);
+  uo_atomic_init(&params.results[0], 0);
+  uo_atomic_init(&params.results[1], 0);
+  uo_atomic_init(&params.results[2], 0);
+  uo_atomic_init(&params.adjudicated, 0);
+
+  uo_time_now(&params.time_start);
+
+  // Step 3. Play games on each thread of the engine thread pool
+  uo_atomic_store(&engine.stopped, 0);
+
+  for (size_t i = 0; i < engine.thread_count; ++i)
   {
-    uo_square square_enemy_N = uo_bitboard_next_square(&temp);
-    uo_bitboard attacks_enemy_N = uo_bitboard_attacks_N(square_enemy_N);
+    uo_engine_run_thread(uo_tuning_generate_selfplay_thread_run, &params);
+  }
 
-    int mobility_enemy_N = uo_popcnt(mask_mobility_enemy & attacks_enemy_N);
-    score -= uo_score_mobility_N(mobility_enemy_N);
+  // Step 4. Wait for games to finish
+  for (size_t i = 0; i < engine.thread_count; ++i)
+  {
+    uo_semaphore_wait(params.semaphore);
+  }
 
-    score -= uo_score_N;
+  uo_engine_stop_search();
 
-    attack_units_enemy += uo_popcnt(attacks_enemy_N & zone_own_K) * uo_attack_unit_N;
-  }
+  uo_tuning_selfplay_print_progress(&params, uo_atomic_load(&params.games), uo_atomic_load(&params.positions));
 
+  uo_semaphore_destroy(params.semaphore);
+  fclose(fp);
+  free(openings);
+  if (file_mmap) uo_file_mmap_close(file_mmap);
+}
 
-  // bishops
-  temp = own_B;
-  while (temp)
-  {
-    uo_square square_own_B = uo_bitboard_next_square(&temp);
-    uo_bitboard attacks_own_B = uo_bitboard_attacks_B(square_own_B, occupied);
+// SPSA tuning of search parameters. Each iteration perturbs all parameters at once by plus or minus the perturbation size,
+// plays a pair of games between the two perturbed parameter sets from the same opening with colors swapped and moves the
+// parameters in the direction of the winning side. Gain sequences follow the usual choices of Spall, and the final perturbation
+// size and learning rate of each parameter are set relative to the range of the parameter. Iterations are run concurrently
+// on the engine threads, so that each thread applies its update as soon as its game pair is finished.
+#define uo_spsa_alpha 0.602
+#define uo_spsa_gamma 0.101
+#define uo_spsa_c_end_divisor 20.0
+#define uo_spsa_r_end 0.002
+#define uo_spsa_hash_size 16
+
+typedef struct uo_tuning_spsa_params
+{
+  char **openings;
+  size_t opening_count;
+  size_t random_plies;
+  size_t depth;
+  size_t nodes;
+  size_t pair_count;
+  uint64_t seed;
+  uo_mutex *mutex;
+  double theta[uo_search_parameter_count];
+  double a[uo_search_parameter_count];
+  double c[uo_search_parameter_count];
+  double A;
+  uo_time time_start;
+  volatile uo_atomic_int claimed;
+  volatile uo_atomic_int games;
+  volatile uo_atomic_int results[3]; // losses, draws and wins of the positively perturbed parameters
+  uo_semaphore *semaphore;
+} uo_tuning_spsa_params;
+
+static inline void uo_tuning_spsa_print_progress(uo_tuning_spsa_params *params, int games)
+{
+  double time_msec = uo_time_elapsed_msec(&params->time_start);
 
-    int mobility_own_B = uo_popcnt(mask_mobility_own & attacks_own_B);
-    score += uo_score_mobility_B(mobility_own_B);
+  printf("games: %d (+%d =%d -%d), games per second: %.2f\n",
+    games, uo_atomic_load(&params->results[2]), uo_atomic_load(&params->results[1]), uo_atomic_load(&params->results[0]),
+    games / time_msec * 1000.0);
+  fflush(stdout);
+}
 
-    score += uo_score_B;
+static void uo_tuning_spsa_print_parameters(uo_tuning_spsa_params *params)
+{
+  uo_mutex_lock(params->mutex);
 
-    attack_units_own += uo_popcnt(attacks_own_B & zone_enemy_K) * uo_attack_unit_B;
+  for (size_t i = 0; i < uo_search_parameter_count; ++i)
+  {
+    printf("setoption name %s value %.0f\n", uo_search_parameter_options[i].name, params->theta[i]);
   }
 
-  temp = enemy_B;
-  while (temp)
-  {
-    uo_square square_enemy_B = uo_bitboard_next_square(&temp);
-    uo_bitboard attacks_enemy_B = uo_bitboard_attacks_B(square_enemy_B, occupied);
+  uo_mutex_unlock(params->mutex);
+  fflush(stdout);
+}
 
-    int mobility_enemy_B = uo_popcnt(mask_mobility_enemy & attacks_enemy_B);
-    score -= uo_score_mobility_B(mobility_enemy_B);
+// Plays a game from the given position. Returns the result from white's point of view.
+static int8_t uo_tuning_spsa_play_game(uo_engine_thread *thread, uo_tuning_spsa_params *params, const char *fen,
+  const uo_search_parameters *parameters_white, const uo_search_parameters *parameters_black,
+  uo_ttable *ttable_white, uo_ttable *ttable_black)
+{
+  uo_position *position = &thread->position;
+  uo_position_from_fen(position, fen);
 
-    score -= uo_score_B;
+  // Entries searched with the parameters of one side must not be probed by the other side or by later games
+  uo_ttable_clear(ttable_white);
+  uo_ttable_clear(ttable_black);
 
-    attack_units_enemy += uo_popcnt(attacks_enemy_B & zone_own_K) * uo_attack_unit_B;
-  }
+  int win_plies = 0;
+  int loss_plies = 0;
+  int draw_plies = 0;
 
-  // rooks
-  temp = own_R;
-  while (temp)
+  while (true)
   {
-    uo_square square_own_R = uo_bitboard_next_square(&temp);
-    uo_bitboard attacks_own_R = uo_bitboard_attacks_R(square_own_R, occupied);
+    bool is_white = uo_color(position->flags) == uo_white;
 
-    int mobility_own_R = uo_popcnt(mask_mobility_own & attacks_own_R);
-    score += uo_score_mobility_R(mobility_own_R);
+    // Step 1. Check whether the game is over by rules or by tablebases
+    bool adjudicated = false;
+    int8_t result = uo_tuning_selfplay_result(position, &adjudicated);
+    if (result != uo_dataset_result_unknown) return is_white ? result : -result;
 
-    score += uo_score_R;
+    // Step 2. Search the position using the parameters and the transposition table of the side to move
+    thread->search_parameters = is_white ? parameters_white : parameters_black;
+    thread->ttable = is_white ? ttable_white : ttable_black;
 
-    attack_units_own += uo_popcnt(attacks_own_R & zone_enemy_K) * uo_attack_unit_R;
-  }
+    uo_move bestmove;
+    int16_t score = uo_engine_thread_search(thread, params->depth, params->nodes, &bestmove);
 
-  temp = enemy_R;
-  while (temp)
-  {
-    uo_square square_enemy_R = uo_bitboard_next_square(&temp);
-    uo_bitboard attacks_enemy_R = uo_bitboard_attacks_R(square_enemy_R, occupied);
+    // Checkmate or stalemate
+    if (!bestmove)
+    {
+      result = uo_position_is_check(position) ? -1 : 0;
+      return is_white ? result : -result;
+    }
 
-    int mobility_enemy_R = uo_popcnt(mask_mobility_enemy & attacks_enemy_R);
-    score -= uo_score_mobility_R(mobility_enemy_R);
+    // Step 3. Adjudicate by score
+    int16_t score_white = is_white ? score : -score;
+    win_plies = score_white >= uo_selfplay_win_score ? win_plies + 1 : 0;
+    loss_plies = score_white <= -uo_selfplay_win_score ? loss_plies + 1 : 0;
+    draw_plies = position->root_ply >= uo_selfplay_draw_ply_min && score_white <= uo_selfplay_draw_score && score_white >= -uo_selfplay_draw_score ? draw_plies + 1 : 0;
 
-    score -= uo_score_R;
+    if (win_plies >= uo_selfplay_win_plies) return 1;
+    if (loss_plies >= uo_selfplay_win_plies) return -1;
+    if (draw_plies >= uo_selfplay_draw_plies) return 0;
 
-    attack_units_enemy += uo_popcnt(attacks_enemy_R & zone_own_K) * uo_attack_unit_R;
+    // Step 4. Play best move
+    uo_position_make_move(position, bestmove, 0, 0);
+    uo_position_reset_root(position);
   }
+}
 
-  // queens
-  temp = own_Q;
-  while (temp)
+static void *uo_tuning_spsa_thread_run(void *arg)
+{
+  uo_engine_thread *thread = arg;
+  uo_tuning_spsa_params *params = thread->data;
+  uo_search_parameters parameters_plus;
+  uo_search_parameters parameters_minus;
+  int *plus = (int *)&parameters_plus;
+  int *minus = (int *)&parameters_minus;
+  double c_k[uo_search_parameter_count];
+  int delta[uo_search_parameter_count];
+  char fen[0x100];
+  uo_ttable ttable_plus;
+  uo_ttable ttable_minus;
+
+  uint64_t rand_state = params->seed + thread->index;
+
+  size_t capacity = uo_spsa_hash_size * (size_t)1000000 / sizeof * ttable_plus.entries;
+  uo_ttable_init(&ttable_plus, uo_msb(capacity) + 1);
+  uo_ttable_init(&ttable_minus, uo_msb(capacity) + 1);
+
+  uo_atomic_unlock(&thread->busy);
+
+  int k;
+  while ((k = uo_atomic_increment(&params->claimed)) <= (int)params->pair_count)
   {
-    uo_square square_own_Q = uo_bitboard_next_square(&temp);
-    uo_bitboard attacks_own_Q = uo_bitboard_attacks_Q(square_own_Q, occupied);
+    // Step 1. Perturb parameters in random directions. Perturbed values are rounded randomly, so that the expected value
+    //         is not biased also when the perturbation is smaller than one.
+    uo_mutex_lock(params->mutex);
 
-    int mobility_own_Q = uo_popcnt(mask_mobility_own & attacks_own_Q);
-    score += uo_score_mobility_Q(mobility_own_Q);
+    for (size_t i = 0; i < uo_search_parameter_count; ++i)
+    {
+      const uo_search_parameter_option *option = uo_search_parameter_options + i;
+      c_k[i] = params->c[i] / pow(k, uo_spsa_gamma);
+      delta[i] = uo_rand_u64_r(&rand_state) & 1 ? 1 : -1;
+
+      double value_plus = params->theta[i] + c_k[i] * delta[i] + uo_rand_percent_excl_r(&rand_state);
+      double value_minus = params->theta[i] - c_k[i] * delta[i] + uo_rand_percent_excl_r(&rand_state);
+      plus[i] = uo_max(option->min, uo_min(option->max, (int)floor(value_plus)));
+      minus[i] = uo_max(option->min, uo_min(option->max, (int)floor(value_minus)));
+    }
 
-    score += uo_score_Q;
+    uo_mutex_unlock(params->mutex);
 
-    attack_units_own += uo_popcnt(attacks_own_Q & zone_enemy_K) * uo_attack_unit_Q;
-  }
+    // Step 2. Play opening. Both games of the pair start from the same position.
+    while (!uo_tuning_selfplay_opening(params->openings, params->opening_count, params->random_plies, &thread->position, &rand_state));
+    uo_position_print_fen(&thread->position, fen);
 
-  temp = enemy_Q;
-  while (temp)
-  {
-    uo_square square_enemy_Q = uo_bitboard_next_square(&temp);
-    uo_bitboard attacks_enemy_Q = uo_bitboard_attacks_Q(square_enemy_Q, occupied);
+    // Step 3. Play the game pair with colors swapped
+    int8_t result_first = uo_tuning_spsa_play_game(thread, params, fen, &parameters_plus, &parameters_minus, &ttable_plus, &ttable_minus);
+    int8_t result_second = -uo_tuning_spsa_play_game(thread, params, fen, &parameters_minus, &parameters_plus, &ttable_minus, &ttable_plus);
+    int result = result_first + result_second;
 
-    int mobility_enemy_Q = uo_popcnt(mask_mobility_enemy & attacks_enemy_Q);
-    score -= uo_score_mobility_Q(mobility_enemy_Q);
+    uo_atomic_increment(&params->results[result_first + 1]);
+    uo_atomic_increment(&params->results[result_second + 1]);
 
-    score -= uo_score_Q;
+    // Step 4. Update parameters towards the winning side
+    double a_k = 1.0 / pow(k + params->A, uo_spsa_alpha);
 
-    attack_units_enemy += uo_popcnt(attacks_enemy_Q & zone_own_K) * uo_attack_unit_Q;
-  }
+    uo_mutex_lock(params->mutex);
 
-  // king safety
+    for (size_t i = 0; i < uo_search_parameter_count; ++i)
+    {
+      const uo_search_parameter_option *option = uo_search_parameter_options + i;
+      double theta = params->theta[i] + params->a[i] * a_k / c_k[i] * result * delta[i];
+      params->theta[i] = uo_max((double)option->min, uo_min((double)option->max, theta));
+    }
 
-  uo_bitboard undefended_zone_own_K = uo_andn(attacks_own, zone_own_K);
-  uo_bitboard undefended_zone_enemy_K = uo_andn(attacks_enemy, zone_enemy_K);
+    uo_mutex_unlock(params->mutex);
 
-  supported_contact_check_by_R |= own_R & attacks_own & (attacks_enemy_K & uo_bitboard_attacks_R(square_enemy_K, 0));
-  attack_units_own += uo_popcnt(supported_contact_check_by_R & undefended_zone_enemy_K) * uo_attack_unit_supported_contact_R;
+    int games = uo_atomic_add(&params->games, 2);
 
-  supported_contact_check_by_Q |= own_Q & attacks_own & attacks_enemy_K;
-  attack_units_own += uo_popcnt(supported_contact_check_by_Q & undefended_zone_enemy_K) * uo_attack_unit_supported_contact_Q;
+    if (games % 100 == 0)
+    {
+      uo_tuning_spsa_print_progress(params, games);
+    }
 
-  assert(attack_units_own < 100);
-  score += uo_score_attacks_to_K(attack_units_own);
+    if (games % 1000 == 0)
+    {
+      uo_tuning_spsa_print_parameters(params);
+    }
+  }
 
-  assert(attack_units_enemy < 100);
-  score -= uo_score_attacks_to_K(attack_units_enemy);
+  uo_ttable_free(&ttable_plus);
+  uo_ttable_free(&ttable_minus);
 
-  int mobility_own_K = uo_popcnt(uo_andn(attacks_enemy_K | attacks_enemy, attacks_own_K));
-  score += uo_score_zero_mobility_K * !mobility_own_K;
+  uo_semaphore_release(params->semaphore);
 
-  int mobility_enemy_K = uo_popcnt(uo_andn(attacks_own_K | attacks_own, attacks_enemy_K));
-  score -= uo_score_zero_mobility_K * !mobility_enemy_K;
+  return NULL;
+}
 
-  score += uo_score_king_cover_pawn * (int32_t)uo_popcnt(attacks_own_K & own_P);
-  score -= uo_score_king_cover_pawn * (int32_t)uo_popcnt(attacks_enemy_K & enemy_P);
+void uo_tuning_tune_search_parameters(char *openings_filepath, size_t game_count, size_t random_plies, size_t depth, size_t nodes)
+{
+  if (game_count < 2) return;
 
-  // flip middle game pawn square scores if own king is on queen side and
-  // flip end game pawn square scores if enemy king is on queen side
-  uint8_t flip_if_own_K_queenside = (uo_square_file(square_own_K) < 4) * 7;
-  uint8_t flip_if_enemy_K_queenside = (uo_square_file(square_enemy_K) < 4) * 7;
+  // Step 1. Load opening positions
+  uo_file_mmap *file_mmap = NULL;
+  char **openings = NULL;
+  size_t opening_count = 0;
 
-  // pawns
-  temp = own_P;
-  while (temp)
+  if (openings_filepath)
   {
-    uo_square square_own_P = uo_bitboard_next_square(&temp);
-
-    // isolated pawns
-    bool is_isolated_P = !(uo_square_bitboard_adjecent_files[square_own_P] & own_P);
-    score += is_isolated_P * uo_score_isolated_P;
+    file_mmap = uo_file_mmap_open_read(openings_filepath);
+    if (!file_mmap)
+    {
+      printf("Unable to open file '%s'\n", openings_filepath);
+      return;
+    }
 
-    score_mg += uo_score_mg_P(square_own_P ^ flip_if_own_K_queenside);
-    score_eg += uo_score_eg_P(square_own_P ^ flip_if_enemy_K_queenside);
+    openings = uo_file_mmap_readlines(file_mmap, &opening_count);
   }
 
-  temp = enemy_P;
-  while (temp)
+  // Step 2. Initialize parameters from the engine options and gain sequences from the parameter ranges
+  size_t pair_count = game_count / 2;
+
+  uo_tuning_spsa_params params = {
+    .openings = openings,
+    .opening_count = opening_count,
+    .random_plies = random_plies,
+    .depth = depth,
+    .nodes = nodes,
+    .pair_count = pair_count,
+    .seed = time(NULL),
+    .mutex = uo_mutex_create(),
+    .A = pair_count * 0.1,
+    .semaphore = uo_semaphore_create(0)
+  };
+
+  const int *theta = (const int *)&engine_options.search_parameters;
+
+  for (size_t i = 0; i < uo_search_parameter_count; ++i)
   {
-    uo_square square_flipped_enemy_P = uo_bitboard_next_square(&temp) ^ 56;
-
-    // isolated pawns
-    bool is_isolated_P = !(uo_square_bitboard_adjecent_files[square_flipped_enemy_P] & enemy_P);
-    score -= is_isolated_P * uo_score_isolated_P;
+    const uo_search_parameter_option *option = uo_search_parameter_options + i;
+    double c_end = (option->max - option->min) / uo_spsa_c_end_divisor;
+    double a_end = uo_spsa_r_end * c_end * c_end;
 
-    score_mg -= uo_score_mg_P(square_flipped_enemy_P ^ flip_if_enemy_K_queenside);
-    score_eg -= uo_score_eg_P(square_flipped_enemy_P ^ flip_if_own_K_queenside);
+    params.theta[i] = theta[i];
+    params.c[i] = c_end * pow(pair_count, uo_spsa_gamma);
+    params.a[i] = a_end * pow(params.A + pair_count, uo_spsa_alpha);
   }
 
-  // passed pawns
-  temp = own_P & uo_bitboard_rank_fifth;
-  while (temp)
-  {
-    uo_square square_own_P = uo_bitboard_next_square(&temp);
-    score += uo_score_passed_pawn_on_fifth * uo_bitboard_is_passed_P(square_own_P, enemy_P);
-  }
-  temp = own_P & uo_bitboard_rank_sixth;
-  while (temp)
-  {
-    uo_square square_own_P = uo_bitboard_next_square(&temp);
-    score += uo_score_passed_pawn_on_sixth * uo_bitboard_is_passed_P(square_own_P, enemy_P);
-  }
+  uo_atomic_init(&params.claimed, 0);
+  uo_atomic_init(&params.games, 0);
+  uo_atomic_init(&params.results[0], 0);
+  uo_atomic_init(&params.results[1], 0);
+  uo_atomic_init(&params.results[2], 0);
+
+  uo_time_now(&params.time_start);
+
+  // Step 3. Play game pairs on each thread of the engine thread pool
+  uo_atomic_store(&engine.stopped, 0);
 
-  temp = enemy_P & uo_bitboard_rank_fourth;
-  while (temp)
+  for (size_t i = 0; i < engine.thread_count; ++i)
   {
-    uo_square square_enemy_P = uo_bitboard_next_square(&temp);
-    score -= uo_score_passed_pawn_on_fifth * uo_bitboard_is_passed_enemy_P(square_enemy_P, own_P);
+    uo_engine_run_thread(uo_tuning_spsa_thread_run, &params);
   }
-  temp = enemy_P & uo_bitboard_rank_third;
-  while (temp)
+
+  // Step 4. Wait for games to finish
+  for (size_t i = 0; i < engine.thread_count; ++i)
   {
-    uo_square square_enemy_P = uo_bitboard_next_square(&temp);
-    score -= uo_score_passed_pawn_on_sixth * uo_bitboard_is_passed_enemy_P(square_enemy_P, own_P);
+    uo_semaphore_wait(params.semaphore);
   }
 
-  // castling rights
-  score_mg += uo_score_casting_right * (castling_right_own_OO + castling_right_own_OOO - castling_right_enemy_OO - castling_right_enemy_OOO);
+  uo_engine_stop_search();
+
+  uo_tuning_spsa_print_progress(&params, uo_atomic_load(&params.games));
+  uo_tuning_spsa_print_parameters(&params);
 
-  bool both_rooks_undeveloped_own = uo_popcnt(own_R & (uo_square_bitboard(uo_square__a1) | uo_square_bitboard(uo_square__h1))) == 2;
-  bool both_rooks_undeveloped_enemy = uo_popcnt(enemy_R & (uo_square_bitboard(uo_square__a8) | uo_square_bitboard(uo_square__h8))) == 2;
+  uo_semaphore_destroy(params.semaphore);
+  uo_mutex_destroy(params.mutex);
+  free(openings);
+  if (file_mmap) uo_file_mmap_close(file_mmap);
+}
 
-  score_mg += uo_score_rook_stuck_in_corner * both_rooks_undeveloped_own * !(castling_right_own_OO + castling_right_own_OOO);
-  score_mg -= uo_score_rook_stuck_in_corner * both_rooks_undeveloped_enemy * !(castling_right_enemy_OO + castling_right_enemy_OOO);
+// Dataset preprocessing runs in two passes, so that datasets larger than memory can be processed. First, positions are
+// resolved and written to temporary bucket files chosen by a seeded hash of the key. Then each bucket is loaded to memory,
+// deduplicated and shuffled in turn and appended to the output. Bucket sizes are set by the memory limit. Positions of
+// equal keys fall into the same bucket, and buckets are random subsets of the positions, so that the output is shuffled.
+#define uo_preprocess_chunk_records 0x1000
+#define uo_preprocess_chunk_bytes 0x40000
+#define uo_preprocess_buffer_entries 0x100
+#define uo_preprocess_bucket_count_max 0x100
+#define uo_preprocess_entry_memory 80 // bytes per entry in memory including hash set
+#define uo_preprocess_csv_line_estimate 64
+
+// Concurrent hash set of keys. Keys are distributed to shards by their high bits, and each shard is an open addressing
+// table guarded by a spin lock. Zero is reserved for empty slots.
+#define uo_preprocess_key_set_shard_bits 10
+#define uo_preprocess_key_set_shard_count (1 << uo_preprocess_key_set_shard_bits)
+
+typedef struct uo_preprocess_key_set
+{
+  uint64_t *keys;
+  size_t shard_capacity;
+  uo_atomic_flag locks[uo_preprocess_key_set_shard_count];
+} uo_preprocess_key_set;
 
-  // king safety
-  score_mg += (uo_score_king_in_the_center * (0 != (own_K & (uo_bitboard_file(2) | uo_bitboard_file(3) | uo_bitboard_file(4) | uo_bitboard_file(5)))))
-    - (uo_score_king_in_the_center * (0 != (enemy_K & (uo_bitboard_file(2) | uo_bitboard_file(3) | uo_bitboard_file(4) | uo_bitboard_file(5)))));
+// Returns false if the key was already in the set
+static bool uo_preprocess_key_set_insert(uo_preprocess_key_set *set, uint64_t key)
+{
+  size_t shard = key >> (64 - uo_preprocess_key_set_shard_bits);
+  size_t mask = set->shard_capacity - 1;
+  uint64_t *slots = set->keys + shard * set->shard_capacity;
+  size_t i = key & mask;
+  bool inserted = true;
 
-  score_mg += (uo_score_castled_king * (square_own_K == uo_square__g1))
-    - (uo_score_castled_king * (square_enemy_K == uo_square__g8));
+  uo_atomic_lock(&set->locks[shard]);
 
-  score_mg += (uo_score_castled_king * (square_own_K == uo_square__b1))
-    - (uo_score_castled_king * (square_enemy_K == uo_square__b8));
+  while (slots[i])
+  {
+    if (slots[i] == key)
+    {
+      inserted = false;
+      break;
+    }
 
-  int32_t material_percentage = uo_position_material_percentage(position);
+    i = (i + 1) & mask;
+  }
 
-  score += score_mg * material_percentage / 100;
-  score += score_eg * (100 - material_percentage) / 100;
+  if (inserted) slots[i] = key;
 
-  assert(score < uo_score_tb_win_threshold && score > -uo_score_tb_win_threshold);
+  uo_atomic_unlock(&set->locks[shard]);
 
-  return score;
+  return inserted;
 }
 
+// Resolved position and its key. Zero key marks a duplicate.
+typedef struct uo_preprocess_entry
+{
+  uint64_t key;
+  uo_dataset_record record;
+} uo_preprocess_entry;
 
-bool uo_tuning_train_evaluation_parameters(char *dataset_filepath)
+typedef struct uo_tuning_preprocess_params
 {
-  if (!dataset_filepath)
-  {
-    return false;
-  }
+  // input
+  uo_dataset *dataset;
+  uo_file_mmap *file_mmap;
+  size_t chunk_count;
+
+  // buckets
+  FILE **buckets;
+  size_t bucket_count;
+  int bucket_bits;
+  uint64_t seed;
+  volatile uo_atomic_int bucket_sizes[uo_preprocess_bucket_count_max];
+
+  // bucket being deduplicated
+  uo_preprocess_entry *entries;
+  size_t entry_count;
+  uo_preprocess_key_set *key_set;
+
+  uo_time time_start;
+  volatile uo_atomic_int claimed;
+  volatile uo_atomic_int positions;
+  volatile uo_atomic_int dropped;
+  volatile uo_atomic_int duplicates;
+  uo_semaphore *semaphore;
+} uo_tuning_preprocess_params;
+
+static inline size_t uo_tuning_preprocess_bucket(uo_tuning_preprocess_params *params, uint64_t key)
+{
+  return params->bucket_bits
+    ? ((key ^ params->seed) * 0x9E3779B97F4A7C15) >> (64 - params->bucket_bits)
+    : 0;
+}
 
-  uo_file_mmap *file_mmap = uo_file_mmap_open_read(dataset_filepath);
-  if (!file_mmap)
-  {
-    return false;
-  }
+// Replaces the position of a record with the leaf of its quiescence search principal variation. Score and result
+// are kept and adjusted to the side to move of the leaf. Returns false if the leaf is not quiescent.
+static bool uo_tuning_preprocess_resolve(uo_engine_thread *thread, const uo_dataset_record *record, uo_preprocess_entry *entry)
+{
+  uo_position *position = &thread->position;
 
-  printf("Initial tuning parameters:\n");
-  for (size_t i = 0; i < uo_tuning_param_count; ++i)
+  // Step 1. Load position
+  uo_position_packed packed;
+  uo_dataset_record_unpack(record, &packed);
+  uo_position_unpack(position, &packed);
+  position->root_ply = record->ply;
+
+  // Step 2. Quiescence search
+  if (uo_engine_thread_quiesce(thread) == uo_score_unknown) return false;
+
+  // Step 3. Play principal variation. Moves are checked to be legal in case of a key collision in the transposition table.
+  const uo_move *pv = thread->pv_table[0];
+  size_t ply = 0;
+  bool is_quiescent = true;
+
+  for (; pv[ply]; ++ply)
   {
-    tuning_param_infos[i] = (uo_tuning_param_info){
-      .increment = i % 1 == 0 ? 1 : -1,
-      .mse = 0.0,
-      .aimd_double = true
-    };
-    printf("  param[%4zu]: %4d\n", i, tuning_params[i]);
+    size_t move_count = uo_position_generate_moves(position);
+    size_t i = 0;
+    while (i < move_count && position->movelist.head[i] != pv[ply]) ++i;
+
+    if (i == move_count)
+    {
+      is_quiescent = false;
+      break;
+    }
+
+    uo_position_make_move(position, pv[ply], 0, 0);
   }
-  printf("\n");
-  fflush(stdout);
 
-  uo_position position;
-  double prev_mse = 1.1;
-  double mse = 1.0;
+  // Step 4. Principal variation may end early on a transposition table hit or when the position is in check
+  is_quiescent = is_quiescent && uo_position_is_quiescent(position);
 
-  for (size_t iter = 0; mse < prev_mse && iter < 1000; ++iter)
+  // Step 5. Pack the leaf position
+  if (is_quiescent)
   {
-    prev_mse = mse;
-    mse = 0.0;
+    int16_t score = record->score;
+    int8_t result = record->result;
 
-    double count = 0.0;
-    char *line = uo_file_mmap_readline(file_mmap);
-
-    while (line && *line)
+    if (ply & 1)
     {
-      uo_position_from_fen(&position, line);
-      uint8_t color = uo_color(position.flags);
+      score = -score;
+      if (result != uo_dataset_result_unknown) result = -result;
+    }
 
-      char *eval = strchr(line, ',') + 1;
+    uo_dataset_record_pack(position, score, result, &entry->record);
+    entry->key = position->key ? position->key : 1;
+  }
 
-      double q_score_expected = 1.0;
+  // Step 6. Unmake moves, so that move history beyond the root is left cleared for the next position
+  while (ply--) uo_position_unmake_move(position);
 
-      // Forced mate detected
-      if (eval[0] == '#')
-      {
-        if (eval[1] == '-') q_score_expected = -q_score_expected;
-        if (color == uo_black) q_score_expected = -q_score_expected;
-      }
-      else
-      {
-        char *end;
-        double cp_expected = (double)strtol(eval, &end, 10);
-        if (color == uo_black) cp_expected = -cp_expected;
-        q_score_expected = uo_score_centipawn_to_q_score(cp_expected);
-      }
+  return is_quiescent;
+}
 
-      count = count + 1.0;
-      double cp_actual = uo_tuning_position_evaluate(&position);
-      double q_score_actual = uo_score_centipawn_to_q_score(cp_actual);
-      double diff = q_score_expected - q_score_actual;
-      mse = mse * (count - 1.0) / count + diff * diff / count;
+static inline void uo_tuning_preprocess_flush_bucket(uo_tuning_preprocess_params *params, size_t bucket, uo_preprocess_entry *buffer, size_t count)
+{
+  // Entries are written with a single call, which locks the stream
+  fwrite(buffer, sizeof * buffer, count, params->buckets[bucket]);
+  uo_atomic_add(&params->bucket_sizes[bucket], count);
+}
 
-      for (size_t i = 0; i < uo_tuning_param_count; ++i)
-      {
-        tuning_params[i] += tuning_param_infos[i].increment;
-        double cp_actual = uo_tuning_position_evaluate(&position);
-        tuning_params[i] -= tuning_param_infos[i].increment;
+static void *uo_tuning_preprocess_resolve_thread_run(void *arg)
+{
+  uo_engine_thread *thread = arg;
+  uo_tuning_preprocess_params *params = thread->data;
+  uo_preprocess_entry *buffers = malloc(params->bucket_count * uo_preprocess_buffer_entries * sizeof * buffers);
+  size_t *buffer_counts = calloc(params->bucket_count, sizeof * buffer_counts);
+  uo_position *position_csv = malloc(sizeof * position_csv);
+  char line[0x100];
 
-        double q_score_actual = uo_score_centipawn_to_q_score(cp_actual);
-        double diff = q_score_expected - q_score_actual;
-        tuning_param_infos[i].mse = tuning_param_infos[i].mse * (count - 1.0) / count + diff * diff / count;
-      }
+  uo_atomic_unlock(&thread->busy);
 
-      line = uo_file_mmap_readline(file_mmap);
+  size_t chunk;
+  while ((chunk = uo_atomic_increment(&params->claimed) - 1) < params->chunk_count)
+  {
+    int positions = 0;
+    int dropped = 0;
+    uo_dataset_record record_csv;
+    const uo_dataset_record *record = NULL;
+
+    // Step 1. Chunk of a binary dataset is a range of records, and chunk of a csv dataset is a range of bytes containing
+    // the lines which start within the range
+    const uo_dataset_record *records = NULL;
+    const uo_dataset_record *records_end = NULL;
+    const char *ptr = NULL;
+    const char *ptr_end = NULL;
+    const char *file_end = NULL;
+
+    if (params->dataset)
+    {
+      records = params->dataset->records + chunk * uo_preprocess_chunk_records;
+      records_end = params->dataset->records + uo_min(params->dataset->count, (chunk + 1) * uo_preprocess_chunk_records);
+    }
+    else
+    {
+      file_end = params->file_mmap->ptr + params->file_mmap->size;
+      ptr = params->file_mmap->ptr + chunk * uo_preprocess_chunk_bytes;
+      ptr_end = file_end - ptr > uo_preprocess_chunk_bytes ? ptr + uo_preprocess_chunk_bytes : file_end;
+
+      if (chunk)
+      {
+        const char *newline = memchr(ptr - 1, '\n', file_end - ptr + 1);
+        ptr = newline ? newline + 1 : file_end;
+      }
     }
 
-    printf("Current tuning parameters (iteration %4zu):\n", iter + 1);
-    for (size_t i = 0; i < uo_tuning_param_count; ++i)
+    while (true)
     {
-      if (tuning_param_infos[i].mse < mse)
+      // Step 2. Read next record
+      if (params->dataset)
       {
-        tuning_params[i] += tuning_param_infos[i].increment;
+        if (records == records_end) break;
+        record = records++;
+      }
+      else
+      {
+        if (ptr >= ptr_end) break;
+
+        const char *newline = memchr(ptr, '\n', file_end - ptr);
+        const char *line_end = newline ? newline : file_end;
+        size_t len = line_end - ptr;
+        bool is_too_long = len >= sizeof line;
 
-        if (tuning_param_infos[i].aimd_double)
+        if (!is_too_long)
         {
-          tuning_param_infos[i].increment *= 2;
+          memcpy(line, ptr, len);
+          line[len] = '\0';
         }
-        else
+
+        ptr = line_end + 1;
+        if (len == 0 || (!is_too_long && line[0] == '#')) continue;
+
+        if (is_too_long || !uo_dataset_record_parse_csv(position_csv, line, &record_csv))
         {
-          tuning_param_infos[i].increment += tuning_param_infos[i].increment > 0 ? 1 : -1;
+          ++positions;
+          ++dropped;
+          continue;
         }
+
+        record = &record_csv;
       }
-      else if (tuning_param_infos[i].aimd_double
-        && tuning_param_infos[i].increment != 1
-        && tuning_param_infos[i].increment != -1)
+
+      ++positions;
+
+      // Step 3. Resolve position
+      uo_preprocess_entry entry;
+      if (!uo_tuning_preprocess_resolve(thread, record, &entry))
       {
-        tuning_param_infos[i].increment /= 2;
-        tuning_param_infos[i].aimd_double = false;
+        ++dropped;
+        continue;
       }
-      else if (tuning_param_infos[i].increment == 1)
+
+      // Step 4. Add entry to the buffer of its bucket
+      size_t bucket = uo_tuning_preprocess_bucket(params, entry.key);
+      uo_preprocess_entry *buffer = buffers + bucket * uo_preprocess_buffer_entries;
+      buffer[buffer_counts[bucket]++] = entry;
+
+      if (buffer_counts[bucket] == uo_preprocess_buffer_entries)
       {
-        tuning_param_infos[i].increment = -1;
+        uo_tuning_preprocess_flush_bucket(params, bucket, buffer, buffer_counts[bucket]);
+        buffer_counts[bucket] = 0;
       }
-      else
+    }
+
+    uo_atomic_add(&params->dropped, dropped);
+    int positions_total = uo_atomic_add(&params->positions, positions);
+
+    if (positions_total / 100000 != (positions_total - positions) / 100000)
+    {
+      double time_msec = uo_time_elapsed_msec(&params->time_start);
+      printf("positions read: %d, dropped: %d, positions per second: %.1f\n",
+        positions_total, uo_atomic_load(&params->dropped), positions_total / time_msec * 1000.0);
+      fflush(stdout);
+    }
+  }
+
+  // Step 5. Flush buffers
+  for (size_t bucket = 0; bucket < params->bucket_count; ++bucket)
+  {
+    if (buffer_counts[bucket])
+    {
+      uo_tuning_preprocess_flush_bucket(params, bucket, buffers + bucket * uo_preprocess_buffer_entries, buffer_counts[bucket]);
+    }
+  }
+
+  free(position_csv);
+  free(buffer_counts);
+  free(buffers);
+
+  uo_semaphore_release(params->semaphore);
+
+  return NULL;
+}
+
+static void *uo_tuning_preprocess_deduplicate_thread_run(void *arg)
+{
+  uo_engine_thread *thread = arg;
+  uo_tuning_preprocess_params *params = thread->data;
+
+  uo_atomic_unlock(&thread->busy);
+
+  size_t chunk_count = (params->entry_count + uo_preprocess_chunk_records - 1) / uo_preprocess_chunk_records;
+  int duplicates = 0;
+  size_t chunk;
+
+  while ((chunk = uo_atomic_increment(&params->claimed) - 1) < chunk_count)
+  {
+    uo_preprocess_entry *entry = params->entries + chunk * uo_preprocess_chunk_records;
+    uo_preprocess_entry *entries_end = params->entries + uo_min(params->entry_count, (chunk + 1) * uo_preprocess_chunk_records);
+
+    for (; entry < entries_end; ++entry)
+    {
+      if (!uo_preprocess_key_set_insert(params->key_set, entry->key))
       {
-        tuning_param_infos[i].increment = tuning_param_infos[i].increment > 0 ? -1 : 1;
+        entry->key = 0;
+        ++duplicates;
       }
-
-      printf("  param[%4zu]: %4d, mse: %6.6f, increment: %2d\n", i, tuning_params[i] + tuning_param_infos[i].increment, tuning_param_infos[i].mse, tuning_param_infos[i].increment);
-      tuning_param_infos[i].mse = 0.0;
     }
-    printf("\n");
+  }
 
-    uo_file_mmap_close(file_mmap);
-    file_mmap = uo_file_mmap_open_read(dataset_filepath);
+  uo_atomic_add(&params->duplicates, duplicates);
+
+  uo_semaphore_release(params->semaphore);
+
+  return NULL;
+}
+
+static inline void uo_tuning_preprocess_run_threads(uo_tuning_preprocess_params *params, uo_thread_function function)
+{
+  uo_atomic_store(&params->claimed, 0);
+
+  for (size_t i = 0; i < engine.thread_count; ++i)
+  {
+    uo_engine_run_thread(function, params);
   }
 
-  printf("Final tuning parameters:\n");
-  for (size_t i = 0; i < uo_tuning_param_count; ++i)
+  for (size_t i = 0; i < engine.thread_count; ++i)
   {
-    printf("  param[%4zu]: %4d\n", i, tuning_params[i]);
+    uo_semaphore_wait(params->semaphore);
   }
-  printf("\n");
-  fflush(stdout);
+}
 
-  uo_file_mmap_close(file_mmap);
-  return true;
+void uo_tuning_preprocess_dataset(char *input_filepath, char *output_filepath, size_t memory_mb)
+{
+  if (!input_filepath || !output_filepath) return;
+
+  uo_tuning_preprocess_params params = {
+    .seed = time(NULL),
+    .semaphore = uo_semaphore_create(0)
+  };
+
+  uo_atomic_init(&params.claimed, 0);
+  uo_atomic_init(&params.positions, 0);
+  uo_atomic_init(&params.dropped, 0);
+  uo_atomic_init(&params.duplicates, 0);
+
+  for (size_t i = 0; i < uo_preprocess_bucket_count_max; ++i)
+  {
+    uo_atomic_init(&params.bucket_sizes[i], 0);
+  }
+
+  uo_time_now(&params.time_start);
+
+  size_t bucket_path_len = strlen(output_filepath) + 16;
+  char *bucket_filepath = malloc(bucket_path_len);
+  uo_position *position = malloc(sizeof * position);
+  FILE *fp = NULL;
+  size_t written = 0;
+
+  // Step 1. Open input as binary dataset or as csv file
+  size_t count_estimate;
+  params.dataset = uo_dataset_open_read(input_filepath);
+
+  if (params.dataset)
+  {
+    count_estimate = params.dataset->count;
+    params.chunk_count = (params.dataset->count + uo_preprocess_chunk_records - 1) / uo_preprocess_chunk_records;
+  }
+  else
+  {
+    params.file_mmap = uo_file_mmap_open_read(input_filepath);
+    if (!params.file_mmap)
+    {
+      printf("Unable to open file '%s'\n", input_filepath);
+      goto cleanup;
+    }
+
+    count_estimate = params.file_mmap->size / uo_preprocess_csv_line_estimate;
+    params.chunk_count = (params.file_mmap->size + uo_preprocess_chunk_bytes - 1) / uo_preprocess_chunk_bytes;
+  }
+
+  // Step 2. Open output and bucket files. Number of buckets is a power of two large enough for a bucket to fit in memory.
+  bool binary = uo_dataset_filepath_is_binary(output_filepath);
+  fp = binary ? uo_dataset_open_write(output_filepath) : fopen(output_filepath, "w");
+  if (!fp)
+  {
+    printf("Unable to open file '%s'\n", output_filepath);
+    goto cleanup;
+  }
+
+  size_t memory = uo_max(memory_mb, (size_t)1) << 20;
+  while (((size_t)1 << params.bucket_bits) < uo_preprocess_bucket_count_max
+    && count_estimate * uo_preprocess_entry_memory > memory << params.bucket_bits)
+  {
+    ++params.bucket_bits;
+  }
+
+  params.bucket_count = (size_t)1 << params.bucket_bits;
+  params.buckets = calloc(params.bucket_count, sizeof * params.buckets);
+
+  for (size_t i = 0; i < params.bucket_count; ++i)
+  {
+    snprintf(bucket_filepath, bucket_path_len, "%s.%zu.tmp", output_filepath, i);
+    params.buckets[i] = fopen(bucket_filepath, "w+b");
+    if (!params.buckets[i])
+    {
+      printf("Unable to open file '%s'\n", bucket_filepath);
+      goto cleanup;
+    }
+  }
+
+  // Step 3. Resolve positions to quiescent positions on the engine threads
+  uo_atomic_store(&engine.stopped, 0);
+  uo_tuning_preprocess_run_threads(&params, uo_tuning_preprocess_resolve_thread_run);
+  uo_engine_stop_search();
+
+  int positions = uo_atomic_load(&params.positions);
+  int dropped = uo_atomic_load(&params.dropped);
+  printf("positions read: %d, dropped: %d, buckets: %zu, time: %.1f s\n",
+    positions, dropped, params.bucket_count, uo_time_elapsed_msec(&params.time_start) / 1000.0);
+  fflush(stdout);
+
+  // Step 4. Deduplicate, shuffle and write one bucket at a time
+  size_t entry_capacity = 0;
+  size_t key_set_capacity = 0;
+  params.key_set = malloc(sizeof * params.key_set);
+  params.key_set->keys = NULL;
+
+  for (size_t i = 0; i < uo_preprocess_key_set_shard_count; ++i)
+  {
+    uo_atomic_flag_init(&params.key_set->locks[i]);
+  }
+
+  uo_rand_init(params.seed);
+
+  for (size_t bucket = 0; bucket < params.bucket_count; ++bucket)
+  {
+    // Step 4.1. Load bucket
+    size_t count = uo_atomic_load(&params.bucket_sizes[bucket]);
+    if (count == 0) continue;
+
+    if (count > entry_capacity)
+    {
+      entry_capacity = count;
+      free(params.entries);
+      params.entries = malloc(entry_capacity * sizeof * params.entries);
+    }
+
+    rewind(params.buckets[bucket]);
+    params.entry_count = fread(params.entries, sizeof * params.entries, count, params.buckets[bucket]);
+
+    // Step 4.2. Clear the hash set. Shards are sized for twice the expected number of keys with a margin for uneven distribution.
+    size_t shard_capacity = 0x10;
+    while (shard_capacity < 2 * params.entry_count / uo_preprocess_key_set_shard_count + 0x40) shard_capacity <<= 1;
+
+    if (shard_capacity > key_set_capacity)
+    {
+      key_set_capacity = shard_capacity;
+      free(params.key_set->keys);
+      params.key_set->keys = malloc(key_set_capacity * uo_preprocess_key_set_shard_count * sizeof * params.key_set->keys);
+    }
+
+    params.key_set->shard_capacity = shard_capacity;
+    memset(params.key_set->keys, 0, shard_capacity * uo_preprocess_key_set_shard_count * sizeof * params.key_set->keys);
+
+    // Step 4.3. Mark duplicates on the engine threads
+    uo_tuning_preprocess_run_threads(&params, uo_tuning_preprocess_deduplicate_thread_run);
+
+    // Step 4.4. Compact records in place. A record is smaller than an entry, so it does not overwrite unread entries.
+    uo_dataset_record *records = (uo_dataset_record *)params.entries;
+    size_t record_count = 0;
+
+    for (size_t i = 0; i < params.entry_count; ++i)
+    {
+      if (!params.entries[i].key) continue;
+
+      uo_dataset_record record = params.entries[i].record;
+      records[record_count++] = record;
+    }
+
+    // Step 4.5. Fisher-Yates shuffle
+    for (size_t i = record_count; i > 1; --i)
+    {
+      size_t j = uo_rand_u64() % i;
+      uo_dataset_record record = records[i - 1];
+      records[i - 1] = records[j];
+      records[j] = record;
+    }
+
+    // Step 4.6. Write records
+    if (binary)
+    {
+      fwrite(records, sizeof * records, record_count, fp);
+    }
+    else
+    {
+      char line[0x100];
+
+      for (size_t i = 0; i < record_count; ++i)
+      {
+        uo_dataset_record_print_csv(position, records + i, line);
+        fputs(line, fp);
+      }
+    }
+
+    written += record_count;
+  }
+
+  double time_msec = uo_time_elapsed_msec(&params.time_start);
+  printf("positions read: %d, dropped: %d, duplicates: %d, written: %zu, time: %.1f s, positions per second: %.1f\n",
+    positions, dropped, uo_atomic_load(&params.duplicates), written, time_msec / 1000.0, positions / time_msec * 1000.0);
+
+cleanup:
+  // Step 5. Remove bucket files
+  if (params.buckets)
+  {
+    for (size_t i = 0; i < params.bucket_count; ++i)
+    {
+      if (!params.buckets[i]) continue;
+
+      fclose(params.buckets[i]);
+      snprintf(bucket_filepath, bucket_path_len, "%s.%zu.tmp", output_filepath, i);
+      remove(bucket_filepath);
+    }
+
+    free(params.buckets);
+  }
+
+  if (params.key_set)
+  {
+    free(params.key_set->keys);
+    free(params.key_set);
+  }
+
+  free(params.entries);
+  if (fp) fclose(fp);
+  if (params.file_mmap) uo_file_mmap_close(params.file_mmap);
+  if (params.dataset) uo_dataset_close(params.dataset);
+  free(position);
+  free(bucket_filepath);
+  uo_semaphore_destroy(params.semaphore);
+}
+
+// Linear coefficient of an evaluation parameter for a position
+typedef struct uo_tuning_coefficient
+{
+  uint16_t index;
+  float value;
+} uo_tuning_coefficient;
+
+// Position of the tuning set. Unscaled evaluation is linear in the parameters: offset + sum of coefficient * parameter.
+// Scale factor depends on which side is ahead: scale[0] is applied if unscaled evaluation is not positive and scale[1] otherwise.
+typedef struct uo_tuning_entry
+{
+  size_t coefficient_offset; // offset to the coefficients of the range
+  size_t coefficient_count;
+  float offset;
+  float scale[2];
+  float q_score_expected;
+} uo_tuning_entry;
+
+// Parameters are perturbed by this amount when coefficients are extracted. Using more than one reduces rounding error of terms
+// which are not integer multiples of a parameter.
+#define uo_tuning_coefficient_delta 64
+
+// Adam optimizer
+#define uo_tuning_learning_rate 1.0
+#define uo_tuning_beta1 0.9
+#define uo_tuning_beta2 0.999
+#define uo_tuning_epsilon 1e-8
+
+typedef struct uo_tuning_parallel_params
+{
+  uo_thread_function *function;
+  void *items;
+  size_t item_size;
+  size_t item_count;
+  volatile uo_atomic_int claimed;
+  uo_semaphore *semaphore;
+} uo_tuning_parallel_params;
+
+static void *uo_tuning_parallel_thread_run(void *arg)
+{
+  uo_engine_thread *thread = arg;
+  uo_tuning_parallel_params *params = thread->data;
+
+  uo_atomic_unlock(&thread->busy);
+
+  int item;
+  while ((item = uo_atomic_increment(&params->claimed) - 1) < (int)params->item_count)
+  {
+    params->function((char *)params->items + item * params->item_size);
+  }
+
+  uo_semaphore_release(params->semaphore);
+
+  return NULL;
+}
+
+// Calls the function for each item on the engine threads and waits for all of them to finish. Each item is claimed by
+// one thread, so the item can hold the inputs and the results of the call.
+static void uo_tuning_parallel_run(void *items, size_t item_size, size_t item_count, uo_thread_function *function)
+{
+  if (item_count == 1)
+  {
+    function(items);
+    return;
+  }
+
+  uo_tuning_parallel_params params = {
+    .function = function,
+    .items = items,
+    .item_size = item_size,
+    .item_count = item_count,
+    .semaphore = uo_semaphore_create(0)
+  };
+
+  uo_atomic_init(&params.claimed, 0);
+
+  size_t dispatch_count = uo_min(engine.thread_count, item_count);
+
+  for (size_t i = 0; i < dispatch_count; ++i)
+  {
+    uo_engine_run_thread(uo_tuning_parallel_thread_run, &params);
+  }
+
+  for (size_t i = 0; i < dispatch_count; ++i)
+  {
+    uo_semaphore_wait(params.semaphore);
+  }
+
+  uo_semaphore_destroy(params.semaphore);
+}
+
+typedef struct uo_tuning_range
+{
+  const uo_position_packed *positions;
+  uo_tuning_entry *entries;
+  size_t count;
+
+  // coefficient extraction
+  const uo_evaluation_parameters *parameters;
+  const bool *is_tunable;
+  uo_tuning_coefficient *coefficients;
+  size_t coefficient_count;
+  size_t skipped_count;
+
+  // gradient computation
+  const double *values;
+  double gradient[uo_evaluation_parameter_count];
+  double loss;
+} uo_tuning_range;
+
+static inline double uo_tuning_position_evaluate_linear(uo_position *position, const uo_evaluation_parameters *parameters)
+{
+  uo_evaluation_trace trace;
+  uo_position_evaluate_trace(position, parameters, &trace);
+
+  // After the last term, the previous totals of the trace are the totals of the evaluation
+  return trace.score_prev + (trace.score_mg_prev * (double)trace.phase + trace.score_eg_prev * (100.0 - trace.phase)) / 100.0;
+}
+
+static void *uo_tuning_range_extract_coefficients(void *arg)
+{
+  uo_tuning_range *range = arg;
+
+  uo_position *position = malloc(sizeof * position);
+  uo_evaluation_parameters parameters = *range->parameters;
+  int16_t *values = (int16_t *)&parameters;
+
+  size_t capacity = range->count * 32 + 0x100;
+  range->coefficients = malloc(capacity * sizeof * range->coefficients);
+  range->coefficient_count = 0;
+  range->skipped_count = 0;
+
+  for (size_t j = 0; j < range->count; ++j)
+  {
+    uo_tuning_entry *entry = range->entries + j;
+    uo_position_unpack(position, range->positions + j);
+
+    // Step 1. Positions with specialised endgame evaluation do not depend on the parameters
+    uo_material_hash_entry material;
+    uo_position_material_entry_init(position, &material);
+
+    if (material.evaluate)
+    {
+      entry->coefficient_offset = range->coefficient_count;
+      entry->coefficient_count = 0;
+      entry->offset = material.evaluate(position, material.color_strong);
+      entry->scale[0] = entry->scale[1] = 1.0f;
+      ++range->skipped_count;
+      continue;
+    }
+
+    // Step 2. Coefficient of each parameter is the change in the evaluation when the parameter is changed
+    double linear = uo_tuning_position_evaluate_linear(position, &parameters);
+    double offset = linear;
+    size_t start = range->coefficient_count;
+
+    for (size_t i = 0; i < uo_evaluation_parameter_count; ++i)
+    {
+      if (!range->is_tunable[i]) continue;
+
+      values[i] += uo_tuning_coefficient_delta;
+      double coefficient = (uo_tuning_position_evaluate_linear(position, &parameters) - linear) / uo_tuning_coefficient_delta;
+      values[i] -= uo_tuning_coefficient_delta;
+
+      if (coefficient == 0.0) continue;
+
+      if (range->coefficient_count == capacity)
+      {
+        capacity *= 2;
+        range->coefficients = realloc(range->coefficients, capacity * sizeof * range->coefficients);
+      }
+
+      range->coefficients[range->coefficient_count++] = (uo_tuning_coefficient){ .index = i, .value = coefficient };
+      offset -= coefficient * values[i];
+    }
+
+    // Step 3. Scale factors for both signs of the unscaled evaluation
+    int16_t score_unit = uo_scale_factor_normal * 256;
+    entry->scale[0] = uo_position_evaluate_scale(position, &material, -score_unit) / (float)-score_unit;
+    entry->scale[1] = uo_position_evaluate_scale(position, &material, score_unit) / (float)score_unit;
+
+    entry->offset = offset;
+    entry->coefficient_offset = start;
+    entry->coefficient_count = range->coefficient_count - start;
+  }
+
+  free(position);
+
+  return NULL;
+}
+
+// Derivative of q score with respect to centipawns. Derivative of atan(cp / a) / b is 1 / (a * b * (1 + (cp / a)^2)).
+static inline double uo_tuning_q_score_derivative(double cp)
+{
+  double cp_a = cp / 111.714640912;
+  return 1.0 / (111.714640912 * 1.5620688421 * (1.0 + cp_a * cp_a));
+}
+
+static void *uo_tuning_range_compute_gradient(void *arg)
+{
+  uo_tuning_range *range = arg;
+
+  memset(range->gradient, 0, sizeof range->gradient);
+  range->loss = 0.0;
+
+  for (size_t j = 0; j < range->count; ++j)
+  {
+    const uo_tuning_entry *entry = range->entries + j;
+    const uo_tuning_coefficient *coefficients = range->coefficients + entry->coefficient_offset;
+
+    double linear = entry->offset;
+    for (size_t k = 0; k < entry->coefficient_count; ++k)
+    {
+      linear += coefficients[k].value * range->values[coefficients[k].index];
+    }
+
+    double scale = entry->scale[linear > 0.0];
+    double cp = linear * scale;
+    double q_score = uo_score_centipawn_to_q_score(cp);
+    double diff = q_score - entry->q_score_expected;
+    range->loss += diff * diff;
+
+    if (!entry->coefficient_count) continue;
+
+    double d_linear = 2.0 * diff * uo_tuning_q_score_derivative(cp) * scale;
+
+    for (size_t k = 0; k < entry->coefficient_count; ++k)
+    {
+      range->gradient[coefficients[k].index] += d_linear * coefficients[k].value;
+    }
+  }
+
+  return NULL;
+}
+
+// Expected score of a record. Forced mates are labeled as certain wins and losses.
+static inline double uo_tuning_record_q_score(const uo_dataset_record *record)
+{
+  return uo_score_is_checkmate(record->score)
+    ? (record->score > 0 ? 1.0 : -1.0)
+    : uo_score_centipawn_to_q_score((double)record->score);
+}
+
+typedef struct uo_tuning_evaluate_batch_params
+{
+  const uo_position_packed *positions;
+  int16_t *scores;
+  size_t count;
+  const uo_evaluation_parameters *parameters;
+  volatile uo_atomic_int claimed;
+  uo_semaphore *semaphore;
+} uo_tuning_evaluate_batch_params;
+
+#define uo_tuning_evaluate_batch_chunk_size 0x400
+
+static void *uo_tuning_evaluate_batch_thread_run(void *arg)
+{
+  uo_engine_thread *thread = arg;
+  uo_tuning_evaluate_batch_params *params = thread->data;
+  uo_position *position = &thread->position;
+
+  uo_atomic_unlock(&thread->busy);
+
+  size_t chunk_count = (params->count + uo_tuning_evaluate_batch_chunk_size - 1) / uo_tuning_evaluate_batch_chunk_size;
+  int chunk;
+
+  while ((chunk = uo_atomic_increment(&params->claimed) - 1) < (int)chunk_count)
+  {
+    size_t begin = (size_t)chunk * uo_tuning_evaluate_batch_chunk_size;
+    size_t end = uo_min(begin + uo_tuning_evaluate_batch_chunk_size, params->count);
+
+    for (size_t i = begin; i < end; ++i)
+    {
+      uo_position_unpack(position, params->positions + i);
+      params->scores[i] = params->parameters
+        ? uo_position_evaluate_with_parameters(position, params->parameters)
+        : uo_position_evaluate(position, &thread->pawn_hash, &thread->material_hash);
+    }
+  }
+
+  uo_semaphore_release(params->semaphore);
+
+  return NULL;
+}
+
+void uo_tuning_evaluate_batch(const uo_position_packed *positions, int16_t *scores, size_t count, const uo_evaluation_parameters *parameters)
+{
+  uo_tuning_evaluate_batch_params params = {
+    .positions = positions,
+    .scores = scores,
+    .count = count,
+    .parameters = parameters,
+    .semaphore = uo_semaphore_create(0)
+  };
+
+  uo_atomic_init(&params.claimed, 0);
+
+  for (size_t i = 0; i < engine.thread_count; ++i)
+  {
+    uo_engine_run_thread(uo_tuning_evaluate_batch_thread_run, &params);
+  }
+
+  for (size_t i = 0; i < engine.thread_count; ++i)
+  {
+    uo_semaphore_wait(params.semaphore);
+  }
+
+  uo_semaphore_destroy(params.semaphore);
+}
+
+static double uo_tuning_mse(const uo_position_packed *positions, const double *q_scores_expected, size_t count, const uo_evaluation_parameters *parameters)
+{
+  int16_t *scores = malloc(count * sizeof * scores);
+  uo_tuning_evaluate_batch(positions, scores, count, parameters);
+
+  double mse = 0.0;
+
+  for (size_t j = 0; j < count; ++j)
+  {
+    double diff = q_scores_expected[j] - uo_score_centipawn_to_q_score((double)scores[j]);
+    mse += diff * diff;
+  }
+
+  free(scores);
+
+  return mse / count;
+}
+
+bool uo_tuning_train_evaluation_parameters(char *dataset_filepath, char *parameters_filepath, size_t epochs)
+{
+  if (!dataset_filepath)
+  {
+    return false;
+  }
+
+  // Parameters are tuned starting from the compile time constants. All parameters are int16_t and accessed as an array.
+  uo_evaluation_parameters parameters = uo_evaluation_parameters_default;
+  int16_t *tuning_params = (int16_t *)&parameters;
+
+  // Attack unit parameters select an entry of the table of attacks to king instead of being multiplied by a count,
+  // so evaluation is not linear in them and they are kept fixed
+  bool is_tunable[uo_evaluation_parameter_count];
+
+  printf("Initial tuning parameters:\n");
+  for (size_t i = 0; i < uo_evaluation_parameter_count; ++i)
+  {
+    is_tunable[i] = strncmp(uo_evaluation_parameter_names[i], "uo_attack_unit_", 15) != 0;
+    printf("  param[%4zu]: %4d\n", i, tuning_params[i]);
+  }
+  printf("\n");
+  fflush(stdout);
+
+  // Step 1. Load dataset once into packed positions and expected scores from the point of view of the side to move.
+  // Binary dataset records are decoded directly from the mapped file. Csv datasets are parsed line by line.
+  uo_position_packed *positions;
+  double *q_scores_expected;
+  size_t count = 0;
+
+  uo_dataset *dataset = uo_dataset_open_read(dataset_filepath);
+
+  if (dataset)
+  {
+    positions = malloc(dataset->count * sizeof * positions);
+    q_scores_expected = malloc(dataset->count * sizeof * q_scores_expected);
+
+    for (; count < dataset->count; ++count)
+    {
+      uo_dataset_record_unpack(dataset->records + count, positions + count);
+      q_scores_expected[count] = uo_tuning_record_q_score(dataset->records + count);
+    }
+
+    uo_dataset_close(dataset);
+  }
+  else
+  {
+    uo_file_mmap *file_mmap = uo_file_mmap_open_read(dataset_filepath);
+    if (!file_mmap)
+    {
+      return false;
+    }
+
+    size_t capacity = 0x1000;
+    positions = malloc(capacity * sizeof * positions);
+    q_scores_expected = malloc(capacity * sizeof * q_scores_expected);
+
+    uo_position *position = malloc(sizeof * position);
+    uo_dataset_record record;
+    char *line = uo_file_mmap_readline(file_mmap);
+
+    while (line && *line)
+    {
+      if (uo_dataset_record_parse_csv(position, line, &record))
+      {
+        if (count == capacity)
+        {
+          capacity *= 2;
+          positions = realloc(positions, capacity * sizeof * positions);
+          q_scores_expected = realloc(q_scores_expected, capacity * sizeof * q_scores_expected);
+        }
+
+        uo_position_pack(position, positions + count);
+        q_scores_expected[count++] = uo_tuning_record_q_score(&record);
+      }
+
+      line = uo_file_mmap_readline(file_mmap);
+    }
+
+    free(position);
+    uo_file_mmap_close(file_mmap);
+  }
+
+  if (!count)
+  {
+    free(q_scores_expected);
+    free(positions);
+    return false;
+  }
+
+  // Step 2. Extract linear coefficients of each position once using a range of positions per thread
+  size_t thread_count = uo_max(1, uo_min(engine_options.threads, count));
+  uo_tuning_entry *entries = malloc(count * sizeof * entries);
+  uo_tuning_range *ranges = malloc(thread_count * sizeof * ranges);
+  size_t range_size = count / thread_count;
+  size_t remainder = count % thread_count;
+  size_t offset = 0;
+
+  for (size_t i = 0; i < thread_count; ++i)
+  {
+    size_t range_count = range_size + (i < remainder);
+    ranges[i] = (uo_tuning_range){
+      .positions = positions + offset,
+      .entries = entries + offset,
+      .count = range_count,
+      .parameters = &parameters,
+      .is_tunable = is_tunable
+    };
+    offset += range_count;
+  }
+
+  uo_time time_start;
+  uo_time_now(&time_start);
+
+  uo_tuning_parallel_run(ranges, sizeof * ranges, thread_count, uo_tuning_range_extract_coefficients);
+
+  size_t coefficient_count = 0;
+  size_t skipped_count = 0;
+  for (size_t i = 0; i < thread_count; ++i)
+  {
+    coefficient_count += ranges[i].coefficient_count;
+    skipped_count += ranges[i].skipped_count;
+  }
+
+  for (size_t j = 0; j < count; ++j)
+  {
+    entries[j].q_score_expected = q_scores_expected[j];
+  }
+
+  printf("Extracted coefficients of %zu positions in %.1f s using %zu threads: %.1f coefficients per position, %zu positions with specialised endgame evaluation\n",
+    count, uo_time_elapsed_msec(&time_start) / 1000.0, thread_count, (double)coefficient_count / count, skipped_count);
+
+  double mse_initial = uo_tuning_mse(positions, q_scores_expected, count, &parameters);
+  printf("Initial mean squared error: %.9f\n\n", mse_initial);
+  fflush(stdout);
+
+  // Step 3. Minimize mean squared error using Adam with gradients accumulated per thread
+  double values[uo_evaluation_parameter_count];
+  double gradient[uo_evaluation_parameter_count];
+  double moment1[uo_evaluation_parameter_count] = { 0 };
+  double moment2[uo_evaluation_parameter_count] = { 0 };
+
+  for (size_t i = 0; i < uo_evaluation_parameter_count; ++i)
+  {
+    values[i] = tuning_params[i];
+  }
+
+  for (size_t i = 0; i < thread_count; ++i)
+  {
+    ranges[i].values = values;
+  }
+
+  uo_time_now(&time_start);
+
+  for (size_t epoch = 1; epoch <= epochs; ++epoch)
+  {
+    uo_tuning_parallel_run(ranges, sizeof * ranges, thread_count, uo_tuning_range_compute_gradient);
+
+    double loss = 0.0;
+    memset(gradient, 0, sizeof gradient);
+
+    for (size_t t = 0; t < thread_count; ++t)
+    {
+      loss += ranges[t].loss;
+
+      for (size_t i = 0; i < uo_evaluation_parameter_count; ++i)
+      {
+        gradient[i] += ranges[t].gradient[i];
+      }
+    }
+
+    loss /= count;
+
+    double beta1_power = pow(uo_tuning_beta1, (double)epoch);
+    double beta2_power = pow(uo_tuning_beta2, (double)epoch);
+
+    for (size_t i = 0; i < uo_evaluation_parameter_count; ++i)
+    {
+      if (!is_tunable[i]) continue;
+
+      double g = gradient[i] / count;
+      moment1[i] = uo_tuning_beta1 * moment1[i] + (1.0 - uo_tuning_beta1) * g;
+      moment2[i] = uo_tuning_beta2 * moment2[i] + (1.0 - uo_tuning_beta2) * g * g;
+
+      double moment1_corrected = moment1[i] / (1.0 - beta1_power);
+      double moment2_corrected = moment2[i] / (1.0 - beta2_power);
+      values[i] -= uo_tuning_learning_rate * moment1_corrected / (sqrt(moment2_corrected) + uo_tuning_epsilon);
+    }
+
+    if (epoch % 100 == 0 || epoch == epochs)
+    {
+      printf("epoch %6zu, loss: %.9f, time: %.1f s\n", epoch, loss, uo_time_elapsed_msec(&time_start) / 1000.0);
+      fflush(stdout);
+    }
+  }
+
+  for (size_t i = 0; i < uo_evaluation_parameter_count; ++i)
+  {
+    double value = round(values[i]);
+    tuning_params[i] = (int16_t)uo_max(INT16_MIN, uo_min(INT16_MAX, value));
+  }
+
+  double mse_final = uo_tuning_mse(positions, q_scores_expected, count, &parameters);
+  printf("\nFinal mean squared error: %.9f (initial %.9f)\n\n", mse_final, mse_initial);
+
+  // Step 4. Print final parameters in the format of the parameter description and save them to parameter file
+  printf("Final tuning parameters:\n");
+  for (size_t i = 0; i < uo_evaluation_parameter_count; ++i)
+  {
+    printf("uo_evaluation_parameter(%s, %d)\n", uo_evaluation_parameter_names[i], tuning_params[i]);
+  }
+  printf("\n");
+
+  if (parameters_filepath && !uo_evaluation_parameters_save(&parameters, parameters_filepath))
+  {
+    printf("Unable to save parameters to file '%s'\n", parameters_filepath);
+  }
+
+  fflush(stdout);
+
+  for (size_t i = 0; i < thread_count; ++i)
+  {
+    free(ranges[i].coefficients);
+  }
+
+  free(ranges);
+  free(entries);
+  free(q_scores_expected);
+  free(positions);
+  return true;
+}
+
+// Network training. Float network has the layout of uo_nnue. Parameters, gradient and Adam moments are single arrays
+// in the order of the weight file, so that optimizer steps and checkpoints handle all parameters as one vector.
+#define uo_tuning_nnue_ft_biases 0
+#define uo_tuning_nnue_ft_weights (uo_tuning_nnue_ft_biases + UO_NNUE_L1)
+#define uo_tuning_nnue_l1_biases (uo_tuning_nnue_ft_weights + UO_NNUE_FEATURE_COUNT * UO_NNUE_L1)
+#define uo_tuning_nnue_l1_weights (uo_tuning_nnue_l1_biases + UO_NNUE_L2)
+#define uo_tuning_nnue_l2_biases (uo_tuning_nnue_l1_weights + UO_NNUE_L2 * 2 * UO_NNUE_L1)
+#define uo_tuning_nnue_l2_weights (uo_tuning_nnue_l2_biases + UO_NNUE_L3)
+#define uo_tuning_nnue_out_bias (uo_tuning_nnue_l2_weights + UO_NNUE_L3 * UO_NNUE_L2)
+#define uo_tuning_nnue_out_weights (uo_tuning_nnue_out_bias + 1)
+#define uo_tuning_nnue_parameter_count (uo_tuning_nnue_out_weights + UO_NNUE_L3)
+
+// Gradient of the layers after the feature transformer is small enough to be accumulated separately by each thread
+#define uo_tuning_nnue_dense_count (uo_tuning_nnue_parameter_count - uo_tuning_nnue_l1_biases)
+#define uo_tuning_nnue_dense(offset) ((offset) - uo_tuning_nnue_l1_biases)
+
+// Quantization of uo_nnue: activation 1.0 is 127 and hidden and output layer weight 1.0 is 1 << UO_NNUE_WEIGHT_SCALE_BITS.
+// Output 1.0 of the float network is then 127 * 64 / UO_NNUE_OUTPUT_SCALE centipawns. Weights of the hidden and output
+// layers are clamped so that they fit int8 after quantization.
+#define uo_tuning_nnue_activation_scale 127.0f
+#define uo_tuning_nnue_weight_scale ((float)(1 << UO_NNUE_WEIGHT_SCALE_BITS))
+#define uo_tuning_nnue_output_centipawns (uo_tuning_nnue_activation_scale * uo_tuning_nnue_weight_scale / UO_NNUE_OUTPUT_SCALE)
+#define uo_tuning_nnue_weight_max (127.0f / uo_tuning_nnue_weight_scale)
+
+// Adam optimizer
+#define uo_tuning_nnue_learning_rate 1e-3f
+#define uo_tuning_nnue_beta1 0.9f
+#define uo_tuning_nnue_beta2 0.999f
+#define uo_tuning_nnue_epsilon 1e-8f
+
+// Loss of the exported network is measured on at most this many positions
+#define uo_tuning_nnue_quantized_loss_count 0x10000
+
+// Checkpoint file: magic "UONT", version, parameter count and completed epochs as uint32 values and Adam step count as
+// uint64 value followed by parameters and both Adam moments as float arrays
+#define uo_tuning_nnue_checkpoint_magic 0x544E4F55
+#define uo_tuning_nnue_checkpoint_version 1
+
+typedef struct uo_tuning_nnue_checkpoint_header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t parameter_count;
+  uint32_t epoch;
+  uint64_t step;
+} uo_tuning_nnue_checkpoint_header;
+
+// Features of both perspectives, side to move first
+typedef struct uo_tuning_nnue_sample
+{
+  size_t features[2][32];
+  size_t count;
+  float q_score_expected;
+} uo_tuning_nnue_sample;
+
+typedef struct uo_tuning_nnue_trainer
+{
+  float *parameters;
+  float *gradient;
+  float *moment1;
+  float *moment2;
+  float *l1_weights_t; // [2 * L1][L2]
+  float *l2_weights_t; // [L2][L3]
+
+  // mini-batch
+  const uo_dataset_record *records;
+  const size_t *indexes;
+  size_t batch_count;
+  uo_tuning_nnue_sample *samples;
+  float *values; // [batch_size][2 * L1] feature transformer output before activation, replaced by its gradient
+
+  // optimizer step
+  float gradient_scale;
+  float beta1_power;
+  float beta2_power;
+
+  size_t thread_count;
+} uo_tuning_nnue_trainer;
+
+typedef struct uo_tuning_nnue_thread
+{
+  uo_tuning_nnue_trainer *trainer;
+  size_t index;
+
+  // activations and their gradients for a slice of the mini-batch
+  float *inputs;            // [slice][2 * L1]
+  float *input_gradients;   // [slice][2 * L1]
+  float *hidden1_values;    // [slice][L2]
+  float *hidden1;           // [slice][L2]
+  float *hidden1_gradients; // [slice][L2]
+  float *hidden2_values;    // [slice][L3]
+  float *hidden2;           // [slice][L3]
+  float *hidden2_gradients; // [slice][L3]
+  float *output_gradients;  // [slice]
+
+  float gradient[uo_tuning_nnue_dense_count];
+  double loss;
+} uo_tuning_nnue_thread;
+
+static inline uo_avx_float uo_tuning_nnue_clipped_relu(uo_avx_float x)
+{
+  return _mm256_min_ps(_mm256_max_ps(x, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+}
+
+static inline uo_avx_float uo_tuning_nnue_clipped_relu_derivative(uo_avx_float x)
+{
+  uo_avx_float is_linear = _mm256_and_ps(
+    _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ),
+    _mm256_cmp_ps(x, _mm256_set1_ps(1.0f), _CMP_LT_OQ));
+
+  return _mm256_and_ps(is_linear, _mm256_set1_ps(1.0f));
+}
+
+// Collects features of both perspectives from a record without unpacking the position. Side to move is first.
+static size_t uo_tuning_nnue_record_features(const uo_dataset_record *record, size_t features[2][32])
+{
+  uint8_t color = uo_color(record->flags);
+  uint8_t flip = color == uo_black ? 56 : 0;
+  uo_bitboard occupied = record->occupied;
+
+  uo_piece pieces[32];
+  uint8_t squares[32];
+  uint8_t squares_K[2] = { 0 };
+  size_t count = 0;
+
+  // Step 1. Decode pieces and squares in absolute coordinates
+  for (size_t i = 0; occupied; ++i)
+  {
+    uo_square square = uo_bitboard_next_square(&occupied);
+    uo_piece piece = ((record->pieces[i >> 1] >> ((i & 1) << 2)) & 0xF) ^ color;
+
+    if (uo_piece_type(piece) == uo_piece__K)
+    {
+      squares_K[uo_color(piece)] = square ^ flip;
+      continue;
+    }
+
+    pieces[count] = piece;
+    squares[count++] = square ^ flip;
+  }
+
+  // Step 2. Feature indexes relative to the king of each perspective
+  for (size_t i = 0; i < count; ++i)
+  {
+    features[0][i] = uo_nnue_feature_index(color, squares_K[color], pieces[i], squares[i]);
+    features[1][i] = uo_nnue_feature_index(!color, squares_K[!color], pieces[i], squares[i]);
+  }
+
+  return count;
+}
+
+static void *uo_tuning_nnue_thread_compute_gradient(void *arg)
+{
+  uo_tuning_nnue_thread *thread = arg;
+  uo_tuning_nnue_trainer *trainer = thread->trainer;
+  float *parameters = trainer->parameters;
+  float *gradient = thread->gradient;
+
+  size_t begin = trainer->batch_count * thread->index / trainer->thread_count;
+  size_t end = trainer->batch_count * (thread->index + 1) / trainer->thread_count;
+  size_t n = end - begin;
+
+  memset(gradient, 0, sizeof thread->gradient);
+  thread->loss = 0.0;
+
+  if (!n) return NULL;
+
+  // Step 1. Feature transformer. Accumulators are sums of the weight columns of active features.
+  for (size_t i = begin; i < end; ++i)
+  {
+    uo_tuning_nnue_sample *sample = trainer->samples + i;
+    const uo_dataset_record *record = trainer->records + trainer->indexes[i];
+    sample->count = uo_tuning_nnue_record_features(record, sample->features);
+    sample->q_score_expected = uo_tuning_record_q_score(record);
+
+    float *values = trainer->values + i * 2 * UO_NNUE_L1;
+
+    for (size_t perspective = 0; perspective < 2; ++perspective)
+    {
+      float *accumulator = values + perspective * UO_NNUE_L1;
+      memcpy(accumulator, parameters + uo_tuning_nnue_ft_biases, UO_NNUE_L1 * sizeof(float));
+
+      for (size_t j = 0; j < sample->count; ++j)
+      {
+        float *column = parameters + uo_tuning_nnue_ft_weights + sample->features[perspective][j] * UO_NNUE_L1;
+        uo_vec_add_ps(accumulator, column, accumulator, UO_NNUE_L1);
+      }
+    }
+
+    uo_vec_mapfunc_ps(values, thread->inputs + (i - begin) * 2 * UO_NNUE_L1, 2 * UO_NNUE_L1, uo_tuning_nnue_clipped_relu);
+  }
+
+  // Step 2. Hidden layers for the whole slice
+  uo_matmul_ps(thread->inputs, parameters + uo_tuning_nnue_l1_weights, thread->hidden1_values, n, UO_NNUE_L2, 2 * UO_NNUE_L1, 0, 0, 0);
+  for (size_t i = 0; i < n; ++i)
+  {
+    float *row = thread->hidden1_values + i * UO_NNUE_L2;
+    uo_vec_add_ps(row, parameters + uo_tuning_nnue_l1_biases, row, UO_NNUE_L2);
+  }
+  uo_vec_mapfunc_ps(thread->hidden1_values, thread->hidden1, n * UO_NNUE_L2, uo_tuning_nnue_clipped_relu);
+
+  uo_matmul_ps(thread->hidden1, parameters + uo_tuning_nnue_l2_weights, thread->hidden2_values, n, UO_NNUE_L3, UO_NNUE_L2, 0, 0, 0);
+  for (size_t i = 0; i < n; ++i)
+  {
+    float *row = thread->hidden2_values + i * UO_NNUE_L3;
+    uo_vec_add_ps(row, parameters + uo_tuning_nnue_l2_biases, row, UO_NNUE_L3);
+  }
+  uo_vec_mapfunc_ps(thread->hidden2_values, thread->hidden2, n * UO_NNUE_L3, uo_tuning_nnue_clipped_relu);
+
+  // Step 3. Output, loss and gradient of the output. Loss is squared error of q score as in evaluation tuning.
+  for (size_t i = 0; i < n; ++i)
+  {
+    float output = parameters[uo_tuning_nnue_out_bias]
+      + uo_dotproduct_ps(thread->hidden2 + i * UO_NNUE_L3, parameters + uo_tuning_nnue_out_weights, UO_NNUE_L3);
+
+    double cp = output * uo_tuning_nnue_output_centipawns;
+    double diff = uo_score_centipawn_to_q_score(cp) - trainer->samples[begin + i].q_score_expected;
+    thread->loss += diff * diff;
+
+    float output_gradient = 2.0 * diff * uo_tuning_q_score_derivative(cp) * uo_tuning_nnue_output_centipawns;
+    thread->output_gradients[i] = output_gradient;
+    gradient[uo_tuning_nnue_dense(uo_tuning_nnue_out_bias)] += output_gradient;
+    uo_vec_mul1_ps(parameters + uo_tuning_nnue_out_weights, output_gradient, thread->hidden2_gradients + i * UO_NNUE_L3, UO_NNUE_L3);
+  }
+
+  uo_matmul_t_ps(thread->hidden2, thread->output_gradients, gradient + uo_tuning_nnue_dense(uo_tuning_nnue_out_weights), UO_NNUE_L3, 1, n, 0, 0, 0);
+
+  // Step 4. Backward pass of the hidden layers
+  uo_vec_mapfunc_mul_ps(thread->hidden2_values, thread->hidden2_gradients, thread->hidden2_gradients, n * UO_NNUE_L3, uo_tuning_nnue_clipped_relu_derivative);
+  uo_matmul_t_ps(thread->hidden1, thread->hidden2_gradients, gradient + uo_tuning_nnue_dense(uo_tuning_nnue_l2_weights), UO_NNUE_L2, UO_NNUE_L3, n, 0, 0, 0);
+  for (size_t i = 0; i < n; ++i)
+  {
+    float *bias_gradient = gradient + uo_tuning_nnue_dense(uo_tuning_nnue_l2_biases);
+    uo_vec_add_ps(bias_gradient, thread->hidden2_gradients + i * UO_NNUE_L3, bias_gradient, UO_NNUE_L3);
+  }
+
+  uo_matmul_ps(thread->hidden2_gradients, trainer->l2_weights_t, thread->hidden1_gradients, n, UO_NNUE_L2, UO_NNUE_L3, 0, 0, 0);
+  uo_vec_mapfunc_mul_ps(thread->hidden1_values, thread->hidden1_gradients, thread->hidden1_gradients, n * UO_NNUE_L2, uo_tuning_nnue_clipped_relu_derivative);
+  uo_matmul_t_ps(thread->inputs, thread->hidden1_gradients, gradient + uo_tuning_nnue_dense(uo_tuning_nnue_l1_weights), 2 * UO_NNUE_L1, UO_NNUE_L2, n, 0, 0, 0);
+  for (size_t i = 0; i < n; ++i)
+  {
+    float *bias_gradient = gradient + uo_tuning_nnue_dense(uo_tuning_nnue_l1_biases);
+    uo_vec_add_ps(bias_gradient, thread->hidden1_gradients + i * UO_NNUE_L2, bias_gradient, UO_NNUE_L2);
+  }
+
+  // Step 5. Gradient of the feature transformer output replaces its values
+  uo_matmul_ps(thread->hidden1_gradients, trainer->l1_weights_t, thread->input_gradients, n, 2 * UO_NNUE_L1, UO_NNUE_L2, 0, 0, 0);
+  for (size_t i = begin; i < end; ++i)
+  {
+    float *values = trainer->values + i * 2 * UO_NNUE_L1;
+    uo_vec_mapfunc_mul_ps(values, thread->input_gradients + (i - begin) * 2 * UO_NNUE_L1, values, 2 * UO_NNUE_L1, uo_tuning_nnue_clipped_relu_derivative);
+  }
+
+  return NULL;
+}
+
+// Feature transformer gradient is accumulated over the whole mini-batch by each thread for its own columns of the
+// weight matrix, so that the threads do not write to the same memory and no copies of the weight matrix are needed
+static void *uo_tuning_nnue_thread_accumulate_feature_gradient(void *arg)
+{
+  uo_tuning_nnue_thread *thread = arg;
+  uo_tuning_nnue_trainer *trainer = thread->trainer;
+
+  size_t begin = (UO_NNUE_L1 * thread->index / trainer->thread_count) & ~(uo_floats_per_avx_float - 1);
+  size_t end = (UO_NNUE_L1 * (thread->index + 1) / trainer->thread_count) & ~(uo_floats_per_avx_float - 1);
+  size_t n = end - begin;
+
+  if (!n) return NULL;
+
+  float *bias_gradient = trainer->gradient + uo_tuning_nnue_ft_biases + begin;
+
+  for (size_t i = 0; i < trainer->batch_count; ++i)
+  {
+    const uo_tuning_nnue_sample *sample = trainer->samples + i;
+
+    for (size_t perspective = 0; perspective < 2; ++perspective)
+    {
+      float *values_gradient = trainer->values + (i * 2 + perspective) * UO_NNUE_L1 + begin;
+      uo_vec_add_ps(bias_gradient, values_gradient, bias_gradient, n);
+
+      for (size_t j = 0; j < sample->count; ++j)
+      {
+        float *column_gradient = trainer->gradient + uo_tuning_nnue_ft_weights + sample->features[perspective][j] * UO_NNUE_L1 + begin;
+        uo_vec_add_ps(column_gradient, values_gradient, column_gradient, n);
+      }
+    }
+  }
+
+  return NULL;
+}
+
+// Adam step for a range of parameters. Gradient is cleared for the next mini-batch.
+static void *uo_tuning_nnue_thread_optimize(void *arg)
+{
+  uo_tuning_nnue_thread *thread = arg;
+  uo_tuning_nnue_trainer *trainer = thread->trainer;
+
+  size_t begin = uo_tuning_nnue_parameter_count * thread->index / trainer->thread_count;
+  size_t end = uo_tuning_nnue_parameter_count * (thread->index + 1) / trainer->thread_count;
+
+  float learning_rate = uo_tuning_nnue_learning_rate / (1.0f - trainer->beta1_power);
+  float moment2_scale = 1.0f / (1.0f - trainer->beta2_power);
+
+  for (size_t i = begin; i < end; ++i)
+  {
+    float g = trainer->gradient[i] * trainer->gradient_scale;
+    trainer->gradient[i] = 0.0f;
+
+    float moment1 = trainer->moment1[i] = uo_tuning_nnue_beta1 * trainer->moment1[i] + (1.0f - uo_tuning_nnue_beta1) * g;
+    float moment2 = trainer->moment2[i] = uo_tuning_nnue_beta2 * trainer->moment2[i] + (1.0f - uo_tuning_nnue_beta2) * g * g;
+    trainer->parameters[i] -= learning_rate * moment1 / (sqrtf(moment2 * moment2_scale) + uo_tuning_nnue_epsilon);
+  }
+
+  return NULL;
+}
+
+static inline void uo_tuning_nnue_clamp(float *weights, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    weights[i] = uo_max(-uo_tuning_nnue_weight_max, uo_min(uo_tuning_nnue_weight_max, weights[i]));
+  }
+}
+
+// Uniform initialization scaled by the number of inputs of the layer. Feature transformer has about 30 active inputs.
+static void uo_tuning_nnue_initialize(float *parameters)
+{
+  struct { size_t offset; size_t count; float range; } layers[] = {
+    { uo_tuning_nnue_ft_biases, UO_NNUE_L1, 0.0f },
+    { uo_tuning_nnue_ft_weights, UO_NNUE_FEATURE_COUNT * UO_NNUE_L1, 1.0f / sqrtf(30.0f) },
+    { uo_tuning_nnue_l1_biases, UO_NNUE_L2, 1.0f / sqrtf(2 * UO_NNUE_L1) },
+    { uo_tuning_nnue_l1_weights, UO_NNUE_L2 * 2 * UO_NNUE_L1, 1.0f / sqrtf(2 * UO_NNUE_L1) },
+    { uo_tuning_nnue_l2_biases, UO_NNUE_L3, 1.0f / sqrtf(UO_NNUE_L2) },
+    { uo_tuning_nnue_l2_weights, UO_NNUE_L3 * UO_NNUE_L2, 1.0f / sqrtf(UO_NNUE_L2) },
+    { uo_tuning_nnue_out_bias, 1, 0.0f },
+    { uo_tuning_nnue_out_weights, UO_NNUE_L3, 1.0f / sqrtf(UO_NNUE_L3) },
+  };
+
+  for (size_t i = 0; i < sizeof layers / sizeof * layers; ++i)
+  {
+    for (size_t j = 0; j < layers[i].count; ++j)
+    {
+      parameters[layers[i].offset + j] = uo_rand_between(-layers[i].range, layers[i].range);
+    }
+  }
+}
+
+static bool uo_tuning_nnue_checkpoint_load(uo_tuning_nnue_trainer *trainer, const char *filepath, size_t *epoch, size_t *step)
+{
+  uo_file_mmap *file_mmap = uo_file_mmap_open_read(filepath);
+  if (!file_mmap) return false;
+
+  uo_tuning_nnue_checkpoint_header header;
+  size_t size = uo_tuning_nnue_parameter_count * sizeof(float);
+
+  if (file_mmap->size != sizeof header + 3 * size)
+  {
+    uo_file_mmap_close(file_mmap);
+    return false;
+  }
+
+  memcpy(&header, file_mmap->ptr, sizeof header);
+
+  if (header.magic != uo_tuning_nnue_checkpoint_magic
+    || header.version != uo_tuning_nnue_checkpoint_version
+    || header.parameter_count != uo_tuning_nnue_parameter_count)
+  {
+    uo_file_mmap_close(file_mmap);
+    return false;
+  }
+
+  const char *ptr = file_mmap->ptr + sizeof header;
+  memcpy(trainer->parameters, ptr, size);
+  memcpy(trainer->moment1, ptr + size, size);
+  memcpy(trainer->moment2, ptr + 2 * size, size);
+  uo_file_mmap_close(file_mmap);
+
+  *epoch = header.epoch;
+  *step = header.step;
+  return true;
+}
+
+static bool uo_tuning_nnue_checkpoint_save(const uo_tuning_nnue_trainer *trainer, const char *filepath, size_t epoch, size_t step)
+{
+  FILE *fp = fopen(filepath, "wb");
+  if (!fp) return false;
+
+  uo_tuning_nnue_checkpoint_header header = {
+    .magic = uo_tuning_nnue_checkpoint_magic,
+    .version = uo_tuning_nnue_checkpoint_version,
+    .parameter_count = uo_tuning_nnue_parameter_count,
+    .epoch = epoch,
+    .step = step
+  };
+
+  bool success = fwrite(&header, sizeof header, 1, fp) == 1
+    && fwrite(trainer->parameters, sizeof(float), uo_tuning_nnue_parameter_count, fp) == uo_tuning_nnue_parameter_count
+    && fwrite(trainer->moment1, sizeof(float), uo_tuning_nnue_parameter_count, fp) == uo_tuning_nnue_parameter_count
+    && fwrite(trainer->moment2, sizeof(float), uo_tuning_nnue_parameter_count, fp) == uo_tuning_nnue_parameter_count;
+
+  return fclose(fp) == 0 && success;
+}
+
+static inline int32_t uo_tuning_nnue_quantize_bias(float bias)
+{
+  return (int32_t)roundf(bias * uo_tuning_nnue_activation_scale * uo_tuning_nnue_weight_scale);
+}
+
+static uo_nnue *uo_tuning_nnue_quantize(const float *parameters)
+{
+  uo_nnue *nnue = uo_nnue_create_empty();
+
+  uo_vec_quantize_ps_epi16(parameters + uo_tuning_nnue_ft_biases, nnue->ft_biases, uo_tuning_nnue_activation_scale, UO_NNUE_L1);
+  uo_vec_quantize_ps_epi16(parameters + uo_tuning_nnue_ft_weights, nnue->ft_weights, uo_tuning_nnue_activation_scale, UO_NNUE_FEATURE_COUNT * UO_NNUE_L1);
+  uo_vec_quantize_ps_epi8(parameters + uo_tuning_nnue_l1_weights, nnue->l1_weights, uo_tuning_nnue_weight_scale, UO_NNUE_L2 * 2 * UO_NNUE_L1);
+  uo_vec_quantize_ps_epi8(parameters + uo_tuning_nnue_l2_weights, nnue->l2_weights, uo_tuning_nnue_weight_scale, UO_NNUE_L3 * UO_NNUE_L2);
+  uo_vec_quantize_ps_epi8(parameters + uo_tuning_nnue_out_weights, nnue->out_weights, uo_tuning_nnue_weight_scale, UO_NNUE_L3);
+
+  for (size_t i = 0; i < UO_NNUE_L2; ++i)
+  {
+    nnue->l1_biases[i] = uo_tuning_nnue_quantize_bias(parameters[uo_tuning_nnue_l1_biases + i]);
+  }
+
+  for (size_t i = 0; i < UO_NNUE_L3; ++i)
+  {
+    nnue->l2_biases[i] = uo_tuning_nnue_quantize_bias(parameters[uo_tuning_nnue_l2_biases + i]);
+  }
+
+  *nnue->out_bias = uo_tuning_nnue_quantize_bias(parameters[uo_tuning_nnue_out_bias]);
+
+  return nnue;
+}
+
+// Mean squared error of the quantized network evaluated the same way as in search
+static double uo_tuning_nnue_quantized_loss(const uo_nnue *nnue, const uo_dataset_record *records, size_t count)
+{
+  size_t features[2][32];
+  int16_t values[2][UO_NNUE_L1];
+  double loss = 0.0;
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    size_t feature_count = uo_tuning_nnue_record_features(records + i, features);
+    uo_nnue_accumulator_refresh(nnue, values[0], features[0], feature_count);
+    uo_nnue_accumulator_refresh(nnue, values[1], features[1], feature_count);
+
+    int32_t cp = uo_nnue_propagate(nnue, values[0], values[1]);
+    double diff = uo_score_centipawn_to_q_score((double)cp) - uo_tuning_record_q_score(records + i);
+    loss += diff * diff;
+  }
+
+  return loss / count;
+}
+
+bool uo_tuning_train_nnue(char *dataset_filepath, char *nnue_filepath, char *checkpoint_filepath, size_t epochs, size_t batch_size)
+{
+  if (!dataset_filepath || !nnue_filepath || !batch_size)
+  {
+    return false;
+  }
+
+  // Step 1. Map binary dataset. Records are decoded into features for each mini-batch.
+  uo_dataset *dataset = uo_dataset_open_read(dataset_filepath);
+  if (!dataset)
+  {
+    printf("Unable to read binary dataset file '%s'\n", dataset_filepath);
+    fflush(stdout);
+    return false;
+  }
+
+  size_t count = dataset->count;
+  if (!count)
+  {
+    uo_dataset_close(dataset);
+    return false;
+  }
+
+  batch_size = uo_min(batch_size, count);
+
+  // Step 2. Allocate parameters, gradient and buffers of the mini-batch
+  size_t thread_count = uo_max(1, uo_min(engine_options.threads, batch_size));
+  size_t slice_size = (batch_size + thread_count - 1) / thread_count;
+
+  uo_tuning_nnue_trainer trainer = {
+    .parameters = malloc(uo_tuning_nnue_parameter_count * sizeof(float)),
+    .gradient = calloc(uo_tuning_nnue_parameter_count, sizeof(float)),
+    .moment1 = calloc(uo_tuning_nnue_parameter_count, sizeof(float)),
+    .moment2 = calloc(uo_tuning_nnue_parameter_count, sizeof(float)),
+    .l1_weights_t = malloc(UO_NNUE_L2 * 2 * UO_NNUE_L1 * sizeof(float)),
+    .l2_weights_t = malloc(UO_NNUE_L3 * UO_NNUE_L2 * sizeof(float)),
+    .records = dataset->records,
+    .samples = malloc(batch_size * sizeof(uo_tuning_nnue_sample)),
+    .values = malloc(batch_size * 2 * UO_NNUE_L1 * sizeof(float)),
+    .thread_count = thread_count
+  };
+
+  uo_tuning_nnue_thread *threads = malloc(thread_count * sizeof * threads);
+
+  for (size_t i = 0; i < thread_count; ++i)
+  {
+    uo_tuning_nnue_thread *thread = threads + i;
+    thread->trainer = &trainer;
+    thread->index = i;
+    thread->inputs = malloc(slice_size * 2 * UO_NNUE_L1 * sizeof(float));
+    thread->input_gradients = malloc(slice_size * 2 * UO_NNUE_L1 * sizeof(float));
+    thread->hidden1_values = malloc(slice_size * UO_NNUE_L2 * sizeof(float));
+    thread->hidden1 = malloc(slice_size * UO_NNUE_L2 * sizeof(float));
+    thread->hidden1_gradients = malloc(slice_size * UO_NNUE_L2 * sizeof(float));
+    thread->hidden2_values = malloc(slice_size * UO_NNUE_L3 * sizeof(float));
+    thread->hidden2 = malloc(slice_size * UO_NNUE_L3 * sizeof(float));
+    thread->hidden2_gradients = malloc(slice_size * UO_NNUE_L3 * sizeof(float));
+    thread->output_gradients = malloc(slice_size * sizeof(float));
+  }
+
+  size_t *indexes = malloc(count * sizeof * indexes);
+  for (size_t i = 0; i < count; ++i)
+  {
+    indexes[i] = i;
+  }
+
+  // Step 3. Resume from checkpoint if it exists or initialize parameters randomly
+  size_t epoch_start = 0;
+  size_t step = 0;
+
+  uo_rand_init(time(NULL));
+
+  if (checkpoint_filepath && uo_tuning_nnue_checkpoint_load(&trainer, checkpoint_filepath, &epoch_start, &step))
+  {
+    printf("Resuming training from checkpoint '%s' after epoch %zu\n", checkpoint_filepath, epoch_start);
+  }
+  else
+  {
+    uo_tuning_nnue_initialize(trainer.parameters);
+  }
+
+  printf("Training network on %zu positions using %zu threads, batch size %zu\n\n", count, thread_count, batch_size);
+  fflush(stdout);
+
+  uo_time time_start;
+  uo_time_now(&time_start);
+
+  // Step 4. Train with Adam on shuffled mini-batches
+  for (size_t epoch = epoch_start + 1; epoch <= epochs; ++epoch)
+  {
+    for (size_t i = count - 1; i > 0; --i)
+    {
+      size_t j = uo_rand_u64() % (i + 1);
+      size_t index = indexes[i];
+      indexes[i] = indexes[j];
+      indexes[j] = index;
+    }
+
+    double loss = 0.0;
+
+    for (size_t offset = 0; offset < count; offset += batch_size)
+    {
+      trainer.indexes = indexes + offset;
+      trainer.batch_count = uo_min(batch_size, count - offset);
+
+      // Step 4.1. Forward and backward pass of the hidden layers for a slice of the mini-batch per thread
+      uo_transpose_ps(trainer.parameters + uo_tuning_nnue_l1_weights, trainer.l1_weights_t, UO_NNUE_L2, 2 * UO_NNUE_L1);
+      uo_transpose_ps(trainer.parameters + uo_tuning_nnue_l2_weights, trainer.l2_weights_t, UO_NNUE_L3, UO_NNUE_L2);
+      uo_tuning_parallel_run(threads, sizeof * threads, thread_count, uo_tuning_nnue_thread_compute_gradient);
+
+      float *dense_gradient = trainer.gradient + uo_tuning_nnue_l1_biases;
+
+      for (size_t t = 0; t < thread_count; ++t)
+      {
+        loss += threads[t].loss;
+        uo_vec_add_ps(dense_gradient, threads[t].gradient, dense_gradient, uo_tuning_nnue_dense_count);
+      }
+
+      // Step 4.2. Feature transformer gradient for a range of columns per thread
+      uo_tuning_parallel_run(threads, sizeof * threads, thread_count, uo_tuning_nnue_thread_accumulate_feature_gradient);
+
+      // Step 4.3. Adam step for a range of parameters per thread
+      ++step;
+      trainer.gradient_scale = 1.0f / trainer.batch_count;
+      trainer.beta1_power = powf(uo_tuning_nnue_beta1, (float)step);
+      trainer.beta2_power = powf(uo_tuning_nnue_beta2, (float)step);
+      uo_tuning_parallel_run(threads, sizeof * threads, thread_count, uo_tuning_nnue_thread_optimize);
+
+      uo_tuning_nnue_clamp(trainer.parameters + uo_tuning_nnue_l1_weights, UO_NNUE_L2 * 2 * UO_NNUE_L1);
+      uo_tuning_nnue_clamp(trainer.parameters + uo_tuning_nnue_l2_weights, UO_NNUE_L3 * UO_NNUE_L2);
+      uo_tuning_nnue_clamp(trainer.parameters + uo_tuning_nnue_out_weights, UO_NNUE_L3);
+    }
+
+    printf("epoch %6zu, loss: %.9f, time: %.1f s\n", epoch, loss / count, uo_time_elapsed_msec(&time_start) / 1000.0);
+    fflush(stdout);
+
+    // Step 4.4. Save checkpoint after each epoch
+    if (checkpoint_filepath && !uo_tuning_nnue_checkpoint_save(&trainer, checkpoint_filepath, epoch, step))
+    {
+      printf("Unable to save checkpoint to file '%s'\n", checkpoint_filepath);
+      fflush(stdout);
+    }
+  }
+
+  // Step 5. Export quantized network
+  uo_nnue *nnue = uo_tuning_nnue_quantize(trainer.parameters);
+  bool success = uo_nnue_save(nnue, nnue_filepath);
+
+  if (success)
+  {
+    double loss = uo_tuning_nnue_quantized_loss(nnue, dataset->records, uo_min(count, uo_tuning_nnue_quantized_loss_count));
+    printf("\nSaved network to file '%s', mean squared error of quantized network: %.9f\n", nnue_filepath, loss);
+  }
+  else
+  {
+    printf("Unable to save network to file '%s'\n", nnue_filepath);
+  }
+
+  fflush(stdout);
+
+  // Step 6. Free resources
+  uo_nnue_free(nnue);
+
+  for (size_t i = 0; i < thread_count; ++i)
+  {
+    uo_tuning_nnue_thread *thread = threads + i;
+    free(thread->inputs);
+    free(thread->input_gradients);
+    free(thread->hidden1_values);
+    free(thread->hidden1);
+    free(thread->hidden1_gradients);
+    free(thread->hidden2_values);
+    free(thread->hidden2);
+    free(thread->hidden2_gradients);
+    free(thread->output_gradients);
+  }
+
+  free(threads);
+  free(indexes);
+  free(trainer.values);
+  free(trainer.samples);
+  free(trainer.l2_weights_t);
+  free(trainer.l1_weights_t);
+  free(trainer.moment2);
+  free(trainer.moment1);
+  free(trainer.gradient);
+  free(trainer.parameters);
+  uo_dataset_close(dataset);
+
+  return success;
 }
@@ -3,12 +3,16 @@
 #include "uo_engine.h"
 #include "uo_evaluation.h"
 #include "uo_tuning.h"
+#include "uo_dataset.h"
+#include "uo_match.h"
+#include "uo_math.h"
 #include "uo_def.h"
 #include "uo_global.h"
 #include "uo_strmap.h"
 
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 
@@ -20,6 +24,7 @@ static int state;
 
 static FILE *log_file;
 static char *ptr;
+static char *line_end;
 
 typedef void (*uo_uci_command)(void);
 
@@ -37,6 +42,7 @@ static char *uo_uci_read_stdin(void)
       fwrite(buf, sizeof * buf, strlen(buf), log_file);
     }
 
+    line_end = buf + strlen(buf);
     ptr = strtok(buf, "\n ");
   }
   else
@@ -121,11 +127,69 @@ static void uo_uci_command__position_fen(void)
 static void uo_uci_command__position_randomize(void)
 {
   ptr = strtok(NULL, " \n");
-  uo_position_randomize(&engine.position, ptr);
+  uo_position_randomize(&engine.position, ptr, NULL);
+}
+
+// Arguments of the previous position command and the resulting position key.
+// These are used to detect when the new position command only appends moves to the previous one.
+static char position_args_prev[sizeof buf];
+static uint64_t position_key_prev;
+
+static bool uo_uci_position_make_moves(void)
+{
+  while (ptr)
+  {
+    if (strlen(ptr) < 4) return false;
+
+    if (uo_position_is_max_depth_reached(&engine.position))
+    {
+      uo_position_reset_root(&engine.position);
+    }
+
+    uo_move move = uo_position_parse_legal_move(&engine.position, ptr);
+
+    // Not a legal move
+    if (!move) return false;
+
+    uo_position_make_move(&engine.position, move, 0, 0);
+    ptr = strtok(NULL, " \n");
+  }
+
+  uo_position_reset_root(&engine.position);
+  return true;
 }
 
 static void uo_uci_command__position(void)
 {
+  uo_time time_start;
+  uo_time_now(&time_start);
+
+  // Rest of the command line, e.g. "startpos moves e2e4 e7e5"
+  char *args = ptr + strlen(ptr);
+  if (args < line_end) ++args;
+
+  size_t args_len = strcspn(args, "\r\n");
+  size_t args_prev_len = strlen(position_args_prev);
+
+  uo_engine_lock_position();
+
+  // If the command is the previous command with some moves appended, let's make only the new moves.
+  // This keeps the move history and history heuristic tables of the current position intact.
+  bool is_continuation = args_prev_len
+    && args_len > args_prev_len
+    && args[args_prev_len] == ' '
+    && strncmp(args, position_args_prev, args_prev_len) == 0
+    && engine.position.key == position_key_prev;
+
+  memcpy(position_args_prev, args, args_len);
+  position_args_prev[args_len] = '\0';
+
+  if (is_continuation)
+  {
+    ptr = strtok(args + args_prev_len, " \n");
+    goto make_moves;
+  }
+
   uo_uci_read_stdin();
 
   static uo_strmap *uci_command_map__position = NULL;
@@ -140,69 +204,42 @@ static void uo_uci_command__position(void)
   }
 
   uo_uci_command command = uo_strmap_get(uci_command_map__position, ptr);
-  if (!command) return;
-
-  uo_engine_lock_position();
-  command();
 
-  if (ptr && strcmp(ptr, "moves") == 0)
+  // Randomized positions cannot be continued incrementally
+  if (!command || command == uo_uci_command__position_randomize)
   {
-    while ((ptr = strtok(NULL, " \n")))
-    {
-      if (strlen(ptr) < 4)
-      {
-        uo_engine_unlock_position();
-        return;
-      }
-
-      uo_move move = uo_position_parse_move(&engine.position, ptr);
-      if (!move)
-      {
-        uo_engine_unlock_position();
-        return;
-      }
-
-      if (uo_position_is_max_depth_reached(&engine.position))
-      {
-        uo_position_reset_root(&engine.position);
-      }
-
-      uo_square square_from = uo_move_square_from(move);
-      uo_square square_to = uo_move_square_to(move);
-      uo_move_type move_type_promo = uo_move_get_type(move) & uo_move_type__promo_Q;
-
-      size_t move_count = uo_position_generate_moves(&engine.position);
-
-      for (size_t i = 0; i < move_count; ++i)
-      {
-        uo_move move = engine.position.movelist.head[i];
-        if (square_from == uo_move_square_from(move)
-          && square_to == uo_move_square_to(move))
-        {
-          uo_move_type move_type = uo_move_get_type(move);
-
-          if ((move_type & uo_move_type__promo) && move_type_promo != (move_type & uo_move_type__promo_Q))
-          {
-            continue;
-          }
+    position_args_prev[0] = '\0';
+  }
 
-          uo_position_make_move(&engine.position, move, 0, 0);
-          goto next_move;
-        }
-      }
+  if (!command)
+  {
+    uo_engine_unlock_position();
+    return;
+  }
 
-      uo_engine_unlock_position();
+  command();
 
-      // Not a legal move
-      return;
+make_moves:
 
-    next_move:;
-    }
+  if (ptr && strcmp(ptr, "moves") == 0)
+  {
+    ptr = strtok(NULL, " \n");
+  }
 
-    uo_position_reset_root(&engine.position);
+  if (!uo_uci_position_make_moves())
+  {
+    position_args_prev[0] = '\0';
   }
 
+  position_key_prev = engine.position.key;
   uo_engine_unlock_position();
+
+  if (engine_options.debug)
+  {
+    uo_engine_lock_stdout();
+    printf("info string position set up in %.3f ms\n", uo_time_elapsed_msec(&time_start));
+    uo_engine_unlock_stdout();
+  }
 }
 
 static void uo_uci_command__isready(void)
@@ -215,6 +252,7 @@ static void uo_uci_command__isready(void)
 static void uo_uci_command__ucinewgame(void)
 {
   uo_ttable_clear(&engine.ttable);
+  uo_eval_hash_clear(&engine.eval_hash);
 }
 
 static void uo_uci_command__setoption(void)
@@ -233,6 +271,7 @@ static void uo_uci_command__setoption(void)
     if (ptr && strcmp(ptr, "Clear Hash") == 0)
     {
       uo_engine_clear_hash();
+      uo_eval_hash_clear(&engine.eval_hash);
     }
 
     // Hash
@@ -242,6 +281,13 @@ static void uo_uci_command__setoption(void)
       if (state == uo_uci_state_idle) uo_engine_reconfigure();
     }
 
+    // EvalHash
+    if (ptr && sscanf(ptr, "EvalHash value %" PRIi64, &spin) == 1 && spin >= 0 && spin <= 33554432)
+    {
+      engine_options.eval_hash_size = spin;
+      if (state == uo_uci_state_idle) uo_engine_reconfigure();
+    }
+
     // Threads
     if (ptr && sscanf(ptr, "Threads value %" PRIi64, &spin) == 1 && spin >= 1 && spin <= 512)
     {
@@ -258,7 +304,7 @@ static void uo_uci_command__setoption(void)
     // EvalFile
     if (ptr && sscanf(ptr, "EvalFile value %255s", engine_options.eval_filename) == 1)
     {
-      // 
+      if (state == uo_uci_state_idle) uo_engine_reconfigure();
     }
 
     // Move Overhead
@@ -319,6 +365,23 @@ static void uo_uci_command__setoption(void)
     {
       engine_options.tb.syzygy.probe_limit = spin;
     }
+
+    // Search parameters
+    char name[0x40];
+    if (ptr && sscanf(ptr, "%63s value %" PRIi64, name, &spin) == 2)
+    {
+      int *parameters = (int *)&engine_options.search_parameters;
+
+      for (size_t i = 0; i < uo_search_parameter_count; ++i)
+      {
+        const uo_search_parameter_option *option = uo_search_parameter_options + i;
+
+        if (strcmp(name, option->name) == 0 && spin >= option->min && spin <= option->max)
+        {
+          parameters[i] = spin;
+        }
+      }
+    }
   }
 }
 
@@ -379,8 +442,21 @@ static void uo_uci_command__go(void)
     {
       if (ptr && strcmp(ptr, "searchmoves") == 0)
       {
-        // TODO
-        uo_uci_read_stdin();
+        size_t i = 0;
+
+        uo_engine_lock_position();
+
+        while (uo_uci_read_stdin() && i < UO_MAX_MOVE_COUNT - 1)
+        {
+          uo_move move = uo_position_parse_legal_move(&engine.position, ptr);
+          if (!move) break;
+          engine.searchmoves[i++] = move;
+        }
+
+        uo_engine_unlock_position();
+
+        engine.searchmoves[i] = 0;
+        engine.search_params.searchmoves = i ? engine.searchmoves : NULL;
         continue;
       }
 
@@ -481,7 +557,7 @@ static void uo_uci_command__go(void)
 
       if (ptr && strcmp(ptr, "ponder") == 0)
       {
-        engine.search_params.ponder = true;
+        uo_atomic_init(&engine.search_params.ponder, 1);
         uo_uci_read_stdin();
         continue;
       }
@@ -668,6 +744,7 @@ static void uo_uci_command_init__uci(void)
   printf("option name Debug Log File type string default\n");
   printf("option name Threads type spin default %zu min 1 max 254\n", engine_options.threads);
   printf("option name Hash type spin default %zu min 1 max 33554432\n", engine_options.hash_size);
+  printf("option name EvalHash type spin default %zu min 0 max 33554432\n", engine_options.eval_hash_size);
   printf("option name Move Overhead type spin default %zu min 1 max 5000\n", engine_options.move_overhead);
   printf("option name Clear Hash type button\n");
   printf("option name Ponder type check default false\n");
@@ -678,7 +755,14 @@ static void uo_uci_command_init__uci(void)
   printf("option name SyzygyProbeDepth type spin default 1 min 1 max 100\n");
   printf("option name Syzygy50MoveRule type check default true\n");
   printf("option name SyzygyProbeLimit type spin default 7 min 0 max 7\n");
-  //printf("option name EvalFile type string default %s\n", engine_options.eval_filename);
+  printf("option name EvalFile type string default %s\n", engine_options.eval_filename);
+
+  for (size_t i = 0; i < uo_search_parameter_count; ++i)
+  {
+    const uo_search_parameter_option *option = uo_search_parameter_options + i;
+    printf("option name %s type spin default %d min %d max %d\n",
+      option->name, ((int *)&engine_options.search_parameters)[i], option->min, option->max);
+  }
 
   state = uo_uci_state_config;
   printf("uciok\n");
@@ -693,14 +777,155 @@ static void uo_uci_command_config__isready(void)
   fflush(stdout);
 }
 
+static void uo_uci_print_evaluation_trace(uo_position *position)
+{
+  uo_evaluation_trace trace;
+  uo_position_evaluate_trace(position, uo_evaluation_parameters_current(), &trace);
+
+  // Contributions are printed from the point of view of white
+  int color = uo_color(position->flags) == uo_white ? 1 : -1;
+
+  printf("Term            |     MG     EG");
+#ifdef UO_EVALUATION_TRACE_CYCLES
+  printf(" | Cycles");
+#endif
+  printf("\n");
+
+  for (size_t i = 0; i < uo_evaluation_term_count; ++i)
+  {
+    printf("%-15s | %6d %6d", uo_evaluation_term_names[i], color * trace.mg[i], color * trace.eg[i]);
+#ifdef UO_EVALUATION_TRACE_CYCLES
+    printf(" | %6" PRIu64, trace.cycles[i]);
+#endif
+    printf("\n");
+  }
+
+  printf("\nPhase: %d%% middle game\n", trace.phase);
+  printf("Evaluation: %d (unscaled %d)\n\n", color * trace.score, color * trace.score_unscaled);
+}
+
+static void uo_uci_print_evaluation_trace_positions_file(const char *filepath)
+{
+  uo_file_mmap *file_mmap = uo_file_mmap_open_read(filepath);
+  if (!file_mmap)
+  {
+    printf("Unable to open file '%s'\n", filepath);
+    return;
+  }
+
+  uo_position position;
+  uo_evaluation_trace trace;
+  double mg[uo_evaluation_term_count] = { 0 };
+  double eg[uo_evaluation_term_count] = { 0 };
+  double cycles[uo_evaluation_term_count] = { 0 };
+  size_t count = 0;
+  size_t count_specialised = 0;
+
+  // Step 1. Sum absolute contributions and cycle counts of each term. Lines start with a fen and rest of the line is ignored.
+  char *line;
+  while ((line = uo_file_mmap_readline(file_mmap)))
+  {
+    if (!uo_position_from_fen(&position, line)) continue;
+
+    uo_material_hash_entry material;
+    uo_position_material_entry_init(&position, &material);
+    if (material.evaluate)
+    {
+      ++count_specialised;
+      continue;
+    }
+
+    uo_position_evaluate_trace(&position, uo_evaluation_parameters_current(), &trace);
+
+    for (size_t i = 0; i < uo_evaluation_term_count; ++i)
+    {
+      mg[i] += abs(trace.mg[i]);
+      eg[i] += abs(trace.eg[i]);
+      cycles[i] += trace.cycles[i];
+    }
+
+    ++count;
+  }
+
+  uo_file_mmap_close(file_mmap);
+
+  if (!count)
+  {
+    printf("No positions to evaluate in file '%s'\n", filepath);
+    return;
+  }
+
+  // Step 2. Print means
+  printf("Positions: %zu (%zu positions with specialised endgame evaluation skipped)\n\n", count, count_specialised);
+  printf("Term            |   |MG|   |EG|");
+#ifdef UO_EVALUATION_TRACE_CYCLES
+  printf(" | Cycles");
+#endif
+  printf("\n");
+
+#ifdef UO_EVALUATION_TRACE_CYCLES
+  double cycles_total = 0;
+#endif
+
+  for (size_t i = 0; i < uo_evaluation_term_count; ++i)
+  {
+    printf("%-15s | %6.1f %6.1f", uo_evaluation_term_names[i], mg[i] / count, eg[i] / count);
+#ifdef UO_EVALUATION_TRACE_CYCLES
+    printf(" | %6.1f", cycles[i] / count);
+    cycles_total += cycles[i];
+#endif
+    printf("\n");
+  }
+
+#ifdef UO_EVALUATION_TRACE_CYCLES
+  printf("\nCycles per evaluation: %.1f\n", cycles_total / count);
+#endif
+  printf("\n");
+}
+
+static void uo_uci_command__eval__trace(void)
+{
+  uo_engine_lock_stdout();
+  uo_engine_lock_position();
+
+  char *line = strtok(NULL, "\n");
+
+  char *arg_positions_file_end;
+  char *arg_positions_file = uo_line_arg_parse(line, "positions_file", 1, &arg_positions_file_end);
+
+  if (arg_positions_file && arg_positions_file_end) *arg_positions_file_end = '\0';
+
+  if (arg_positions_file)
+  {
+    uo_uci_print_evaluation_trace_positions_file(arg_positions_file);
+  }
+  else
+  {
+    uo_uci_print_evaluation_trace(&engine.position);
+  }
+
+  fflush(stdout);
+
+  uo_engine_unlock_position();
+  uo_engine_unlock_stdout();
+}
+
 static void uo_uci_command__eval(void)
 {
+  uo_uci_read_stdin();
+
+  if (ptr && strcmp(ptr, "trace") == 0)
+  {
+    uo_uci_command__eval__trace();
+    return;
+  }
+
   uo_uci_command__d();
 
   uo_engine_lock_stdout();
   uo_engine_lock_position();
 
-  int16_t value = uo_position_evaluate(&engine.position);
+  int16_t value = uo_position_evaluate(&engine.position, NULL, NULL);
 
   uint16_t color = uo_color(engine.position.flags) == uo_white ? 1 : -1;
 
@@ -727,22 +952,106 @@ static void uo_uci_command__gen__evaldata(void)
 
   char *line = strtok(NULL, "\n");
 
-  char *arg_engine_file_end;
-  char *arg_engine_file = uo_line_arg_parse(line, "engine_file", 1, &arg_engine_file_end);
-
   char *arg_dataset_file_end;
   char *arg_dataset_file = uo_line_arg_parse(line, "dataset_file", 1, &arg_dataset_file_end);
 
   char *arg_positions_end;
   char *arg_positions = uo_line_arg_parse(line, "positions", 1, &arg_positions_end);
 
-  if (arg_engine_file && arg_engine_file_end) *arg_engine_file_end = '\0';
+  char *arg_depth_end;
+  char *arg_depth = uo_line_arg_parse(line, "depth", 1, &arg_depth_end);
+
+  char *arg_nodes_end;
+  char *arg_nodes = uo_line_arg_parse(line, "nodes", 1, &arg_nodes_end);
+
   if (arg_dataset_file && arg_dataset_file_end) *arg_dataset_file_end = '\0';
   if (arg_positions && arg_positions_end) *arg_positions_end = '\0';
+  if (arg_depth && arg_depth_end) *arg_depth_end = '\0';
+  if (arg_nodes && arg_nodes_end) *arg_nodes_end = '\0';
 
   size_t positions = arg_positions ? strtoull(arg_positions, NULL, 10) : 0;
+  size_t nodes = arg_nodes ? strtoull(arg_nodes, NULL, 10) : 0;
+
+  // Without limits, positions are labeled by depth 1 search
+  size_t depth = arg_depth ? strtoull(arg_depth, NULL, 10) : nodes ? 0 : 1;
+
+  uo_tuning_generate_dataset(arg_dataset_file, positions, depth, nodes);
+
+  printf("\n");
+  uo_engine_unlock_position();
+  uo_engine_unlock_stdout();
+}
+
+static void uo_uci_command__gen__selfplay(void)
+{
+  uo_engine_lock_stdout();
+  uo_engine_lock_position();
+
+  char *line = strtok(NULL, "\n");
+
+  char *arg_dataset_file_end;
+  char *arg_dataset_file = uo_line_arg_parse(line, "dataset_file", 1, &arg_dataset_file_end);
+
+  char *arg_openings_file_end;
+  char *arg_openings_file = uo_line_arg_parse(line, "openings_file", 1, &arg_openings_file_end);
+
+  char *arg_games_end;
+  char *arg_games = uo_line_arg_parse(line, "games", 1, &arg_games_end);
+
+  char *arg_random_plies_end;
+  char *arg_random_plies = uo_line_arg_parse(line, "random_plies", 1, &arg_random_plies_end);
+
+  char *arg_depth_end;
+  char *arg_depth = uo_line_arg_parse(line, "depth", 1, &arg_depth_end);
+
+  char *arg_nodes_end;
+  char *arg_nodes = uo_line_arg_parse(line, "nodes", 1, &arg_nodes_end);
+
+  if (arg_dataset_file && arg_dataset_file_end) *arg_dataset_file_end = '\0';
+  if (arg_openings_file && arg_openings_file_end) *arg_openings_file_end = '\0';
+  if (arg_games && arg_games_end) *arg_games_end = '\0';
+  if (arg_random_plies && arg_random_plies_end) *arg_random_plies_end = '\0';
+  if (arg_depth && arg_depth_end) *arg_depth_end = '\0';
+  if (arg_nodes && arg_nodes_end) *arg_nodes_end = '\0';
 
-  uo_tuning_generate_dataset(arg_dataset_file, arg_engine_file, NULL, positions);
+  size_t games = arg_games ? strtoull(arg_games, NULL, 10) : 0;
+  size_t random_plies = arg_random_plies ? strtoull(arg_random_plies, NULL, 10) : 8;
+  size_t depth = arg_depth ? strtoull(arg_depth, NULL, 10) : 0;
+
+  // Without limits, moves are searched with a fixed node count
+  size_t nodes = arg_nodes ? strtoull(arg_nodes, NULL, 10) : depth ? 0 : 5000;
+
+  uo_tuning_generate_selfplay(arg_dataset_file, arg_openings_file, games, random_plies, depth, nodes);
+
+  printf("\n");
+  uo_engine_unlock_position();
+  uo_engine_unlock_stdout();
+}
+
+static void uo_uci_command__gen__preprocess(void)
+{
+  uo_engine_lock_stdout();
+  uo_engine_lock_position();
+
+  char *line = strtok(NULL, "\n");
+
+  char *arg_input_file_end;
+  char *arg_input_file = uo_line_arg_parse(line, "input_file", 1, &arg_input_file_end);
+
+  char *arg_output_file_end;
+  char *arg_output_file = uo_line_arg_parse(line, "output_file", 1, &arg_output_file_end);
+
+  char *arg_memory_end;
+  char *arg_memory = uo_line_arg_parse(line, "memory", 1, &arg_memory_end);
+
+  if (arg_input_file && arg_input_file_end) *arg_input_file_end = '\0';
+  if (arg_output_file && arg_output_file_end) *arg_output_file_end = '\0';
+  if (arg_memory && arg_memory_end) *arg_memory_end = '\0';
+
+  // Memory limit in megabytes
+  size_t memory = arg_memory ? strtoull(arg_memory, NULL, 10) : 1024;
+
+  uo_tuning_preprocess_dataset(arg_input_file, arg_output_file, memory);
 
   printf("\n");
   uo_engine_unlock_position();
@@ -759,6 +1068,8 @@ static void uo_uci_command__gen(void)
   {
     uci_command_map__gen = uo_strmap_create();
     uo_strmap_add(uci_command_map__gen, "evaldata", uo_uci_command__gen__evaldata);
+    uo_strmap_add(uci_command_map__gen, "selfplay", uo_uci_command__gen__selfplay);
+    uo_strmap_add(uci_command_map__gen, "preprocess", uo_uci_command__gen__preprocess);
 
   }
 
@@ -766,6 +1077,119 @@ static void uo_uci_command__gen(void)
   if (command) command();
 }
 
+static void uo_uci_command__convert(void)
+{
+  uo_engine_lock_stdout();
+
+  char *line = strtok(NULL, "\n");
+
+  char *arg_input_file_end;
+  char *arg_input_file = uo_line_arg_parse(line, "input_file", 1, &arg_input_file_end);
+
+  char *arg_output_file_end;
+  char *arg_output_file = uo_line_arg_parse(line, "output_file", 1, &arg_output_file_end);
+
+  if (arg_input_file && arg_input_file_end) *arg_input_file_end = '\0';
+  if (arg_output_file && arg_output_file_end) *arg_output_file_end = '\0';
+
+  if (arg_input_file && arg_output_file)
+  {
+    uo_time time_start;
+    uo_time_now(&time_start);
+
+    size_t count = uo_dataset_convert(arg_input_file, arg_output_file);
+
+    printf("positions converted: %zu, time: %.1f s\n", count, uo_time_elapsed_msec(&time_start) / 1000.0);
+  }
+
+  uo_engine_unlock_stdout();
+}
+
+static void uo_uci_command__match(void)
+{
+  uo_engine_lock_stdout();
+
+  char *line = strtok(NULL, "\n");
+
+  char *arg_engine1_end;
+  char *arg_engine1 = uo_line_arg_parse(line, "engine1", 1, &arg_engine1_end);
+
+  char *arg_engine2_end;
+  char *arg_engine2 = uo_line_arg_parse(line, "engine2", 1, &arg_engine2_end);
+
+  char *arg_openings_file_end;
+  char *arg_openings_file = uo_line_arg_parse(line, "openings_file", 1, &arg_openings_file_end);
+
+  char *arg_games_end;
+  char *arg_games = uo_line_arg_parse(line, "games", 1, &arg_games_end);
+
+  char *arg_concurrency_end;
+  char *arg_concurrency = uo_line_arg_parse(line, "concurrency", 1, &arg_concurrency_end);
+
+  char *arg_random_plies_end;
+  char *arg_random_plies = uo_line_arg_parse(line, "random_plies", 1, &arg_random_plies_end);
+
+  char *arg_tc_end;
+  char *arg_tc = uo_line_arg_parse(line, "tc", 1, &arg_tc_end);
+
+  char *arg_timemargin_end;
+  char *arg_timemargin = uo_line_arg_parse(line, "timemargin", 1, &arg_timemargin_end);
+
+  char *arg_elo0_end;
+  char *arg_elo0 = uo_line_arg_parse(line, "elo0", 1, &arg_elo0_end);
+
+  char *arg_elo1_end;
+  char *arg_elo1 = uo_line_arg_parse(line, "elo1", 1, &arg_elo1_end);
+
+  char *arg_alpha_end;
+  char *arg_alpha = uo_line_arg_parse(line, "alpha", 1, &arg_alpha_end);
+
+  char *arg_beta_end;
+  char *arg_beta = uo_line_arg_parse(line, "beta", 1, &arg_beta_end);
+
+  if (arg_engine1 && arg_engine1_end) *arg_engine1_end = '\0';
+  if (arg_engine2 && arg_engine2_end) *arg_engine2_end = '\0';
+  if (arg_openings_file && arg_openings_file_end) *arg_openings_file_end = '\0';
+  if (arg_games && arg_games_end) *arg_games_end = '\0';
+  if (arg_concurrency && arg_concurrency_end) *arg_concurrency_end = '\0';
+  if (arg_random_plies && arg_random_plies_end) *arg_random_plies_end = '\0';
+  if (arg_tc && arg_tc_end) *arg_tc_end = '\0';
+  if (arg_timemargin && arg_timemargin_end) *arg_timemargin_end = '\0';
+  if (arg_elo0 && arg_elo0_end) *arg_elo0_end = '\0';
+  if (arg_elo1 && arg_elo1_end) *arg_elo1_end = '\0';
+  if (arg_alpha && arg_alpha_end) *arg_alpha_end = '\0';
+  if (arg_beta && arg_beta_end) *arg_beta_end = '\0';
+
+  // Time control in seconds as base time and increment, e.g. 10+0.1
+  double time_sec = 10.0;
+  double inc_sec = 0.1;
+  if (arg_tc) sscanf(arg_tc, "%lf+%lf", &time_sec, &inc_sec);
+
+  // Without engines, the match is played against this engine
+  uo_match_options options = {
+    .engine_cmdlines = {
+      arg_engine1 ? arg_engine1 : engine.process_info.argv[0],
+      arg_engine2 ? arg_engine2 : engine.process_info.argv[0]
+    },
+    .openings_filepath = arg_openings_file,
+    .game_count = arg_games ? strtoull(arg_games, NULL, 10) : 1000,
+    .concurrency = arg_concurrency ? strtoull(arg_concurrency, NULL, 10) : engine_options.threads,
+    .random_plies = arg_random_plies ? strtoull(arg_random_plies, NULL, 10) : arg_openings_file ? 0 : 8,
+    .time_msec = time_sec * 1000.0,
+    .inc_msec = inc_sec * 1000.0,
+    .time_margin_msec = arg_timemargin ? strtod(arg_timemargin, NULL) : 100.0,
+    .elo0 = arg_elo0 ? strtod(arg_elo0, NULL) : 0.0,
+    .elo1 = arg_elo1 ? strtod(arg_elo1, NULL) : 5.0,
+    .alpha = arg_alpha ? strtod(arg_alpha, NULL) : 0.05,
+    .beta = arg_beta ? strtod(arg_beta, NULL) : 0.05
+  };
+
+  uo_match_run(&options);
+
+  printf("\n");
+  uo_engine_unlock_stdout();
+}
+
 static void uo_uci_command__tune__eval(void)
 {
   uo_engine_lock_stdout();
@@ -776,14 +1200,102 @@ static void uo_uci_command__tune__eval(void)
   char *arg_dataset_file_end;
   char *arg_dataset_file = uo_line_arg_parse(line, "dataset_file", 1, &arg_dataset_file_end);
 
+  char *arg_parameters_file_end;
+  char *arg_parameters_file = uo_line_arg_parse(line, "parameters_file", 1, &arg_parameters_file_end);
+
+  char *arg_epochs_end;
+  char *arg_epochs = uo_line_arg_parse(line, "epochs", 1, &arg_epochs_end);
+
+  if (arg_dataset_file && arg_dataset_file_end) *arg_dataset_file_end = '\0';
+  if (arg_parameters_file && arg_parameters_file_end) *arg_parameters_file_end = '\0';
+  if (arg_epochs && arg_epochs_end) *arg_epochs_end = '\0';
+
+  size_t epochs = arg_epochs ? strtoull(arg_epochs, NULL, 10) : 1000;
+
+  uo_tuning_train_evaluation_parameters(arg_dataset_file, arg_parameters_file, epochs);
+
+  uo_engine_unlock_position();
+  uo_engine_unlock_stdout();
+}
+
+static void uo_uci_command__tune__nnue(void)
+{
+  uo_engine_lock_stdout();
+  uo_engine_lock_position();
+
+  char *line = strtok(NULL, "\n");
+
+  char *arg_dataset_file_end;
+  char *arg_dataset_file = uo_line_arg_parse(line, "dataset_file", 1, &arg_dataset_file_end);
+
+  char *arg_nnue_file_end;
+  char *arg_nnue_file = uo_line_arg_parse(line, "nnue_file", 1, &arg_nnue_file_end);
+
+  char *arg_checkpoint_file_end;
+  char *arg_checkpoint_file = uo_line_arg_parse(line, "checkpoint_file", 1, &arg_checkpoint_file_end);
+
+  char *arg_epochs_end;
+  char *arg_epochs = uo_line_arg_parse(line, "epochs", 1, &arg_epochs_end);
+
+  char *arg_batch_size_end;
+  char *arg_batch_size = uo_line_arg_parse(line, "batch_size", 1, &arg_batch_size_end);
+
   if (arg_dataset_file && arg_dataset_file_end) *arg_dataset_file_end = '\0';
+  if (arg_nnue_file && arg_nnue_file_end) *arg_nnue_file_end = '\0';
+  if (arg_checkpoint_file && arg_checkpoint_file_end) *arg_checkpoint_file_end = '\0';
+  if (arg_epochs && arg_epochs_end) *arg_epochs_end = '\0';
+  if (arg_batch_size && arg_batch_size_end) *arg_batch_size_end = '\0';
 
-  uo_tuning_train_evaluation_parameters(arg_dataset_file);
+  size_t epochs = arg_epochs ? strtoull(arg_epochs, NULL, 10) : 10;
+  size_t batch_size = arg_batch_size ? strtoull(arg_batch_size, NULL, 10) : 16384;
+
+  uo_tuning_train_nnue(arg_dataset_file, arg_nnue_file, arg_checkpoint_file, epochs, batch_size);
 
   uo_engine_unlock_position();
   uo_engine_unlock_stdout();
 }
 
+static void uo_uci_command__tune__spsa(void)
+{
+  uo_engine_lock_stdout();
+  uo_engine_lock_position();
+
+  char *line = strtok(NULL, "\n");
+
+  char *arg_openings_file_end;
+  char *arg_openings_file = uo_line_arg_parse(line, "openings_file", 1, &arg_openings_file_end);
+
+  char *arg_games_end;
+  char *arg_games = uo_line_arg_parse(line, "games", 1, &arg_games_end);
+
+  char *arg_random_plies_end;
+  char *arg_random_plies = uo_line_arg_parse(line, "random_plies", 1, &arg_random_plies_end);
+
+  char *arg_depth_end;
+  char *arg_depth = uo_line_arg_parse(line, "depth", 1, &arg_depth_end);
+
+  char *arg_nodes_end;
+  char *arg_nodes = uo_line_arg_parse(line, "nodes", 1, &arg_nodes_end);
+
+  if (arg_openings_file && arg_openings_file_end) *arg_openings_file_end = '\0';
+  if (arg_games && arg_games_end) *arg_games_end = '\0';
+  if (arg_random_plies && arg_random_plies_end) *arg_random_plies_end = '\0';
+  if (arg_depth && arg_depth_end) *arg_depth_end = '\0';
+  if (arg_nodes && arg_nodes_end) *arg_nodes_end = '\0';
+
+  size_t games = arg_games ? strtoull(arg_games, NULL, 10) : 10000;
+  size_t random_plies = arg_random_plies ? strtoull(arg_random_plies, NULL, 10) : 8;
+  size_t depth = arg_depth ? strtoull(arg_depth, NULL, 10) : 0;
+
+  // Without limits, moves are searched with a fixed node count
+  size_t nodes = arg_nodes ? strtoull(arg_nodes, NULL, 10) : depth ? 0 : 5000;
+
+  uo_tuning_tune_search_parameters(arg_openings_file, games, random_plies, depth, nodes);
+
+  printf("\n");
+  uo_engine_unlock_position();
+  uo_engine_unlock_stdout();
+}
 
 static void uo_uci_command__tune(void)
 {
@@ -795,6 +1307,8 @@ static void uo_uci_command__tune(void)
   {
     uci_command_map__tune = uo_strmap_create();
     uo_strmap_add(uci_command_map__tune, "eval", uo_uci_command__tune__eval);
+    uo_strmap_add(uci_command_map__tune, "nnue", uo_uci_command__tune__nnue);
+    uo_strmap_add(uci_command_map__tune, "spsa", uo_uci_command__tune__spsa);
 
   }
 
@@ -802,6 +1316,29 @@ static void uo_uci_command__tune(void)
   if (command) command();
 }
 
+static void uo_uci_command__bench__matmul(void)
+{
+  uo_engine_lock_stdout();
+  uo_benchmark_matmul();
+  uo_engine_unlock_stdout();
+}
+
+static void uo_uci_command__bench(void)
+{
+  uo_uci_read_stdin();
+
+  static uo_strmap *uci_command_map__bench = NULL;
+
+  if (!uci_command_map__bench)
+  {
+    uci_command_map__bench = uo_strmap_create();
+    uo_strmap_add(uci_command_map__bench, "matmul", uo_uci_command__bench__matmul);
+  }
+
+  uo_uci_command command = uo_strmap_get(uci_command_map__bench, ptr);
+  if (command) command();
+}
+
 static void uo_uci_command__stop(void)
 {
   uo_engine_stop_search();
@@ -809,6 +1346,14 @@ static void uo_uci_command__stop(void)
   return;
 }
 
+static void uo_uci_command__ponderhit(void)
+{
+  // Opponent played the expected move. Continue the search as a normal search with time measured from now on.
+  // Start time is written before the flag is cleared, so that search threads see the new start time once they see the flag.
+  uo_time_now(&engine.search_params.time_start);
+  uo_atomic_store(&engine.search_params.ponder, 0);
+}
+
 
 int uo_uci_run()
 {
@@ -844,10 +1389,14 @@ int uo_uci_run()
   uo_strmap_add(uci_command_map_idle, "debug", uo_uci_command__debug);
   uo_strmap_add(uci_command_map_idle, "gen", uo_uci_command__gen);
   uo_strmap_add(uci_command_map_idle, "tune", uo_uci_command__tune);
+  uo_strmap_add(uci_command_map_idle, "bench", uo_uci_command__bench);
+  uo_strmap_add(uci_command_map_idle, "convert", uo_uci_command__convert);
+  uo_strmap_add(uci_command_map_idle, "match", uo_uci_command__match);
 
   uo_strmap *uci_command_map_running = uci_command_map_by_state[uo_uci_state_running] = uo_strmap_create();
   uo_strmap_add(uci_command_map_running, "quit", uo_uci_command__quit);
   uo_strmap_add(uci_command_map_running, "stop", uo_uci_command__stop);
+  uo_strmap_add(uci_command_map_running, "ponderhit", uo_uci_command__ponderhit);
   uo_strmap_add(uci_command_map_running, "d", uo_uci_command__d);
   uo_strmap_add(uci_command_map_running, "isready", uo_uci_command__isready);
   uo_strmap_add(uci_command_map_running, "debug", uo_uci_command__debug);
@@ -1,18 +1,84 @@
 #include "uo_zobrist.h"
+#include "uo_bitboard.h"
 #include "uo_piece.h"
 #include "uo_util.h"
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <assert.h>
 
 uint64_t uo_zobrist[0xEull << 6];
 uint64_t *uo_zobrist_castling;
 uint64_t *uo_zobrist_enpassant_file;
 uint64_t uo_zobrist_side_to_move;
 
+uint64_t uo_zobrist_cuckoo_keys[uo_zobrist_cuckoo_size];
+uo_move uo_zobrist_cuckoo_moves[uo_zobrist_cuckoo_size];
+
 static bool init;
 static uint64_t rand_seed = 7109;
 
+static inline uo_bitboard uo_zobrist_cuckoo_piece_attacks(uo_piece piece, uo_square square)
+{
+  switch (piece & ~1)
+  {
+    case uo_piece__N: return uo_bitboard_attacks_N(square);
+    case uo_piece__B: return uo_bitboard_attacks_B(square, 0);
+    case uo_piece__R: return uo_bitboard_attacks_R(square, 0);
+    case uo_piece__Q: return uo_bitboard_attacks_Q(square, 0);
+    case uo_piece__K: return uo_bitboard_attacks_K(square);
+    default: return 0;
+  }
+}
+
+static void uo_zobrist_init_cuckoo()
+{
+  // Piece attacks are needed for enumerating the reversible moves
+  uo_bitboard_init();
+
+  size_t count = 0;
+
+  // Pawn moves are not reversible
+  for (uo_piece piece = uo_piece__N; piece <= uo_piece__k; ++piece)
+  {
+    for (uo_square square_from = 0; square_from < 64; ++square_from)
+    {
+      uo_bitboard attacks = uo_zobrist_cuckoo_piece_attacks(piece, square_from);
+
+      for (uo_square square_to = square_from + 1; square_to < 64; ++square_to)
+      {
+        if (!(attacks & uo_square_bitboard(square_to))) continue;
+
+        uint64_t key = uo_zobkey(piece, square_from) ^ uo_zobkey(piece, square_to) ^ uo_zobrist_side_to_move;
+        uo_move move = uo_move_encode(square_from, square_to, uo_move_type__quiet);
+        size_t i = uo_zobrist_cuckoo_hash1(key);
+        ++count;
+
+        // Insert the key and push out the existing entry to its alternative slot until an empty slot is found
+        while (true)
+        {
+          uint64_t key_temp = uo_zobrist_cuckoo_keys[i];
+          uo_zobrist_cuckoo_keys[i] = key;
+          key = key_temp;
+
+          uo_move move_temp = uo_zobrist_cuckoo_moves[i];
+          uo_zobrist_cuckoo_moves[i] = move;
+          move = move_temp;
+
+          if (!move) break;
+
+          i = i == uo_zobrist_cuckoo_hash1(key)
+            ? uo_zobrist_cuckoo_hash2(key)
+            : uo_zobrist_cuckoo_hash1(key);
+        }
+      }
+    }
+  }
+
+  // Number of reversible moves on an empty board for both colors
+  assert(count == 3668);
+}
+
 void uo_zobrist_init()
 {
   if (init)
@@ -29,5 +95,7 @@ void uo_zobrist_init()
   uo_zobrist_side_to_move = uo_rand_u64();
   uo_zobrist_enpassant_file = uo_zobrist;
   uo_zobrist_castling = uo_zobrist + 56;
+
+  uo_zobrist_init_cuckoo();
 }
 